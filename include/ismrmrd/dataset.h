@@ -13,7 +13,14 @@
 #include <hdf5.h>
 
 #ifdef __cplusplus
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 namespace ISMRMRD {
 extern "C" {
 #endif
@@ -27,12 +34,203 @@ extern "C" {
  *   Acquisitions are stored in the variable groupname/data.
  *
  */
+struct ISMRMRD_DatasetCache;
+struct ISMRMRD_DatasetBackend;
+
 typedef struct ISMRMRD_Dataset {
     char *filename;
     char *groupname;
     hid_t fileid;
+    struct ISMRMRD_DatasetCache *cache; /**< Open HDF5 handles and datatypes, private to the library */
+    const struct ISMRMRD_DatasetBackend *backend; /**< Storage backend, NULL for HDF5 */
+    void *backend_data;                 /**< State of the storage backend */
 } ISMRMRD_Dataset;
 
+/**
+ *  Storage backend of a dataset.
+ *
+ *  The dataset functions for the header, acquisitions, waveforms, images and
+ *  arrays, and flushing, are forwarded to the backend. The other dataset
+ *  functions are specific to HDF5 and fail for other backends, except that
+ *  storage policies are ignored.
+ */
+typedef struct ISMRMRD_DatasetBackend {
+    const char *name;
+    int (*open)(struct ISMRMRD_Dataset *dset, const bool create_if_needed);
+    int (*close)(struct ISMRMRD_Dataset *dset);
+    int (*flush)(struct ISMRMRD_Dataset *dset); /**< NULL if nothing is buffered */
+    int (*write_header)(const struct ISMRMRD_Dataset *dset, const char *xmlstring);
+    char * (*read_header)(const struct ISMRMRD_Dataset *dset);
+    int (*append_acquisitions)(const struct ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, size_t n);
+    int (*read_acquisitions)(const struct ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                             ISMRMRD_Acquisition *acqs);
+    uint32_t (*get_number_of_acquisitions)(const struct ISMRMRD_Dataset *dset);
+    int (*append_waveform)(const struct ISMRMRD_Dataset *dset, const ISMRMRD_Waveform *wav);
+    int (*read_waveform)(const struct ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Waveform *wav);
+    uint32_t (*get_number_of_waveforms)(const struct ISMRMRD_Dataset *dset);
+    int (*append_images)(const struct ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *ims, size_t n);
+    int (*read_images)(const struct ISMRMRD_Dataset *dset, const char *varname, const uint32_t start,
+                       const uint32_t count, const uint32_t stride, ISMRMRD_Image *ims);
+    uint32_t (*get_number_of_images)(const struct ISMRMRD_Dataset *dset, const char *varname);
+    int (*append_array)(const struct ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_NDArray *arr);
+    int (*read_array)(const struct ISMRMRD_Dataset *dset, const char *varname, const uint32_t index,
+                      ISMRMRD_NDArray *arr);
+    uint32_t (*get_number_of_arrays)(const struct ISMRMRD_Dataset *dset, const char *varname);
+} ISMRMRD_DatasetBackend;
+
+/** The HDF5 file backend, the default */
+EXPORTISMRMRD const ISMRMRD_DatasetBackend *ismrmrd_hdf5_backend(void);
+
+/**
+ *  The in-memory backend.
+ *
+ *  Datasets are kept in the process, keyed by filename and groupname, until
+ *  ismrmrd_remove_memory_dataset. Items are stored as copies of the
+ *  structures without serialization. Every call takes a process wide lock.
+ */
+EXPORTISMRMRD const ISMRMRD_DatasetBackend *ismrmrd_memory_backend(void);
+
+/**
+ *  The append-only log backend.
+ *
+ *  Every group of a file shares one log of length-prefixed records, which
+ *  are buffered and written sequentially. An index of the records is written
+ *  at the end of the file when the last dataset of the file is closed, and
+ *  is rewritten by the next writer. Files without a valid index, e.g. after a
+ *  crash, are scanned instead, up to the last complete record. Records are
+ *  read from a memory mapping of the file. Records are stored in the byte
+ *  order of the writer. Not available on Windows.
+ */
+EXPORTISMRMRD const ISMRMRD_DatasetBackend *ismrmrd_log_backend(void);
+
+/**
+ *  Discards every group of the in-memory file filename.
+ *  No dataset of that file may be open.
+ */
+EXPORTISMRMRD int ismrmrd_remove_memory_dataset(const char *filename);
+
+/**
+ * Allocation time of the file space of a dataset variable
+ */
+enum ISMRMRD_StorageAllocTime {
+    ISMRMRD_ALLOC_TIME_DEFAULT = 0, /**< HDF5 default, incremental for chunked storage */
+    ISMRMRD_ALLOC_TIME_EARLY,       /**< allocate when the variable is created */
+    ISMRMRD_ALLOC_TIME_INCREMENTAL, /**< allocate chunks as they are written */
+    ISMRMRD_ALLOC_TIME_LATE         /**< allocate when the variable is first written */
+};
+
+/** Maximum number of client data values of an additional HDF5 filter */
+#define ISMRMRD_FILTER_MAX_VALUES 8
+
+/**
+ * Storage policy of a dataset variable.
+ *
+ * Chunking, compression and allocation time only take effect when the variable
+ * is created, the chunk cache whenever the variable is opened.
+ * Zero means automatic, HDF5 default or disabled for every field.
+ *
+ * Filters are applied to the chunks, so they compress images, arrays and the
+ * headers of acquisitions and waveforms. They do not compress raw data: the
+ * samples and trajectories of acquisitions and the samples of waveforms are
+ * variable length, which HDF5 keeps in its global heap outside the chunks, so
+ * they are always stored uncompressed whatever the policy.
+ * Reading filtered data needs no configuration.
+ *
+ * Contiguous variables are created unchunked and unfiltered with room for a
+ * fixed number of elements, appending beyond that fails. Their arrays and
+ * image data can be memory mapped instead of read. The number of elements
+ * used is kept in the ismrmrd_element_count attribute of the HDF5 dataset, whose
+ * extent stays at the full capacity: other HDF5 readers see all
+ * contiguous_elements, the unused ones with unspecified contents.
+ */
+typedef struct ISMRMRD_StoragePolicy {
+    uint32_t chunk_elements;  /**< Elements per chunk along the append dimension, 0 for one element per chunk */
+    size_t chunk_cache_bytes; /**< Size of the raw data chunk cache, 0 for the HDF5 default */
+    size_t chunk_cache_slots; /**< Number of chunk cache hash slots, 0 for the HDF5 default */
+    uint16_t alloc_time;      /**< One of ISMRMRD_StorageAllocTime */
+    uint16_t shuffle;         /**< Non-zero applies the byte shuffle filter before compression */
+    uint16_t deflate_level;   /**< Deflate (gzip) compression level 1-9, 0 disables it */
+    uint32_t filter_id;       /**< Registered id of an HDF5 filter plugin used instead of deflate, 0 for none */
+    uint32_t filter_nvalues;  /**< Number of client data values passed to the additional filter */
+    uint32_t filter_values[ISMRMRD_FILTER_MAX_VALUES]; /**< Client data values of the additional filter */
+    uint32_t contiguous_elements; /**< Non-zero stores the variable contiguously with room for this many elements, see ismrmrd_map_array */
+} ISMRMRD_StoragePolicy;
+
+/** Initialize a storage policy to the automatic defaults */
+EXPORTISMRMRD int ismrmrd_init_storage_policy(ISMRMRD_StoragePolicy *policy);
+
+/** Target size in bytes of the chunks suggested by ismrmrd_suggested_chunk_elements */
+#define ISMRMRD_SUGGESTED_CHUNK_BYTES 65536
+
+/**
+ * Returns a number of elements per chunk for elements of element_size bytes
+ * so that chunks are about ISMRMRD_SUGGESTED_CHUNK_BYTES large.
+ *
+ * Larger chunks speed up appending and sequential reads of small elements but
+ * slow down random reads, which have to read a whole chunk per element. They
+ * are therefore only used when a storage policy asks for them, without one
+ * every chunk holds a single element as in earlier versions.
+ */
+EXPORTISMRMRD uint32_t ismrmrd_suggested_chunk_elements(size_t element_size);
+
+/**
+ * Entry of the acquisition index, one per acquisition.
+ *
+ * The index is stored in groupname/ismrmrd_index and is sorted by slice, contrast,
+ * repetition, phase, set, average, segment, kspace_encode_step_2,
+ * kspace_encode_step_1 and finally the acquisition number.
+ */
+typedef struct ISMRMRD_AcquisitionIndexEntry {
+    uint64_t flags;                /**< Acquisition flags */
+    uint32_t acquisition;          /**< Index of the acquisition in the dataset */
+    uint16_t slice;
+    uint16_t contrast;
+    uint16_t repetition;
+    uint16_t phase;
+    uint16_t set;
+    uint16_t average;
+    uint16_t segment;
+    uint16_t kspace_encode_step_2;
+    uint16_t kspace_encode_step_1;
+} ISMRMRD_AcquisitionIndexEntry;
+
+/** Matches any value of an encoding counter in an ISMRMRD_AcquisitionIndexQuery */
+#define ISMRMRD_INDEX_ANY -1
+
+/**
+ * Selection of acquisitions by encoding counters and flags.
+ *
+ * Counters are either a value or ISMRMRD_INDEX_ANY.
+ * Flags are bit masks as built by ismrmrd_set_flag.
+ */
+typedef struct ISMRMRD_AcquisitionIndexQuery {
+    int32_t slice;
+    int32_t contrast;
+    int32_t repetition;
+    int32_t phase;
+    int32_t set;
+    int32_t average;
+    int32_t segment;
+    int32_t kspace_encode_step_2;
+    int32_t kspace_encode_step_1;
+    uint64_t flags_set;   /**< Flags which must all be set */
+    uint64_t flags_clear; /**< Flags which must all be clear */
+} ISMRMRD_AcquisitionIndexQuery;
+
+/** Initialize a query to match every acquisition */
+EXPORTISMRMRD int ismrmrd_init_acquisition_index_query(ISMRMRD_AcquisitionIndexQuery *query);
+
+/**
+ *  Serializes calls into HDF5 when the HDF5 library is not thread safe.
+ *
+ *  The dataset functions hold this lock while they call HDF5, so datasets
+ *  may be used from several threads either way. Code that calls HDF5 itself
+ *  while another thread uses a dataset takes it around those calls. The lock
+ *  is recursive, and does nothing when HDF5 is thread safe.
+ */
+EXPORTISMRMRD void ismrmrd_lock_hdf5(void);
+EXPORTISMRMRD void ismrmrd_unlock_hdf5(void);
+
 /**
  * Initializes an ISMRMRD dataset structure
  *
@@ -45,12 +243,114 @@ EXPORTISMRMRD int ismrmrd_init_dataset(ISMRMRD_Dataset *dset, const char *filena
  */
 EXPORTISMRMRD int ismrmrd_open_dataset(ISMRMRD_Dataset *dset, const bool create_if_neded);
 
+/**
+ * HDF5 file driver of a dataset
+ */
+enum ISMRMRD_FileDriver {
+    ISMRMRD_DRIVER_DEFAULT = 0, /**< HDF5 default, sec2 */
+    ISMRMRD_DRIVER_SEC2,        /**< POSIX unbuffered I/O */
+    ISMRMRD_DRIVER_STDIO,       /**< C stdio buffered I/O */
+    ISMRMRD_DRIVER_CORE,        /**< the whole file in memory */
+    ISMRMRD_DRIVER_DIRECT       /**< O_DIRECT, bypassing the page cache, if HDF5 was built with it */
+};
+
+/**
+ * File format version bound, see H5Pset_libver_bounds
+ */
+enum ISMRMRD_LibverBound {
+    ISMRMRD_LIBVER_DEFAULT = 0, /**< HDF5 default, earliest low and latest high bound */
+    ISMRMRD_LIBVER_EARLIEST,
+    ISMRMRD_LIBVER_V18,
+    ISMRMRD_LIBVER_V110,
+    ISMRMRD_LIBVER_LATEST
+};
+
+/**
+ * Options of how a dataset file is opened.
+ *
+ * Zero means the HDF5 default or disabled for every size. The file space
+ * strategy only takes effect when the file is created; the page buffer needs
+ * a file created with paged file space. Other backends only use
+ * create_if_needed and read_only.
+ */
+typedef struct ISMRMRD_DatasetOptions {
+    bool create_if_needed;         /**< Create the file if it cannot be opened read-write */
+    bool read_only;                /**< Open the file read-only, never creating it */
+    uint16_t driver;               /**< One of ISMRMRD_FileDriver */
+    size_t core_increment;         /**< Growth of the memory image of the core driver, 0 for 1 MiB */
+    bool core_backing_store;       /**< Write the memory image of the core driver to the file when closed */
+    hsize_t alignment;             /**< Alignment of objects in the file, 0 disables it */
+    hsize_t alignment_threshold;   /**< Only objects at least this large are aligned */
+    size_t metadata_cache_bytes;   /**< Initial size of the metadata cache */
+    hsize_t file_space_page_size;  /**< Non-zero creates files with paged file space of this page size */
+    size_t page_buffer_bytes;      /**< Size of the page buffer */
+    uint16_t libver_low;           /**< One of ISMRMRD_LibverBound */
+    uint16_t libver_high;          /**< One of ISMRMRD_LibverBound */
+    ISMRMRD_StoragePolicy storage; /**< Storage policy of the whole group, as ismrmrd_set_storage_policy with an empty varname */
+} ISMRMRD_DatasetOptions;
+
+/** Initialize options to the behaviour of ismrmrd_open_dataset(dset, true) */
+EXPORTISMRMRD int ismrmrd_init_dataset_options(ISMRMRD_DatasetOptions *options);
+
+/**
+ * Opens an ISMRMRD dataset with options.
+ */
+EXPORTISMRMRD int ismrmrd_open_dataset_ex(ISMRMRD_Dataset *dset, const ISMRMRD_DatasetOptions *options);
+
+/**
+ * Selects the storage backend of a dataset. Call after ismrmrd_init_dataset
+ * and before opening it. NULL selects HDF5.
+ */
+EXPORTISMRMRD int ismrmrd_set_dataset_backend(ISMRMRD_Dataset *dset, const ISMRMRD_DatasetBackend *backend);
+
 /**
  * Closes all references to the underlying HDF5 file.
  *
+ * This also releases the HDF5 dataset handles and datatypes which are
+ * kept open for the lifetime of the open dataset.
  */
 EXPORTISMRMRD int ismrmrd_close_dataset(ISMRMRD_Dataset *dset);
 
+/**
+ * Flushes the dataset to disk.
+ *
+ * A pending update of the acquisition index is written first, so that
+ * everything appended so far is on disk when this returns.
+ */
+EXPORTISMRMRD int ismrmrd_flush_dataset(ISMRMRD_Dataset *dset);
+
+/**
+ * Opens the dataset for single-writer/multiple-reader (SWMR) access.
+ *
+ * Both sides use the latest HDF5 file format. A writer opens the file
+ * read/write, creating it if needed, and must call ismrmrd_start_swmr_write
+ * once the header and any other variables have been written, as no objects
+ * can be created after that. A reader opens the file read-only and sees the
+ * acquisitions and waveforms appended by the writer, see
+ * ismrmrd_wait_for_acquisition. Readers can only open the file after the
+ * writer has started SWMR writing. Counting acquisitions or waveforms
+ * refreshes the datasets in place, the file is only reopened by a read of
+ * payloads written after it was opened.
+ */
+EXPORTISMRMRD int ismrmrd_open_dataset_swmr(ISMRMRD_Dataset *dset, const bool reader);
+
+/**
+ * Starts SWMR writing on a dataset opened with ismrmrd_open_dataset_swmr.
+ *
+ * Creates the acquisition and waveform variables if they do not exist yet.
+ * From then on only these and existing variables can be appended to, and the
+ * file is flushed every flush_interval appended acquisitions or waveforms so
+ * that readers see them. 0 flushes after every append.
+ */
+EXPORTISMRMRD int ismrmrd_start_swmr_write(ISMRMRD_Dataset *dset, const uint32_t flush_interval);
+
+/**
+ * Waits up to timeout_ms for the writer of a SWMR dataset to append the
+ * acquisition index. Returns true if it is available.
+ */
+EXPORTISMRMRD bool ismrmrd_wait_for_acquisition(const ISMRMRD_Dataset *dset, const uint32_t index,
+                                                const uint32_t timeout_ms);
+
 /**
  *  Writes the XML header string to the dataset.
  *
@@ -74,11 +374,66 @@ EXPORTISMRMRD char * ismrmrd_read_header(const ISMRMRD_Dataset *dset);
  */
 EXPORTISMRMRD int ismrmrd_append_acquisition(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acq);
 
+/**
+ *  Appends n acquisitions to the dataset.
+ *
+ *  The dataset is extended once and all n acquisitions are written with a single
+ *  hyperslab write, which is much faster than n calls to ismrmrd_append_acquisition.
+ */
+EXPORTISMRMRD int ismrmrd_append_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, size_t n);
+
 /**
  *  Reads the acquisition with the specified index from the dataset.
+ *
+ *  The trajectory and data are decoded directly into the existing buffers of acq,
+ *  which are only reallocated when their size changes.
  */
 EXPORTISMRMRD int ismrmrd_read_acquisition(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Acquisition *acq);
 
+/**
+ *  Reads count acquisitions starting at index start from the dataset.
+ *
+ *  The whole range is read with a single hyperslab selection.
+ *  acqs must point to count initialized acquisitions, whose buffers are reused
+ *  as described for ismrmrd_read_acquisition.
+ */
+EXPORTISMRMRD int ismrmrd_read_acquisitions(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count, ISMRMRD_Acquisition *acqs);
+
+/**
+ *  Reads the headers of count acquisitions starting at index start from the dataset.
+ *
+ *  Only the head member of the stored acquisitions is read, the trajectories and
+ *  data are not touched. heads must point to count headers.
+ */
+EXPORTISMRMRD int ismrmrd_read_acquisition_headers(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                                                   ISMRMRD_AcquisitionHeader *heads);
+
+/**
+ *  Builds the acquisition index, or extends it to cover all acquisitions in the dataset.
+ *
+ *  Only the headers of acquisitions missing from the index are read.
+ *  Once a dataset has an index, appended acquisitions are added to it and it is
+ *  written back when the dataset is closed.
+ */
+EXPORTISMRMRD int ismrmrd_update_acquisition_index(const ISMRMRD_Dataset *dset);
+
+/**
+ *  Returns true if the dataset has an acquisition index.
+ */
+EXPORTISMRMRD bool ismrmrd_has_acquisition_index(const ISMRMRD_Dataset *dset);
+
+/**
+ *  Returns the indices of the acquisitions matching query, in ascending order.
+ *
+ *  The leading specified counters of the sort order are found by binary search,
+ *  the remaining counters and flags are filtered. The number of matches is stored
+ *  in count. The returned array must be freed by the caller, it is NULL if there
+ *  are no matches or on error.
+ */
+EXPORTISMRMRD uint32_t * ismrmrd_query_acquisition_index(const ISMRMRD_Dataset *dset,
+                                                         const ISMRMRD_AcquisitionIndexQuery *query,
+                                                         uint32_t *count);
+
 /**
  *  Return the number of acquisitions in the dataset.
  */
@@ -116,6 +471,16 @@ EXPORTISMRMRD uint32_t ismrmrd_get_number_of_waveforms(const ISMRMRD_Dataset *ds
 EXPORTISMRMRD int ismrmrd_append_image(const ISMRMRD_Dataset *dset, const char *varname,
                                        const ISMRMRD_Image *im);
 
+/**
+ *  Appends n images to the variable named varname in the dataset.
+ *
+ *  The images must all have the same size and data type. The header, attribute
+ *  and data datasets are each extended once and written with contiguous hyperslab
+ *  writes, which is much faster than n calls to ismrmrd_append_image.
+ */
+EXPORTISMRMRD int ismrmrd_append_images(const ISMRMRD_Dataset *dset, const char *varname,
+                                        const ISMRMRD_Image *ims, size_t n);
+
 /**
  *   Reads an image stored with appendImage.
  *   The index indicates which image to read from the variable named varname.
@@ -123,6 +488,28 @@ EXPORTISMRMRD int ismrmrd_append_image(const ISMRMRD_Dataset *dset, const char *
 EXPORTISMRMRD int ismrmrd_read_image(const ISMRMRD_Dataset *dset, const char *varname,
                                      const uint32_t index, ISMRMRD_Image *im);
 
+/**
+ *   Reads count images from the variable named varname, starting at index start
+ *   and stride images apart.
+ *
+ *   The headers and attribute strings are each read with a single hyperslab selection,
+ *   the data in as few blocks as possible. ims must point to count initialized images.
+ */
+EXPORTISMRMRD int ismrmrd_read_images(const ISMRMRD_Dataset *dset, const char *varname,
+                                      const uint32_t start, const uint32_t count, const uint32_t stride,
+                                      ISMRMRD_Image *ims);
+
+/**
+ *   Reads the data of count images from the variable named varname, starting at index
+ *   start and stride images apart, into one contiguous array of size
+ *   (x, y, z, channels, count) with a single hyperslab selection.
+ *
+ *   If heads is not NULL it must point to count headers, which receive the image headers.
+ */
+EXPORTISMRMRD int ismrmrd_read_image_array(const ISMRMRD_Dataset *dset, const char *varname,
+                                           const uint32_t start, const uint32_t count, const uint32_t stride,
+                                           ISMRMRD_NDArray *arr, ISMRMRD_ImageHeader *heads);
+
 /**
  *  Return the number of images in the variable varname in the dataset.
  */
@@ -148,20 +535,111 @@ EXPORTISMRMRD int ismrmrd_append_array(const ISMRMRD_Dataset *dset, const char *
 EXPORTISMRMRD int ismrmrd_read_array(const ISMRMRD_Dataset *dataset, const char *varname,
                                      const uint32_t index, ISMRMRD_NDArray *arr);
 
+/**
+ *  Reads a sub-region of the array with the specified index from the data file.
+ *
+ *  offset and count have ndim entries in array order, i.e. the first one is the
+ *  fastest varying dimension, and ndim must match the stored array. Only the
+ *  selected region is read, arr gets the size given by count.
+ */
+EXPORTISMRMRD int ismrmrd_read_array_slab(const ISMRMRD_Dataset *dset, const char *varname,
+                                          const uint32_t index, const uint16_t ndim,
+                                          const size_t *offset, const size_t *count, ISMRMRD_NDArray *arr);
+
+/**
+ *  Reads a sub-region of the data of the image with the specified index
+ *  from the variable named varname.
+ *
+ *  offset and count are in (x, y, z, channel) order. Only the selected region
+ *  is read, arr gets the 4D size given by count.
+ */
+EXPORTISMRMRD int ismrmrd_read_image_slab(const ISMRMRD_Dataset *dset, const char *varname,
+                                          const uint32_t index, const size_t offset[4],
+                                          const size_t count[4], ISMRMRD_NDArray *arr);
+
+/**
+ *  Gets the dimensions and data type of the arrays stored in the variable varname.
+ */
+EXPORTISMRMRD int ismrmrd_get_array_properties(const ISMRMRD_Dataset *dset, const char *varname,
+                                               uint16_t *ndim, size_t dims[ISMRMRD_NDARRAY_MAXDIM],
+                                               uint16_t *data_type);
+
+/**
+ * Read only mapping of an array or image stored in the file.
+ */
+typedef struct ISMRMRD_ArrayMapping {
+    uint16_t data_type;                 /**< e.g. unsigned short, float, complex float, etc. */
+    uint16_t ndim;                      /**< Number of dimensions */
+    size_t dims[ISMRMRD_NDARRAY_MAXDIM];  /**< Dimensions */
+    const void *data;                   /**< The element inside the mapping, NULL if not mapped */
+    void *map_base;                     /**< Page aligned start of the mapping */
+    size_t map_length;                  /**< Length of the mapping */
+} ISMRMRD_ArrayMapping;
+
+/**
+ *  Maps the array with the specified index into memory without reading it.
+ *
+ *  Only variables created with a contiguous storage policy can be mapped, see
+ *  ISMRMRD_StoragePolicy, from files opened with the sec2 or stdio driver. For
+ *  anything else, or where mapping is not supported, map->data is NULL and the
+ *  array has to be read with ismrmrd_read_array.
+ *  The mapping stays valid until ismrmrd_unmap_array, even after the dataset is closed.
+ */
+EXPORTISMRMRD int ismrmrd_map_array(const ISMRMRD_Dataset *dset, const char *varname,
+                                    const uint32_t index, ISMRMRD_ArrayMapping *map);
+
+/**
+ *  Maps the (x, y, z, channels) data of the image with the specified index
+ *  into memory, see ismrmrd_map_array.
+ */
+EXPORTISMRMRD int ismrmrd_map_image_data(const ISMRMRD_Dataset *dset, const char *varname,
+                                         const uint32_t index, ISMRMRD_ArrayMapping *map);
+
+/**
+ *  Releases a mapping made with ismrmrd_map_array or ismrmrd_map_image_data.
+ */
+EXPORTISMRMRD int ismrmrd_unmap_array(ISMRMRD_ArrayMapping *map);
+
 /**
  *  Return the number of arrays in the variable varname in the dataset.
  */
 EXPORTISMRMRD uint32_t ismrmrd_get_number_of_arrays(const ISMRMRD_Dataset *dset, const char *varname);
 
+/**
+ *  Sets the storage policy of the variable varname in the dataset.
+ *
+ *  The policy applies to every HDF5 dataset at or below groupname/varname,
+ *  e.g. "data" for the acquisitions or the name of an image variable for its
+ *  headers, attributes and data. An empty varname sets the policy of the whole group.
+ *  The most specific policy wins. Open handles are reopened with the new chunk cache.
+ *  Fails if a requested filter is not available in this HDF5 installation.
+ */
+EXPORTISMRMRD int ismrmrd_set_storage_policy(const ISMRMRD_Dataset *dset, const char *varname,
+                                             const ISMRMRD_StoragePolicy *policy);
+
     
 #ifdef __cplusplus
 } /* extern "C" */
 
+template <typename T> class NDArrayView;
+template <typename T> class MappedNDArray;
+
 //  ISMRMRD Dataset C++ Interface
 class EXPORTISMRMRD Dataset {
 public:
     // Constructor and destructor
     Dataset(const char* filename, const char* groupname, bool create_file_if_needed = true);
+    // Applies default_policy to every variable in the group, see setStoragePolicy
+    Dataset(const char* filename, const char* groupname, bool create_file_if_needed,
+            const ISMRMRD_StoragePolicy &default_policy);
+    // Opens the file with options, see ismrmrd_open_dataset_ex
+    Dataset(const char* filename, const char* groupname, const ISMRMRD_DatasetOptions &options);
+    // Stores the dataset with backend, e.g. ismrmrd_memory_backend()
+    Dataset(const char* filename, const char* groupname, bool create_file_if_needed,
+            const ISMRMRD_DatasetBackend *backend);
+    // Single writer, multiple reader access, see ismrmrd_open_dataset_swmr
+    enum SwmrRole { SWMR_WRITER, SWMR_READER };
+    Dataset(const char* filename, const char* groupname, SwmrRole role);
     ~Dataset();
     
     // Methods
@@ -170,27 +648,288 @@ public:
     void readHeader(std::string& xmlstring);
     // Acquisitions
     void appendAcquisition(const Acquisition &acq);
+    void appendAcquisitions(const std::vector<Acquisition> &acqs);
     void readAcquisition(uint32_t index, Acquisition &acq);
+    void readAcquisitions(uint32_t start, uint32_t count, std::vector<Acquisition> &acqs);
+    void readAcquisitionHeaders(uint32_t start, uint32_t count, std::vector<AcquisitionHeader> &heads);
+    void updateAcquisitionIndex();
+    bool hasAcquisitionIndex();
+    std::vector<uint32_t> queryAcquisitionIndex(const ISMRMRD_AcquisitionIndexQuery &query);
     uint32_t getNumberOfAcquisitions();
     // Images
     template <typename T> void appendImage(const std::string &var, const Image<T> &im);
     void appendImage(const std::string &var, const ISMRMRD_Image *im);
+    template <typename T> void appendImages(const std::string &var, const std::vector<Image<T> > &ims);
     template <typename T> void readImage(const std::string &var, uint32_t index, Image<T> &im);
+    template <typename T> void readImages(const std::string &var, uint32_t start, uint32_t count,
+                                          std::vector<Image<T> > &ims, uint32_t stride = 1);
+    template <typename T> void readImageArray(const std::string &var, uint32_t start, uint32_t count,
+                                              NDArray<T> &arr, uint32_t stride = 1);
+    template <typename T> void readImageArray(const std::string &var, uint32_t start, uint32_t count,
+                                              NDArray<T> &arr, std::vector<ImageHeader> &heads, uint32_t stride = 1);
+    template <typename T> void readImageSlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset,
+                                             const std::vector<size_t> &count, NDArray<T> &arr);
     uint32_t getNumberOfImages(const std::string &var);
     // NDArrays
     template <typename T> void appendNDArray(const std::string &var, const NDArray<T> &arr);
     void appendNDArray(const std::string &var, const ISMRMRD_NDArray *arr);
     template <typename T> void readNDArray(const std::string &var, uint32_t index, NDArray<T> &arr);
+    template <typename T> void readNDArraySlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset,
+                                               const std::vector<size_t> &count, NDArray<T> &arr);
+    // Reads the array lazily, see NDArrayView
+    template <typename T> NDArrayView<T> getNDArrayView(const std::string &var, uint32_t index,
+                                                        size_t cache_bytes = 64 << 20, size_t tile_bytes = 0);
     uint32_t getNumberOfNDArrays(const std::string &var);
+    // Maps the array into memory if possible and reads it otherwise, see MappedNDArray
+    template <typename T> void mapNDArray(const std::string &var, uint32_t index, MappedNDArray<T> &arr);
+    template <typename T> void mapImageData(const std::string &var, uint32_t index, MappedNDArray<T> &arr);
 
     //Waveforms
     void appendWaveform(const Waveform &wav);
     void readWaveform(uint32_t index, Waveform & wav);
     uint32_t getNumberOfWaveforms();
+
+    // Storage
+    void setStoragePolicy(const std::string &var, const ISMRMRD_StoragePolicy &policy);
+    void flush();
+
+    // SWMR
+    void startSwmrWrite(uint32_t flush_interval = 0);
+    bool waitForAcquisition(uint32_t index, uint32_t timeout_ms);
 protected:
+    template <typename T> friend class NDArrayView;
     ISMRMRD_Dataset dset_;
 };
 
+// Timings of an AcquisitionStream, in seconds
+struct EXPORTISMRMRD AcquisitionStreamStats {
+    AcquisitionStreamStats();
+    // Fraction of the read time that was hidden behind the consumer
+    double overlap() const;
+
+    uint64_t acquisitions;  // handed to the consumer
+    uint64_t batches;       // read by the reader thread
+    double read_time;       // reader thread inside readAcquisitions
+    double stall_time;      // reader thread waiting for a free batch (back-pressure)
+    double wait_time;       // consumer waiting for a filled batch
+    double elapsed_time;    // since the stream was opened
+};
+
+//  Reads the acquisitions of a dataset in order on a background thread.
+//
+//  The reader fills a bounded ring of num_batches batches of batch_size
+//  pre-allocated acquisitions and blocks while the ring is full. next() swaps
+//  the buffers of the next acquisition with the caller's, so the caller's
+//  buffers are reused for later reads.
+//
+//  The stream opens the file itself. Its reads go through the HDF5 lock of
+//  the library, see ismrmrd_lock_hdf5.
+class EXPORTISMRMRD AcquisitionStream {
+public:
+    AcquisitionStream(const char* filename, const char* groupname,
+                      uint32_t batch_size = 64, uint32_t num_batches = 4);
+    // The acquisitions [start, start + count), clamped to the end of the dataset
+    AcquisitionStream(const char* filename, const char* groupname, uint32_t start, uint32_t count,
+                      uint32_t batch_size, uint32_t num_batches);
+    ~AcquisitionStream();
+
+    // Returns false at the end of the stream, rethrows errors of the reader thread
+    bool next(Acquisition &acq);
+    // Stops the reader thread, the following next() returns false
+    void stop();
+    uint32_t size() const;
+    AcquisitionStreamStats stats();
+
+private:
+    AcquisitionStream(const AcquisitionStream &);
+    AcquisitionStream & operator= (const AcquisitionStream &);
+    void open(const char* filename, const char* groupname, uint32_t start, uint32_t count,
+              uint32_t batch_size, uint32_t num_batches);
+    void run();
+
+    Dataset *dataset_;
+    uint32_t start_;
+    uint32_t count_;
+    uint32_t batch_size_;
+    // Ring of batches, filled in order by the reader and released by next()
+    std::vector<std::vector<Acquisition> > ring_;
+    std::vector<uint32_t> batch_sizes_;
+    size_t filled_;
+    size_t consumer_batch_;
+    uint32_t consumer_pos_;
+    bool holding_batch_;
+    bool done_;
+    bool stopping_;
+    std::exception_ptr error_;
+    AcquisitionStreamStats stats_;
+    std::chrono::steady_clock::time_point opened_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::thread reader_;
+};
+
+// Counters of an AsyncWriter
+struct EXPORTISMRMRD AsyncWriterStats {
+    enum { LATENCY_BUCKETS = 32 };
+
+    AsyncWriterStats();
+    // Upper bound in microseconds of the enqueue to durable latency of the
+    // fraction q of the items, e.g. 0.99
+    double latencyPercentile(double q) const;
+
+    uint64_t acquisitions;
+    uint64_t waveforms;
+    uint64_t batches;
+    uint64_t max_queued;  // the deepest the queue has been
+    uint64_t full_waits;  // appends that waited for the queue to drain
+    // latency[k] counts the items that were on disk within [2^k, 2^(k+1)) microseconds
+    // of being queued, the first and last buckets are open ended
+    uint64_t latency[LATENCY_BUCKETS];
+};
+
+//  Appends acquisitions and waveforms to a dataset on a background thread.
+//
+//  append() takes ownership of the item and queues it. The writer thread
+//  appends everything queued as one batch and flushes the file, after which
+//  the items are durable. append() blocks while max_queued items are waiting.
+//  An error on the writer thread is rethrown by the next append(), flush() or
+//  the first close() and no further items are written.
+//
+//  The writer opens the file itself. Its writes go through the HDF5 lock of
+//  the library, see ismrmrd_lock_hdf5.
+class EXPORTISMRMRD AsyncWriter {
+public:
+    AsyncWriter(const char* filename, const char* groupname, size_t max_queued = 1024);
+    // Closes without throwing, call close() to see the errors
+    ~AsyncWriter();
+
+    void append(Acquisition &&acq);
+    void append(Waveform &&wav);
+    // Returns when everything appended before the call is on disk
+    void flush();
+    // Flushes and stops the writer thread, later calls do nothing
+    void close();
+    AsyncWriterStats stats();
+
+private:
+    AsyncWriter(const AsyncWriter &);
+    AsyncWriter & operator= (const AsyncWriter &);
+    void wait_for_space(std::unique_lock<std::mutex> &lock);
+    void run();
+
+    typedef std::chrono::steady_clock Clock;
+
+    Dataset *dataset_;
+    size_t max_queued_;
+    // Queued items, swapped with the writer thread's batch
+    std::vector<Acquisition> acqs_;
+    std::vector<Clock::time_point> acq_times_;
+    std::vector<Waveform> wavs_;
+    std::vector<Clock::time_point> wav_times_;
+    uint64_t queued_total_;
+    uint64_t written_total_;
+    bool closing_;
+    bool closed_;
+    std::exception_ptr error_;
+    AsyncWriterStats stats_;
+    std::mutex mutex_;
+    std::condition_variable work_;
+    std::condition_variable progress_;
+    std::thread writer_;
+};
+
+// Counters of an NDArrayView
+struct EXPORTISMRMRD NDArrayViewStats {
+    NDArrayViewStats();
+
+    uint64_t hits;       // accesses served from a cached tile
+    uint64_t misses;     // accesses that read a tile from the file
+    uint64_t evictions;  // tiles dropped to make room
+    uint64_t bytes_read;
+};
+
+//  Read only view of an array stored in a dataset which is loaded on demand.
+//
+//  The array is read in tiles which span the fastest varying dimensions and
+//  as much of the slower ones as fits in tile_bytes, e.g. whole slices of a
+//  volume. At most cache_bytes of tiles are kept, the least recently used
+//  tile is dropped first. tile_bytes 0 chooses cache_bytes / 16.
+//
+//  The view reads through the dataset, which must outlive it.
+template <typename T> class EXPORTISMRMRD NDArrayView {
+public:
+    NDArrayView(Dataset &dataset, const std::string &var, uint32_t index,
+                size_t cache_bytes = 64 << 20, size_t tile_bytes = 0);
+
+    uint16_t getNDim() const;
+    const size_t (&getDims() const)[ISMRMRD_NDARRAY_MAXDIM];
+    size_t getNumberOfElements() const;
+    const std::vector<size_t> &getTileDims() const;
+
+    // Same indexing as NDArray<T>::operator ()
+    T operator () (size_t x, size_t y=0, size_t z=0, size_t w=0, size_t n=0, size_t m=0, size_t l=0);
+
+    // Drops the cached tiles
+    void clear();
+    NDArrayViewStats stats() const;
+
+private:
+    struct Tile {
+        size_t key;
+        uint64_t last_used;
+        NDArray<T> data;
+    };
+    size_t load(size_t key, const size_t (&tile_index)[ISMRMRD_NDARRAY_MAXDIM]);
+
+    Dataset *dataset_;
+    std::string var_;
+    uint32_t index_;
+    uint16_t ndim_;
+    size_t dims_[ISMRMRD_NDARRAY_MAXDIM];
+    std::vector<size_t> tile_dims_;
+    // number of tiles along each dimension
+    size_t grid_[ISMRMRD_NDARRAY_MAXDIM];
+    size_t max_tiles_;
+    std::vector<Tile> tiles_;
+    // tile key to position in tiles_
+    std::map<size_t, size_t> lookup_;
+    size_t last_key_;
+    size_t last_tile_;
+    uint64_t clock_;
+    NDArrayViewStats stats_;
+};
+
+//  Read only array which views a memory mapping of the file where possible.
+//
+//  Arrays and image data of contiguous variables (see ISMRMRD_StoragePolicy)
+//  are mapped without being read or copied, anything else is read into memory.
+//  The mapping does not depend on the Dataset and is released by the destructor.
+template <typename T> class EXPORTISMRMRD MappedNDArray {
+    friend class Dataset;
+public:
+    MappedNDArray();
+    ~MappedNDArray();
+
+    // Whether the data views the file rather than a copy
+    bool isMapped() const;
+    uint16_t getNDim() const;
+    const size_t (&getDims() const)[ISMRMRD_NDARRAY_MAXDIM];
+    size_t getNumberOfElements() const;
+    const T * getDataPtr() const;
+    // Same indexing as NDArray<T>::operator ()
+    const T & operator () (uint16_t x, uint16_t y=0, uint16_t z=0, uint16_t w=0, uint16_t n=0, uint16_t m=0, uint16_t l=0) const;
+
+private:
+    MappedNDArray(const MappedNDArray &);
+    MappedNDArray & operator= (const MappedNDArray &);
+    void release();
+
+    ISMRMRD_ArrayMapping map_;
+    // holds the data when it could not be mapped
+    NDArray<T> copy_;
+};
+
 } /* ISMRMRD namespace */
 #endif
 
@@ -93,7 +93,8 @@ enum ISMRMRD_Constants {
     ISMRMRD_CHANNEL_MASKS = 16,
     ISMRMRD_NDARRAY_MAXDIM = 7,
     ISMRMRD_POSITION_LENGTH = 3,
-    ISMRMRD_DIRECTION_LENGTH = 3
+    ISMRMRD_DIRECTION_LENGTH = 3,
+    ISMRMRD_DEFAULT_ALIGNMENT = 64
 };
 
 
@@ -365,6 +366,92 @@ EXPORTISMRMRD int ismrmrd_make_consistent_ndarray(ISMRMRD_NDArray *arr);
 EXPORTISMRMRD size_t ismrmrd_size_of_ndarray_data(const ISMRMRD_NDArray *arr);
 /** @} */
 
+/*********************/
+/* Memory Allocation */
+/*********************/
+/** @addtogroup capi
+ *  @{
+ */
+
+/**
+ * Allocator used for the structs made by the ismrmrd_create_* functions and
+ * for the data, trajectory and attribute buffers of acquisitions, images,
+ * arrays and waveforms.
+ *
+ * There is one allocator for the whole process. The default allocates
+ * with posix_memalign (_aligned_malloc on Windows) and releases with free
+ * (_aligned_free), so on POSIX its buffers may also be passed to free. The
+ * library records which allocator made each buffer and releases it with that
+ * one, even after another allocator is set. Buffers from malloc are still
+ * accepted where the library takes ownership and are released with free.
+ * The functions are called from any thread.
+ */
+typedef struct ISMRMRD_Allocator {
+    /** Returns size bytes aligned to alignment, a power of two, or NULL */
+    void *(*allocate)(size_t size, size_t alignment, void *context);
+    /** Resizes ptr keeping its contents and alignment, allocates if ptr is
+     *  NULL. Returns NULL and leaves ptr alone on failure. */
+    void *(*reallocate)(void *ptr, size_t size, size_t alignment, void *context);
+    /** Releases ptr, which may be NULL */
+    void (*release)(void *ptr, void *context);
+    /** Passed to each of the functions */
+    void *context;
+} ISMRMRD_Allocator;
+
+/**
+ * Sets the allocator, NULL restores the default. Live buffers stay with the
+ * allocator that made them and move to the new one when next resized. Fails
+ * for a pool allocator while the buffer alignment is larger than 64 bytes. The swap is atomic, but it is not
+ * thread safe with respect to buffers allocated on other threads during the
+ * call, so set the allocator while no other thread uses the library.
+ */
+EXPORTISMRMRD int ismrmrd_set_allocator(const ISMRMRD_Allocator *allocator);
+/** Copies the current allocator into allocator */
+EXPORTISMRMRD int ismrmrd_get_allocator(ISMRMRD_Allocator *allocator);
+/** Allocate, resize and release through the current allocator */
+EXPORTISMRMRD void *ismrmrd_malloc(size_t size);
+EXPORTISMRMRD void *ismrmrd_realloc(void *ptr, size_t size);
+EXPORTISMRMRD void ismrmrd_free(void *ptr);
+
+/**
+ * Sets the alignment requested for every allocation, a power of two of at
+ * least the size of a pointer. The default, ISMRMRD_DEFAULT_ALIGNMENT, is a
+ * cache line and suits aligned AVX-512 loads and FFTW. Buffers keep their
+ * alignment through resizes and copies, buffers allocated before a change
+ * get the new alignment when they are next resized. Fails for alignments
+ * larger than 64 bytes while a pool allocator is set.
+ */
+EXPORTISMRMRD int ismrmrd_set_buffer_alignment(size_t alignment);
+EXPORTISMRMRD size_t ismrmrd_get_buffer_alignment(void);
+/** Whether ptr is a multiple of alignment */
+EXPORTISMRMRD bool ismrmrd_is_aligned(const void *ptr, size_t alignment);
+
+/** Counters of a pool allocator */
+typedef struct ISMRMRD_PoolAllocatorStats {
+    uint64_t allocations;  /**< Blocks handed out */
+    uint64_t reused;       /**< Blocks handed out from the cache */
+    uint64_t cached_bytes; /**< Bytes of released blocks kept for reuse */
+} ISMRMRD_PoolAllocatorStats;
+
+/**
+ * Creates a pool allocator and fills in allocator with it.
+ *
+ * Blocks are rounded up to size classes of 2^n and 3 * 2^n bytes, from
+ * 64 bytes to 16 MiB, which covers readouts and images of the usual sizes
+ * with little waste. Released blocks are kept in per class free lists, up to
+ * max_cached_bytes in all, and handed out again for the next request of the
+ * same class. The lists are split in shards picked by thread, so threads
+ * allocating the same sizes rarely wait on each other. Larger blocks go
+ * straight to the system. Blocks are aligned to 64 bytes, larger
+ * buffer alignments fail to allocate.
+ */
+EXPORTISMRMRD int ismrmrd_create_pool_allocator(ISMRMRD_Allocator *allocator, size_t max_cached_bytes);
+/** Frees the cached blocks and the pool. Fails while the pool is the current
+ *  allocator or blocks of it allocated through ismrmrd_malloc are live. */
+EXPORTISMRMRD int ismrmrd_destroy_pool_allocator(ISMRMRD_Allocator *allocator);
+EXPORTISMRMRD int ismrmrd_get_pool_allocator_stats(const ISMRMRD_Allocator *allocator, ISMRMRD_PoolAllocatorStats *stats);
+/** @} */
+
 /*********/
 /* Flags */
 /*********/
@@ -493,13 +580,19 @@ public:
 /// MR Acquisition type
 class EXPORTISMRMRD Acquisition {
     friend class Dataset;
+    friend class AcquisitionStream;
+    friend class AsyncWriter;
 public:
     // Constructors, assignment, destructor
     Acquisition();
     Acquisition(uint16_t num_samples, uint16_t active_channels=1, uint16_t trajectory_dimensions=0);
     Acquisition(const Acquisition &other);
+    Acquisition(Acquisition &&other) noexcept;
     Acquisition & operator= (const Acquisition &other);
+    Acquisition & operator= (Acquisition &&other) noexcept;
     ~Acquisition();
+    // Exchanges the headers and buffers, nothing is copied
+    void swap(Acquisition &other) noexcept;
 
     // Accessors and mutators
     const uint16_t &version();
@@ -569,6 +662,12 @@ public:
      */
     const float * getTrajPtr() const;
     float * getTrajPtr();
+
+    /**
+     * Whether the data and trajectory start on the buffer alignment,
+     * see ismrmrd_set_buffer_alignment
+     */
+    bool isAligned() const;
     
     /**
      * Returns a reference to the trajectory
@@ -632,8 +731,12 @@ public:
     Image(uint16_t matrix_size_x = 0, uint16_t matrix_size_y = 1,
           uint16_t matrix_size_z = 1, uint16_t channels = 1);
     Image(const Image &other);
+    Image(Image &&other) noexcept;
     Image & operator= (const Image &other);
+    Image & operator= (Image &&other) noexcept;
     ~Image();
+    // Exchanges the headers and buffers, nothing is copied
+    void swap(Image &other) noexcept;
 
     // Image dimensions
     void resize(uint16_t matrix_size_x, uint16_t matrix_size_y, uint16_t matrix_size_z, uint16_t channels);
@@ -768,6 +871,8 @@ public:
     // Data
     T * getDataPtr();
     const T * getDataPtr() const;
+    /** Whether the data starts on the buffer alignment **/
+    bool isAligned() const;
     /** Returns the number of elements in the image data **/
     size_t getNumberOfDataElements() const;
     /** Returns the size of the image data in bytes **/
@@ -794,19 +899,26 @@ public:
     NDArray();
     NDArray(const std::vector<size_t> dimvec);
     NDArray(const NDArray<T> &other);
+    NDArray(NDArray<T> &&other) noexcept;
     ~NDArray();
     NDArray<T> & operator= (const NDArray<T> &other);
+    NDArray<T> & operator= (NDArray<T> &&other) noexcept;
+    // Exchanges the dimensions and buffers, nothing is copied
+    void swap(NDArray<T> &other) noexcept;
 
     // Accessors and mutators
     uint16_t getVersion() const;
     ISMRMRD_DataTypes getDataType() const;
     uint16_t getNDim() const;
     const size_t (&getDims())[ISMRMRD_NDARRAY_MAXDIM];
+    const size_t (&getDims() const)[ISMRMRD_NDARRAY_MAXDIM];
     size_t getDataSize() const;
     void resize(const std::vector<size_t> dimvec);
     size_t getNumberOfElements() const;
     T * getDataPtr();
     const T * getDataPtr() const;
+    /** Whether the data starts on the buffer alignment **/
+    bool isAligned() const;
     
     /** Returns iterator to the beginning of the array **/
     T * begin();
@@ -821,6 +933,10 @@ protected:
     ISMRMRD_NDArray arr;
 };
 
+// Found by argument dependent lookup, e.g. by std::sort
+EXPORTISMRMRD void swap(Acquisition &a, Acquisition &b) noexcept;
+template <typename T> EXPORTISMRMRD void swap(Image<T> &a, Image<T> &b) noexcept;
+template <typename T> EXPORTISMRMRD void swap(NDArray<T> &a, NDArray<T> &b) noexcept;
 
 /** @} */
 
@@ -0,0 +1,111 @@
+/**
+ * @file serialization.h
+ * @defgroup serialization Wire Serialization API
+ * @{
+ */
+
+#ifndef ISMRMRDSERIALIZATION_H
+#define ISMRMRDSERIALIZATION_H
+
+#include "ismrmrd/export.h"
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/waveform.h"
+
+#include <iostream>
+#include <string>
+
+namespace ISMRMRD
+{
+  /*
+    Binary message format for moving data between processes.
+
+    Every message starts with a MessageFrame, which gives its id, the version
+    of the format and the number of bytes that follow, so readers can skip
+    messages they do not handle. The bodies are
+
+      ISMRMRD_MESSAGE_HEADER       the xml header, without a terminating null
+      ISMRMRD_MESSAGE_CLOSE        empty, the sender is done
+      ISMRMRD_MESSAGE_ACQUISITION  AcquisitionHeader, trajectory, data
+      ISMRMRD_MESSAGE_WAVEFORM     WaveformHeader, data
+      ISMRMRD_MESSAGE_IMAGE        ImageHeader, attribute string, data
+      ISMRMRD_MESSAGE_NDARRAY      version, data_type, ndim and a reserved
+                                   field as uint16, ISMRMRD_NDARRAY_MAXDIM
+                                   dimensions as uint64, data
+
+    The header structures are sent as they are laid out in memory, so both
+    ends need the same byte order. Errors throw std::runtime_error. A message
+    whose length or data type does not match its headers is skipped before
+    the error is thrown, so the next frame can be read; one with an
+    unexpected id or version is left unread to be skipped by the caller.
+  */
+
+  /** Ids of the messages */
+  enum MessageId {
+    ISMRMRD_MESSAGE_HEADER = 3,
+    ISMRMRD_MESSAGE_CLOSE = 4,
+    ISMRMRD_MESSAGE_ACQUISITION = 1008,
+    ISMRMRD_MESSAGE_IMAGE = 1022,
+    ISMRMRD_MESSAGE_WAVEFORM = 1026,
+    ISMRMRD_MESSAGE_NDARRAY = 1030
+  };
+
+  /** Version of the message format written by this library */
+  const uint16_t ISMRMRD_MESSAGE_VERSION = 1;
+
+  /** Start of every message */
+  struct MessageFrame {
+    uint16_t id;       /**< One of MessageId */
+    uint16_t version;  /**< Version of the message format */
+    uint32_t reserved;
+    uint64_t length;   /**< Bytes of the message after the frame */
+  };
+
+  // Writing to streams
+  EXPORTISMRMRD void serialize(const Acquisition &acq, std::ostream &os);
+  EXPORTISMRMRD void serialize(const Waveform &wav, std::ostream &os);
+  template <typename T> EXPORTISMRMRD void serialize(const Image<T> &im, std::ostream &os);
+  template <typename T> EXPORTISMRMRD void serialize(const NDArray<T> &arr, std::ostream &os);
+  EXPORTISMRMRD void serializeHeader(const std::string &xml, std::ostream &os);
+  EXPORTISMRMRD void serializeClose(std::ostream &os);
+
+  // Reading from streams. readMessageFrame returns false at the end of the
+  // stream, the message is then read with the function for its id or skipped.
+  // An image of a data type not known in advance is read in two steps,
+  // deserializeImageHeader, then deserializeImageData into an Image of
+  // head.data_type.
+  EXPORTISMRMRD bool readMessageFrame(std::istream &is, MessageFrame &frame);
+  EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Acquisition &acq);
+  EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Waveform &wav);
+  template <typename T> EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Image<T> &im);
+  template <typename T> EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, NDArray<T> &arr);
+  EXPORTISMRMRD void deserializeImageHeader(std::istream &is, const MessageFrame &frame, ImageHeader &head);
+  template <typename T> EXPORTISMRMRD void deserializeImageData(std::istream &is, const MessageFrame &frame, const ImageHeader &head, Image<T> &im);
+  EXPORTISMRMRD void deserializeHeader(std::istream &is, const MessageFrame &frame, std::string &xml);
+  EXPORTISMRMRD void skipMessage(std::istream &is, const MessageFrame &frame);
+
+#ifndef _WIN32
+  // The same for file descriptors, e.g. pipes and sockets. The header,
+  // trajectory or attributes, and data are gathered with writev and
+  // scattered with readv, without intermediate copies.
+  EXPORTISMRMRD void serialize(const Acquisition &acq, int fd);
+  EXPORTISMRMRD void serialize(const Waveform &wav, int fd);
+  template <typename T> EXPORTISMRMRD void serialize(const Image<T> &im, int fd);
+  template <typename T> EXPORTISMRMRD void serialize(const NDArray<T> &arr, int fd);
+  EXPORTISMRMRD void serializeHeader(const std::string &xml, int fd);
+  EXPORTISMRMRD void serializeClose(int fd);
+
+  EXPORTISMRMRD bool readMessageFrame(int fd, MessageFrame &frame);
+  EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Acquisition &acq);
+  EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Waveform &wav);
+  template <typename T> EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Image<T> &im);
+  template <typename T> EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, NDArray<T> &arr);
+  EXPORTISMRMRD void deserializeImageHeader(int fd, const MessageFrame &frame, ImageHeader &head);
+  template <typename T> EXPORTISMRMRD void deserializeImageData(int fd, const MessageFrame &frame, const ImageHeader &head, Image<T> &im);
+  EXPORTISMRMRD void deserializeHeader(int fd, const MessageFrame &frame, std::string &xml);
+  EXPORTISMRMRD void skipMessage(int fd, const MessageFrame &frame);
+#endif
+}
+
+/** @} */
+
+#endif //ISMRMRDSERIALIZATION_H
@@ -0,0 +1,157 @@
+/**
+ * @file shm_ring.h
+ * @defgroup shm_ring Shared Memory Acquisition Ring
+ * @{
+ */
+
+#ifndef ISMRMRDSHMRING_H
+#define ISMRMRDSHMRING_H
+
+#include "ismrmrd/export.h"
+#include "ismrmrd/ismrmrd.h"
+
+#include <string>
+
+#ifndef _WIN32
+
+namespace ISMRMRD
+{
+  /*
+    Ring buffer of acquisitions in POSIX shared memory, for processes on the
+    same machine.
+
+    The ring is created with createAcquisitionRing under a shared memory name
+    such as "/ismrmrd_ring", then opened by any number of producers and one
+    consumer. Producers reserve a record, fill the header, data and
+    trajectory in place and commit it. The consumer gets views of the
+    committed records in order and releases them when done. Their space is
+    reused once every earlier record has been released too, so records may be
+    released out of order. The data and trajectory of a record start on 64
+    byte boundaries.
+
+    Records are claimed with a compare and swap and committed in the order
+    they were claimed, nothing takes a lock. Waiting spins briefly and then
+    yields the processor. A producer that dies between reserve and commit
+    stalls the ring, as later records cannot be committed before its own;
+    they time out in commit. Pages are placed on the NUMA node of the process
+    that creates the ring, which should run on the node of its users.
+
+    Errors throw std::runtime_error.
+  */
+
+  struct AcquisitionRingControl;
+
+  /** Creates the ring name with capacity bytes for records, rounded up to a multiple of 64 */
+  EXPORTISMRMRD void createAcquisitionRing(const std::string &name, size_t capacity);
+  /** Removes the name, processes that have the ring open keep using it */
+  EXPORTISMRMRD void removeAcquisitionRing(const std::string &name);
+
+  /** Record reserved by a producer, valid until it is committed */
+  struct EXPORTISMRMRD AcquisitionSlot {
+    AcquisitionSlot();
+
+    /** Initialized as by ismrmrd_init_acquisition_header with the reserved
+        sizes, which must not be changed */
+    ISMRMRD_AcquisitionHeader *head;
+    complex_float_t *data;
+    float *traj;
+
+  private:
+    friend class AcquisitionRingProducer;
+    uint64_t start_;
+    uint64_t end_;
+  };
+
+  /** Read only acquisition in a record of the ring, valid until it is released */
+  class EXPORTISMRMRD AcquisitionView {
+  public:
+    AcquisitionView();
+
+    bool isValid() const;
+    const AcquisitionHeader &getHead() const;
+    const complex_float_t *getDataPtr() const;
+    const float *getTrajPtr() const;
+    size_t getNumberOfDataElements() const;
+    size_t getNumberOfTrajElements() const;
+    size_t getDataSize() const;
+    size_t getTrajSize() const;
+    const complex_float_t &data(uint16_t sample, uint16_t channel) const;
+    const float &traj(uint16_t dimension, uint16_t sample) const;
+    /** Copies the acquisition out of the ring */
+    void copyTo(Acquisition &acq) const;
+
+  private:
+    friend class AcquisitionRingConsumer;
+    const char *record_;
+  };
+
+  class EXPORTISMRMRD AcquisitionRingProducer {
+  public:
+    explicit AcquisitionRingProducer(const std::string &name);
+    ~AcquisitionRingProducer();
+
+    /** Reserves a record, waiting up to timeout_us for space.
+        Returns false if there was no space in time. */
+    bool reserve(uint16_t num_samples, uint16_t active_channels, uint16_t trajectory_dimensions,
+                 AcquisitionSlot &slot, uint32_t timeout_us = 1000000);
+    /** Hands the record to the consumer once the records reserved before it
+        are committed. Throws if they are not within timeout_us, e.g. because
+        their producer died, leaving the slot reserved to try again. */
+    void commit(AcquisitionSlot &slot, uint32_t timeout_us = 1000000);
+    /** Gives up a reserved record, which the consumer skips. Waits for earlier
+        records like commit. */
+    void abandon(AcquisitionSlot &slot, uint32_t timeout_us = 1000000);
+    /** Reserves, copies and commits acq, returns false if there was no space in time */
+    bool push(const Acquisition &acq, uint32_t timeout_us = 1000000);
+    /** Detaches from the ring, the consumer sees the end of the stream once
+        every producer has closed. Called by the destructor. */
+    void close();
+
+  private:
+    AcquisitionRingProducer(const AcquisitionRingProducer &);
+    AcquisitionRingProducer & operator= (const AcquisitionRingProducer &);
+
+    void *map_;
+    size_t map_size_;
+    AcquisitionRingControl *control_;
+    char *records_;
+    bool open_;
+  };
+
+  class EXPORTISMRMRD AcquisitionRingConsumer {
+  public:
+    /** Only one consumer may have the ring open at a time. The ring of a
+        consumer process that died is taken over, and the records it had not
+        released are viewed again. */
+    explicit AcquisitionRingConsumer(const std::string &name);
+    ~AcquisitionRingConsumer();
+
+    /** Views the next record, waiting up to timeout_us for one. Returns false
+        on timeout or at the end of the stream, see isFinished(). */
+    bool next(AcquisitionView &view, uint32_t timeout_us = 1000000);
+    /** Gives the record back to the producers, view is no longer valid */
+    void release(AcquisitionView &view);
+    /** Whether all producers have closed and every record has been viewed */
+    bool isFinished();
+    /** Bytes committed and not yet viewed */
+    size_t pending();
+
+  private:
+    AcquisitionRingConsumer(const AcquisitionRingConsumer &);
+    AcquisitionRingConsumer & operator= (const AcquisitionRingConsumer &);
+
+    void *map_;
+    size_t map_size_;
+    AcquisitionRingControl *control_;
+    char *records_;
+    // next record to view, records before it and after the tail are held by the caller
+    uint64_t read_;
+    uint64_t tail_;
+  };
+}
+
+#endif // _WIN32
+
+/** @} */
+
+#endif //ISMRMRDSHMRING_H
@@ -0,0 +1,561 @@
+#include "ismrmrd/ismrmrd.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace ISMRMRD {
+
+//
+// Block table
+//
+// Every buffer handed out by ismrmrd_malloc is recorded with its capacity and
+// the allocator that owns it, so that it is released by that allocator
+// whatever the current one is, and a resize knows how much to copy. The
+// buffers themselves carry nothing extra: those of the default allocator can
+// still be passed to free, and buffers from malloc can be given to the
+// library, which releases them with free as before. The table is sharded by
+// address so that threads rarely wait on each other.
+//
+namespace {
+
+// An allocator that has been set, with the number of its buffers in the table
+struct Owner {
+    constexpr explicit Owner(const ISMRMRD_Allocator &allocator_) : allocator(allocator_), live(0) {}
+    ISMRMRD_Allocator allocator;
+    std::atomic<int64_t> live;
+};
+
+struct BlockRecord {
+    Owner *owner;
+    size_t capacity;
+};
+
+struct TableShard {
+    std::mutex mutex;
+    std::unordered_map<const void *, BlockRecord> blocks;
+};
+
+const size_t NUM_TABLE_SHARDS = 64;
+
+// Never destroyed, buffers may still be released by static destructors
+TableShard &table_shard(const void *ptr) {
+    static TableShard *shards = new TableShard[NUM_TABLE_SHARDS];
+    return shards[(reinterpret_cast<uintptr_t>(ptr) / ISMRMRD_DEFAULT_ALIGNMENT) % NUM_TABLE_SHARDS];
+}
+
+bool find_block(const void *ptr, BlockRecord *record) {
+    TableShard &shard = table_shard(ptr);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::unordered_map<const void *, BlockRecord>::const_iterator found = shard.blocks.find(ptr);
+    if (found == shard.blocks.end()) {
+        return false;
+    }
+    *record = found->second;
+    return true;
+}
+
+// Returns false if the table has no memory left
+bool record_block(const void *ptr, Owner *owner, size_t capacity) {
+    TableShard &shard = table_shard(ptr);
+    BlockRecord record = {owner, capacity};
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    try {
+        std::pair<std::unordered_map<const void *, BlockRecord>::iterator, bool> inserted =
+            shard.blocks.insert(std::make_pair(ptr, record));
+        if (!inserted.second) {
+            // The previous block at this address was passed to free directly
+            inserted.first->second.owner->live--;
+            inserted.first->second = record;
+        }
+    } catch (const std::bad_alloc &) {
+        return false;
+    }
+    owner->live++;
+    return true;
+}
+
+bool take_block(const void *ptr, BlockRecord *record) {
+    TableShard &shard = table_shard(ptr);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::unordered_map<const void *, BlockRecord>::iterator found = shard.blocks.find(ptr);
+    if (found == shard.blocks.end()) {
+        return false;
+    }
+    *record = found->second;
+    shard.blocks.erase(found);
+    record->owner->live--;
+    return true;
+}
+
+} // namespace
+
+//
+// Default allocator
+//
+namespace {
+
+void *default_allocate(size_t size, size_t alignment, void *context) {
+    void *ptr = NULL;
+    (void) context;
+#ifdef _WIN32
+    ptr = _aligned_malloc(size, alignment);
+#else
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+        ptr = NULL;
+    }
+#endif
+    return ptr;
+}
+
+void default_release(void *ptr, void *context) {
+    (void) context;
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+// Neither realloc nor _aligned_realloc can change the alignment of a block,
+// so a block that has to move is copied by hand, as much as the table says
+// it holds
+void *default_reallocate(void *ptr, size_t size, size_t alignment, void *context) {
+    if (ptr == NULL) {
+        return default_allocate(size, alignment, context);
+    }
+    BlockRecord record;
+    if (!find_block(ptr, &record)) {
+        // Allocated by calling default_allocate directly, its size is unknown
+#ifdef _WIN32
+        return _aligned_realloc(ptr, size, alignment);
+#else
+        void *newPtr = default_allocate(size, alignment, context);
+        if (newPtr == NULL) {
+            return NULL;
+        }
+        void *moved = realloc(ptr, size);
+        if (moved == NULL) {
+            free(newPtr);
+            return NULL;
+        }
+        memcpy(newPtr, moved, size);
+        free(moved);
+        return newPtr;
+#endif
+    }
+    if (size <= record.capacity && size > record.capacity / 2 && ismrmrd_is_aligned(ptr, alignment)) {
+        return ptr;
+    }
+    void *newPtr = default_allocate(size, alignment, context);
+    if (newPtr == NULL) {
+        return NULL;
+    }
+    memcpy(newPtr, ptr, std::min(size, record.capacity));
+    default_release(ptr, context);
+    return newPtr;
+}
+
+constexpr ISMRMRD_Allocator default_allocator = {default_allocate, default_reallocate, default_release, NULL};
+
+} // namespace
+
+//
+// Pool allocator
+//
+// Every block starts with a header of one cache line that records its size
+// class, the caller gets the memory after it. Released blocks are pushed on
+// the free list of their class in the shard of the releasing thread and
+// popped again by the next request for that class.
+//
+namespace {
+
+const size_t POOL_ALIGNMENT = 64;
+const size_t SMALLEST_CLASS = 64;
+const size_t LARGEST_CLASS = 16 << 20;
+const size_t NUM_SHARDS = 8;
+// Blocks larger than every class go straight to the system
+const uint32_t NO_CLASS = 0xffffffff;
+
+struct BlockHeader {
+    size_t capacity;
+    uint32_t size_class;
+    BlockHeader *next;
+};
+
+struct Shard {
+    std::mutex mutex;
+    std::vector<BlockHeader *> free_lists;
+};
+
+struct Pool {
+    Pool(size_t max_cached) : max_cached_bytes(max_cached), allocations(0), reused(0), cached_bytes(0) {
+        for (size_t size = SMALLEST_CLASS; size <= LARGEST_CLASS; size *= 2) {
+            classes.push_back(size);
+            if (size < LARGEST_CLASS) {
+                classes.push_back(size + size / 2);
+            }
+        }
+        for (size_t n = 0; n < NUM_SHARDS; n++) {
+            shards[n].free_lists.assign(classes.size(), NULL);
+        }
+    }
+
+    std::vector<size_t> classes;
+    Shard shards[NUM_SHARDS];
+    size_t max_cached_bytes;
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> reused;
+    std::atomic<uint64_t> cached_bytes;
+};
+
+BlockHeader *header_of(void *ptr) {
+    return reinterpret_cast<BlockHeader *>(static_cast<char *>(ptr) - POOL_ALIGNMENT);
+}
+
+void *memory_of(BlockHeader *block) {
+    return reinterpret_cast<char *>(block) + POOL_ALIGNMENT;
+}
+
+BlockHeader *system_allocate(size_t capacity, uint32_t size_class) {
+    void *block = NULL;
+#ifdef _WIN32
+    block = _aligned_malloc(POOL_ALIGNMENT + capacity, POOL_ALIGNMENT);
+#else
+    if (posix_memalign(&block, POOL_ALIGNMENT, POOL_ALIGNMENT + capacity) != 0) {
+        block = NULL;
+    }
+#endif
+    if (block == NULL) {
+        return NULL;
+    }
+    BlockHeader *header = static_cast<BlockHeader *>(block);
+    header->capacity = capacity;
+    header->size_class = size_class;
+    header->next = NULL;
+    return header;
+}
+
+void system_release(BlockHeader *block) {
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+}
+
+// Threads are spread over the shards in the order they first allocate
+size_t shard_of_thread() {
+    static std::atomic<size_t> next_shard(0);
+    static thread_local size_t shard = next_shard++ % NUM_SHARDS;
+    return shard;
+}
+
+BlockHeader *pop_block(Shard &shard, uint32_t size_class) {
+    BlockHeader *block = shard.free_lists[size_class];
+    if (block != NULL) {
+        shard.free_lists[size_class] = block->next;
+    }
+    return block;
+}
+
+void *pool_allocate(size_t size, size_t alignment, void *context) {
+    Pool *pool = static_cast<Pool *>(context);
+    if (alignment > POOL_ALIGNMENT) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Pool allocator alignment is 64 bytes.");
+        return NULL;
+    }
+    pool->allocations++;
+
+    std::vector<size_t>::const_iterator found = std::lower_bound(pool->classes.begin(), pool->classes.end(), size);
+    if (found == pool->classes.end()) {
+        BlockHeader *block = system_allocate(size, NO_CLASS);
+        return block == NULL ? NULL : memory_of(block);
+    }
+    uint32_t size_class = static_cast<uint32_t>(found - pool->classes.begin());
+
+    // The shard of this thread first, then any other that is not busy
+    size_t own = shard_of_thread();
+    BlockHeader *block = NULL;
+    {
+        std::lock_guard<std::mutex> lock(pool->shards[own].mutex);
+        block = pop_block(pool->shards[own], size_class);
+    }
+    for (size_t n = 1; block == NULL && n < NUM_SHARDS; n++) {
+        Shard &shard = pool->shards[(own + n) % NUM_SHARDS];
+        std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+            block = pop_block(shard, size_class);
+        }
+    }
+    if (block != NULL) {
+        pool->reused++;
+        pool->cached_bytes -= block->capacity;
+        return memory_of(block);
+    }
+
+    block = system_allocate(*found, size_class);
+    return block == NULL ? NULL : memory_of(block);
+}
+
+void pool_release(void *ptr, void *context) {
+    if (ptr == NULL) {
+        return;
+    }
+    Pool *pool = static_cast<Pool *>(context);
+    BlockHeader *block = header_of(ptr);
+    if (block->size_class == NO_CLASS ||
+        pool->cached_bytes.fetch_add(block->capacity) + block->capacity > pool->max_cached_bytes) {
+        if (block->size_class != NO_CLASS) {
+            pool->cached_bytes -= block->capacity;
+        }
+        system_release(block);
+        return;
+    }
+    Shard &shard = pool->shards[shard_of_thread()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    block->next = shard.free_lists[block->size_class];
+    shard.free_lists[block->size_class] = block;
+}
+
+void *pool_reallocate(void *ptr, size_t size, size_t alignment, void *context) {
+    if (ptr == NULL) {
+        return pool_allocate(size, alignment, context);
+    }
+    // Keep the block unless it is too small or more than twice too big
+    BlockHeader *block = header_of(ptr);
+    if (size <= block->capacity && size > block->capacity / 2) {
+        return ptr;
+    }
+    void *newPtr = pool_allocate(size, alignment, context);
+    if (newPtr == NULL) {
+        return NULL;
+    }
+    memcpy(newPtr, ptr, std::min(size, block->capacity));
+    pool_release(ptr, context);
+    return newPtr;
+}
+
+bool is_pool_allocator(const ISMRMRD_Allocator *allocator) {
+    return allocator->allocate == pool_allocate && allocator->context != NULL;
+}
+
+} // namespace
+
+//
+// Current allocator
+//
+// Each distinct allocator that is set gets one owner, kept for the life of
+// the process: its buffers may outlive it as the current allocator, and a
+// call on another thread may still be using it. Setting an allocator again
+// finds its owner, so switching back and forth does not grow the list.
+//
+namespace {
+
+Owner default_owner(default_allocator);
+std::atomic<Owner *> current_owner(&default_owner);
+std::atomic<size_t> buffer_alignment(ISMRMRD_DEFAULT_ALIGNMENT);
+// Serializes the changes of the allocator and the alignment
+std::mutex settings_mutex;
+// Owners of the allocators set so far, other than the default one
+std::vector<Owner *> *owners = new std::vector<Owner *>();
+
+bool same_allocator(const ISMRMRD_Allocator &a, const ISMRMRD_Allocator &b) {
+    return a.allocate == b.allocate && a.reallocate == b.reallocate && a.release == b.release &&
+           a.context == b.context;
+}
+
+// Requires settings_mutex
+Owner *find_owner(const ISMRMRD_Allocator &allocator) {
+    if (same_allocator(default_owner.allocator, allocator)) {
+        return &default_owner;
+    }
+    for (std::vector<Owner *>::const_iterator owner = owners->begin(); owner != owners->end(); ++owner) {
+        if (same_allocator((*owner)->allocator, allocator)) {
+            return *owner;
+        }
+    }
+    return NULL;
+}
+
+} // namespace
+
+extern "C" {
+
+int ismrmrd_set_allocator(const ISMRMRD_Allocator *allocator) {
+    if (allocator != NULL &&
+        (allocator->allocate == NULL || allocator->reallocate == NULL || allocator->release == NULL)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Allocator functions should not be NULL.");
+    }
+    if (allocator == NULL) {
+        allocator = &default_allocator;
+    }
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    if (is_pool_allocator(allocator) && buffer_alignment.load() > POOL_ALIGNMENT) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pool allocator alignment is 64 bytes.");
+    }
+    Owner *owner = find_owner(*allocator);
+    if (owner == NULL) {
+        owner = new (std::nothrow) Owner(*allocator);
+        if (owner == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to copy allocator.");
+        }
+        try {
+            owners->push_back(owner);
+        } catch (const std::bad_alloc &) {
+            delete owner;
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to copy allocator.");
+        }
+    }
+    current_owner.store(owner);
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_get_allocator(ISMRMRD_Allocator *allocator) {
+    if (allocator == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+    *allocator = current_owner.load()->allocator;
+    return ISMRMRD_NOERROR;
+}
+
+void *ismrmrd_malloc(size_t size) {
+    Owner *owner = current_owner.load(std::memory_order_acquire);
+    const ISMRMRD_Allocator &allocator = owner->allocator;
+    void *ptr = allocator.allocate(size, buffer_alignment.load(std::memory_order_relaxed), allocator.context);
+    if (ptr != NULL && !record_block(ptr, owner, size)) {
+        allocator.release(ptr, allocator.context);
+        ptr = NULL;
+    }
+    return ptr;
+}
+
+void *ismrmrd_realloc(void *ptr, size_t size) {
+    Owner *owner = current_owner.load(std::memory_order_acquire);
+    size_t alignment = buffer_alignment.load(std::memory_order_relaxed);
+    BlockRecord record = {owner, 0};
+    if (ptr != NULL && !find_block(ptr, &record)) {
+        // Not from ismrmrd_malloc, it came from malloc
+        return realloc(ptr, size);
+    }
+    if (record.owner == owner) {
+        void *newPtr = owner->allocator.reallocate(ptr, size, alignment, owner->allocator.context);
+        if (newPtr == NULL) {
+            return NULL;
+        }
+        if (newPtr == ptr) {
+            record_block(ptr, owner, std::max(size, record.capacity));
+            return ptr;
+        }
+        if (ptr != NULL) {
+            take_block(ptr, &record);
+        }
+        if (!record_block(newPtr, owner, size)) {
+            owner->allocator.release(newPtr, owner->allocator.context);
+            return NULL;
+        }
+        return newPtr;
+    }
+    // Allocated before the allocator changed, it moves to the current one
+    void *newPtr = ismrmrd_malloc(size);
+    if (newPtr == NULL) {
+        return NULL;
+    }
+    memcpy(newPtr, ptr, std::min(size, record.capacity));
+    ismrmrd_free(ptr);
+    return newPtr;
+}
+
+void ismrmrd_free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    BlockRecord record;
+    if (!take_block(ptr, &record)) {
+        // Not from ismrmrd_malloc, it came from malloc
+        free(ptr);
+        return;
+    }
+    record.owner->allocator.release(ptr, record.owner->allocator.context);
+}
+
+int ismrmrd_set_buffer_alignment(size_t alignment) {
+    // posix_memalign also wants a multiple of the pointer size
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Alignment should be a power of two and at least the size of a pointer.");
+    }
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    if (is_pool_allocator(&current_owner.load()->allocator) && alignment > POOL_ALIGNMENT) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pool allocator alignment is 64 bytes.");
+    }
+    buffer_alignment.store(alignment);
+    return ISMRMRD_NOERROR;
+}
+
+size_t ismrmrd_get_buffer_alignment(void) {
+    return buffer_alignment.load();
+}
+
+int ismrmrd_create_pool_allocator(ISMRMRD_Allocator *allocator, size_t max_cached_bytes) {
+    if (allocator == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+    Pool *pool = new (std::nothrow) Pool(max_cached_bytes);
+    if (pool == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to create pool allocator.");
+    }
+    allocator->allocate = pool_allocate;
+    allocator->reallocate = pool_reallocate;
+    allocator->release = pool_release;
+    allocator->context = pool;
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_destroy_pool_allocator(ISMRMRD_Allocator *allocator) {
+    if (allocator == NULL || !is_pool_allocator(allocator)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not a pool allocator.");
+    }
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    if (current_owner.load()->allocator.context == allocator->context) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "The pool allocator is still in use.");
+    }
+    Owner *owner = find_owner(*allocator);
+    if (owner != NULL && owner->live.load() != 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Buffers of the pool allocator are still in use.");
+    }
+    Pool *pool = static_cast<Pool *>(allocator->context);
+    for (size_t n = 0; n < NUM_SHARDS; n++) {
+        for (size_t c = 0; c < pool->classes.size(); c++) {
+            while (BlockHeader *block = pop_block(pool->shards[n], static_cast<uint32_t>(c))) {
+                system_release(block);
+            }
+        }
+    }
+    delete pool;
+    memset(allocator, 0, sizeof(*allocator));
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_get_pool_allocator_stats(const ISMRMRD_Allocator *allocator, ISMRMRD_PoolAllocatorStats *stats) {
+    if (allocator == NULL || !is_pool_allocator(allocator)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not a pool allocator.");
+    }
+    if (stats == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+    const Pool *pool = static_cast<const Pool *>(allocator->context);
+    stats->allocations = pool->allocations;
+    stats->reused = pool->reused;
+    stats->cached_bytes = pool->cached_bytes;
+    return ISMRMRD_NOERROR;
+}
+
+} // extern "C"
+
+} // namespace ISMRMRD
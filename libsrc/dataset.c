@@ -1,3 +1,8 @@
+/* mmap is POSIX, not C99 */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 /* Language and Cross platform section for defining types */
 #ifdef __cplusplus
 #include <cstring>
@@ -10,6 +15,14 @@
 #include <stdio.h>
 #endif /* __cplusplus */
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include <hdf5.h>
 #include <ismrmrd/waveform.h>
 #include "ismrmrd/dataset.h"
@@ -23,6 +36,14 @@ extern "C" {
 /* Private (Static) Functions */
 /******************************/
 
+static hid_t file_of(const ISMRMRD_Dataset *dset);
+static int check_storage_policy(const ISMRMRD_StoragePolicy *policy);
+static int set_storage_policy_unlocked(const ISMRMRD_Dataset *dset, const char *varname,
+                                       const ISMRMRD_StoragePolicy *policy);
+static uint32_t get_number_of_acquisitions_unlocked(const ISMRMRD_Dataset *dset);
+struct AcquisitionReads;
+static void free_acquisition_reads(struct AcquisitionReads *reads);
+
 static herr_t walk_hdf5_errors(unsigned int n, const H5E_error2_t *desc, void *client_data)
 {
     (void)n;
@@ -31,8 +52,27 @@ static herr_t walk_hdf5_errors(unsigned int n, const H5E_error2_t *desc, void *c
     return 0;
 }
 
+static herr_t find_stale_heap(unsigned int n, const H5E_error2_t *desc, void *client_data)
+{
+    (void)n;
+    if (desc->maj_num == H5E_HEAP && desc->min_num == H5E_CANTPROTECT) {
+        *(bool *) client_data = true;
+    }
+    return 0;
+}
+
+/* True if the last HDF5 call failed because a global heap collection lies
+ * beyond the end of the file as a SWMR reader knows it, or is still being
+ * written. Other failures are not fixed by reopening the file. */
+static bool failed_on_stale_heap(void)
+{
+    bool stale = false;
+    H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, find_stale_heap, &stale);
+    return stale;
+}
+
 static bool link_exists(const ISMRMRD_Dataset *dset, const char *link_path) {
-    htri_t val = H5Lexists(dset->fileid, link_path, H5P_DEFAULT);
+    htri_t val = H5Lexists(file_of(dset), link_path, H5P_DEFAULT);
 
     if (NULL == dset) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
@@ -129,6 +169,365 @@ static char * append_to_path(const ISMRMRD_Dataset *dset,
     return newpath;
 }
 
+/******************************************/
+/* Private cache of open HDF5 identifiers */
+/******************************************/
+
+/* Datatypes are cached by slot. The first slots are the NDArray types
+ * indexed by ISMRMRD_DataTypes, the others are the compound types. */
+enum ISMRMRD_CachedTypes {
+    CACHED_TYPE_ACQUISITION = ISMRMRD_CXDOUBLE + 1,
+    CACHED_TYPE_ACQUISITION_HEAD,
+    CACHED_TYPE_ACQUISITION_INDEX,
+    CACHED_TYPE_WAVEFORM,
+    CACHED_TYPE_IMAGEHEADER,
+    CACHED_TYPE_ATTRIBUTE_STRING,
+    CACHED_TYPE_XMLHEADER,
+    CACHED_TYPE_COUNT
+};
+
+/* Contiguous datasets cannot be extended. They are created with room for a
+ * fixed number of elements and record how many of them are used in this attribute. */
+#define CONTIGUOUS_COUNT_ATTRIBUTE "ismrmrd_element_count"
+
+typedef struct ISMRMRD_CachedDataset {
+    char *path;
+    hid_t dataset;
+    /* Element count of a contiguous dataset, count_attribute is -1 for others */
+    hid_t count_attribute;
+    hsize_t count;
+} ISMRMRD_CachedDataset;
+
+typedef struct ISMRMRD_CachedPolicy {
+    char *path;
+    ISMRMRD_StoragePolicy policy;
+} ISMRMRD_CachedPolicy;
+
+typedef struct ISMRMRD_DatasetCache {
+    ISMRMRD_CachedDataset *datasets;
+    size_t num_datasets;
+    size_t max_datasets;
+    ISMRMRD_CachedPolicy *policies;
+    size_t num_policies;
+    /* Acquisition index, the first index_sorted entries are sorted */
+    int index_state;
+    bool index_dirty;
+    ISMRMRD_AcquisitionIndexEntry *index;
+    size_t index_size;
+    size_t index_sorted;
+    size_t index_capacity;
+    /* Single writer, multiple reader state, see ismrmrd_open_dataset_swmr */
+    int swmr_mode;
+    uint32_t swmr_flush_interval;
+    uint32_t swmr_unflushed;
+    uint32_t swmr_counts[2];
+    hid_t reader_fileid;
+    hid_t types[CACHED_TYPE_COUNT];
+    /* Reused by every ismrmrd_read_acquisitions, NULL until the first */
+    struct AcquisitionReads *reads;
+} ISMRMRD_DatasetCache;
+
+enum ISMRMRD_IndexStates {
+    INDEX_UNKNOWN = 0,
+    INDEX_ABSENT,
+    INDEX_LOADED
+};
+
+/* Reads retried while a SWMR writer is busy, waiting 0, 1, 2, 4, ... ms */
+#define SWMR_READ_RETRIES 10
+
+enum ISMRMRD_SwmrModes {
+    SWMR_OFF = 0,
+    SWMR_WRITER_OPEN,   /* latest file format, objects can still be created */
+    SWMR_WRITING,       /* after H5Fstart_swmr_write */
+    SWMR_READING
+};
+
+/* The open file. A SWMR reader reopens it to see what the writer appended,
+ * and as reads take a const dataset the current handle lives in the cache. */
+static hid_t file_of(const ISMRMRD_Dataset *dset) {
+    if (dset->cache != NULL && dset->cache->swmr_mode == SWMR_READING) {
+        return dset->cache->reader_fileid;
+    }
+    return dset->fileid;
+}
+
+/* The HDF5 backend is implemented by the public functions themselves */
+static const ISMRMRD_DatasetBackend hdf5_backend = {
+    "hdf5",
+    ismrmrd_open_dataset,
+    ismrmrd_close_dataset,
+    ismrmrd_flush_dataset,
+    ismrmrd_write_header,
+    ismrmrd_read_header,
+    ismrmrd_append_acquisitions,
+    ismrmrd_read_acquisitions,
+    ismrmrd_get_number_of_acquisitions,
+    ismrmrd_append_waveform,
+    ismrmrd_read_waveform,
+    ismrmrd_get_number_of_waveforms,
+    ismrmrd_append_images,
+    ismrmrd_read_images,
+    ismrmrd_get_number_of_images,
+    ismrmrd_append_array,
+    ismrmrd_read_array,
+    ismrmrd_get_number_of_arrays
+};
+
+/* Whether the dataset is handled by a backend other than HDF5 */
+static bool uses_backend(const ISMRMRD_Dataset *dset) {
+    return dset->backend != NULL && dset->backend != &hdf5_backend;
+}
+
+/* True if path is prefix itself or an object below it */
+static bool path_is_below(const char *path, const char *prefix) {
+    size_t len = strlen(prefix);
+    return strncmp(path, prefix, len) == 0 && (path[len] == '\0' || path[len] == '/');
+}
+
+static int create_cache(ISMRMRD_Dataset *dset) {
+    int n;
+    ISMRMRD_DatasetCache *cache = (ISMRMRD_DatasetCache *) malloc(sizeof(ISMRMRD_DatasetCache));
+    if (cache == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc dataset cache");
+    }
+    cache->datasets = NULL;
+    cache->num_datasets = 0;
+    cache->max_datasets = 0;
+    cache->policies = NULL;
+    cache->num_policies = 0;
+    cache->index_state = INDEX_UNKNOWN;
+    cache->index_dirty = false;
+    cache->index = NULL;
+    cache->index_size = 0;
+    cache->index_sorted = 0;
+    cache->index_capacity = 0;
+    cache->swmr_mode = SWMR_OFF;
+    cache->swmr_flush_interval = 0;
+    cache->swmr_unflushed = 0;
+    cache->swmr_counts[0] = cache->swmr_counts[1] = (uint32_t) -1;
+    cache->reader_fileid = -1;
+    for (n = 0; n < CACHED_TYPE_COUNT; n++) {
+        cache->types[n] = -1;
+    }
+    cache->reads = NULL;
+    dset->cache = cache;
+    return ISMRMRD_NOERROR;
+}
+
+static int close_cached_entry(ISMRMRD_CachedDataset *entry) {
+    int status = ISMRMRD_NOERROR;
+
+    if ((entry->count_attribute >= 0 && H5Aclose(entry->count_attribute) < 0) ||
+        H5Dclose(entry->dataset) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        status = ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close dataset");
+    }
+    free(entry->path);
+    return status;
+}
+
+static int free_cache(ISMRMRD_Dataset *dset) {
+    int status = ISMRMRD_NOERROR;
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    size_t n;
+
+    if (cache == NULL) {
+        return ISMRMRD_NOERROR;
+    }
+    for (n = 0; n < cache->num_datasets; n++) {
+        if (close_cached_entry(&cache->datasets[n]) != ISMRMRD_NOERROR) {
+            status = ISMRMRD_HDF5ERROR;
+        }
+    }
+    free(cache->datasets);
+    for (n = 0; n < cache->num_policies; n++) {
+        free(cache->policies[n].path);
+    }
+    free(cache->policies);
+    free(cache->index);
+    free_acquisition_reads(cache->reads);
+    for (n = 0; n < CACHED_TYPE_COUNT; n++) {
+        if (cache->types[n] >= 0 && H5Tclose(cache->types[n]) < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype");
+        }
+    }
+    free(cache);
+    dset->cache = NULL;
+    return status;
+}
+
+static int add_cached_dataset(const ISMRMRD_Dataset *dset, const char *path, hid_t dataset) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    ISMRMRD_CachedDataset *entry;
+
+    if (cache == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open");
+    }
+    if (cache->num_datasets == cache->max_datasets) {
+        size_t max_datasets = cache->max_datasets == 0 ? 8 : 2 * cache->max_datasets;
+        ISMRMRD_CachedDataset *newPtr = (ISMRMRD_CachedDataset *) realloc(cache->datasets,
+                max_datasets * sizeof(ISMRMRD_CachedDataset));
+        if (newPtr == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc dataset cache");
+        }
+        cache->datasets = newPtr;
+        cache->max_datasets = max_datasets;
+    }
+    entry = &cache->datasets[cache->num_datasets];
+    entry->path = (char *) malloc(strlen(path) + 1);
+    if (entry->path == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc cached path");
+    }
+    strcpy(entry->path, path);
+    entry->dataset = dataset;
+    entry->count_attribute = -1;
+    entry->count = 0;
+
+    /* The element count of a contiguous dataset is read once and kept up to date */
+    if (H5Aexists(dataset, CONTIGUOUS_COUNT_ATTRIBUTE) > 0) {
+        uint64_t value;
+        entry->count_attribute = H5Aopen(dataset, CONTIGUOUS_COUNT_ATTRIBUTE, H5P_DEFAULT);
+        if (entry->count_attribute < 0 || H5Aread(entry->count_attribute, H5T_NATIVE_UINT64, &value) < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            if (entry->count_attribute >= 0) {
+                H5Aclose(entry->count_attribute);
+            }
+            free(entry->path);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to read element count.");
+        }
+        entry->count = (hsize_t) value;
+    }
+    cache->num_datasets++;
+    return ISMRMRD_NOERROR;
+}
+
+static hid_t find_cached_dataset(const ISMRMRD_Dataset *dset, const char *path) {
+    size_t n;
+    if (dset->cache == NULL) {
+        return -1;
+    }
+    for (n = 0; n < dset->cache->num_datasets; n++) {
+        if (strcmp(dset->cache->datasets[n].path, path) == 0) {
+            return dset->cache->datasets[n].dataset;
+        }
+    }
+    return -1;
+}
+
+static ISMRMRD_CachedDataset *find_cache_entry(const ISMRMRD_Dataset *dset, hid_t dataset) {
+    size_t n;
+    if (dset->cache == NULL) {
+        return NULL;
+    }
+    for (n = 0; n < dset->cache->num_datasets; n++) {
+        if (dset->cache->datasets[n].dataset == dataset) {
+            return &dset->cache->datasets[n];
+        }
+    }
+    return NULL;
+}
+
+static void remove_cached_dataset(const ISMRMRD_Dataset *dset, const char *path) {
+    size_t n;
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    if (cache == NULL) {
+        return;
+    }
+    for (n = 0; n < cache->num_datasets; n++) {
+        if (strcmp(cache->datasets[n].path, path) == 0) {
+            close_cached_entry(&cache->datasets[n]);
+            cache->datasets[n] = cache->datasets[cache->num_datasets - 1];
+            cache->num_datasets--;
+            return;
+        }
+    }
+}
+
+/* Returns the most specific storage policy covering path, or NULL */
+static const ISMRMRD_StoragePolicy *find_storage_policy(const ISMRMRD_Dataset *dset, const char *path) {
+    const ISMRMRD_CachedPolicy *best = NULL;
+    size_t n;
+    if (dset->cache == NULL) {
+        return NULL;
+    }
+    for (n = 0; n < dset->cache->num_policies; n++) {
+        const ISMRMRD_CachedPolicy *entry = &dset->cache->policies[n];
+        if (path_is_below(path, entry->path) &&
+            (best == NULL || strlen(entry->path) > strlen(best->path))) {
+            best = entry;
+        }
+    }
+    return best == NULL ? NULL : &best->policy;
+}
+
+/* Returns a dataset access property list applying the chunk cache policy of path.
+ * Returns H5P_DEFAULT if there is nothing to set, otherwise the caller closes it. */
+static hid_t create_dataset_access_plist(const ISMRMRD_Dataset *dset, const char *path) {
+    const ISMRMRD_StoragePolicy *policy = find_storage_policy(dset, path);
+    hid_t dapl;
+
+    if (policy == NULL || (policy->chunk_cache_bytes == 0 && policy->chunk_cache_slots == 0)) {
+        return H5P_DEFAULT;
+    }
+    dapl = H5Pcreate(H5P_DATASET_ACCESS);
+    if (dapl < 0) {
+        return H5P_DEFAULT;
+    }
+    H5Pset_chunk_cache(dapl,
+            policy->chunk_cache_slots > 0 ? policy->chunk_cache_slots : H5D_CHUNK_CACHE_NSLOTS_DEFAULT,
+            policy->chunk_cache_bytes > 0 ? policy->chunk_cache_bytes : H5D_CHUNK_CACHE_NBYTES_DEFAULT,
+            H5D_CHUNK_CACHE_W0_DEFAULT);
+    return dapl;
+}
+
+/* Returns the open dataset at path or -1 if it does not exist.
+ * The handle is owned by the cache and must not be closed by the caller. */
+static hid_t open_cached_dataset(const ISMRMRD_Dataset *dset, const char *path) {
+    hid_t dapl;
+    hid_t dataset = find_cached_dataset(dset, path);
+    if (dataset >= 0) {
+        return dataset;
+    }
+    if (!link_exists(dset, path)) {
+        return -1;
+    }
+    dapl = create_dataset_access_plist(dset, path);
+    dataset = H5Dopen2(file_of(dset), path, dapl);
+    if (dapl != H5P_DEFAULT) {
+        H5Pclose(dapl);
+    }
+    if (dataset < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to open dataset");
+        return -1;
+    }
+    if (add_cached_dataset(dset, path, dataset) != ISMRMRD_NOERROR) {
+        H5Dclose(dataset);
+        return -1;
+    }
+    return dataset;
+}
+
+/* Closes every cached dataset, e.g. before H5Fstart_swmr_write */
+static int close_cached_datasets(const ISMRMRD_Dataset *dset) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    int status = ISMRMRD_NOERROR;
+    size_t n;
+
+    for (n = 0; n < cache->num_datasets; n++) {
+        if (close_cached_entry(&cache->datasets[n]) != ISMRMRD_NOERROR) {
+            status = ISMRMRD_HDF5ERROR;
+        }
+    }
+    cache->num_datasets = 0;
+    return status;
+}
+
+/* Defined in dataset.cpp */
+void ismrmrd_sleep_without_hdf5_lock(uint32_t ms);
+
 static int delete_var(const ISMRMRD_Dataset *dset, const char *var) {
     int status = ISMRMRD_NOERROR;
     herr_t h5status;
@@ -139,6 +538,7 @@ static int delete_var(const ISMRMRD_Dataset *dset, const char *var) {
     }
 
     path = make_path(dset, var);
+    remove_cached_dataset(dset, path);
     if (link_exists(dset, path)) {
         h5status = H5Ldelete(dset->fileid, path, H5P_DEFAULT);
         if (h5status < 0) {
@@ -334,6 +734,48 @@ static hid_t get_hdf5type_acquisitionheader(void) {
     return datatype;   
 }
 
+/* The acquisition compound with only its head member, the HDF5 library
+ * skips the variable length fields when reading with this type */
+static hid_t get_hdf5type_acquisition_head(void) {
+    hid_t datatype, vartype;
+    herr_t h5status;
+
+    datatype = H5Tcreate(H5T_COMPOUND, sizeof(ISMRMRD_AcquisitionHeader));
+    vartype = get_hdf5type_acquisitionheader();
+    h5status = H5Tinsert(datatype, "head", 0, vartype);
+    H5Tclose(vartype);
+
+    if (h5status < 0) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed get acquisition head data type");
+    }
+
+    return datatype;
+}
+
+static hid_t get_hdf5type_acquisition_index(void) {
+    hid_t datatype;
+    herr_t h5status;
+
+    datatype = H5Tcreate(H5T_COMPOUND, sizeof(ISMRMRD_AcquisitionIndexEntry));
+    h5status = H5Tinsert(datatype, "flags", HOFFSET(ISMRMRD_AcquisitionIndexEntry, flags), H5T_NATIVE_UINT64);
+    h5status = H5Tinsert(datatype, "acquisition", HOFFSET(ISMRMRD_AcquisitionIndexEntry, acquisition), H5T_NATIVE_UINT32);
+    h5status = H5Tinsert(datatype, "slice", HOFFSET(ISMRMRD_AcquisitionIndexEntry, slice), H5T_NATIVE_UINT16);
+    h5status = H5Tinsert(datatype, "contrast", HOFFSET(ISMRMRD_AcquisitionIndexEntry, contrast), H5T_NATIVE_UINT16);
+    h5status = H5Tinsert(datatype, "repetition", HOFFSET(ISMRMRD_AcquisitionIndexEntry, repetition), H5T_NATIVE_UINT16);
+    h5status = H5Tinsert(datatype, "phase", HOFFSET(ISMRMRD_AcquisitionIndexEntry, phase), H5T_NATIVE_UINT16);
+    h5status = H5Tinsert(datatype, "set", HOFFSET(ISMRMRD_AcquisitionIndexEntry, set), H5T_NATIVE_UINT16);
+    h5status = H5Tinsert(datatype, "average", HOFFSET(ISMRMRD_AcquisitionIndexEntry, average), H5T_NATIVE_UINT16);
+    h5status = H5Tinsert(datatype, "segment", HOFFSET(ISMRMRD_AcquisitionIndexEntry, segment), H5T_NATIVE_UINT16);
+    h5status = H5Tinsert(datatype, "kspace_encode_step_2", HOFFSET(ISMRMRD_AcquisitionIndexEntry, kspace_encode_step_2), H5T_NATIVE_UINT16);
+    h5status = H5Tinsert(datatype, "kspace_encode_step_1", HOFFSET(ISMRMRD_AcquisitionIndexEntry, kspace_encode_step_1), H5T_NATIVE_UINT16);
+
+    if (h5status < 0) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed get acquisition index data type");
+    }
+
+    return datatype;
+}
+
 static hid_t get_hdf5type_acquisition(void) {
     hid_t datatype, vartype, vlvartype;
     herr_t h5status;
@@ -579,30 +1021,119 @@ static uint16_t get_ndarray_data_type(hid_t hdf5type) {
     return dtype;
 }
 
+/* Returns the cached datatype for slot, creating it on first use.
+ * The datatype is owned by the cache and must not be closed by the caller. */
+static hid_t get_cached_type(const ISMRMRD_Dataset *dset, int slot) {
+    hid_t datatype;
+
+    if (NULL == dset->cache) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open");
+        return -1;
+    }
+    if (slot <= 0 || slot >= CACHED_TYPE_COUNT) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_TYPEERROR, "Failed to get HDF5 data type.");
+        return -1;
+    }
+    if (dset->cache->types[slot] >= 0) {
+        return dset->cache->types[slot];
+    }
+
+    switch (slot) {
+        case CACHED_TYPE_ACQUISITION:
+            datatype = get_hdf5type_acquisition();
+            break;
+        case CACHED_TYPE_ACQUISITION_HEAD:
+            datatype = get_hdf5type_acquisition_head();
+            break;
+        case CACHED_TYPE_ACQUISITION_INDEX:
+            datatype = get_hdf5type_acquisition_index();
+            break;
+        case CACHED_TYPE_WAVEFORM:
+            datatype = get_hdf5type_waveform();
+            break;
+        case CACHED_TYPE_IMAGEHEADER:
+            datatype = get_hdf5type_imageheader();
+            break;
+        case CACHED_TYPE_ATTRIBUTE_STRING:
+            datatype = get_hdf5type_image_attribute_string();
+            break;
+        case CACHED_TYPE_XMLHEADER:
+            datatype = get_hdf5type_xmlheader();
+            break;
+        default:
+            datatype = get_hdf5type_ndarray((uint16_t) slot);
+    }
+    dset->cache->types[slot] = datatype;
+    return datatype;
+}
+
+/* Returns true and sets *count for contiguous datasets, which must be cached */
+static bool get_contiguous_count(const ISMRMRD_Dataset *dset, hid_t dataset, hsize_t *count)
+{
+    const ISMRMRD_CachedDataset *entry = find_cache_entry(dset, dataset);
+
+    if (entry == NULL || entry->count_attribute < 0) {
+        return false;
+    }
+    *count = entry->count;
+    return true;
+}
+
+/* Sets the element count of a cached dataset, making it contiguous */
+static int set_contiguous_count(const ISMRMRD_Dataset *dset, hid_t dataset, hsize_t count)
+{
+    ISMRMRD_CachedDataset *entry = find_cache_entry(dset, dataset);
+    uint64_t value = (uint64_t) count;
+    hid_t dataspace;
+
+    if (entry == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not cached.");
+    }
+    if (entry->count_attribute < 0) {
+        dataspace = H5Screate(H5S_SCALAR);
+        entry->count_attribute = H5Acreate2(dataset, CONTIGUOUS_COUNT_ATTRIBUTE, H5T_NATIVE_UINT64,
+                dataspace, H5P_DEFAULT, H5P_DEFAULT);
+        H5Sclose(dataspace);
+        if (entry->count_attribute < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to create element count.");
+        }
+    }
+    if (H5Awrite(entry->count_attribute, H5T_NATIVE_UINT64, &value) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to write element count.");
+    }
+    entry->count = count;
+    return ISMRMRD_NOERROR;
+}
+
 static uint32_t get_number_of_elements(const ISMRMRD_Dataset *dset, const char * path)
 {
     herr_t h5status;
     uint32_t num;
+    hid_t dataset;
 
     if (NULL == dset) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
         return 0;
     }
 
-    if (link_exists(dset, path)) {
-        hid_t dataset, dataspace;
+    dataset = open_cached_dataset(dset, path);
+    if (dataset >= 0) {
+        hid_t dataspace;
         hsize_t rank, *dims, *maxdims;
-        dataset = H5Dopen2(dset->fileid, path, H5P_DEFAULT);
         dataspace = H5Dget_space(dataset);
         rank = H5Sget_simple_extent_ndims(dataspace);
         dims = (hsize_t *) malloc(rank*sizeof(hsize_t));
         maxdims = (hsize_t *) malloc(rank*sizeof(hsize_t));
         h5status = H5Sget_simple_extent_dims(dataspace, dims, maxdims);
         num = dims[0];
+        if (get_contiguous_count(dset, dataset, &dims[0])) {
+            num = dims[0];
+        }
         free(dims);
         free(maxdims);
         h5status = H5Sclose(dataspace);
-        h5status= H5Dclose(dataset);
         if (h5status < 0) {
             H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
             ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR,
@@ -617,153 +1148,383 @@ static uint32_t get_number_of_elements(const ISMRMRD_Dataset *dset, const char *
     return num;
 }
 
-static int append_element(const ISMRMRD_Dataset * dset, const char * path,
-        void * elem, const hid_t datatype,
-        const uint16_t ndim, const size_t *dims)
-{
-    hid_t dataset, dataspace, props, filespace, memspace;
-    herr_t h5status = 0;
-    hsize_t *hdfdims = NULL, *ext_dims = NULL, *offset = NULL, *maxdims = NULL, *chunk_dims = NULL;
-    int n = 0, rank = 0;
-    
-    if (NULL == dset) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+/* The SWMR writer records the number of acquisitions and waveforms which are
+ * completely on disk in the swmr_counts variable after every flush. The extents
+ * alone are not enough: SWMR covers the chunked datasets but not the global heap
+ * holding the variable length payloads, so readers trust the counts instead. */
+static int swmr_publish(const ISMRMRD_Dataset *dset) {
+    uint32_t counts[2];
+    hid_t dataset;
+    char *path;
+
+    if (H5Fflush(dset->fileid, H5F_SCOPE_LOCAL) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to flush dataset.");
     }
+    path = make_path(dset, "data");
+    counts[0] = get_number_of_elements(dset, path);
+    free(path);
+    path = make_path(dset, "waveforms");
+    counts[1] = get_number_of_elements(dset, path);
+    free(path);
 
-    /* Check the path and find rank */
-    if (link_exists(dset, path)) {
-        /* open dataset */
-        dataset = H5Dopen2(dset->fileid, path, H5P_DEFAULT);
-        /* TODO check that the header dataset's datatype is correct */
-        dataspace = H5Dget_space(dataset);
-        rank = H5Sget_simple_extent_ndims(dataspace);
-        if (rank != ndim + 1) {
-            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dimensions are incorrect.");
+    path = make_path(dset, "swmr_counts");
+    dataset = open_cached_dataset(dset, path);
+    free(path);
+    if (dataset < 0 || H5Dwrite(dataset, H5T_NATIVE_UINT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, counts) < 0 ||
+        H5Dflush(dataset) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to write SWMR counts.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+/* Makes the appended elements visible to SWMR readers every flush interval */
+static int swmr_appended(const ISMRMRD_Dataset *dset, size_t n) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+
+    if (cache == NULL || cache->swmr_mode != SWMR_WRITING) {
+        return ISMRMRD_NOERROR;
+    }
+    cache->swmr_unflushed += (uint32_t) n;
+    if (cache->swmr_unflushed < cache->swmr_flush_interval) {
+        return ISMRMRD_NOERROR;
+    }
+    cache->swmr_unflushed = 0;
+    return swmr_publish(dset);
+}
+
+/* Picks up the elements published by a SWMR writer. The file stays open, the
+ * dataset at path, if any, and the counts are refreshed in place. */
+static int swmr_refresh(const ISMRMRD_Dataset *dset, const char *path) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    hid_t dataset;
+    char *countspath;
+
+    if (cache == NULL || cache->swmr_mode != SWMR_READING) {
+        return ISMRMRD_NOERROR;
+    }
+    dataset = path == NULL ? -1 : find_cached_dataset(dset, path);
+    if (dataset >= 0 && H5Drefresh(dataset) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to refresh dataset.");
+    }
+
+    /* Without counts, e.g. once the file has been closed, the extents are complete */
+    countspath = make_path(dset, "swmr_counts");
+    dataset = open_cached_dataset(dset, countspath);
+    free(countspath);
+    if (dataset < 0) {
+        cache->swmr_counts[0] = cache->swmr_counts[1] = (uint32_t) -1;
+        return ISMRMRD_NOERROR;
+    }
+    if (H5Drefresh(dataset) < 0 || H5Dread(dataset, H5T_NATIVE_UINT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, cache->swmr_counts) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to read SWMR counts.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+/* A SWMR reader only sees the global heap holding the variable length payloads
+ * up to the end of the file when it was opened, so a read of payloads appended
+ * since then fails until the file is reopened. The file id of the dataset is
+ * not changed, see file_of. */
+static int swmr_reopen(const ISMRMRD_Dataset *dset) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    hid_t fapl;
+
+    if (close_cached_datasets(dset) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close datasets.");
+    }
+    if (cache->reader_fileid >= 0) {
+        if (H5Fclose(cache->reader_fileid) < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close file.");
         }
-    } else {
-        dataset   = -1; /* will be initialized below */
-        dataspace = -1; /* will be initialized below */
-        rank = ndim + 1;
+        cache->reader_fileid = -1;
+    }
+    /* Until the file is open again every access fails with an invalid id */
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+    cache->reader_fileid = H5Fopen(dset->filename, H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, fapl);
+    H5Pclose(fapl);
+    if (cache->reader_fileid < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to reopen file.");
     }
+    return swmr_refresh(dset, NULL);
+}
+
+/* Creates an extendible dataset of nelem elements of dims with the storage
+ * policy of its path and caches it. Returns the dataset or a negative value. */
+static hid_t create_extendible_dataset(const ISMRMRD_Dataset *dset, const char *path, const hid_t datatype,
+        const uint16_t ndim, const size_t *dims, const size_t nelem)
+{
+    const ISMRMRD_StoragePolicy *policy = find_storage_policy(dset, path);
+    size_t element_size = H5Tget_size(datatype);
+    hid_t dataset, dataspace, props, dapl;
+    hsize_t *hdfdims, *maxdims, *chunk_dims;
+    herr_t h5status = 0;
+    int n, rank = ndim + 1;
 
     hdfdims = (hsize_t *) malloc(rank * sizeof(hsize_t));
     maxdims = (hsize_t *) malloc(rank * sizeof(hsize_t));
-    offset = (hsize_t *) malloc(rank * sizeof(hsize_t));
-    ext_dims = (hsize_t *) malloc(rank * sizeof(hsize_t));
     chunk_dims = (hsize_t *) malloc(rank * sizeof(hsize_t));
 
-    /* extend or create if needed, and select the last block */
-    if (link_exists(dset, path)) {
-        h5status = H5Sget_simple_extent_dims(dataspace, hdfdims, maxdims);
-        for (n = 0; n<ndim; n++) {
-            if (dims[n] != hdfdims[n+1]) {
-                free(hdfdims);
-                free(ext_dims);
-                free(offset);
-                free(maxdims);
-                free(chunk_dims);
-                return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dimensions are incorrect.");
-            }
+    hdfdims[0] = nelem;
+    maxdims[0] = H5S_UNLIMITED;
+    if (policy != NULL && policy->contiguous_elements > 0) {
+        if (nelem > policy->contiguous_elements) {
+            free(hdfdims);
+            free(maxdims);
+            free(chunk_dims);
+            ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Contiguous dataset is too small");
+            return -1;
         }
-        /* extend it by one */
-        hdfdims[0] += 1;
-        h5status = H5Dset_extent(dataset, hdfdims);
-        /* Select the last block */
-        ext_dims[0] = 1;
-        for (n = 0; n < ndim; n++) {
-            offset[n + 1] = 0;
-            ext_dims[n + 1] = dims[n];
+        hdfdims[0] = maxdims[0] = policy->contiguous_elements;
+    }
+    for (n = 0; n < ndim; n++) {
+        hdfdims[n + 1] = dims[n];
+        maxdims[n + 1] = dims[n];
+        chunk_dims[n + 1] = dims[n];
+        element_size *= dims[n];
+    }
+    /* one element per chunk reads fastest at random, see ismrmrd_suggested_chunk_elements */
+    chunk_dims[0] = 1;
+    if (policy != NULL && policy->chunk_elements > 0) {
+        chunk_dims[0] = policy->chunk_elements;
+    }
+    dataspace = H5Screate_simple(rank, hdfdims, maxdims);
+    props = H5Pcreate(H5P_DATASET_CREATE);
+    if (policy != NULL && policy->contiguous_elements > 0) {
+        /* allocated up front so that the elements have a file address */
+        h5status = H5Pset_layout(props, H5D_CONTIGUOUS);
+        if (h5status >= 0) {
+            h5status = H5Pset_alloc_time(props, H5D_ALLOC_TIME_EARLY);
         }
     } else {
-        hdfdims[0] = 1;
-        maxdims[0] = H5S_UNLIMITED;
-        ext_dims[0] = 1;
-        chunk_dims[0] = 1;
-        for (n = 0; n < ndim; n++) {
-            hdfdims[n + 1] = dims[n];
-            maxdims[n + 1] = dims[n];
-            offset[n + 1] = 0;
-            ext_dims[n + 1] = dims[n];
-            chunk_dims[n + 1] = dims[n];
-        }
-        dataspace = H5Screate_simple(rank, hdfdims, maxdims);
-        props = H5Pcreate(H5P_DATASET_CREATE);
         /* enable chunking so that the dataset is extensible */
         h5status = H5Pset_chunk (props, rank, chunk_dims);
-        /* create */
-        dataset = H5Dcreate2(dset->fileid, path, datatype, dataspace, H5P_DEFAULT, props,  H5P_DEFAULT);
-        if (dataset < 0) {
-            free(hdfdims);
-            free(ext_dims);
-            free(offset);
-            free(maxdims);
-            free(chunk_dims);
-            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create dataset");
+    }
+    if (policy != NULL && policy->contiguous_elements == 0) {
+        /* shuffle must come first to help the compressors */
+        if (h5status >= 0 && policy->shuffle) {
+            h5status = H5Pset_shuffle(props);
         }
-        h5status = H5Pclose(props);
-        if (h5status < 0) {
-            free(hdfdims);
-            free(ext_dims);
-            free(offset);
-            free(maxdims);
-            free(chunk_dims);
-            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close property list");
+        /* a plugin compressor replaces deflate rather than feeding it compressed data */
+        if (h5status >= 0 && policy->filter_id > 0) {
+            h5status = H5Pset_filter(props, (H5Z_filter_t) policy->filter_id, H5Z_FLAG_MANDATORY,
+                    policy->filter_nvalues, (const unsigned int *) policy->filter_values);
+        } else if (h5status >= 0 && policy->deflate_level > 0) {
+            h5status = H5Pset_deflate(props, policy->deflate_level);
+        }
+        switch (h5status >= 0 ? policy->alloc_time : ISMRMRD_ALLOC_TIME_DEFAULT) {
+            case ISMRMRD_ALLOC_TIME_EARLY:
+                h5status = H5Pset_alloc_time(props, H5D_ALLOC_TIME_EARLY);
+                break;
+            case ISMRMRD_ALLOC_TIME_INCREMENTAL:
+                h5status = H5Pset_alloc_time(props, H5D_ALLOC_TIME_INCR);
+                break;
+            case ISMRMRD_ALLOC_TIME_LATE:
+                h5status = H5Pset_alloc_time(props, H5D_ALLOC_TIME_LATE);
+                break;
+            default:
+                break;
         }
     }
-
-    /* Select the last block */
-    offset[0] = hdfdims[0]-1;
-    filespace = H5Dget_space(dataset);
-    h5status  = H5Sselect_hyperslab (filespace, H5S_SELECT_SET, offset, NULL, ext_dims, NULL);
-	
-	if (h5status < 0) {
-	
-		H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-		return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to select hyperslab");
-	}
-    memspace = H5Screate_simple(rank, ext_dims, NULL);
-
     free(hdfdims);
-    free(ext_dims);
-    free(offset);
     free(maxdims);
     free(chunk_dims);
-
-    /* Write it */
-    /* since this is a 1 element array we can just pass the pointer to the header */
-    h5status = H5Dwrite(dataset, datatype, memspace, filespace, H5P_DEFAULT, elem);
     if (h5status < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to write dataset");
+        H5Pclose(props);
+        H5Sclose(dataspace);
+        return -1;
     }
 
-    /* Clean up */
-    h5status = H5Sclose(dataspace);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close dataspace");
+    /* create */
+    dapl = create_dataset_access_plist(dset, path);
+    dataset = H5Dcreate2(dset->fileid, path, datatype, dataspace, H5P_DEFAULT, props, dapl);
+    if (dapl != H5P_DEFAULT) {
+        H5Pclose(dapl);
     }
-    h5status = H5Sclose(filespace);
-    if (h5status < 0) {
+    H5Pclose(props);
+    H5Sclose(dataspace);
+    if (dataset < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close filespace");
+        return -1;
     }
-    h5status = H5Sclose(memspace);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close memspace");
+    if (add_cached_dataset(dset, path, dataset) != ISMRMRD_NOERROR) {
+        H5Dclose(dataset);
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Failed to cache dataset");
+        return -1;
     }
-    h5status = H5Dclose(dataset);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close dataset");
+    if (policy != NULL && policy->contiguous_elements > 0 &&
+            set_contiguous_count(dset, dataset, nelem) != ISMRMRD_NOERROR) {
+        remove_cached_dataset(dset, path);
+        return -1;
+    }
+    return dataset;
+}
+
+/* Extends the dataset at path by nelem elements, creating it if needed.
+ * On success *start is the index of the first of the new elements. */
+static int extend_elements(const ISMRMRD_Dataset * dset, const char * path,
+        const hid_t datatype, const uint16_t ndim, const size_t *dims,
+        const size_t nelem, hsize_t *start)
+{
+    hid_t dataset, dataspace;
+    herr_t h5status = 0;
+    hsize_t hdfdims[ISMRMRD_NDARRAY_MAXDIM + 1];
+    int n = 0, rank = 0;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+    if (ndim > ISMRMRD_NDARRAY_MAXDIM) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Too many dimensions.");
+    }
+
+    dataset = open_cached_dataset(dset, path);
+    if (dataset < 0) {
+        /* create it with room for the new elements */
+        dataset = create_extendible_dataset(dset, path, datatype, ndim, dims, nelem);
+        if (dataset < 0) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create dataset");
+        }
+        *start = 0;
+        return ISMRMRD_NOERROR;
+    }
+
+    /* TODO check that the header dataset's datatype is correct */
+    dataspace = H5Dget_space(dataset);
+    rank = H5Sget_simple_extent_ndims(dataspace);
+    if (rank != ndim + 1) {
+        H5Sclose(dataspace);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dimensions are incorrect.");
+    }
+    h5status = H5Sget_simple_extent_dims(dataspace, hdfdims, NULL);
+    H5Sclose(dataspace);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to get dataset dimensions");
+    }
+    for (n = 0; n < ndim; n++) {
+        if (dims[n] != hdfdims[n+1]) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dimensions are incorrect.");
+        }
+    }
+
+    /* contiguous datasets have a fixed size, use up nelem of the free elements */
+    if (get_contiguous_count(dset, dataset, start)) {
+        if (*start + nelem > hdfdims[0]) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Contiguous dataset is full.");
+        }
+        return set_contiguous_count(dset, dataset, *start + nelem);
+    }
+
+    /* extend it by nelem */
+    *start = hdfdims[0];
+    hdfdims[0] += nelem;
+    h5status = H5Dset_extent(dataset, hdfdims);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to extend dataset");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+/* Writes nelem contiguous elements to the block of the dataset at path
+ * starting at start, which must already be within its extent. */
+static int write_elements(const ISMRMRD_Dataset * dset, const char * path,
+        void * elems, const hid_t datatype,
+        const uint16_t ndim, const size_t *dims, const hsize_t start, const size_t nelem)
+{
+    hid_t dataset, filespace, memspace;
+    herr_t h5status = 0;
+    hsize_t offset[ISMRMRD_NDARRAY_MAXDIM + 1], ext_dims[ISMRMRD_NDARRAY_MAXDIM + 1];
+    int n = 0, rank = ndim + 1;
+
+    dataset = open_cached_dataset(dset, path);
+    if (dataset < 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open dataset");
+    }
+
+    /* Select the block */
+    offset[0] = start;
+    ext_dims[0] = nelem;
+    for (n = 0; n < ndim; n++) {
+        offset[n + 1] = 0;
+        ext_dims[n + 1] = dims[n];
+    }
+    filespace = H5Dget_space(dataset);
+    h5status  = H5Sselect_hyperslab (filespace, H5S_SELECT_SET, offset, NULL, ext_dims, NULL);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        H5Sclose(filespace);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to select hyperslab");
+    }
+    memspace = H5Screate_simple(rank, ext_dims, NULL);
+
+    /* Write it */
+    /* the elements are contiguous in memory so we can pass the pointer to the first one */
+    h5status = H5Dwrite(dataset, datatype, memspace, filespace, H5P_DEFAULT, elems);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        H5Sclose(filespace);
+        H5Sclose(memspace);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to write dataset");
+    }
+
+    /* Clean up */
+    h5status = H5Sclose(filespace);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close filespace");
+    }
+    h5status = H5Sclose(memspace);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close memspace");
     }
 
     return ISMRMRD_NOERROR;
 }
 
+/* Appends nelem elements and returns the index of the first in start */
+static int append_elements_at(const ISMRMRD_Dataset * dset, const char * path,
+        void * elems, const hid_t datatype,
+        const uint16_t ndim, const size_t *dims, const size_t nelem, hsize_t *start)
+{
+    int status;
+
+    /* Nothing to write */
+    if (nelem == 0) {
+        return ISMRMRD_NOERROR;
+    }
+
+    status = extend_elements(dset, path, datatype, ndim, dims, nelem, start);
+    if (status != ISMRMRD_NOERROR) {
+        return status;
+    }
+    return write_elements(dset, path, elems, datatype, ndim, dims, *start, nelem);
+}
+
+static int append_elements(const ISMRMRD_Dataset * dset, const char * path,
+        void * elems, const hid_t datatype,
+        const uint16_t ndim, const size_t *dims, const size_t nelem)
+{
+    hsize_t start = 0;
+    return append_elements_at(dset, path, elems, datatype, ndim, dims, nelem, &start);
+}
+
+static int append_element(const ISMRMRD_Dataset * dset, const char * path,
+        void * elem, const hid_t datatype,
+        const uint16_t ndim, const size_t *dims)
+{
+    return append_elements(dset, path, elem, datatype, ndim, dims, 1);
+}
+
 static int get_array_properties(const ISMRMRD_Dataset *dset, const char *path,
         uint16_t *ndim, size_t dims[ISMRMRD_NDARRAY_MAXDIM],
         uint16_t *data_type)
@@ -777,14 +1538,12 @@ static int get_array_properties(const ISMRMRD_Dataset *dset, const char *path,
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
 
-    /* Check path existence */
-    if (!link_exists(dset, path)) {
+    /* open dataset */
+    dataset = open_cached_dataset(dset, path);
+    if (dataset < 0) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Path to element not found.");
     }
 
-    /* open dataset */
-    dataset = H5Dopen2(dset->fileid, path, H5P_DEFAULT);
-
     /* get the data type */
     hdf5type = H5Dget_type(dataset);
 
@@ -798,10 +1557,11 @@ static int get_array_properties(const ISMRMRD_Dataset *dset, const char *path,
     hdfdims = (hsize_t *)malloc(rank * sizeof(*hdfdims));
     h5status = H5Sget_simple_extent_dims(filespace, hdfdims, NULL);
 
-    /* set the return values - permute dimensions */
+    /* set the return values - permute dimensions, the first HDF5
+     * dimension is the append dimension and not part of the element */
     *data_type = get_ndarray_data_type(hdf5type);
-    *ndim = rank;
-    for (n=0; n<rank; n++) {
+    *ndim = rank - 1;
+    for (n=0; n<rank-1; n++) {
         dims[n] = hdfdims[rank-n-1];
     }
 
@@ -818,21 +1578,233 @@ static int get_array_properties(const ISMRMRD_Dataset *dset, const char *path,
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
         return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close filespace");
     }
-    h5status = H5Dclose(dataset);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close dataset.");
+
+    return ISMRMRD_NOERROR;
+
+}
+
+/* Buffers handed to HDF5 while decoding the variable length fields of
+ * acquisitions. The pool holds the trajectory and data buffers of the
+ * destination acquisitions, buffer 2n is the trajectory and 2n + 1 the data
+ * of acquisition n. HDF5 does not say which field it allocates for, so
+ * requests are matched by size: the first unused buffer of exactly the
+ * requested size, in acquisition order, is handed out as it is. Buffers of
+ * a field keep their owner this way whatever order HDF5 decodes the fields
+ * in, and as long as trajectory and data sizes differ. Only when no buffer
+ * has the size is the first unused one reallocated. */
+typedef struct VlenBufferSlot {
+    size_t capacity;
+    size_t number;
+} VlenBufferSlot;
+
+typedef struct VlenBufferPool {
+    void **buffers;
+    size_t *capacities;
+    size_t size;
+    VlenBufferSlot *by_size;  /* buffers sorted by capacity, then number */
+    size_t *position;         /* position of each buffer in by_size */
+    /* Union find over both orders, the first unused entry at or after each */
+    size_t *next_by_size;
+    size_t *next_by_number;
+    int *used;
+} VlenBufferPool;
+
+static int compare_vlen_slots(const void *a, const void *b) {
+    const VlenBufferSlot *x = (const VlenBufferSlot *) a;
+    const VlenBufferSlot *y = (const VlenBufferSlot *) b;
+    if (x->capacity != y->capacity) {
+        return x->capacity < y->capacity ? -1 : 1;
+    }
+    return x->number < y->number ? -1 : (x->number > y->number ? 1 : 0);
+}
+
+static size_t find_unused(size_t *next, size_t n) {
+    while (next[n] != n) {
+        next[n] = next[next[n]];
+        n = next[n];
+    }
+    return n;
+}
+
+/* Marks every buffer unused, for the start of a read */
+static void vlen_pool_reset(VlenBufferPool *pool) {
+    size_t n;
+    for (n = 0; n < pool->size; n++) {
+        pool->by_size[n].capacity = pool->capacities[n];
+        pool->by_size[n].number = n;
     }
+    qsort(pool->by_size, pool->size, sizeof(VlenBufferSlot), compare_vlen_slots);
+    for (n = 0; n < pool->size; n++) {
+        pool->position[pool->by_size[n].number] = n;
+        pool->used[n] = 0;
+    }
+    for (n = 0; n <= pool->size; n++) {
+        pool->next_by_size[n] = n;
+        pool->next_by_number[n] = n;
+    }
+}
+
+static void vlen_pool_destroy(VlenBufferPool *pool) {
+    free(pool->buffers);
+    free(pool->capacities);
+    free(pool->by_size);
+    free(pool->position);
+    free(pool->next_by_size);
+    free(pool->next_by_number);
+    free(pool->used);
+}
 
+static int vlen_pool_create(VlenBufferPool *pool, size_t size) {
+    pool->size = size;
+    pool->buffers = (void **) malloc(size * sizeof(void *));
+    pool->capacities = (size_t *) malloc(size * sizeof(size_t));
+    pool->by_size = (VlenBufferSlot *) malloc(size * sizeof(VlenBufferSlot));
+    pool->position = (size_t *) malloc(size * sizeof(size_t));
+    pool->next_by_size = (size_t *) malloc((size + 1) * sizeof(size_t));
+    pool->next_by_number = (size_t *) malloc((size + 1) * sizeof(size_t));
+    pool->used = (int *) malloc(size * sizeof(int));
+    if (pool->buffers == NULL || pool->capacities == NULL || pool->by_size == NULL ||
+        pool->position == NULL || pool->next_by_size == NULL || pool->next_by_number == NULL ||
+        pool->used == NULL) {
+        vlen_pool_destroy(pool);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition buffer pool.");
+    }
     return ISMRMRD_NOERROR;
+}
+
+static void *vlen_pool_alloc(size_t size, void *info) {
+    VlenBufferPool *pool = (VlenBufferPool *) info;
+    VlenBufferSlot *slots = pool->by_size;
+    size_t lo = 0, hi = pool->size, mid, found, number;
+    void *newPtr;
+
+    /* The first buffer of at least size bytes in the sorted order */
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (slots[mid].capacity < size) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    found = find_unused(pool->next_by_size, lo);
+    if (found < pool->size && slots[found].capacity == size) {
+        number = slots[found].number;
+    } else {
+        number = find_unused(pool->next_by_number, 0);
+        if (number >= pool->size) {
+            return NULL;
+        }
+        newPtr = ismrmrd_realloc(pool->buffers[number], size);
+        if (newPtr == NULL) {
+            return NULL;
+        }
+        pool->buffers[number] = newPtr;
+        pool->capacities[number] = size;
+    }
+    pool->used[number] = 1;
+    pool->next_by_number[number] = number + 1;
+    pool->next_by_size[pool->position[number]] = pool->position[number] + 1;
+    return pool->buffers[number];
+}
 
+static void vlen_pool_free(void *mem, void *info) {
+    /* The pool keeps ownership of every buffer it hands out */
+    (void) mem;
+    (void) info;
 }
 
-int read_element(const ISMRMRD_Dataset *dset, const char *path, void *elem,
-        const hid_t datatype, const uint32_t index)
+static void vlen_pool_restart(void *info) {
+    vlen_pool_reset((VlenBufferPool *) info);
+}
+
+/* The staging array, buffer pool, transfer properties and path of
+ * ismrmrd_read_acquisitions. They are kept in the dataset cache so that a
+ * loop reading one readout at a time does not allocate them for every read,
+ * and grow to the largest count read. */
+typedef struct AcquisitionReads {
+    HDF5_Acquisition *staging;
+    VlenBufferPool pool;
+    size_t capacity;
+    hid_t plist;
+    char *path;
+} AcquisitionReads;
+
+static void free_acquisition_reads(AcquisitionReads *reads) {
+    if (reads == NULL) {
+        return;
+    }
+    if (reads->plist >= 0) {
+        H5Pclose(reads->plist);
+    }
+    vlen_pool_destroy(&reads->pool);
+    free(reads->staging);
+    free(reads->path);
+    free(reads);
+}
+
+/* The read state of the dataset with room for count acquisitions */
+static AcquisitionReads *acquisition_reads(const ISMRMRD_Dataset *dset, size_t count) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    AcquisitionReads *reads = cache->reads;
+    HDF5_Acquisition *staging;
+
+    if (reads == NULL) {
+        reads = (AcquisitionReads *) calloc(1, sizeof(AcquisitionReads));
+        if (reads == NULL) {
+            ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition read state.");
+            return NULL;
+        }
+        /* The pool lives as long as the property list that points at it */
+        reads->plist = H5Pcreate(H5P_DATASET_XFER);
+        reads->path = make_path(dset, "data");
+        if (reads->plist < 0 || reads->path == NULL ||
+            H5Pset_vlen_mem_manager(reads->plist, vlen_pool_alloc, &reads->pool, vlen_pool_free, NULL) < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            free_acquisition_reads(reads);
+            ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to create transfer property list.");
+            return NULL;
+        }
+        cache->reads = reads;
+    }
+    if (count > reads->capacity) {
+        /* Every acquisition has a trajectory and a data field */
+        staging = (HDF5_Acquisition *) realloc(reads->staging, count * sizeof(HDF5_Acquisition));
+        if (staging == NULL) {
+            ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition buffer.");
+            return NULL;
+        }
+        reads->staging = staging;
+        vlen_pool_destroy(&reads->pool);
+        reads->capacity = 0;
+        if (vlen_pool_create(&reads->pool, 2 * count) != ISMRMRD_NOERROR) {
+            memset(&reads->pool, 0, sizeof(reads->pool));
+            return NULL;
+        }
+        reads->capacity = count;
+    }
+    reads->pool.size = 2 * count;
+    return reads;
+}
+
+/* Transfer properties of a read. A read that is retried calls restart first,
+ * e.g. to take back the buffers handed out to the failed attempt. */
+typedef struct ReadTransfer {
+    hid_t plist;
+    void (*restart)(void *info);
+    void *info;
+} ReadTransfer;
+
+/* Reads nelem elements starting at start and stride elements apart into
+ * the contiguous buffer elems, with the default transfer if xfer is NULL */
+static int read_strided_elements(const ISMRMRD_Dataset *dset, const char *path, void *elems,
+        const hid_t datatype, const uint32_t start, const uint32_t stride, const uint32_t nelem,
+        const ReadTransfer *xfer)
 {
+    hid_t xfer_plist = xfer == NULL ? H5P_DEFAULT : xfer->plist;
     hid_t dataset, filespace, memspace;
-    hsize_t *hdfdims = NULL, *offset = NULL, *count = NULL;
+    hsize_t *hdfdims = NULL, *offset = NULL, *count = NULL, *step = NULL;
+    hsize_t nstored;
     herr_t h5status = 0;
     int rank = 0;
     int n;
@@ -843,14 +1815,12 @@ int read_element(const ISMRMRD_Dataset *dset, const char *path, void *elem,
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
 
-    /* Check path existence */
-    if (!link_exists(dset, path)) {
+    /* open dataset */
+    dataset = open_cached_dataset(dset, path);
+    if (dataset < 0) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Path to element not found.");
     }
 
-    /* open dataset */
-    dataset = H5Dopen2(dset->fileid, path, H5P_DEFAULT);
-
     /* TODO check that the dataset's datatype is correct */
     filespace = H5Dget_space(dataset);
 
@@ -859,29 +1829,61 @@ int read_element(const ISMRMRD_Dataset *dset, const char *path, void *elem,
     hdfdims = (hsize_t *)malloc(rank * sizeof(*hdfdims));
     offset = (hsize_t *)malloc(rank * sizeof(*offset));
     count = (hsize_t *)malloc(rank * sizeof(*count));
+    step = (hsize_t *)malloc(rank * sizeof(*step));
 
     h5status = H5Sget_simple_extent_dims(filespace, hdfdims, NULL);
+    nstored = hdfdims[0];
+    get_contiguous_count(dset, dataset, &nstored);
 
-    if (index >= hdfdims[0]) {
+    if (nelem == 0 || stride == 0 || (hsize_t)start + (hsize_t)(nelem - 1) * stride >= nstored) {
+        H5Sclose(filespace);
         ret_code = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
         goto cleanup;
     }
 
-    offset[0] = index;
-    count[0] = 1;
+    offset[0] = start;
+    count[0] = nelem;
+    step[0] = stride;
     for (n=1; n< rank; n++) {
         offset[n] = 0;
         count[n] = hdfdims[n];
+        step[n] = 1;
     }
 
-    h5status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset, NULL, count, NULL);
+    h5status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset, step, count, NULL);
 
-    /* create space for one */
+    /* create space for the whole range */
     memspace = H5Screate_simple(rank, count, NULL);
 
-    h5status = H5Dread(dataset, datatype, memspace, filespace, H5P_DEFAULT, elem);
+    h5status = H5Dread(dataset, datatype, memspace, filespace, xfer_plist, elems);
+
+    /* Payloads appended since the SWMR reader opened the file need a reopen,
+     * and a writer may still be growing the global heap, which is consistent
+     * again once its flush is complete. Reopen and retry, other threads may
+     * use HDF5 while this one waits. */
+    for (n = 0; h5status < 0 && dset->cache != NULL && dset->cache->swmr_mode == SWMR_READING &&
+            n < SWMR_READ_RETRIES && failed_on_stale_heap(); n++) {
+        H5Eclear2(H5E_DEFAULT);
+        H5Sclose(filespace);
+        if (n > 0) {
+            ismrmrd_sleep_without_hdf5_lock(1u << (n - 1));
+        }
+        if (swmr_reopen(dset) != ISMRMRD_NOERROR || (dataset = open_cached_dataset(dset, path)) < 0) {
+            H5Sclose(memspace);
+            ret_code = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to refresh dataset.");
+            goto cleanup;
+        }
+        filespace = H5Dget_space(dataset);
+        H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset, step, count, NULL);
+        if (xfer != NULL && xfer->restart != NULL) {
+            xfer->restart(xfer->info);
+        }
+        h5status = H5Dread(dataset, datatype, memspace, filespace, xfer_plist, elems);
+    }
     if (h5status < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        H5Sclose(filespace);
+        H5Sclose(memspace);
         ret_code = ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to read from dataset.");
         goto cleanup;
     }
@@ -898,138 +1900,810 @@ int read_element(const ISMRMRD_Dataset *dset, const char *path, void *elem,
         ret_code = ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close memspace.");
         goto cleanup;
     }
-    h5status = H5Dclose(dataset);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        ret_code = ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close dataset.");
-        goto cleanup;
-    }
 
 cleanup:
+    free(step);
     free(count);
     free(offset);
     free(hdfdims);
     return ret_code;
 }
 
-/********************/
-/* Public functions */
-/********************/
-int ismrmrd_init_dataset(ISMRMRD_Dataset *dset, const char *filename,
-        const char *groupname)
+static int read_elements(const ISMRMRD_Dataset *dset, const char *path, void *elems,
+        const hid_t datatype, const uint32_t start, const uint32_t nelem, const ReadTransfer *xfer)
 {
-    if (NULL == dset) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    return read_strided_elements(dset, path, elems, datatype, start, 1, nelem, xfer);
+}
+
+int read_element(const ISMRMRD_Dataset *dset, const char *path, void *elem,
+        const hid_t datatype, const uint32_t index)
+{
+    return read_elements(dset, path, elem, datatype, index, 1, NULL);
+}
+
+/**********************/
+/* Acquisition index  */
+/**********************/
+
+#define INDEX_COUNTERS 9
+
+/* Reserved name, so that the index does not take the place of a user variable */
+#define INDEX_VARIABLE "ismrmrd_index"
+
+/* The encoding counters of an index entry in sort order */
+static uint16_t index_counter(const ISMRMRD_AcquisitionIndexEntry *entry, int n) {
+    switch (n) {
+        case 0: return entry->slice;
+        case 1: return entry->contrast;
+        case 2: return entry->repetition;
+        case 3: return entry->phase;
+        case 4: return entry->set;
+        case 5: return entry->average;
+        case 6: return entry->segment;
+        case 7: return entry->kspace_encode_step_2;
+        default: return entry->kspace_encode_step_1;
     }
+}
 
-    /* Disable HDF5 automatic error prenting */
-    H5Eset_auto2(H5E_DEFAULT, NULL, NULL);
+static void query_counters(const ISMRMRD_AcquisitionIndexQuery *query, int32_t counters[INDEX_COUNTERS]) {
+    counters[0] = query->slice;
+    counters[1] = query->contrast;
+    counters[2] = query->repetition;
+    counters[3] = query->phase;
+    counters[4] = query->set;
+    counters[5] = query->average;
+    counters[6] = query->segment;
+    counters[7] = query->kspace_encode_step_2;
+    counters[8] = query->kspace_encode_step_1;
+}
 
-    dset->filename = (char *) malloc(strlen(filename) + 1);
-    if (dset->filename == NULL) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc dataset filename");
+static int compare_index_entries(const void *a, const void *b) {
+    const ISMRMRD_AcquisitionIndexEntry *ea = (const ISMRMRD_AcquisitionIndexEntry *) a;
+    const ISMRMRD_AcquisitionIndexEntry *eb = (const ISMRMRD_AcquisitionIndexEntry *) b;
+    int n;
+    for (n = 0; n < INDEX_COUNTERS; n++) {
+        uint16_t ca = index_counter(ea, n), cb = index_counter(eb, n);
+        if (ca != cb) {
+            return ca < cb ? -1 : 1;
+        }
     }
-    strcpy(dset->filename, filename);
+    if (ea->acquisition != eb->acquisition) {
+        return ea->acquisition < eb->acquisition ? -1 : 1;
+    }
+    return 0;
+}
 
-    dset->groupname = (char *) malloc(strlen(groupname) + 1);
-    if (dset->groupname == NULL) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc dataset groupname");
+/* Compares the first prefix counters of entry with key */
+static int compare_index_prefix(const ISMRMRD_AcquisitionIndexEntry *entry, const int32_t *key, int prefix) {
+    int n;
+    for (n = 0; n < prefix; n++) {
+        int32_t c = index_counter(entry, n);
+        if (c != key[n]) {
+            return c < key[n] ? -1 : 1;
+        }
     }
-    strcpy(dset->groupname, groupname);
+    return 0;
+}
 
-    dset->fileid = 0;
+static int compare_uint32(const void *a, const void *b) {
+    uint32_t ua = *(const uint32_t *) a, ub = *(const uint32_t *) b;
+    return ua < ub ? -1 : (ua > ub ? 1 : 0);
+}
+
+static int add_index_entry(ISMRMRD_DatasetCache *cache, const ISMRMRD_AcquisitionHeader *head, uint32_t acquisition) {
+    ISMRMRD_AcquisitionIndexEntry *entry;
+    if (cache->index_size == cache->index_capacity) {
+        size_t capacity = cache->index_capacity == 0 ? 1024 : 2 * cache->index_capacity;
+        ISMRMRD_AcquisitionIndexEntry *newPtr = (ISMRMRD_AcquisitionIndexEntry *) realloc(cache->index,
+                capacity * sizeof(ISMRMRD_AcquisitionIndexEntry));
+        if (newPtr == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc acquisition index");
+        }
+        cache->index = newPtr;
+        cache->index_capacity = capacity;
+    }
+    entry = &cache->index[cache->index_size++];
+    entry->flags = head->flags;
+    entry->acquisition = acquisition;
+    entry->slice = head->idx.slice;
+    entry->contrast = head->idx.contrast;
+    entry->repetition = head->idx.repetition;
+    entry->phase = head->idx.phase;
+    entry->set = head->idx.set;
+    entry->average = head->idx.average;
+    entry->segment = head->idx.segment;
+    entry->kspace_encode_step_2 = head->idx.kspace_encode_step_2;
+    entry->kspace_encode_step_1 = head->idx.kspace_encode_step_1;
+    cache->index_dirty = true;
     return ISMRMRD_NOERROR;
 }
 
-int ismrmrd_open_dataset(ISMRMRD_Dataset *dset, const bool create_if_needed) {
-    /* TODO add a mode for clobbering the dataset if it exists. */
-    hid_t fileid;
+/* Adds the acquisitions first..total-1 to the index, reading only their headers */
+static int catch_up_acquisition_index(const ISMRMRD_Dataset *dset, uint32_t total) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    ISMRMRD_AcquisitionHeader *heads;
+    uint32_t start, count, n;
+    const uint32_t block = 4096;
+    int status = ISMRMRD_NOERROR;
 
-    if (NULL == dset) {
-        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
-        return false;
+    if (cache->index_size >= total) {
+        return ISMRMRD_NOERROR;
+    }
+    heads = (ISMRMRD_AcquisitionHeader *) malloc(block * sizeof(ISMRMRD_AcquisitionHeader));
+    if (heads == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition headers.");
+    }
+    for (start = (uint32_t) cache->index_size; status == ISMRMRD_NOERROR && start < total; start += count) {
+        count = total - start < block ? total - start : block;
+        status = ismrmrd_read_acquisition_headers(dset, start, count, heads);
+        for (n = 0; status == ISMRMRD_NOERROR && n < count; n++) {
+            status = add_index_entry(cache, &heads[n], start + n);
+        }
+    }
+    free(heads);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to update acquisition index.");
     }
+    return ISMRMRD_NOERROR;
+}
 
-    /* Try opening the file */
-    /* Note the is_hdf5 function doesn't work well when trying to open multiple files */
-    fileid = H5Fopen(dset->filename, H5F_ACC_RDWR, H5P_DEFAULT);
+/* Sorts the entries added since the last sort and merges them in */
+static int sort_acquisition_index(ISMRMRD_DatasetCache *cache) {
+    ISMRMRD_AcquisitionIndexEntry *merged;
+    size_t i, j, k;
+    size_t size = cache->index_size, sorted = cache->index_sorted;
 
-    if (fileid > 0) {
-        dset->fileid = fileid;
+    if (sorted == size) {
+        return ISMRMRD_NOERROR;
     }
-    else if (create_if_needed == false) {
-        /*Try opening the file as read-only*/
-        fileid = H5Fopen(dset->filename, H5F_ACC_RDONLY, H5P_DEFAULT);
-        if (fileid > 0) {
-            dset->fileid = fileid;
+    qsort(cache->index + sorted, size - sorted, sizeof(ISMRMRD_AcquisitionIndexEntry), compare_index_entries);
+    if (sorted > 0) {
+        merged = (ISMRMRD_AcquisitionIndexEntry *) malloc(size * sizeof(ISMRMRD_AcquisitionIndexEntry));
+        if (merged == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition index");
         }
-        else{
-            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            /* Some sort of error opening the file - Maybe it doesn't exist? */
-            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+        i = 0;
+        j = sorted;
+        k = 0;
+        while (i < sorted && j < size) {
+            if (compare_index_entries(&cache->index[i], &cache->index[j]) <= 0) {
+                merged[k++] = cache->index[i++];
+            } else {
+                merged[k++] = cache->index[j++];
+            }
         }
-    }
-    else {
-        /* Try creating a new file using the default properties. */
-        /* this will be readwrite */
-        fileid = H5Fcreate(dset->filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-        if (fileid > 0) {
-            dset->fileid = fileid;
-        }
-        else {
-            /* Error opening the file */
-            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+        while (i < sorted) {
+            merged[k++] = cache->index[i++];
+        }
+        while (j < size) {
+            merged[k++] = cache->index[j++];
         }
+        free(cache->index);
+        cache->index = merged;
+        cache->index_capacity = size;
     }
-    /* Open the existing dataset */
-    /* ensure that /groupname exists */
-    create_link(dset, dset->groupname);
-
+    cache->index_sorted = size;
     return ISMRMRD_NOERROR;
 }
 
-int ismrmrd_close_dataset(ISMRMRD_Dataset *dset) {
-    herr_t h5status;
+/* Reads the stored index into the cache, once per open dataset */
+static int load_acquisition_index(const ISMRMRD_Dataset *dset) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    char *path;
+    uint32_t n;
+    int status = ISMRMRD_NOERROR;
 
-    if (NULL == dset) {
-        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
-        return false;
+    if (cache == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open");
     }
-
-    if (dset->filename != NULL) {
-        free(dset->filename);
-        dset->filename = NULL;
+    if (cache->index_state != INDEX_UNKNOWN) {
+        return ISMRMRD_NOERROR;
     }
 
-    if (dset->groupname != NULL) {
-        free(dset->groupname);
-        dset->groupname = NULL;
+    path = make_path(dset, INDEX_VARIABLE);
+    if (open_cached_dataset(dset, path) < 0) {
+        cache->index_state = INDEX_ABSENT;
+        free(path);
+        return ISMRMRD_NOERROR;
+    }
+    n = get_number_of_elements(dset, path);
+    if (n > 0) {
+        cache->index = (ISMRMRD_AcquisitionIndexEntry *) malloc(n * sizeof(ISMRMRD_AcquisitionIndexEntry));
+        if (cache->index == NULL) {
+            free(path);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition index");
+        }
+        cache->index_capacity = n;
+        status = read_elements(dset, path, cache->index,
+                get_cached_type(dset, CACHED_TYPE_ACQUISITION_INDEX), 0, n, NULL);
+    }
+    free(path);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read acquisition index.");
     }
+    cache->index_size = n;
+    cache->index_sorted = n;
+    cache->index_state = INDEX_LOADED;
+    return ISMRMRD_NOERROR;
+}
 
-    /* Check for a valid fileid before trying to close the file */
-    if (dset->fileid > 0) {
-        h5status = H5Fclose (dset->fileid);
-        dset->fileid = 0;
+/* Writes the index in the cache over the stored one */
+static int write_acquisition_index(const ISMRMRD_Dataset *dset) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    hid_t dataset, datatype;
+    hsize_t dims[1];
+    herr_t h5status;
+    char *path;
+    int status;
+
+    status = sort_acquisition_index(cache);
+    if (status != ISMRMRD_NOERROR) {
+        return status;
+    }
+    datatype = get_cached_type(dset, CACHED_TYPE_ACQUISITION_INDEX);
+    path = make_path(dset, INDEX_VARIABLE);
+    dataset = open_cached_dataset(dset, path);
+    if (dataset < 0) {
+        status = append_elements(dset, path, cache->index, datatype, 0, NULL, cache->index_size);
+        free(path);
+        if (status != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to write acquisition index.");
+        }
+    } else {
+        /* The index only grows, resize and overwrite it in place */
+        free(path);
+        dims[0] = cache->index_size;
+        h5status = H5Dset_extent(dataset, dims);
+        if (h5status >= 0 && cache->index_size > 0) {
+            h5status = H5Dwrite(dataset, datatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, cache->index);
+        }
         if (h5status < 0) {
             H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close dataset.");
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to write acquisition index.");
         }
     }
-
+    cache->index_dirty = false;
     return ISMRMRD_NOERROR;
 }
 
-int ismrmrd_write_header(const ISMRMRD_Dataset *dset, const char *xmlstring) {
-    hid_t dataset, dataspace, datatype, props;
-    hsize_t dims[] = {1};
-    herr_t h5status;
-    void *buff[1];
+/* Adds n acquisitions appended at first to an existing index. The index always
+ * covers the acquisitions 0..index_size-1, an index which is behind catches up
+ * in ismrmrd_update_acquisition_index or the next query. */
+static int index_appended_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs,
+                                       hsize_t first, size_t n) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    size_t i;
+    int status;
+
+    status = load_acquisition_index(dset);
+    if (status != ISMRMRD_NOERROR || cache->index_state != INDEX_LOADED) {
+        return status;
+    }
+    if (cache->index_size != first) {
+        return ISMRMRD_NOERROR;
+    }
+    for (i = 0; i < n; i++) {
+        status = add_index_entry(cache, &acqs[i].head, first + (uint32_t) i);
+        if (status != ISMRMRD_NOERROR) {
+            return status;
+        }
+    }
+    return ISMRMRD_NOERROR;
+}
+
+/********************/
+/* Public functions */
+/********************/
+
+/* Defines the public function ismrmrd_<name>, which holds the HDF5 lock, see
+   ismrmrd_lock_hdf5, around <name>_unlocked. Every public function that calls
+   HDF5 is defined this way. The redeclaration fails to compile unless params
+   are also those of <name>_unlocked. */
+#define LOCKED_HDF5_FUNCTION(type, name, params, args) \
+    static type name##_unlocked params;                \
+    type ismrmrd_##name params                         \
+    {                                                  \
+        type result;                                   \
+        ismrmrd_lock_hdf5();                           \
+        result = name##_unlocked args;                 \
+        ismrmrd_unlock_hdf5();                         \
+        return result;                                 \
+    }
+
+static int init_dataset_unlocked(ISMRMRD_Dataset *dset, const char *filename,
+        const char *groupname)
+{
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+
+    /* Disable HDF5 automatic error prenting */
+    H5Eset_auto2(H5E_DEFAULT, NULL, NULL);
+
+    dset->filename = (char *) malloc(strlen(filename) + 1);
+    if (dset->filename == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc dataset filename");
+    }
+    strcpy(dset->filename, filename);
+
+    dset->groupname = (char *) malloc(strlen(groupname) + 1);
+    if (dset->groupname == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc dataset groupname");
+    }
+    strcpy(dset->groupname, groupname);
+
+    dset->fileid = 0;
+    dset->cache = NULL;
+    dset->backend = NULL;
+    dset->backend_data = NULL;
+    return ISMRMRD_NOERROR;
+}
+
+LOCKED_HDF5_FUNCTION(int, init_dataset,
+        (ISMRMRD_Dataset *dset, const char *filename, const char *groupname),
+        (dset, filename, groupname))
+
+int ismrmrd_set_dataset_backend(ISMRMRD_Dataset *dset, const ISMRMRD_DatasetBackend *backend)
+{
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+    if (dset->fileid > 0 || dset->cache != NULL || dset->backend_data != NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is already open");
+    }
+    dset->backend = backend;
+    return ISMRMRD_NOERROR;
+}
+
+const ISMRMRD_DatasetBackend *ismrmrd_hdf5_backend(void)
+{
+    return &hdf5_backend;
+}
+
+int ismrmrd_init_dataset_options(ISMRMRD_DatasetOptions *options) {
+    if (options == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+    options->create_if_needed = true;
+    options->read_only = false;
+    options->driver = ISMRMRD_DRIVER_DEFAULT;
+    options->core_increment = 0;
+    options->core_backing_store = false;
+    options->alignment = 0;
+    options->alignment_threshold = 0;
+    options->metadata_cache_bytes = 0;
+    options->file_space_page_size = 0;
+    options->page_buffer_bytes = 0;
+    options->libver_low = ISMRMRD_LIBVER_DEFAULT;
+    options->libver_high = ISMRMRD_LIBVER_DEFAULT;
+    return ismrmrd_init_storage_policy(&options->storage);
+}
+
+static H5F_libver_t get_libver_bound(uint16_t bound, H5F_libver_t default_bound) {
+    switch (bound) {
+    case ISMRMRD_LIBVER_EARLIEST:
+        return H5F_LIBVER_EARLIEST;
+    case ISMRMRD_LIBVER_V18:
+        return H5F_LIBVER_V18;
+    case ISMRMRD_LIBVER_V110:
+        return H5F_LIBVER_V110;
+    case ISMRMRD_LIBVER_LATEST:
+        return H5F_LIBVER_LATEST;
+    default:
+        return default_bound;
+    }
+}
+
+static herr_t set_file_driver(hid_t fapl, const ISMRMRD_DatasetOptions *options) {
+    switch (options->driver) {
+    case ISMRMRD_DRIVER_DEFAULT:
+        return 0;
+    case ISMRMRD_DRIVER_SEC2:
+        return H5Pset_fapl_sec2(fapl);
+    case ISMRMRD_DRIVER_STDIO:
+        return H5Pset_fapl_stdio(fapl);
+    case ISMRMRD_DRIVER_CORE:
+        return H5Pset_fapl_core(fapl, options->core_increment > 0 ? options->core_increment : (size_t) 1 << 20,
+                                options->core_backing_store);
+    case ISMRMRD_DRIVER_DIRECT:
+#ifdef H5_HAVE_DIRECT
+        /* Buffers and transfers have to be aligned to the file system blocks */
+        return H5Pset_fapl_direct(fapl, options->alignment > 0 ? (size_t) options->alignment : 4096,
+                                  4096, (size_t) 16 << 20);
+#else
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "HDF5 was built without the direct file driver.");
+        return -1;
+#endif
+    default:
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Unknown file driver.");
+        return -1;
+    }
+}
+
+/* The file access property list for options, negative on failure */
+static hid_t create_file_access_plist(const ISMRMRD_DatasetOptions *options) {
+    hid_t fapl;
+    herr_t h5status;
+    H5AC_cache_config_t config;
+
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    if (fapl < 0) {
+        return fapl;
+    }
+    h5status = set_file_driver(fapl, options);
+    if (h5status >= 0 && options->alignment > 0) {
+        h5status = H5Pset_alignment(fapl, options->alignment_threshold, options->alignment);
+    }
+    if (h5status >= 0 && options->metadata_cache_bytes > 0) {
+        config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+        h5status = H5Pget_mdc_config(fapl, &config);
+        if (h5status >= 0) {
+            config.set_initial_size = true;
+            config.initial_size = options->metadata_cache_bytes;
+            if (config.max_size < config.initial_size) {
+                config.max_size = config.initial_size;
+            }
+            if (config.min_size > config.initial_size) {
+                config.min_size = config.initial_size;
+            }
+            h5status = H5Pset_mdc_config(fapl, &config);
+        }
+    }
+    if (h5status >= 0 && options->page_buffer_bytes > 0) {
+        h5status = H5Pset_page_buffer_size(fapl, options->page_buffer_bytes, 0, 0);
+    }
+    if (h5status >= 0 && (options->libver_low != ISMRMRD_LIBVER_DEFAULT ||
+                          options->libver_high != ISMRMRD_LIBVER_DEFAULT)) {
+        h5status = H5Pset_libver_bounds(fapl, get_libver_bound(options->libver_low, H5F_LIBVER_EARLIEST),
+                                        get_libver_bound(options->libver_high, H5F_LIBVER_LATEST));
+    }
+    if (h5status < 0) {
+        H5Pclose(fapl);
+        return -1;
+    }
+    return fapl;
+}
+
+/* The file creation property list for options, negative on failure */
+static hid_t create_file_create_plist(const ISMRMRD_DatasetOptions *options) {
+    hid_t fcpl;
+
+    fcpl = H5Pcreate(H5P_FILE_CREATE);
+    if (fcpl < 0 || options->file_space_page_size == 0) {
+        return fcpl;
+    }
+    if (H5Pset_file_space_strategy(fcpl, H5F_FSPACE_STRATEGY_PAGE, false, 1) < 0 ||
+            H5Pset_file_space_page_size(fcpl, options->file_space_page_size) < 0) {
+        H5Pclose(fcpl);
+        return -1;
+    }
+    return fcpl;
+}
+
+int ismrmrd_open_dataset(ISMRMRD_Dataset *dset, const bool create_if_needed) {
+    ISMRMRD_DatasetOptions options;
+
+    ismrmrd_init_dataset_options(&options);
+    options.create_if_needed = create_if_needed;
+    return ismrmrd_open_dataset_ex(dset, &options);
+}
+
+static int open_dataset_ex_unlocked(ISMRMRD_Dataset *dset, const ISMRMRD_DatasetOptions *options) {
+    /* TODO add a mode for clobbering the dataset if it exists. */
+    hid_t fileid, fapl, fcpl;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+    if (NULL == options) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL options parameter");
+    }
+    if (uses_backend(dset)) {
+        return dset->backend->open(dset, options->create_if_needed && !options->read_only);
+    }
+    /* Refuse a bad policy before the file is created */
+    if (check_storage_policy(&options->storage) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Invalid storage policy.");
+    }
+
+    fapl = create_file_access_plist(options);
+    if (fapl < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to set the file access options.");
+    }
+
+    /* Try opening the file */
+    /* Note the is_hdf5 function doesn't work well when trying to open multiple files */
+    if (options->read_only) {
+        fileid = H5Fopen(dset->filename, H5F_ACC_RDONLY, fapl);
+    }
+    else {
+        fileid = H5Fopen(dset->filename, H5F_ACC_RDWR, fapl);
+        if (fileid < 0 && options->create_if_needed == false) {
+            /*Try opening the file as read-only*/
+            fileid = H5Fopen(dset->filename, H5F_ACC_RDONLY, fapl);
+        }
+        else if (fileid < 0) {
+            /* Try creating a new file, this will be readwrite */
+            fcpl = create_file_create_plist(options);
+            if (fcpl >= 0) {
+                fileid = H5Fcreate(dset->filename, H5F_ACC_TRUNC, fcpl, fapl);
+                H5Pclose(fcpl);
+            }
+        }
+    }
+    H5Pclose(fapl);
+    if (fileid < 0) {
+        /* Some sort of error opening the file - Maybe it doesn't exist? */
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+    }
+    dset->fileid = fileid;
+
+    /* Open the existing dataset */
+    /* ensure that /groupname exists */
+    create_link(dset, dset->groupname);
+
+    /* HDF5 handles are kept open until the dataset is closed */
+    if (dset->cache == NULL && create_cache(dset) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to create the dataset cache.");
+    }
+
+    return set_storage_policy_unlocked(dset, "", &options->storage);
+}
+
+LOCKED_HDF5_FUNCTION(int, open_dataset_ex,
+        (ISMRMRD_Dataset *dset, const ISMRMRD_DatasetOptions *options),
+        (dset, options))
+
+static int close_dataset_unlocked(ISMRMRD_Dataset *dset) {
+    herr_t h5status;
+    hid_t fileid;
+    int status = ISMRMRD_NOERROR;
+
+    if (NULL == dset) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+        return false;
+    }
+    if (uses_backend(dset)) {
+        status = dset->backend->close(dset);
+        free(dset->filename);
+        dset->filename = NULL;
+        free(dset->groupname);
+        dset->groupname = NULL;
+        return status;
+    }
+
+    /* Acquisitions appended to an indexed dataset are added to its index */
+    if (dset->cache != NULL && dset->cache->index_dirty) {
+        status = write_acquisition_index(dset);
+    }
+
+    /* Publish the last appends to SWMR readers */
+    if (status == ISMRMRD_NOERROR && dset->cache != NULL &&
+        dset->cache->swmr_mode == SWMR_WRITING && dset->cache->swmr_unflushed > 0) {
+        status = swmr_publish(dset);
+    }
+
+    if (dset->filename != NULL) {
+        free(dset->filename);
+        dset->filename = NULL;
+    }
+
+    if (dset->groupname != NULL) {
+        free(dset->groupname);
+        dset->groupname = NULL;
+    }
+
+    /* Cached objects must be closed before the file, which a SWMR reader may
+     * have reopened */
+    fileid = file_of(dset);
+    if (free_cache(dset) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to release dataset cache.");
+    }
+
+    /* Check for a valid fileid before trying to close the file */
+    if (dset->fileid > 0) {
+        h5status = fileid < 0 ? 0 : H5Fclose(fileid);
+        dset->fileid = 0;
+        if (h5status < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close dataset.");
+        }
+    }
+
+    return status;
+}
+
+LOCKED_HDF5_FUNCTION(int, close_dataset, (ISMRMRD_Dataset *dset), (dset))
+
+static int flush_dataset_unlocked(ISMRMRD_Dataset *dset) {
+    herr_t h5status;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+    if (uses_backend(dset)) {
+        return dset->backend->flush != NULL ? dset->backend->flush(dset) : ISMRMRD_NOERROR;
+    }
+
+    if (dset->cache != NULL && dset->cache->index_dirty) {
+        if (write_acquisition_index(dset) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to write acquisition index.");
+        }
+    }
+
+    if (dset->cache != NULL && dset->cache->swmr_mode == SWMR_WRITING) {
+        dset->cache->swmr_unflushed = 0;
+        return swmr_publish(dset);
+    }
+
+    h5status = H5Fflush(dset->fileid, H5F_SCOPE_LOCAL);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to flush dataset.");
+    }
+
+    return ISMRMRD_NOERROR;
+}
+
+LOCKED_HDF5_FUNCTION(int, flush_dataset, (ISMRMRD_Dataset *dset), (dset))
+
+static int open_dataset_swmr_unlocked(ISMRMRD_Dataset *dset, const bool reader) {
+    hid_t fileid, fapl;
+    int status;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+    if (uses_backend(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+    }
+
+    /* SWMR needs the latest file format on both sides */
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+    if (reader) {
+        fileid = H5Fopen(dset->filename, H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, fapl);
+    } else {
+        fileid = H5Fopen(dset->filename, H5F_ACC_RDWR, fapl);
+        if (fileid < 0) {
+            fileid = H5Fcreate(dset->filename, H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+        }
+    }
+    H5Pclose(fapl);
+    if (fileid < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+    }
+    dset->fileid = fileid;
+
+    if (!reader) {
+        create_link(dset, dset->groupname);
+    }
+    if (dset->cache == NULL) {
+        status = create_cache(dset);
+        if (status != ISMRMRD_NOERROR) {
+            return status;
+        }
+    }
+    dset->cache->swmr_mode = reader ? SWMR_READING : SWMR_WRITER_OPEN;
+    dset->cache->reader_fileid = reader ? fileid : -1;
+    return ISMRMRD_NOERROR;
+}
+
+LOCKED_HDF5_FUNCTION(int, open_dataset_swmr, (ISMRMRD_Dataset *dset, const bool reader), (dset, reader))
+
+static int start_swmr_write_unlocked(ISMRMRD_Dataset *dset, const uint32_t flush_interval) {
+    const char *vars[] = {"data", "waveforms"};
+    const int types[] = {CACHED_TYPE_ACQUISITION, CACHED_TYPE_WAVEFORM};
+    char *path;
+    int n;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+    if (uses_backend(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+    }
+    if (dset->cache == NULL || dset->cache->swmr_mode != SWMR_WRITER_OPEN) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open as a SWMR writer.");
+    }
+
+    /* No objects can be created once readers may be attached */
+    for (n = 0; n < 2; n++) {
+        path = make_path(dset, vars[n]);
+        if (open_cached_dataset(dset, path) < 0 &&
+            create_extendible_dataset(dset, path, get_cached_type(dset, types[n]), 0, NULL, 0) < 0) {
+            free(path);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create dataset.");
+        }
+        free(path);
+    }
+    if (dset->cache->index_dirty && write_acquisition_index(dset) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to write acquisition index.");
+    }
+    path = make_path(dset, "swmr_counts");
+    if (open_cached_dataset(dset, path) < 0) {
+        hsize_t dims[1] = {2};
+        hid_t dataspace = H5Screate_simple(1, dims, NULL);
+        hid_t dataset = H5Dcreate2(dset->fileid, path, H5T_NATIVE_UINT32, dataspace,
+                H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        H5Sclose(dataspace);
+        if (dataset < 0 || add_cached_dataset(dset, path, dataset) != ISMRMRD_NOERROR) {
+            free(path);
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create dataset.");
+        }
+    }
+    free(path);
+    if (swmr_publish(dset) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to write SWMR counts.");
+    }
+
+    if (close_cached_datasets(dset) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datasets.");
+    }
+    if (H5Fstart_swmr_write(dset->fileid) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to start SWMR write.");
+    }
+    dset->cache->swmr_mode = SWMR_WRITING;
+    dset->cache->swmr_flush_interval = flush_interval;
+    dset->cache->swmr_unflushed = 0;
+    return ISMRMRD_NOERROR;
+}
+
+LOCKED_HDF5_FUNCTION(int, start_swmr_write,
+        (ISMRMRD_Dataset *dset, const uint32_t flush_interval),
+        (dset, flush_interval))
+
+static bool wait_for_acquisition_unlocked(const ISMRMRD_Dataset *dset, const uint32_t index, const uint32_t timeout_ms) {
+    uint32_t waited = 0, interval = 1;
+
+    if (NULL == dset) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+        return false;
+    }
+    if (uses_backend(dset)) {
+        return index < get_number_of_acquisitions_unlocked(dset);
+    }
+
+    /* Poll with a growing interval, up to 50 ms between refreshes, the lock
+       is released while sleeping */
+    while (get_number_of_acquisitions_unlocked(dset) <= index) {
+        if (waited >= timeout_ms) {
+            return false;
+        }
+        if (interval > timeout_ms - waited) {
+            interval = timeout_ms - waited;
+        }
+        ismrmrd_sleep_without_hdf5_lock(interval);
+        waited += interval;
+        if (interval < 50) {
+            interval *= 2;
+        }
+    }
+    return true;
+}
+
+LOCKED_HDF5_FUNCTION(bool, wait_for_acquisition,
+        (const ISMRMRD_Dataset *dset, const uint32_t index, const uint32_t timeout_ms),
+        (dset, index, timeout_ms))
+
+static int write_header_unlocked(const ISMRMRD_Dataset *dset, const char *xmlstring) {
+    hid_t dataset, dataspace, datatype, props;
+    hsize_t dims[] = {1};
+    herr_t h5status;
+    void *buff[1];
     char * path;
 
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
+    if (uses_backend(dset)) {
+        return dset->backend->write_header(dset, xmlstring);
+    }
 
     if (xmlstring==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "xmlstring should not be NULL.");
@@ -1083,7 +2757,11 @@ int ismrmrd_write_header(const ISMRMRD_Dataset *dset, const char *xmlstring) {
     return ISMRMRD_NOERROR;
 }
 
-char * ismrmrd_read_header(const ISMRMRD_Dataset *dset) {
+LOCKED_HDF5_FUNCTION(int, write_header,
+        (const ISMRMRD_Dataset *dset, const char *xmlstring),
+        (dset, xmlstring))
+
+static char * read_header_unlocked(const ISMRMRD_Dataset *dset) {
     hid_t dataset, datatype;
     herr_t h5status;
     char* xmlstring = NULL;
@@ -1093,6 +2771,9 @@ char * ismrmrd_read_header(const ISMRMRD_Dataset *dset) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
         return NULL;
     }
+    if (uses_backend(dset)) {
+        return dset->backend->read_header(dset);
+    }
 
     /* The path to the xml header */
     path = make_path(dset, "xml");
@@ -1103,7 +2784,7 @@ char * ismrmrd_read_header(const ISMRMRD_Dataset *dset) {
         goto cleanup_path;
     }
 
-    dataset = H5Dopen2(dset->fileid, path, H5P_DEFAULT);
+    dataset = H5Dopen2(file_of(dset), path, H5P_DEFAULT);
     datatype = get_hdf5type_xmlheader();
     /* Read it into a 1D buffer*/
     h5status = H5Dread(dataset, datatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, &xmlstring);
@@ -1137,7 +2818,9 @@ cleanup_path:
     return xmlstring;
 }
 
-uint32_t ismrmrd_get_number_of_acquisitions(const ISMRMRD_Dataset *dset) {
+LOCKED_HDF5_FUNCTION(char *, read_header, (const ISMRMRD_Dataset *dset), (dset))
+
+static uint32_t get_number_of_acquisitions_unlocked(const ISMRMRD_Dataset *dset) {
     char *path;
     uint32_t numacq;
 
@@ -1145,22 +2828,35 @@ uint32_t ismrmrd_get_number_of_acquisitions(const ISMRMRD_Dataset *dset) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
         return 0;
     }
+    if (uses_backend(dset)) {
+        return dset->backend->get_number_of_acquisitions(dset);
+    }
     /* The path to the acqusition data */    
     path = make_path(dset, "data");
+    swmr_refresh(dset, path);
     numacq = get_number_of_elements(dset, path);
     free(path);
+    if (dset->cache != NULL && numacq > dset->cache->swmr_counts[0]) {
+        numacq = dset->cache->swmr_counts[0];
+    }
     return numacq;
 }
 
-int ismrmrd_append_acquisition(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acq) {
+LOCKED_HDF5_FUNCTION(uint32_t, get_number_of_acquisitions, (const ISMRMRD_Dataset *dset), (dset))
+
+static int append_acquisition_unlocked(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acq) {
     int status;
     char *path;
     hid_t datatype;
+    hsize_t first = 0;
     HDF5_Acquisition hdf5acq[1];
 
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
+    if (uses_backend(dset)) {
+        return dset->backend->append_acquisitions(dset, acq, 1);
+    }
     if (acq==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
     }
@@ -1169,7 +2865,7 @@ int ismrmrd_append_acquisition(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquis
     path = make_path(dset, "data");
 
     /* The acquisition datatype */
-    datatype = get_hdf5type_acquisition();
+    datatype = get_cached_type(dset, CACHED_TYPE_ACQUISITION);
 
     /* Create the HDF5 version of the acquisition */
     hdf5acq[0].head = acq->head;
@@ -1179,64 +2875,407 @@ int ismrmrd_append_acquisition(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquis
     hdf5acq[0].data.p = acq->data;
 
     /* Write it */
-    status = append_element(dset, path, hdf5acq, datatype, 0, NULL);
+    status = append_elements_at(dset, path, hdf5acq, datatype, 0, NULL, 1, &first);
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append acquisition.");
     }
 
     free(path);
 
-    /* Clean up */
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
+    status = index_appended_acquisitions(dset, acq, first, 1);
+    if (status != ISMRMRD_NOERROR) {
+        return status;
     }
-
-    return ISMRMRD_NOERROR;
+    return swmr_appended(dset, 1);
 }
 
-int ismrmrd_read_acquisition(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Acquisition *acq)
-{
-    hid_t datatype;
-    herr_t status;
-    HDF5_Acquisition hdf5acq;
-    char *path;
+LOCKED_HDF5_FUNCTION(int, append_acquisition,
+        (const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acq),
+        (dset, acq))
+
+static int append_acquisitions_unlocked(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, size_t n) {
+    int status;
+    char *path;
+    hid_t datatype;
+    hsize_t first = 0;
+    HDF5_Acquisition *hdf5acqs;
+    size_t i;
 
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
-    if (acq==NULL) {
+    if (uses_backend(dset)) {
+        return dset->backend->append_acquisitions(dset, acqs, n);
+    }
+    if (n == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (acqs==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
     }
 
-    /* The path to the acquisition data */
+    /* Create the HDF5 version of the acquisitions, the payloads are not copied */
+    hdf5acqs = (HDF5_Acquisition *) malloc(n * sizeof(HDF5_Acquisition));
+    if (hdf5acqs == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition buffer.");
+    }
+    for (i = 0; i < n; i++) {
+        hdf5acqs[i].head = acqs[i].head;
+        hdf5acqs[i].traj.len = acqs[i].head.number_of_samples * acqs[i].head.trajectory_dimensions;
+        hdf5acqs[i].traj.p = acqs[i].traj;
+        hdf5acqs[i].data.len = 2 * acqs[i].head.number_of_samples * acqs[i].head.active_channels;
+        hdf5acqs[i].data.p = acqs[i].data;
+    }
+
+    /* The path to the acqusition data */
     path = make_path(dset, "data");
 
     /* The acquisition datatype */
-    datatype = get_hdf5type_acquisition();
+    datatype = get_cached_type(dset, CACHED_TYPE_ACQUISITION);
 
-    status = read_element(dset, path, &hdf5acq, datatype, index);
-    memcpy(&acq->head, &hdf5acq.head, sizeof(ISMRMRD_AcquisitionHeader));
-    ismrmrd_make_consistent_acquisition(acq);
-    memcpy(acq->traj, hdf5acq.traj.p, ismrmrd_size_of_acquisition_traj(acq));
-    memcpy(acq->data, hdf5acq.data.p, ismrmrd_size_of_acquisition_data(acq));
+    /* Extend the dataset once and write all of them */
+    status = append_elements_at(dset, path, hdf5acqs, datatype, 0, NULL, n, &first);
+    free(hdf5acqs);
+    free(path);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append acquisitions.");
+    }
 
-    /* clean up */
+    status = index_appended_acquisitions(dset, acqs, first, n);
+    if (status != ISMRMRD_NOERROR) {
+        return status;
+    }
+    return swmr_appended(dset, n);
+}
+
+LOCKED_HDF5_FUNCTION(int, append_acquisitions,
+        (const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, size_t n),
+        (dset, acqs, n))
+
+int ismrmrd_read_acquisition(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Acquisition *acq)
+{
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (acq==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
+    }
+
+    return ismrmrd_read_acquisitions(dset, index, 1, acq);
+}
+
+static int read_acquisitions_unlocked(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count, ISMRMRD_Acquisition *acqs)
+{
+    hid_t datatype;
+    ReadTransfer xfer;
+    int status;
+    AcquisitionReads *reads;
+    HDF5_Acquisition *hdf5acqs;
+    VlenBufferPool *pool;
+    uint32_t n;
+    size_t unused;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return dset->backend->read_acquisitions(dset, start, count, acqs);
+    }
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (acqs==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
+    }
+
+    if (dset->cache == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open");
+    }
+    reads = acquisition_reads(dset, count);
+    if (reads == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to prepare acquisition read.");
+    }
+    hdf5acqs = reads->staging;
+    pool = &reads->pool;
+
+    /* Initialized acquisitions have buffers of the size given by their header */
+    for (n = 0; n < count; n++) {
+        pool->buffers[2 * n] = acqs[n].traj;
+        pool->capacities[2 * n] = acqs[n].traj == NULL ? 0 : ismrmrd_size_of_acquisition_traj(&acqs[n]);
+        pool->buffers[2 * n + 1] = acqs[n].data;
+        pool->capacities[2 * n + 1] = acqs[n].data == NULL ? 0 : ismrmrd_size_of_acquisition_data(&acqs[n]);
+    }
+    vlen_pool_reset(pool);
+
+    /* A retried read starts over with all buffers */
+    xfer.plist = reads->plist;
+    xfer.restart = vlen_pool_restart;
+    xfer.info = pool;
+
+    /* The acquisition datatype */
+    datatype = get_cached_type(dset, CACHED_TYPE_ACQUISITION);
+
+    /* Read the whole range with one hyperslab selection */
+    status = read_elements(dset, reads->path, hdf5acqs, datatype, start, count, &xfer);
+    if (status != ISMRMRD_NOERROR) {
+        /* Give the (possibly reallocated) buffers back to their owners */
+        for (n = 0; n < count; n++) {
+            acqs[n].traj = (float *) pool->buffers[2 * n];
+            acqs[n].data = (complex_float_t *) pool->buffers[2 * n + 1];
+        }
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read acquisitions.");
+    }
+
+    /* Empty fields are not allocated by HDF5, they keep their own buffer
+     * unless it went to another field. Buffers nobody kept are released. */
+    for (n = 0; n < count; n++) {
+        memcpy(&acqs[n].head, &hdf5acqs[n].head, sizeof(ISMRMRD_AcquisitionHeader));
+        acqs[n].traj = (float *) hdf5acqs[n].traj.p;
+        if (acqs[n].traj == NULL && !pool->used[2 * n]) {
+            acqs[n].traj = (float *) pool->buffers[2 * n];
+            pool->used[2 * n] = 1;
+        }
+        acqs[n].data = (complex_float_t *) hdf5acqs[n].data.p;
+        if (acqs[n].data == NULL && !pool->used[2 * n + 1]) {
+            acqs[n].data = (complex_float_t *) pool->buffers[2 * n + 1];
+            pool->used[2 * n + 1] = 1;
+        }
+    }
+    for (unused = 0; unused < pool->size; unused++) {
+        if (!pool->used[unused]) {
+            ismrmrd_free(pool->buffers[unused]);
+        }
+    }
+    
+    /* Only reallocate if the header disagrees with the stored payload */
+    for (n = 0; n < count; n++) {
+        if (status == ISMRMRD_NOERROR &&
+            (hdf5acqs[n].traj.len * sizeof(float) != ismrmrd_size_of_acquisition_traj(&acqs[n]) ||
+             hdf5acqs[n].data.len * sizeof(float) != ismrmrd_size_of_acquisition_data(&acqs[n]))) {
+            status = ismrmrd_make_consistent_acquisition(&acqs[n]);
+        }
+    }
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(status, "Failed to make acquisitions consistent.");
+    }
+
+    return ISMRMRD_NOERROR;
+}
+
+LOCKED_HDF5_FUNCTION(int, read_acquisitions,
+        (const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count, ISMRMRD_Acquisition *acqs),
+        (dset, start, count, acqs))
+
+static int read_acquisition_headers_unlocked(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                                     ISMRMRD_AcquisitionHeader *heads)
+{
+    hid_t datatype;
+    int status;
+    char *path;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+    }
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (heads==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Header pointer should not be NULL.");
+    }
+
+    /* The path to the acquisition data */
+    path = make_path(dset, "data");
+
+    /* Only the head member of the acquisition datatype */
+    datatype = get_cached_type(dset, CACHED_TYPE_ACQUISITION_HEAD);
+
+    status = read_elements(dset, path, heads, datatype, start, count, NULL);
     free(path);
-    free(hdf5acq.traj.p);
-    free(hdf5acq.data.p);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read acquisition headers.");
+    }
 
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
+    return ISMRMRD_NOERROR;
+}
+
+LOCKED_HDF5_FUNCTION(int, read_acquisition_headers,
+        (const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count, ISMRMRD_AcquisitionHeader *heads),
+        (dset, start, count, heads))
+
+int ismrmrd_init_acquisition_index_query(ISMRMRD_AcquisitionIndexQuery *query) {
+    if (query == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+    query->slice = ISMRMRD_INDEX_ANY;
+    query->contrast = ISMRMRD_INDEX_ANY;
+    query->repetition = ISMRMRD_INDEX_ANY;
+    query->phase = ISMRMRD_INDEX_ANY;
+    query->set = ISMRMRD_INDEX_ANY;
+    query->average = ISMRMRD_INDEX_ANY;
+    query->segment = ISMRMRD_INDEX_ANY;
+    query->kspace_encode_step_2 = ISMRMRD_INDEX_ANY;
+    query->kspace_encode_step_1 = ISMRMRD_INDEX_ANY;
+    query->flags_set = 0;
+    query->flags_clear = 0;
+    return ISMRMRD_NOERROR;
+}
+
+static int update_acquisition_index_unlocked(const ISMRMRD_Dataset *dset) {
+    ISMRMRD_DatasetCache *cache;
+    int status;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+    }
+    status = load_acquisition_index(dset);
+    if (status != ISMRMRD_NOERROR) {
+        return status;
+    }
+    cache = dset->cache;
+    if (cache->index_state == INDEX_ABSENT) {
+        cache->index_state = INDEX_LOADED;
+        cache->index_dirty = true;
+    }
+
+    /* Only the headers of the acquisitions missing from the index are read */
+    status = catch_up_acquisition_index(dset, get_number_of_acquisitions_unlocked(dset));
+    if (status != ISMRMRD_NOERROR) {
+        return status;
     }
 
+    if (cache->index_dirty) {
+        return write_acquisition_index(dset);
+    }
     return ISMRMRD_NOERROR;
 }
 
-int ismrmrd_append_image(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *im) {
+LOCKED_HDF5_FUNCTION(int, update_acquisition_index, (const ISMRMRD_Dataset *dset), (dset))
+
+static bool has_acquisition_index_unlocked(const ISMRMRD_Dataset *dset) {
+    if (dset==NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+        return false;
+    }
+    if (uses_backend(dset)) {
+        return false;
+    }
+    if (load_acquisition_index(dset) != ISMRMRD_NOERROR) {
+        return false;
+    }
+    return dset->cache->index_state == INDEX_LOADED;
+}
+
+LOCKED_HDF5_FUNCTION(bool, has_acquisition_index, (const ISMRMRD_Dataset *dset), (dset))
+
+static uint32_t * query_acquisition_index_unlocked(const ISMRMRD_Dataset *dset,
+        const ISMRMRD_AcquisitionIndexQuery *query, uint32_t *count)
+{
+    ISMRMRD_DatasetCache *cache;
+    int32_t key[INDEX_COUNTERS];
+    size_t lo, hi, first, last, mid, n;
+    int prefix, c;
+    unsigned intent;
+    uint32_t *matches;
+
+    if (count == NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Count pointer should not be NULL.");
+        return NULL;
+    }
+    *count = 0;
+    if (dset==NULL || query==NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+        return NULL;
+    }
+    if (uses_backend(dset)) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+        return NULL;
+    }
+    if (load_acquisition_index(dset) != ISMRMRD_NOERROR) {
+        return NULL;
+    }
+    cache = dset->cache;
+    if (cache->index_state != INDEX_LOADED) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset has no acquisition index.");
+        return NULL;
+    }
+    /* Acquisitions appended without updating the index, e.g. by another
+     * program, are added to it so that a query never misses them. The index
+     * is written back when the dataset is flushed or closed, unless the file
+     * is read-only. */
+    if (catch_up_acquisition_index(dset, get_number_of_acquisitions_unlocked(dset)) != ISMRMRD_NOERROR) {
+        return NULL;
+    }
+    if (H5Fget_intent(file_of(dset), &intent) < 0 || !(intent & H5F_ACC_RDWR)) {
+        cache->index_dirty = false;
+    }
+    if (sort_acquisition_index(cache) != ISMRMRD_NOERROR) {
+        return NULL;
+    }
+
+    /* The leading specified counters select a contiguous range */
+    query_counters(query, key);
+    for (prefix = 0; prefix < INDEX_COUNTERS && key[prefix] != ISMRMRD_INDEX_ANY; prefix++);
+
+    lo = 0;
+    hi = cache->index_size;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (compare_index_prefix(&cache->index[mid], key, prefix) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    first = lo;
+    hi = cache->index_size;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (compare_index_prefix(&cache->index[mid], key, prefix) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    last = lo;
+    if (first == last) {
+        return NULL;
+    }
+
+    matches = (uint32_t *) malloc((last - first) * sizeof(uint32_t));
+    if (matches == NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc query result.");
+        return NULL;
+    }
+    for (n = first; n < last; n++) {
+        const ISMRMRD_AcquisitionIndexEntry *entry = &cache->index[n];
+        bool match = (entry->flags & query->flags_set) == query->flags_set &&
+                     (entry->flags & query->flags_clear) == 0;
+        for (c = prefix + 1; match && c < INDEX_COUNTERS; c++) {
+            match = key[c] == ISMRMRD_INDEX_ANY || key[c] == index_counter(entry, c);
+        }
+        if (match) {
+            matches[(*count)++] = entry->acquisition;
+        }
+    }
+    if (*count == 0) {
+        free(matches);
+        return NULL;
+    }
+    qsort(matches, *count, sizeof(uint32_t), compare_uint32);
+    return matches;
+}
+
+LOCKED_HDF5_FUNCTION(uint32_t *, query_acquisition_index,
+        (const ISMRMRD_Dataset *dset, const ISMRMRD_AcquisitionIndexQuery *query, uint32_t *count),
+        (dset, query, count))
+
+static int append_image_unlocked(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *im) {
     int status;
     hid_t datatype;
     char *path, *headerpath, *attrpath, *datapath;
@@ -1245,6 +3284,9 @@ int ismrmrd_append_image(const ISMRMRD_Dataset *dset, const char *varname, const
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
+    if (uses_backend(dset)) {
+        return dset->backend->append_images(dset, varname, im, 1);
+    }
     if (varname==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
     }
@@ -1260,27 +3302,25 @@ int ismrmrd_append_image(const ISMRMRD_Dataset *dset, const char *varname, const
 
     /* Handle the header */
     headerpath = append_to_path(dset, path, "header");
-    datatype = get_hdf5type_imageheader();
+    datatype = get_cached_type(dset, CACHED_TYPE_IMAGEHEADER);
     status = append_element(dset, headerpath, (void *) &im->head, datatype, 0, NULL);
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append image header.");
     }
-    status = H5Tclose(datatype);
     free(headerpath);
 
     /* Handle the attribute string */
     attrpath = append_to_path(dset, path, "attributes");
-    datatype = get_hdf5type_image_attribute_string();
+    datatype = get_cached_type(dset, CACHED_TYPE_ATTRIBUTE_STRING);
     status = append_element(dset, attrpath, (void *) &im->attribute_string, datatype, 0, NULL);
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append image attribute string.");
     }
-    status = H5Tclose(datatype);
     free(attrpath);
 
     /* Handle the data */
     datapath = append_to_path(dset, path, "data");
-    datatype = get_hdf5type_ndarray(im->head.data_type);
+    datatype = get_cached_type(dset, im->head.data_type);
     /* permute the dimensions in the hdf5 file */
     dims[3] = im->head.matrix_size[0];
     dims[2] = im->head.matrix_size[1];
@@ -1290,20 +3330,132 @@ int ismrmrd_append_image(const ISMRMRD_Dataset *dset, const char *varname, const
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append image data.");
     }
-    status = H5Tclose(datatype);
     free(datapath);
 
     /* Final cleanup */
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
-    }
     free(path);
 
     return ISMRMRD_NOERROR;
 }
 
-uint32_t ismrmrd_get_number_of_images(const ISMRMRD_Dataset *dset, const char *varname)
+LOCKED_HDF5_FUNCTION(int, append_image,
+        (const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *im),
+        (dset, varname, im))
+
+static int append_images_unlocked(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *ims, size_t n) {
+    int status = ISMRMRD_NOERROR;
+    hid_t datatype;
+    char *path, *headerpath, *attrpath, *datapath;
+    size_t dims[4];
+    size_t i, count, datasize;
+    hsize_t start = 0;
+    ISMRMRD_ImageHeader *heads;
+    char **attrs;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return dset->backend->append_images(dset, varname, ims, n);
+    }
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (n == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (ims==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Image pointer should not be NULL.");
+    }
+
+    /* All of them go into one array, so they must have the same shape and type */
+    for (i = 1; i < n; i++) {
+        if (ims[i].head.data_type != ims[0].head.data_type ||
+                ims[i].head.channels != ims[0].head.channels ||
+                ims[i].head.matrix_size[0] != ims[0].head.matrix_size[0] ||
+                ims[i].head.matrix_size[1] != ims[0].head.matrix_size[1] ||
+                ims[i].head.matrix_size[2] != ims[0].head.matrix_size[2]) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Images must all have the same size and data type.");
+        }
+    }
+
+    /* Gather the headers and attribute strings, the strings are not copied */
+    heads = (ISMRMRD_ImageHeader *) malloc(n * sizeof(ISMRMRD_ImageHeader));
+    attrs = (char **) malloc(n * sizeof(char *));
+    if (heads == NULL || attrs == NULL) {
+        free(heads);
+        free(attrs);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc image header buffer.");
+    }
+    for (i = 0; i < n; i++) {
+        heads[i] = ims[i].head;
+        attrs[i] = ims[i].attribute_string;
+    }
+
+    /* The group for this set of images */
+    /* /groupname/varname */
+    path = make_path(dset, varname);
+    /* Make sure the path exists */
+    create_link(dset, path);
+    headerpath = append_to_path(dset, path, "header");
+    attrpath = append_to_path(dset, path, "attributes");
+    datapath = append_to_path(dset, path, "data");
+
+    /* Handle the headers */
+    datatype = get_cached_type(dset, CACHED_TYPE_IMAGEHEADER);
+    if (append_elements(dset, headerpath, heads, datatype, 0, NULL, n) != ISMRMRD_NOERROR) {
+        status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append image headers.");
+        goto cleanup;
+    }
+
+    /* Handle the attribute strings */
+    datatype = get_cached_type(dset, CACHED_TYPE_ATTRIBUTE_STRING);
+    if (append_elements(dset, attrpath, attrs, datatype, 0, NULL, n) != ISMRMRD_NOERROR) {
+        status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append image attribute strings.");
+        goto cleanup;
+    }
+
+    /* Handle the data, extended once for all the images */
+    datatype = get_cached_type(dset, ims[0].head.data_type);
+    /* permute the dimensions in the hdf5 file */
+    dims[3] = ims[0].head.matrix_size[0];
+    dims[2] = ims[0].head.matrix_size[1];
+    dims[1] = ims[0].head.matrix_size[2];
+    dims[0] = ims[0].head.channels;
+    if (extend_elements(dset, datapath, datatype, 4, dims, n, &start) != ISMRMRD_NOERROR) {
+        status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append image data.");
+        goto cleanup;
+    }
+    /* Each image goes straight from its buffer into its hyperslab, images
+       that follow each other in memory in one write */
+    datasize = ismrmrd_size_of_image_data(&ims[0]);
+    for (i = 0; i < n; i += count) {
+        for (count = 1; i + count < n; count++) {
+            if ((char *) ims[i + count].data != (char *) ims[i].data + count * datasize) {
+                break;
+            }
+        }
+        if (write_elements(dset, datapath, ims[i].data, datatype, 4, dims, start + i, count) != ISMRMRD_NOERROR) {
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append image data.");
+            break;
+        }
+    }
+
+cleanup:
+    free(datapath);
+    free(attrpath);
+    free(headerpath);
+    free(path);
+    free(attrs);
+    free(heads);
+    return status;
+}
+
+LOCKED_HDF5_FUNCTION(int, append_images,
+        (const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *ims, size_t n),
+        (dset, varname, ims, n))
+
+static uint32_t get_number_of_images_unlocked(const ISMRMRD_Dataset *dset, const char *varname)
 {
     char *path, *headerpath;
     uint32_t numimages;
@@ -1312,6 +3464,9 @@ uint32_t ismrmrd_get_number_of_images(const ISMRMRD_Dataset *dset, const char *v
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
         return 0;
     }
+    if (uses_backend(dset)) {
+        return dset->backend->get_number_of_images(dset, varname);
+    }
     if (varname==NULL) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
         return 0;
@@ -1327,15 +3482,14 @@ uint32_t ismrmrd_get_number_of_images(const ISMRMRD_Dataset *dset, const char *v
     return numimages;
 }
 
+LOCKED_HDF5_FUNCTION(uint32_t, get_number_of_images,
+        (const ISMRMRD_Dataset *dset, const char *varname),
+        (dset, varname))
+
 
 int ismrmrd_read_image(const ISMRMRD_Dataset *dset, const char *varname,
         const uint32_t index, ISMRMRD_Image *im) {
 
-    int status;
-    hid_t datatype;
-    char *path, *headerpath, *attrpath, *datapath, *attr_string;
-    uint32_t numims;
-
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
@@ -1346,65 +3500,192 @@ int ismrmrd_read_image(const ISMRMRD_Dataset *dset, const char *varname,
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Image pointer should not be NULL.");
     }
 
-    numims = ismrmrd_get_number_of_images(dset, varname);
+    return ismrmrd_read_images(dset, varname, index, 1, 1, im);
+}
+
+static int read_images_unlocked(const ISMRMRD_Dataset *dset, const char *varname,
+        const uint32_t start, const uint32_t count, const uint32_t stride, ISMRMRD_Image *ims) {
+
+    int status = ISMRMRD_NOERROR;
+    hid_t datatype;
+    char *path, *headerpath, *attrpath, *datapath;
+    ISMRMRD_ImageHeader *heads = NULL;
+    char **attrs = NULL;
+    size_t datasize;
+    uint32_t i;
 
-    if (index > numims) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Index requested exceeds number of images in the dataset.");
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return dset->backend->read_images(dset, varname, start, count, stride, ims);
+    }
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (ims==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Image pointer should not be NULL.");
+    }
+    if (stride == 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Stride should not be zero.");
+    }
+
+    heads = (ISMRMRD_ImageHeader *) malloc(count * sizeof(ISMRMRD_ImageHeader));
+    attrs = (char **) calloc(count, sizeof(char *));
+    if (heads == NULL || attrs == NULL) {
+        free(heads);
+        free(attrs);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc image header buffer.");
     }
 
     /* The group for this set of images */
     /* /groupname/varname */
     path = make_path(dset, varname);
-
-    /* Handle the header */
     headerpath = append_to_path(dset, path, "header");
-    datatype = get_hdf5type_imageheader();
-    status = read_element(dset, headerpath, (void *) &im->head, datatype, index);
-    if (status != ISMRMRD_NOERROR) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image header.");
+    attrpath = append_to_path(dset, path, "attributes");
+    datapath = append_to_path(dset, path, "data");
+
+    /* Handle the headers */
+    datatype = get_cached_type(dset, CACHED_TYPE_IMAGEHEADER);
+    if (read_strided_elements(dset, headerpath, heads, datatype, start, stride, count, NULL) != ISMRMRD_NOERROR) {
+        status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image headers.");
+        goto cleanup;
     }
-    free(headerpath);
-    H5Tclose(datatype);
 
-    /* Allocate the memory for the attribute string and the data */
-    ismrmrd_make_consistent_image(im);
+    /* Allocate the memory for the attribute strings and the data */
+    for (i = 0; i < count; i++) {
+        ims[i].head = heads[i];
+        if (ismrmrd_make_consistent_image(&ims[i]) != ISMRMRD_NOERROR) {
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to allocate image.");
+            goto cleanup;
+        }
+    }
 
-    /* Handle the attribute string */
-    attrpath = append_to_path(dset, path, "attributes");
-    datatype = get_hdf5type_image_attribute_string();
-    status = read_element(dset, attrpath, (void *) &attr_string, datatype, index);
-    if (status != ISMRMRD_NOERROR) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image attribute string.");
+    /* Handle the attribute strings */
+    datatype = get_cached_type(dset, CACHED_TYPE_ATTRIBUTE_STRING);
+    if (read_strided_elements(dset, attrpath, attrs, datatype, start, stride, count, NULL) != ISMRMRD_NOERROR) {
+        status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image attribute strings.");
+        goto cleanup;
+    }
+    /* copy the attribute strings read from the file into the Images */
+    for (i = 0; i < count; i++) {
+        if (attrs[i] != NULL && ims[i].head.attribute_string_len > 0) {
+            memcpy(ims[i].attribute_string, attrs[i], ismrmrd_size_of_image_attribute_string(&ims[i]));
+        }
+    }
+
+    /* Handle the data, all images of a variable share one shape and type */
+    datasize = ismrmrd_size_of_image_data(&ims[0]);
+    for (i = 1; i < count; i++) {
+        if (ims[i].head.data_type != ims[0].head.data_type ||
+                ismrmrd_size_of_image_data(&ims[i]) != datasize) {
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Image headers do not match the image data.");
+            goto cleanup;
+        }
+    }
+    /* Each image is read straight into its own buffer */
+    datatype = get_cached_type(dset, ims[0].head.data_type);
+    for (i = 0; i < count; i++) {
+        if (read_strided_elements(dset, datapath, ims[i].data, datatype, start + i * stride, 1, 1, NULL) != ISMRMRD_NOERROR) {
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image data.");
+            break;
+        }
     }
+
+cleanup:
+    for (i = 0; i < count; i++) {
+        free(attrs[i]);
+    }
+    free(datapath);
     free(attrpath);
-    H5Tclose(datatype);
+    free(headerpath);
+    free(path);
+    free(attrs);
+    free(heads);
+    return status;
+}
 
-    /* copy the attribute string read from the file into the Image */
-    memcpy(im->attribute_string, attr_string, ismrmrd_size_of_image_attribute_string(im));
-    free(attr_string);
+LOCKED_HDF5_FUNCTION(int, read_images,
+        (const ISMRMRD_Dataset *dset, const char *varname, const uint32_t start, const uint32_t count, const uint32_t stride, ISMRMRD_Image *ims),
+        (dset, varname, start, count, stride, ims))
 
-    /* Handle the data */
+static int read_image_array_unlocked(const ISMRMRD_Dataset *dset, const char *varname,
+        const uint32_t start, const uint32_t count, const uint32_t stride,
+        ISMRMRD_NDArray *arr, ISMRMRD_ImageHeader *heads) {
+
+    int status = ISMRMRD_NOERROR;
+    hid_t datatype;
+    char *path, *headerpath, *datapath;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+    }
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (arr==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Array pointer should not be NULL.");
+    }
+    if (count == 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Count should not be zero.");
+    }
+    if (stride == 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Stride should not be zero.");
+    }
+
+    /* The group for this set of images */
+    /* /groupname/varname */
+    path = make_path(dset, varname);
+    headerpath = append_to_path(dset, path, "header");
     datapath = append_to_path(dset, path, "data");
-    datatype = get_hdf5type_ndarray(im->head.data_type);
-    status = read_element(dset, datapath, im->data, datatype, index);
-    if (status != ISMRMRD_NOERROR) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image data.");
+
+    /* Handle the headers */
+    if (heads != NULL) {
+        datatype = get_cached_type(dset, CACHED_TYPE_IMAGEHEADER);
+        if (read_strided_elements(dset, headerpath, heads, datatype, start, stride, count, NULL) != ISMRMRD_NOERROR) {
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image headers.");
+            goto cleanup;
+        }
+    }
+
+    /* The images are (x, y, z, channels), the array gets the image index as the 5th dimension */
+    if (get_array_properties(dset, datapath, &arr->ndim, arr->dims, &arr->data_type) != ISMRMRD_NOERROR ||
+            arr->ndim != 4) {
+        status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to get image data properties.");
+        goto cleanup;
+    }
+    arr->ndim = 5;
+    arr->dims[4] = count;
+    datatype = get_cached_type(dset, arr->data_type);
+    if (ismrmrd_make_consistent_ndarray(arr) != ISMRMRD_NOERROR) {
+        status = ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to allocate image array.");
+        goto cleanup;
     }
-    free(datapath);
 
-    /* Final cleanup */
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
+    /* The whole range is read with one hyperslab selection */
+    if (read_strided_elements(dset, datapath, arr->data, datatype, start, stride, count, NULL) != ISMRMRD_NOERROR) {
+        status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image data.");
     }
-    free(path);
 
-    return ISMRMRD_NOERROR;
+cleanup:
+    free(datapath);
+    free(headerpath);
+    free(path);
+    return status;
 }
 
+LOCKED_HDF5_FUNCTION(int, read_image_array,
+        (const ISMRMRD_Dataset *dset, const char *varname, const uint32_t start, const uint32_t count, const uint32_t stride, ISMRMRD_NDArray *arr, ISMRMRD_ImageHeader *heads),
+        (dset, varname, start, count, stride, arr, heads))
+
 
-int ismrmrd_append_waveform(const ISMRMRD_Dataset *dset, const ISMRMRD_Waveform *wav) {
+static int append_waveform_unlocked(const ISMRMRD_Dataset *dset, const ISMRMRD_Waveform *wav) {
     int status;
     char *path;
     hid_t datatype;
@@ -1413,6 +3694,9 @@ int ismrmrd_append_waveform(const ISMRMRD_Dataset *dset, const ISMRMRD_Waveform
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
+    if (uses_backend(dset)) {
+        return dset->backend->append_waveform(dset, wav);
+    }
     if (wav==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
     }
@@ -1421,7 +3705,7 @@ int ismrmrd_append_waveform(const ISMRMRD_Dataset *dset, const ISMRMRD_Waveform
     path = make_path(dset, "waveforms");
 
     /* The acquisition datatype */
-    datatype = get_hdf5type_waveform();
+    datatype = get_cached_type(dset, CACHED_TYPE_WAVEFORM);
 
     /* Create the HDF5 version of the acquisition */
     hdf5wav[0].head = wav->head;
@@ -1436,17 +3720,14 @@ int ismrmrd_append_waveform(const ISMRMRD_Dataset *dset, const ISMRMRD_Waveform
 
     free(path);
 
-    /* Clean up */
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
-    }
-
-    return ISMRMRD_NOERROR;
+    return swmr_appended(dset, 1);
 }
 
-int ismrmrd_read_waveform(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Waveform *wav)
+LOCKED_HDF5_FUNCTION(int, append_waveform,
+        (const ISMRMRD_Dataset *dset, const ISMRMRD_Waveform *wav),
+        (dset, wav))
+
+static int read_waveform_unlocked(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Waveform *wav)
 {
     hid_t datatype;
     herr_t status;
@@ -1456,6 +3737,9 @@ int ismrmrd_read_waveform(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_W
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
+    if (uses_backend(dset)) {
+        return dset->backend->read_waveform(dset, index, wav);
+    }
     if (wav==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Waveform pointer should not be NULL.");
     }
@@ -1464,27 +3748,28 @@ int ismrmrd_read_waveform(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_W
     path = make_path(dset, "waveforms");
 
     /* The acquisition datatype */
-    datatype = get_hdf5type_waveform();
+    datatype = get_cached_type(dset, CACHED_TYPE_WAVEFORM);
 
     status = read_element(dset, path, &hdf5wav, datatype, index);
+    free(path);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read waveform.");
+    }
     memcpy(&wav->head, &hdf5wav.head, sizeof(ISMRMRD_WaveformHeader));
     ismrmrd_make_consistent_waveform(wav);
     memcpy(wav->data, hdf5wav.data.p, ismrmrd_size_of_waveform_data(wav));
 
     /* clean up */
-    free(path);
     free(hdf5wav.data.p);
 
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
-    }
-
     return ISMRMRD_NOERROR;
 }
 
-uint32_t ismrmrd_get_number_of_waveforms(const ISMRMRD_Dataset *dset) {
+LOCKED_HDF5_FUNCTION(int, read_waveform,
+        (const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Waveform *wav),
+        (dset, index, wav))
+
+static uint32_t get_number_of_waveforms_unlocked(const ISMRMRD_Dataset *dset) {
     char *path;
     uint32_t numacq;
 
@@ -1492,14 +3777,23 @@ uint32_t ismrmrd_get_number_of_waveforms(const ISMRMRD_Dataset *dset) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
         return 0;
     }
+    if (uses_backend(dset)) {
+        return dset->backend->get_number_of_waveforms(dset);
+    }
     /* The path to the acqusition data */
     path = make_path(dset, "waveforms");
+    swmr_refresh(dset, path);
     numacq = get_number_of_elements(dset, path);
     free(path);
+    if (dset->cache != NULL && numacq > dset->cache->swmr_counts[1]) {
+        numacq = dset->cache->swmr_counts[1];
+    }
     return numacq;
 }
 
-int ismrmrd_append_array(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_NDArray *arr) {
+LOCKED_HDF5_FUNCTION(uint32_t, get_number_of_waveforms, (const ISMRMRD_Dataset *dset), (dset))
+
+static int append_array_unlocked(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_NDArray *arr) {
     int status;
     hid_t datatype;
     uint16_t ndim;
@@ -1510,6 +3804,9 @@ int ismrmrd_append_array(const ISMRMRD_Dataset *dset, const char *varname, const
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
+    if (uses_backend(dset)) {
+        return dset->backend->append_array(dset, varname, arr);
+    }
     if (varname==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
     }
@@ -1522,7 +3819,7 @@ int ismrmrd_append_array(const ISMRMRD_Dataset *dset, const char *varname, const
     path = make_path(dset, varname);
 
     /* Handle the data */
-    datatype = get_hdf5type_ndarray(arr->data_type);
+    datatype = get_cached_type(dset, arr->data_type);
     ndim = arr->ndim;
     dims = (size_t *) malloc(ndim*sizeof(size_t));
     /* permute the dimensions in the hdf5 file */
@@ -1537,17 +3834,44 @@ int ismrmrd_append_array(const ISMRMRD_Dataset *dset, const char *varname, const
 
     /* Final cleanup */
     free(dims);
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
-    }
     free(path);
 
     return ISMRMRD_NOERROR;
 }
 
-uint32_t ismrmrd_get_number_of_arrays(const ISMRMRD_Dataset *dset, const char *varname) {
+LOCKED_HDF5_FUNCTION(int, append_array,
+        (const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_NDArray *arr),
+        (dset, varname, arr))
+
+static int get_array_properties_unlocked(const ISMRMRD_Dataset *dset, const char *varname,
+        uint16_t *ndim, size_t dims[ISMRMRD_NDARRAY_MAXDIM], uint16_t *data_type) {
+    int status;
+    char *path;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+    }
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (ndim==NULL || dims==NULL || data_type==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+
+    path = make_path(dset, varname);
+    status = get_array_properties(dset, path, ndim, dims, data_type);
+    free(path);
+    return status;
+}
+
+LOCKED_HDF5_FUNCTION(int, get_array_properties,
+        (const ISMRMRD_Dataset *dset, const char *varname, uint16_t *ndim, size_t dims[ISMRMRD_NDARRAY_MAXDIM], uint16_t *data_type),
+        (dset, varname, ndim, dims, data_type))
+
+static uint32_t get_number_of_arrays_unlocked(const ISMRMRD_Dataset *dset, const char *varname) {
     char *path;
     uint32_t numarrays;
 
@@ -1555,6 +3879,9 @@ uint32_t ismrmrd_get_number_of_arrays(const ISMRMRD_Dataset *dset, const char *v
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
         return 0;
     }
+    if (uses_backend(dset)) {
+        return dset->backend->get_number_of_arrays(dset, varname);
+    }
     if (varname==NULL) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
         return 0;
@@ -1568,7 +3895,11 @@ uint32_t ismrmrd_get_number_of_arrays(const ISMRMRD_Dataset *dset, const char *v
     return numarrays;
 }
 
-int ismrmrd_read_array(const ISMRMRD_Dataset *dset, const char *varname,
+LOCKED_HDF5_FUNCTION(uint32_t, get_number_of_arrays,
+        (const ISMRMRD_Dataset *dset, const char *varname),
+        (dset, varname))
+
+static int read_array_unlocked(const ISMRMRD_Dataset *dset, const char *varname,
         const uint32_t index, ISMRMRD_NDArray *arr) {    
     int status;
     hid_t datatype;
@@ -1577,6 +3908,9 @@ int ismrmrd_read_array(const ISMRMRD_Dataset *dset, const char *varname,
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
+    if (uses_backend(dset)) {
+        return dset->backend->read_array(dset, varname, index, arr);
+    }
     if (varname==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
     }
@@ -1590,7 +3924,7 @@ int ismrmrd_read_array(const ISMRMRD_Dataset *dset, const char *varname,
 
     /* get the array properties */
     get_array_properties(dset, path, &arr->ndim, arr->dims, &arr->data_type);
-    datatype = get_hdf5type_ndarray(arr->data_type);
+    datatype = get_cached_type(dset, arr->data_type);
 
     /* allocate the memory */
     ismrmrd_make_consistent_ndarray(arr);
@@ -1602,16 +3936,482 @@ int ismrmrd_read_array(const ISMRMRD_Dataset *dset, const char *varname,
     }
 
     /* Final cleanup */
-    status = H5Tclose(datatype);
-    if (status < 0) {
+    free(path);
+
+    return ISMRMRD_NOERROR;
+}
+
+LOCKED_HDF5_FUNCTION(int, read_array,
+        (const ISMRMRD_Dataset *dset, const char *varname, const uint32_t index, ISMRMRD_NDArray *arr),
+        (dset, varname, index, arr))
+
+
+/* Reads the region given by offset and count, in array order, of the element
+ * with the specified index of the dataset at path into arr */
+static int read_element_slab(const ISMRMRD_Dataset *dset, const char *path, const uint32_t index,
+        const uint16_t ndim, const size_t *offset, const size_t *count, ISMRMRD_NDArray *arr)
+{
+    hid_t dataset, filespace, memspace, datatype;
+    hsize_t hdfdims[ISMRMRD_NDARRAY_MAXDIM + 1];
+    hsize_t hdfoffset[ISMRMRD_NDARRAY_MAXDIM + 1], hdfcount[ISMRMRD_NDARRAY_MAXDIM + 1];
+    herr_t h5status = 0;
+    uint16_t n;
+
+    if (get_array_properties(dset, path, &arr->ndim, arr->dims, &arr->data_type) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to get array properties.");
+    }
+    if (arr->ndim != ndim) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Region dimensions do not match the stored array.");
+    }
+    for (n = 0; n < ndim; n++) {
+        if (count[n] == 0 || offset[n] + count[n] > arr->dims[n]) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Region exceeds the stored array.");
+        }
+    }
+
+    dataset = open_cached_dataset(dset, path);
+    if (dataset < 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Path to element not found.");
+    }
+    filespace = H5Dget_space(dataset);
+    H5Sget_simple_extent_dims(filespace, hdfdims, NULL);
+    get_contiguous_count(dset, dataset, &hdfdims[0]);
+    if (index >= hdfdims[0]) {
+        H5Sclose(filespace);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+
+    /* permute the dimensions, the first HDF5 dimension is the append dimension */
+    hdfoffset[0] = index;
+    hdfcount[0] = 1;
+    for (n = 0; n < ndim; n++) {
+        hdfoffset[ndim - n] = offset[n];
+        hdfcount[ndim - n] = count[n];
+        arr->dims[n] = count[n];
+    }
+
+    /* allocate the memory for the region only */
+    if (ismrmrd_make_consistent_ndarray(arr) != ISMRMRD_NOERROR) {
+        H5Sclose(filespace);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to allocate array.");
+    }
+
+    h5status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, hdfoffset, NULL, hdfcount, NULL);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        H5Sclose(filespace);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to select hyperslab");
+    }
+    memspace = H5Screate_simple(ndim + 1, hdfcount, NULL);
+
+    datatype = get_cached_type(dset, arr->data_type);
+    h5status = H5Dread(dataset, datatype, memspace, filespace, H5P_DEFAULT, arr->data);
+    H5Sclose(memspace);
+    H5Sclose(filespace);
+    if (h5status < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to read from dataset.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static int read_array_slab_unlocked(const ISMRMRD_Dataset *dset, const char *varname,
+        const uint32_t index, const uint16_t ndim,
+        const size_t *offset, const size_t *count, ISMRMRD_NDArray *arr) {
+    int status;
+    char *path;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+    }
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (arr==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Array pointer should not be NULL.");
+    }
+    if (offset==NULL || count==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Region pointers should not be NULL.");
+    }
+    if (ndim > ISMRMRD_NDARRAY_MAXDIM) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Too many dimensions.");
+    }
+
+    /* The group for this set */
+    /* /groupname/varname */
+    path = make_path(dset, varname);
+    status = read_element_slab(dset, path, index, ndim, offset, count, arr);
+    free(path);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read array region.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+LOCKED_HDF5_FUNCTION(int, read_array_slab,
+        (const ISMRMRD_Dataset *dset, const char *varname, const uint32_t index, const uint16_t ndim, const size_t *offset, const size_t *count, ISMRMRD_NDArray *arr),
+        (dset, varname, index, ndim, offset, count, arr))
+
+static int read_image_slab_unlocked(const ISMRMRD_Dataset *dset, const char *varname,
+        const uint32_t index, const size_t offset[4],
+        const size_t count[4], ISMRMRD_NDArray *arr) {
+    int status;
+    char *path, *datapath;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+    }
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (arr==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Array pointer should not be NULL.");
+    }
+    if (offset==NULL || count==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Region pointers should not be NULL.");
     }
+
+    /* The image data is stored as a (x, y, z, channels) array */
+    /* /groupname/varname/data */
+    path = make_path(dset, varname);
+    datapath = append_to_path(dset, path, "data");
+    status = read_element_slab(dset, datapath, index, 4, offset, count, arr);
+    free(datapath);
+    free(path);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image region.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+LOCKED_HDF5_FUNCTION(int, read_image_slab,
+        (const ISMRMRD_Dataset *dset, const char *varname, const uint32_t index, const size_t offset[4], const size_t count[4], ISMRMRD_NDArray *arr),
+        (dset, varname, index, offset, count, arr))
+
+
+/* Maps the element with the specified index of the dataset at path read-only.
+ * map->data stays NULL if the element is not stored contiguously, uncompressed
+ * and in the native memory layout, or if mapping is not supported. */
+static int map_element(const ISMRMRD_Dataset *dset, const char *path, const uint32_t index,
+        ISMRMRD_ArrayMapping *map)
+{
+    hid_t dataset, plist, filetype, memtype, driver;
+    H5D_layout_t layout;
+    haddr_t address;
+    hsize_t nstored, userblock = 0;
+    hsize_t hdfdims[ISMRMRD_NDARRAY_MAXDIM + 1];
+    unsigned intent = 0;
+    int nfilters, equal;
+    size_t element_size;
+    uint16_t n;
+
+    map->data = NULL;
+    map->map_base = NULL;
+    map->map_length = 0;
+
+    if (get_array_properties(dset, path, &map->ndim, map->dims, &map->data_type) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to get array properties.");
+    }
+    dataset = open_cached_dataset(dset, path);
+    if (dataset < 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Path to element not found.");
+    }
+    filetype = H5Dget_space(dataset);
+    H5Sget_simple_extent_dims(filetype, hdfdims, NULL);
+    H5Sclose(filetype);
+    nstored = hdfdims[0];
+    get_contiguous_count(dset, dataset, &nstored);
+    if (index >= nstored) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+
+    /* The bytes on disk must be exactly the array payload */
+    plist = H5Dget_create_plist(dataset);
+    layout = H5Pget_layout(plist);
+    nfilters = H5Pget_nfilters(plist);
+    H5Pclose(plist);
+    if (layout != H5D_CONTIGUOUS || nfilters != 0) {
+        return ISMRMRD_NOERROR;
+    }
+
+    /* Only drivers which keep the file as is on disk, not e.g. the core driver */
+    plist = H5Fget_access_plist(file_of(dset));
+    driver = H5Pget_driver(plist);
+    H5Pclose(plist);
+    if (driver != H5FD_SEC2 && driver != H5FD_STDIO) {
+        return ISMRMRD_NOERROR;
+    }
+    address = H5Dget_offset(dataset);
+    if (address == HADDR_UNDEF) {
+        return ISMRMRD_NOERROR;
+    }
+    memtype = get_cached_type(dset, map->data_type);
+    filetype = H5Dget_type(dataset);
+    equal = H5Tequal(filetype, memtype);
+    H5Tclose(filetype);
+    if (equal <= 0) {
+        return ISMRMRD_NOERROR;
+    }
+
+    /* Addresses are relative to the end of the user block */
+    plist = H5Fget_create_plist(file_of(dset));
+    H5Pget_userblock(plist, &userblock);
+    H5Pclose(plist);
+
+    /* Write out what this process has buffered */
+    if (H5Fget_intent(file_of(dset), &intent) >= 0 && (intent & H5F_ACC_RDWR)) {
+        if (H5Fflush(file_of(dset), H5F_SCOPE_LOCAL) < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to flush file.");
+        }
+    }
+
+    element_size = H5Tget_size(memtype);
+    for (n = 0; n < map->ndim; n++) {
+        element_size *= map->dims[n];
+    }
+
+#ifdef _WIN32
+    (void) address;
+    (void) element_size;
+    return ISMRMRD_NOERROR;
+#else
+    {
+        off_t start, aligned;
+        long page = sysconf(_SC_PAGESIZE);
+        void *base;
+        int fd;
+
+        if (element_size == 0 || page <= 0) {
+            return ISMRMRD_NOERROR;
+        }
+        start = (off_t) (userblock + address + (hsize_t) index * element_size);
+        aligned = start - start % page;
+        fd = open(dset->filename, O_RDONLY);
+        if (fd < 0) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file for mapping.");
+        }
+        base = mmap(NULL, (size_t) (start - aligned) + element_size, PROT_READ, MAP_SHARED, fd, aligned);
+        close(fd);
+        if (base == MAP_FAILED) {
+            return ISMRMRD_NOERROR;
+        }
+        map->map_base = base;
+        map->map_length = (size_t) (start - aligned) + element_size;
+        map->data = (const char *) base + (start - aligned);
+    }
+    return ISMRMRD_NOERROR;
+#endif
+}
+
+static int map_array_unlocked(const ISMRMRD_Dataset *dset, const char *varname,
+        const uint32_t index, ISMRMRD_ArrayMapping *map) {
+    int status;
+    char *path;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+    }
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (map==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Mapping pointer should not be NULL.");
+    }
+
+    path = make_path(dset, varname);
+    status = map_element(dset, path, index, map);
+    free(path);
+    return status;
+}
+
+LOCKED_HDF5_FUNCTION(int, map_array,
+        (const ISMRMRD_Dataset *dset, const char *varname, const uint32_t index, ISMRMRD_ArrayMapping *map),
+        (dset, varname, index, map))
+
+static int map_image_data_unlocked(const ISMRMRD_Dataset *dset, const char *varname,
+        const uint32_t index, ISMRMRD_ArrayMapping *map) {
+    int status;
+    char *path, *datapath;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (uses_backend(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Not supported by the dataset backend.");
+    }
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (map==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Mapping pointer should not be NULL.");
+    }
+
+    /* /groupname/varname/data */
+    path = make_path(dset, varname);
+    datapath = append_to_path(dset, path, "data");
+    status = map_element(dset, datapath, index, map);
+    free(datapath);
     free(path);
+    return status;
+}
+
+LOCKED_HDF5_FUNCTION(int, map_image_data,
+        (const ISMRMRD_Dataset *dset, const char *varname, const uint32_t index, ISMRMRD_ArrayMapping *map),
+        (dset, varname, index, map))
+
+int ismrmrd_unmap_array(ISMRMRD_ArrayMapping *map) {
+    if (map==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Mapping pointer should not be NULL.");
+    }
+#ifndef _WIN32
+    if (map->map_base != NULL && munmap(map->map_base, map->map_length) != 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to unmap array.");
+    }
+#endif
+    map->data = NULL;
+    map->map_base = NULL;
+    map->map_length = 0;
+    return ISMRMRD_NOERROR;
+}
+
+
+int ismrmrd_init_storage_policy(ISMRMRD_StoragePolicy *policy) {
+    if (policy == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+    policy->chunk_elements = 0;
+    policy->chunk_cache_bytes = 0;
+    policy->chunk_cache_slots = 0;
+    policy->alloc_time = ISMRMRD_ALLOC_TIME_DEFAULT;
+    policy->shuffle = 0;
+    policy->deflate_level = 0;
+    policy->filter_id = 0;
+    policy->filter_nvalues = 0;
+    memset(policy->filter_values, 0, sizeof(policy->filter_values));
+    policy->contiguous_elements = 0;
+    return ISMRMRD_NOERROR;
+}
+
+uint32_t ismrmrd_suggested_chunk_elements(size_t element_size) {
+    size_t nelem;
+    if (element_size == 0 || element_size >= ISMRMRD_SUGGESTED_CHUNK_BYTES) {
+        return 1;
+    }
+    nelem = ISMRMRD_SUGGESTED_CHUNK_BYTES / element_size;
+    return nelem > 65536 ? 65536 : (uint32_t) nelem;
+}
+
+static int check_storage_policy(const ISMRMRD_StoragePolicy *policy) {
+    if (policy==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Storage policy pointer should not be NULL.");
+    }
+    if (policy->alloc_time > ISMRMRD_ALLOC_TIME_LATE) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Invalid allocation time.");
+    }
+    if (policy->deflate_level > 9) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Invalid deflate level.");
+    }
+    if (policy->filter_nvalues > ISMRMRD_FILTER_MAX_VALUES) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Too many filter values.");
+    }
+    if (policy->deflate_level > 0 && H5Zfilter_avail(H5Z_FILTER_DEFLATE) <= 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Deflate filter is not available.");
+    }
+    if (policy->contiguous_elements > 0 &&
+            (policy->shuffle || policy->deflate_level > 0 || policy->filter_id > 0)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Contiguous storage cannot be filtered.");
+    }
+    /* This also loads dynamically registered filter plugins */
+    if (policy->filter_id > 0 && H5Zfilter_avail((H5Z_filter_t) policy->filter_id) <= 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Filter is not available.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static int set_storage_policy_unlocked(const ISMRMRD_Dataset *dset, const char *varname,
+                               const ISMRMRD_StoragePolicy *policy)
+{
+    ISMRMRD_DatasetCache *cache;
+    ISMRMRD_CachedPolicy *newPtr;
+    char *path;
+    size_t n;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    /* Storage policies only apply to HDF5 files */
+    if (uses_backend(dset)) {
+        return ISMRMRD_NOERROR;
+    }
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (check_storage_policy(policy) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Invalid storage policy.");
+    }
+    cache = dset->cache;
+    if (cache == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open");
+    }
+
+    /* /groupname/varname, or /groupname for the whole group */
+    if (varname[0] == '\0') {
+        path = (char *) malloc(strlen(dset->groupname) + 1);
+        if (path != NULL) {
+            strcpy(path, dset->groupname);
+        }
+    } else {
+        path = make_path(dset, varname);
+    }
+    if (path == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc path");
+    }
+
+    /* Reopen anything already open below path to apply the new chunk cache */
+    n = 0;
+    while (n < cache->num_datasets) {
+        if (path_is_below(cache->datasets[n].path, path)) {
+            remove_cached_dataset(dset, cache->datasets[n].path);
+        } else {
+            n++;
+        }
+    }
+
+    for (n = 0; n < cache->num_policies; n++) {
+        if (strcmp(cache->policies[n].path, path) == 0) {
+            cache->policies[n].policy = *policy;
+            free(path);
+            return ISMRMRD_NOERROR;
+        }
+    }
+
+    newPtr = (ISMRMRD_CachedPolicy *) realloc(cache->policies,
+            (cache->num_policies + 1) * sizeof(ISMRMRD_CachedPolicy));
+    if (newPtr == NULL) {
+        free(path);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc storage policies");
+    }
+    cache->policies = newPtr;
+    cache->policies[cache->num_policies].path = path;
+    cache->policies[cache->num_policies].policy = *policy;
+    cache->num_policies++;
 
     return ISMRMRD_NOERROR;
 }
 
+LOCKED_HDF5_FUNCTION(int, set_storage_policy,
+        (const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_StoragePolicy *policy),
+        (dset, varname, policy))
 
 #ifdef __cplusplus
 } /* extern "C" */
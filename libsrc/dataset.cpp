@@ -4,6 +4,65 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+//
+// HDF5 lock
+//
+static bool hdf5_is_threadsafe()
+{
+    static const bool threadsafe = []() {
+        hbool_t is_ts = 0;
+        return H5is_library_threadsafe(&is_ts) >= 0 && is_ts;
+    }();
+    return threadsafe;
+}
+
+static std::recursive_mutex &hdf5_mutex()
+{
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+// How often the calling thread holds the lock
+static thread_local unsigned hdf5_lock_depth = 0;
+
+extern "C" {
+
+void ismrmrd_lock_hdf5(void)
+{
+    if (!hdf5_is_threadsafe()) {
+        hdf5_mutex().lock();
+        hdf5_lock_depth++;
+    }
+}
+
+void ismrmrd_unlock_hdf5(void)
+{
+    if (!hdf5_is_threadsafe()) {
+        hdf5_lock_depth--;
+        hdf5_mutex().unlock();
+    }
+}
+
+// Sleeps with the HDF5 lock released, so that other threads can use HDF5
+// while a dataset function waits. Private to the library.
+void ismrmrd_sleep_without_hdf5_lock(uint32_t ms)
+{
+    unsigned depth = hdf5_lock_depth;
+    for (unsigned n = 0; n < depth; n++) {
+        ismrmrd_unlock_hdf5();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    for (unsigned n = 0; n < depth; n++) {
+        ismrmrd_lock_hdf5();
+    }
+}
+
+} // extern "C"
 
 namespace ISMRMRD {
 //
@@ -26,6 +85,69 @@ Dataset::Dataset(const char* filename, const char* groupname, bool create_file_i
     }
 }
 
+Dataset::Dataset(const char* filename, const char* groupname, bool create_file_if_needed,
+                 const ISMRMRD_StoragePolicy &default_policy)
+{
+    int status;
+    status = ismrmrd_init_dataset(&dset_, filename, groupname);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    status = ismrmrd_open_dataset(&dset_, create_file_if_needed);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    status = ismrmrd_set_storage_policy(&dset_, "", &default_policy);
+    if (status != ISMRMRD_NOERROR) {
+        ismrmrd_close_dataset(&dset_);
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+Dataset::Dataset(const char* filename, const char* groupname, const ISMRMRD_DatasetOptions &options)
+{
+    int status;
+    status = ismrmrd_init_dataset(&dset_, filename, groupname);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    status = ismrmrd_open_dataset_ex(&dset_, &options);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+Dataset::Dataset(const char* filename, const char* groupname, bool create_file_if_needed,
+                 const ISMRMRD_DatasetBackend *backend)
+{
+    int status;
+    status = ismrmrd_init_dataset(&dset_, filename, groupname);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    status = ismrmrd_set_dataset_backend(&dset_, backend);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    status = ismrmrd_open_dataset(&dset_, create_file_if_needed);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+Dataset::Dataset(const char* filename, const char* groupname, SwmrRole role)
+{
+    int status;
+    status = ismrmrd_init_dataset(&dset_, filename, groupname);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    status = ismrmrd_open_dataset_swmr(&dset_, role == SWMR_READER);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
 // Destructor
 Dataset::~Dataset()
 {
@@ -60,6 +182,19 @@ void Dataset::appendAcquisition(const Acquisition &acq)
     }
 }
 
+void Dataset::appendAcquisitions(const std::vector<Acquisition> &acqs)
+{
+    // Shallow copies, the trajectories and data are not copied
+    std::vector<ISMRMRD_Acquisition> cacqs(acqs.size());
+    for (size_t n = 0; n < acqs.size(); n++) {
+        cacqs[n] = acqs[n].acq;
+    }
+    int status = ismrmrd_append_acquisitions(&dset_, cacqs.data(), cacqs.size());
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
 void Dataset::readAcquisition(uint32_t index, Acquisition & acq) {
     int status = ismrmrd_read_acquisition(&dset_, index, &acq.acq);
     if (status != ISMRMRD_NOERROR) {
@@ -67,6 +202,60 @@ void Dataset::readAcquisition(uint32_t index, Acquisition & acq) {
     }
 }
 
+void Dataset::readAcquisitions(uint32_t start, uint32_t count, std::vector<Acquisition> &acqs) {
+    acqs.resize(count);
+    // Hand the existing buffers to the C API so that they are reused
+    std::vector<ISMRMRD_Acquisition> cacqs(count);
+    for (uint32_t n = 0; n < count; n++) {
+        cacqs[n] = acqs[n].acq;
+    }
+    int status = ismrmrd_read_acquisitions(&dset_, start, count, cacqs.data());
+    // The buffers may have been reallocated, even on failure
+    for (uint32_t n = 0; n < count; n++) {
+        acqs[n].acq = cacqs[n];
+    }
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void Dataset::readAcquisitionHeaders(uint32_t start, uint32_t count, std::vector<AcquisitionHeader> &heads) {
+    heads.resize(count);
+    // AcquisitionHeader adds no members, so the vector is an array of C headers
+    int status = ismrmrd_read_acquisition_headers(&dset_, start, count, heads.data());
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void Dataset::updateAcquisitionIndex()
+{
+    int status = ismrmrd_update_acquisition_index(&dset_);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+bool Dataset::hasAcquisitionIndex()
+{
+    return ismrmrd_has_acquisition_index(&dset_);
+}
+
+std::vector<uint32_t> Dataset::queryAcquisitionIndex(const ISMRMRD_AcquisitionIndexQuery &query)
+{
+    uint32_t count = 0;
+    uint32_t *matches = ismrmrd_query_acquisition_index(&dset_, &query, &count);
+    if (matches == NULL) {
+        // No matches is not an error, but a missing index is
+        if (!hasAcquisitionIndex()) {
+            throw std::runtime_error(build_exception_string());
+        }
+        return std::vector<uint32_t>();
+    }
+    std::vector<uint32_t> indices(matches, matches + count);
+    free(matches);
+    return indices;
+}
 
 uint32_t Dataset::getNumberOfAcquisitions()
 {
@@ -91,6 +280,19 @@ void Dataset::appendImage(const std::string &var, const ISMRMRD_Image *im)
     }
 }
 
+template <typename T>void Dataset::appendImages(const std::string &var, const std::vector<Image<T> > &ims)
+{
+    // Shallow copies, the attribute strings and data are not copied
+    std::vector<ISMRMRD_Image> cims(ims.size());
+    for (size_t n = 0; n < ims.size(); n++) {
+        cims[n] = ims[n].im;
+    }
+    int status = ismrmrd_append_images(&dset_, var.c_str(), cims.data(), cims.size());
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
 
 void Dataset::appendWaveform(const Waveform &wav) {
     int status = ismrmrd_append_waveform(&dset_,&wav);
@@ -109,6 +311,38 @@ void Dataset::readWaveform(uint32_t index, Waveform &wav) {
 uint32_t Dataset::getNumberOfWaveforms() {
     return ismrmrd_get_number_of_waveforms(&dset_);
 }
+
+// Storage
+void Dataset::setStoragePolicy(const std::string &var, const ISMRMRD_StoragePolicy &policy)
+{
+    int status = ismrmrd_set_storage_policy(&dset_, var.c_str(), &policy);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void Dataset::flush()
+{
+    int status = ismrmrd_flush_dataset(&dset_);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+// SWMR
+void Dataset::startSwmrWrite(uint32_t flush_interval)
+{
+    int status = ismrmrd_start_swmr_write(&dset_, flush_interval);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+bool Dataset::waitForAcquisition(uint32_t index, uint32_t timeout_ms)
+{
+    return ismrmrd_wait_for_acquisition(&dset_, index, timeout_ms);
+}
+
 // Specific instantiations
 template EXPORTISMRMRD void Dataset::appendImage(const std::string &var, const Image<uint16_t> &im);
 template EXPORTISMRMRD void Dataset::appendImage(const std::string &var, const Image<int16_t> &im);
@@ -118,6 +352,14 @@ template EXPORTISMRMRD void Dataset::appendImage(const std::string &var, const I
 template EXPORTISMRMRD void Dataset::appendImage(const std::string &var, const Image<double> &im);
 template EXPORTISMRMRD void Dataset::appendImage(const std::string &var, const Image<complex_float_t> &im);
 template EXPORTISMRMRD void Dataset::appendImage(const std::string &var, const Image<complex_double_t> &im);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<uint16_t> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<int16_t> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<uint32_t> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<int32_t> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<float> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<double> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<complex_float_t> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<complex_double_t> > &ims);
 
 
 template <typename T> void Dataset::readImage(const std::string &var, uint32_t index, Image<T> &im) {
@@ -137,6 +379,73 @@ template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t
 template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t index, Image<complex_float_t> &im);
 template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t index, Image<complex_double_t> &im);
 
+template <typename T> void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count,
+                                               std::vector<Image<T> > &ims, uint32_t stride) {
+    ims.resize(count);
+    // Hand the existing buffers to the C API so that they are reused
+    std::vector<ISMRMRD_Image> cims(count);
+    for (uint32_t n = 0; n < count; n++) {
+        cims[n] = ims[n].im;
+    }
+    int status = ismrmrd_read_images(&dset_, var.c_str(), start, count, stride, cims.data());
+    // The buffers may have been reallocated, even on failure
+    for (uint32_t n = 0; n < count; n++) {
+        ims[n].im = cims[n];
+    }
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+// Specific instantiations
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<uint16_t> > &ims, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<int16_t> > &ims, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<uint32_t> > &ims, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<int32_t> > &ims, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<float> > &ims, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<double> > &ims, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<complex_float_t> > &ims, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<complex_double_t> > &ims, uint32_t stride);
+
+template <typename T> void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count,
+                                                   NDArray<T> &arr, uint32_t stride) {
+    int status = ismrmrd_read_image_array(&dset_, var.c_str(), start, count, stride, &arr.arr, NULL);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+template <typename T> void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count,
+                                                   NDArray<T> &arr, std::vector<ImageHeader> &heads, uint32_t stride) {
+    std::vector<ISMRMRD_ImageHeader> cheads(count);
+    int status = ismrmrd_read_image_array(&dset_, var.c_str(), start, count, stride, &arr.arr, cheads.data());
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    heads.resize(count);
+    for (uint32_t n = 0; n < count; n++) {
+        static_cast<ISMRMRD_ImageHeader &>(heads[n]) = cheads[n];
+    }
+}
+
+// Specific instantiations
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<uint16_t> &arr, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<int16_t> &arr, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<uint32_t> &arr, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<int32_t> &arr, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<float> &arr, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<double> &arr, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<complex_float_t> &arr, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<complex_double_t> &arr, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<uint16_t> &arr, std::vector<ImageHeader> &heads, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<int16_t> &arr, std::vector<ImageHeader> &heads, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<uint32_t> &arr, std::vector<ImageHeader> &heads, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<int32_t> &arr, std::vector<ImageHeader> &heads, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<float> &arr, std::vector<ImageHeader> &heads, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<double> &arr, std::vector<ImageHeader> &heads, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<complex_float_t> &arr, std::vector<ImageHeader> &heads, uint32_t stride);
+template EXPORTISMRMRD void Dataset::readImageArray(const std::string &var, uint32_t start, uint32_t count, NDArray<complex_double_t> &arr, std::vector<ImageHeader> &heads, uint32_t stride);
+
 uint32_t Dataset::getNumberOfImages(const std::string &var)
 {
     uint32_t num =  ismrmrd_get_number_of_images(&dset_, var.c_str());
@@ -188,10 +497,764 @@ template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_
 template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_t index, NDArray<complex_float_t> &arr);
 template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_t index, NDArray<complex_double_t> &arr);
 
+template <typename T> void Dataset::readNDArraySlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset,
+                                                    const std::vector<size_t> &count, NDArray<T> &arr) {
+    if (offset.size() != count.size()) {
+        throw std::runtime_error("Region offset and count must have the same number of dimensions");
+    }
+    int status = ismrmrd_read_array_slab(&dset_, var.c_str(), index, static_cast<uint16_t>(offset.size()),
+                                         offset.data(), count.data(), &arr.arr);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+// Specific instantiations
+template EXPORTISMRMRD void Dataset::readNDArraySlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<uint16_t> &arr);
+template EXPORTISMRMRD void Dataset::readNDArraySlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<int16_t> &arr);
+template EXPORTISMRMRD void Dataset::readNDArraySlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<uint32_t> &arr);
+template EXPORTISMRMRD void Dataset::readNDArraySlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<int32_t> &arr);
+template EXPORTISMRMRD void Dataset::readNDArraySlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<float> &arr);
+template EXPORTISMRMRD void Dataset::readNDArraySlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<double> &arr);
+template EXPORTISMRMRD void Dataset::readNDArraySlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void Dataset::readNDArraySlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<complex_double_t> &arr);
+
+template <typename T> void Dataset::readImageSlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset,
+                                                  const std::vector<size_t> &count, NDArray<T> &arr) {
+    if (offset.size() != 4 || count.size() != 4) {
+        throw std::runtime_error("Image regions must have (x, y, z, channel) offset and count");
+    }
+    int status = ismrmrd_read_image_slab(&dset_, var.c_str(), index, offset.data(), count.data(), &arr.arr);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+// Specific instantiations
+template EXPORTISMRMRD void Dataset::readImageSlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<uint16_t> &arr);
+template EXPORTISMRMRD void Dataset::readImageSlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<int16_t> &arr);
+template EXPORTISMRMRD void Dataset::readImageSlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<uint32_t> &arr);
+template EXPORTISMRMRD void Dataset::readImageSlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<int32_t> &arr);
+template EXPORTISMRMRD void Dataset::readImageSlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<float> &arr);
+template EXPORTISMRMRD void Dataset::readImageSlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<double> &arr);
+template EXPORTISMRMRD void Dataset::readImageSlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void Dataset::readImageSlab(const std::string &var, uint32_t index, const std::vector<size_t> &offset, const std::vector<size_t> &count, NDArray<complex_double_t> &arr);
+
 uint32_t Dataset::getNumberOfNDArrays(const std::string &var)
 {
     uint32_t num = ismrmrd_get_number_of_arrays(&dset_, var.c_str());
     return num;
 }
 
+//
+// AcquisitionStream class implementation
+//
+typedef std::chrono::steady_clock StreamClock;
+
+static double seconds_since(const StreamClock::time_point &start)
+{
+    return std::chrono::duration<double>(StreamClock::now() - start).count();
+}
+
+// log2 of the latency in microseconds, clamped to the histogram
+static int latency_bucket(StreamClock::duration latency)
+{
+    long long us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    int bucket = 0;
+    while (us > 1 && bucket < AsyncWriterStats::LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+AcquisitionStreamStats::AcquisitionStreamStats()
+    : acquisitions(0), batches(0), read_time(0), stall_time(0), wait_time(0), elapsed_time(0)
+{
+}
+
+double AcquisitionStreamStats::overlap() const
+{
+    // Whatever the consumer did not wait for was read while it was busy
+    if (read_time <= 0) {
+        return 0;
+    }
+    return std::max(0.0, read_time - wait_time) / read_time;
+}
+
+AcquisitionStream::AcquisitionStream(const char* filename, const char* groupname,
+                                     uint32_t batch_size, uint32_t num_batches)
+{
+    open(filename, groupname, 0, static_cast<uint32_t>(-1), batch_size, num_batches);
+}
+
+AcquisitionStream::AcquisitionStream(const char* filename, const char* groupname, uint32_t start,
+                                     uint32_t count, uint32_t batch_size, uint32_t num_batches)
+{
+    open(filename, groupname, start, count, batch_size, num_batches);
+}
+
+AcquisitionStream::~AcquisitionStream()
+{
+    stop();
+    delete dataset_;
+}
+
+void AcquisitionStream::open(const char* filename, const char* groupname, uint32_t start,
+                             uint32_t count, uint32_t batch_size, uint32_t num_batches)
+{
+    if (batch_size == 0 || num_batches == 0) {
+        throw std::runtime_error("AcquisitionStream needs at least one batch of one acquisition");
+    }
+    opened_ = StreamClock::now();
+    dataset_ = new Dataset(filename, groupname, false);
+    uint32_t nacq = dataset_->getNumberOfAcquisitions();
+    start_ = std::min(start, nacq);
+    count_ = std::min(count, nacq - start_);
+    batch_size_ = batch_size;
+
+    ring_.resize(num_batches, std::vector<Acquisition>(batch_size));
+    batch_sizes_.resize(num_batches, 0);
+    filled_ = 0;
+    consumer_batch_ = 0;
+    consumer_pos_ = 0;
+    holding_batch_ = false;
+    done_ = false;
+    stopping_ = false;
+
+    try {
+        reader_ = std::thread(&AcquisitionStream::run, this);
+    } catch (...) {
+        delete dataset_;
+        throw;
+    }
+}
+
+void AcquisitionStream::run()
+{
+    size_t batch = 0;
+    uint32_t pos = 0;
+    try {
+        while (pos < count_) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                StreamClock::time_point start = StreamClock::now();
+                while (!stopping_ && filled_ == ring_.size()) {
+                    not_full_.wait(lock);
+                }
+                stats_.stall_time += seconds_since(start);
+                if (stopping_) {
+                    break;
+                }
+            }
+
+            // The batch is neither filled nor held by the consumer, read it unlocked
+            uint32_t n = std::min(batch_size_, count_ - pos);
+            StreamClock::time_point start = StreamClock::now();
+            dataset_->readAcquisitions(start_ + pos, n, ring_[batch]);
+            double read_time = seconds_since(start);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                batch_sizes_[batch] = n;
+                filled_++;
+                stats_.batches++;
+                stats_.read_time += read_time;
+            }
+            not_empty_.notify_one();
+            batch = (batch + 1) % ring_.size();
+            pos += n;
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+    }
+    not_empty_.notify_all();
+}
+
+bool AcquisitionStream::next(Acquisition &acq)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stopping_) {
+        return false;
+    }
+
+    // Release the exhausted batch to the reader
+    if (holding_batch_ && consumer_pos_ == batch_sizes_[consumer_batch_]) {
+        holding_batch_ = false;
+        filled_--;
+        consumer_batch_ = (consumer_batch_ + 1) % ring_.size();
+        consumer_pos_ = 0;
+        not_full_.notify_one();
+    }
+
+    if (!holding_batch_) {
+        StreamClock::time_point start = StreamClock::now();
+        while (!done_ && filled_ == 0) {
+            not_empty_.wait(lock);
+        }
+        stats_.wait_time += seconds_since(start);
+        if (filled_ == 0) {
+            // The batches read before an error are still handed out
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            return false;
+        }
+        holding_batch_ = true;
+    }
+
+    // Swap rather than copy, the caller's buffers go back into the ring
+    acq.swap(ring_[consumer_batch_][consumer_pos_]);
+    consumer_pos_++;
+    stats_.acquisitions++;
+    return true;
+}
+
+void AcquisitionStream::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+}
+
+uint32_t AcquisitionStream::size() const
+{
+    return count_;
+}
+
+AcquisitionStreamStats AcquisitionStream::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    AcquisitionStreamStats stats = stats_;
+    stats.elapsed_time = seconds_since(opened_);
+    return stats;
+}
+
+//
+// AsyncWriter class implementation
+//
+AsyncWriterStats::AsyncWriterStats()
+    : acquisitions(0), waveforms(0), batches(0), max_queued(0), full_waits(0)
+{
+    std::fill(latency, latency + LATENCY_BUCKETS, 0);
+}
+
+double AsyncWriterStats::latencyPercentile(double q) const
+{
+    uint64_t total = 0;
+    for (int k = 0; k < LATENCY_BUCKETS; k++) {
+        total += latency[k];
+    }
+    uint64_t seen = 0;
+    for (int k = 0; k < LATENCY_BUCKETS; k++) {
+        seen += latency[k];
+        if (total > 0 && seen >= q * total) {
+            return static_cast<double>(uint64_t(1) << (k + 1));
+        }
+    }
+    return 0;
+}
+
+AsyncWriter::AsyncWriter(const char* filename, const char* groupname, size_t max_queued)
+    : dataset_(NULL), max_queued_(max_queued), queued_total_(0), written_total_(0),
+      closing_(false), closed_(false)
+{
+    if (max_queued == 0) {
+        throw std::runtime_error("AsyncWriter needs room for at least one item");
+    }
+    dataset_ = new Dataset(filename, groupname, true);
+    // Reserved so that queueing never copies the queued items
+    acqs_.reserve(max_queued);
+    acq_times_.reserve(max_queued);
+    wavs_.reserve(max_queued);
+    wav_times_.reserve(max_queued);
+    try {
+        writer_ = std::thread(&AsyncWriter::run, this);
+    } catch (...) {
+        delete dataset_;
+        throw;
+    }
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    try {
+        close();
+    } catch (...) {
+    }
+    delete dataset_;
+}
+
+void AsyncWriter::wait_for_space(std::unique_lock<std::mutex> &lock)
+{
+    if (closing_) {
+        throw std::runtime_error("AsyncWriter is closed");
+    }
+    if (acqs_.size() + wavs_.size() >= max_queued_ && !error_) {
+        stats_.full_waits++;
+        while (acqs_.size() + wavs_.size() >= max_queued_ && !error_) {
+            progress_.wait(lock);
+        }
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void AsyncWriter::append(Acquisition &&acq)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    wait_for_space(lock);
+    // Take over the buffers, the caller is left with an empty acquisition
+    acqs_.push_back(std::move(acq));
+    acq_times_.push_back(Clock::now());
+    queued_total_++;
+    stats_.max_queued = std::max<uint64_t>(stats_.max_queued, acqs_.size() + wavs_.size());
+    lock.unlock();
+    work_.notify_one();
+}
+
+void AsyncWriter::append(Waveform &&wav)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    wait_for_space(lock);
+    wavs_.push_back(std::move(wav));
+    wav_times_.push_back(Clock::now());
+    queued_total_++;
+    stats_.max_queued = std::max<uint64_t>(stats_.max_queued, acqs_.size() + wavs_.size());
+    lock.unlock();
+    work_.notify_one();
+}
+
+void AsyncWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = queued_total_;
+    while (written_total_ < target && !error_) {
+        progress_.wait(lock);
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void AsyncWriter::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    work_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Only the first close reports the error
+    bool first = !closed_;
+    closed_ = true;
+    if (error_ && first) {
+        std::rethrow_exception(error_);
+    }
+}
+
+AsyncWriterStats AsyncWriter::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void AsyncWriter::run()
+{
+    std::vector<Acquisition> acqs;
+    std::vector<Clock::time_point> acq_times;
+    std::vector<Waveform> wavs;
+    std::vector<Clock::time_point> wav_times;
+    acqs.reserve(max_queued_);
+    acq_times.reserve(max_queued_);
+    wavs.reserve(max_queued_);
+    wav_times.reserve(max_queued_);
+
+    try {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                while (!closing_ && acqs_.empty() && wavs_.empty()) {
+                    work_.wait(lock);
+                }
+                if (acqs_.empty() && wavs_.empty()) {
+                    break;
+                }
+                // Take the whole queue as the batch, the producers refill the empty vectors
+                acqs.swap(acqs_);
+                acq_times.swap(acq_times_);
+                wavs.swap(wavs_);
+                wav_times.swap(wav_times_);
+            }
+            progress_.notify_all();
+
+            if (!acqs.empty()) {
+                dataset_->appendAcquisitions(acqs);
+            }
+            for (size_t n = 0; n < wavs.size(); n++) {
+                dataset_->appendWaveform(wavs[n]);
+            }
+            dataset_->flush();
+
+            Clock::time_point durable = Clock::now();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (size_t n = 0; n < acq_times.size(); n++) {
+                    stats_.latency[latency_bucket(durable - acq_times[n])]++;
+                }
+                for (size_t n = 0; n < wav_times.size(); n++) {
+                    stats_.latency[latency_bucket(durable - wav_times[n])]++;
+                }
+                stats_.acquisitions += acqs.size();
+                stats_.waveforms += wavs.size();
+                stats_.batches++;
+                written_total_ += acqs.size() + wavs.size();
+            }
+            progress_.notify_all();
+            acqs.clear();
+            acq_times.clear();
+            wavs.clear();
+            wav_times.clear();
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::current_exception();
+    }
+    progress_.notify_all();
+}
+
+//
+// NDArrayView class implementation
+//
+NDArrayViewStats::NDArrayViewStats()
+    : hits(0), misses(0), evictions(0), bytes_read(0)
+{
+}
+
+template <typename T> NDArrayView<T>::NDArrayView(Dataset &dataset, const std::string &var, uint32_t index,
+                                                  size_t cache_bytes, size_t tile_bytes)
+    : dataset_(&dataset), var_(var), index_(index), last_key_(static_cast<size_t>(-1)), clock_(0)
+{
+    uint16_t data_type;
+    int status = ismrmrd_get_array_properties(&dataset.dset_, var.c_str(), &ndim_, dims_, &data_type);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    if (data_type != NDArray<T>().getDataType()) {
+        throw std::runtime_error("NDArrayView data type does not match the stored array");
+    }
+    if (index_ >= dataset.getNumberOfNDArrays(var)) {
+        throw std::runtime_error("NDArrayView index exceeds the number of stored arrays");
+    }
+
+    // Shrink the slowest dimensions until a tile fits in tile_bytes
+    if (tile_bytes == 0) {
+        tile_bytes = cache_bytes / 16;
+    }
+    tile_bytes = std::max(tile_bytes, sizeof(T));
+    tile_dims_.assign(dims_, dims_ + ndim_);
+    size_t size = sizeof(T);
+    for (uint16_t k = 0; k < ndim_; k++) {
+        size *= dims_[k];
+    }
+    for (int k = ndim_ - 1; k >= 0 && size > tile_bytes; k--) {
+        size_t inner = size / tile_dims_[k];
+        tile_dims_[k] = std::max<size_t>(1, tile_bytes / inner);
+        size = inner * tile_dims_[k];
+    }
+    for (uint16_t k = 0; k < ISMRMRD_NDARRAY_MAXDIM; k++) {
+        grid_[k] = k < ndim_ ? (dims_[k] + tile_dims_[k] - 1) / tile_dims_[k] : 1;
+    }
+    max_tiles_ = std::max<size_t>(1, cache_bytes / size);
+}
+
+template <typename T> uint16_t NDArrayView<T>::getNDim() const
+{
+    return ndim_;
+}
+
+template <typename T> const size_t (&NDArrayView<T>::getDims() const)[ISMRMRD_NDARRAY_MAXDIM]
+{
+    return dims_;
+}
+
+template <typename T> size_t NDArrayView<T>::getNumberOfElements() const
+{
+    size_t num = 1;
+    for (uint16_t k = 0; k < ndim_; k++) {
+        num *= dims_[k];
+    }
+    return num;
+}
+
+template <typename T> const std::vector<size_t> &NDArrayView<T>::getTileDims() const
+{
+    return tile_dims_;
+}
+
+template <typename T> T NDArrayView<T>::operator () (size_t x, size_t y, size_t z, size_t w, size_t n, size_t m, size_t l)
+{
+    const size_t indices[ISMRMRD_NDARRAY_MAXDIM] = {x, y, z, w, n, m, l};
+    size_t tile_index[ISMRMRD_NDARRAY_MAXDIM];
+    size_t key = 0;
+    for (int k = ndim_ - 1; k >= 0; k--) {
+        if (indices[k] >= dims_[k]) {
+            throw std::runtime_error("NDArrayView index out of range");
+        }
+        tile_index[k] = indices[k] / tile_dims_[k];
+        key = key * grid_[k] + tile_index[k];
+    }
+
+    size_t pos;
+    if (key == last_key_) {
+        pos = last_tile_;
+        stats_.hits++;
+    } else {
+        std::map<size_t, size_t>::const_iterator it = lookup_.find(key);
+        if (it != lookup_.end()) {
+            pos = it->second;
+            stats_.hits++;
+        } else {
+            pos = load(key, tile_index);
+            stats_.misses++;
+        }
+        last_key_ = key;
+        last_tile_ = pos;
+    }
+    Tile &tile = tiles_[pos];
+    tile.last_used = ++clock_;
+
+    // Column major offset within the tile, edge tiles may be smaller
+    const size_t (&tdims)[ISMRMRD_NDARRAY_MAXDIM] = tile.data.getDims();
+    size_t offset = 0, stride = 1;
+    for (uint16_t k = 0; k < ndim_; k++) {
+        offset += (indices[k] - tile_index[k] * tile_dims_[k]) * stride;
+        stride *= tdims[k];
+    }
+    return tile.data.getDataPtr()[offset];
+}
+
+template <typename T> size_t NDArrayView<T>::load(size_t key, const size_t (&tile_index)[ISMRMRD_NDARRAY_MAXDIM])
+{
+    size_t pos;
+    if (tiles_.size() < max_tiles_) {
+        // Constructed in place, empty NDArrays cannot be copied
+        pos = tiles_.size();
+        tiles_.resize(pos + 1);
+    } else {
+        // Reuse the least recently used tile and its buffer
+        pos = 0;
+        for (size_t t = 1; t < tiles_.size(); t++) {
+            if (tiles_[t].last_used < tiles_[pos].last_used) {
+                pos = t;
+            }
+        }
+        lookup_.erase(tiles_[pos].key);
+        stats_.evictions++;
+    }
+
+    std::vector<size_t> offset(ndim_), count(ndim_);
+    for (uint16_t k = 0; k < ndim_; k++) {
+        offset[k] = tile_index[k] * tile_dims_[k];
+        count[k] = std::min(tile_dims_[k], dims_[k] - offset[k]);
+    }
+    Tile &tile = tiles_[pos];
+    try {
+        dataset_->readNDArraySlab(var_, index_, offset, count, tile.data);
+    } catch (...) {
+        // The tile is in an unknown state, drop it
+        tiles_.erase(tiles_.begin() + pos);
+        lookup_.clear();
+        for (size_t t = 0; t < tiles_.size(); t++) {
+            lookup_[tiles_[t].key] = t;
+        }
+        last_key_ = static_cast<size_t>(-1);
+        throw;
+    }
+    tile.key = key;
+    lookup_[key] = pos;
+    stats_.bytes_read += tile.data.getDataSize();
+    return pos;
+}
+
+template <typename T> void NDArrayView<T>::clear()
+{
+    tiles_.clear();
+    lookup_.clear();
+    last_key_ = static_cast<size_t>(-1);
+}
+
+template <typename T> NDArrayViewStats NDArrayView<T>::stats() const
+{
+    return stats_;
+}
+
+template <typename T> NDArrayView<T> Dataset::getNDArrayView(const std::string &var, uint32_t index,
+                                                             size_t cache_bytes, size_t tile_bytes)
+{
+    return NDArrayView<T>(*this, var, index, cache_bytes, tile_bytes);
+}
+
+// Specific instantiations
+template EXPORTISMRMRD class NDArrayView<uint16_t>;
+template EXPORTISMRMRD class NDArrayView<int16_t>;
+template EXPORTISMRMRD class NDArrayView<uint32_t>;
+template EXPORTISMRMRD class NDArrayView<int32_t>;
+template EXPORTISMRMRD class NDArrayView<float>;
+template EXPORTISMRMRD class NDArrayView<double>;
+template EXPORTISMRMRD class NDArrayView<complex_float_t>;
+template EXPORTISMRMRD class NDArrayView<complex_double_t>;
+template EXPORTISMRMRD NDArrayView<uint16_t> Dataset::getNDArrayView(const std::string &var, uint32_t index, size_t cache_bytes, size_t tile_bytes);
+template EXPORTISMRMRD NDArrayView<int16_t> Dataset::getNDArrayView(const std::string &var, uint32_t index, size_t cache_bytes, size_t tile_bytes);
+template EXPORTISMRMRD NDArrayView<uint32_t> Dataset::getNDArrayView(const std::string &var, uint32_t index, size_t cache_bytes, size_t tile_bytes);
+template EXPORTISMRMRD NDArrayView<int32_t> Dataset::getNDArrayView(const std::string &var, uint32_t index, size_t cache_bytes, size_t tile_bytes);
+template EXPORTISMRMRD NDArrayView<float> Dataset::getNDArrayView(const std::string &var, uint32_t index, size_t cache_bytes, size_t tile_bytes);
+template EXPORTISMRMRD NDArrayView<double> Dataset::getNDArrayView(const std::string &var, uint32_t index, size_t cache_bytes, size_t tile_bytes);
+template EXPORTISMRMRD NDArrayView<complex_float_t> Dataset::getNDArrayView(const std::string &var, uint32_t index, size_t cache_bytes, size_t tile_bytes);
+template EXPORTISMRMRD NDArrayView<complex_double_t> Dataset::getNDArrayView(const std::string &var, uint32_t index, size_t cache_bytes, size_t tile_bytes);
+
+//
+// MappedNDArray class implementation
+//
+template <typename T> MappedNDArray<T>::MappedNDArray()
+{
+    map_.data_type = static_cast<uint16_t>(copy_.getDataType());
+    map_.ndim = 0;
+    std::fill(map_.dims, map_.dims + ISMRMRD_NDARRAY_MAXDIM, 0);
+    map_.data = NULL;
+    map_.map_base = NULL;
+    map_.map_length = 0;
+}
+
+template <typename T> MappedNDArray<T>::~MappedNDArray()
+{
+    release();
+}
+
+template <typename T> void MappedNDArray<T>::release()
+{
+    if (map_.map_base != NULL) {
+        ismrmrd_unmap_array(&map_);
+    }
+    map_.data = NULL;
+}
+
+template <typename T> bool MappedNDArray<T>::isMapped() const
+{
+    return map_.map_base != NULL;
+}
+
+template <typename T> uint16_t MappedNDArray<T>::getNDim() const
+{
+    return map_.ndim;
+}
+
+template <typename T> const size_t (&MappedNDArray<T>::getDims() const)[ISMRMRD_NDARRAY_MAXDIM]
+{
+    return map_.dims;
+}
+
+template <typename T> size_t MappedNDArray<T>::getNumberOfElements() const
+{
+    size_t num = 1;
+    for (uint16_t k = 0; k < map_.ndim; k++) {
+        num *= map_.dims[k];
+    }
+    return num;
+}
+
+template <typename T> const T * MappedNDArray<T>::getDataPtr() const
+{
+    return static_cast<const T *>(map_.data);
+}
+
+template <typename T> const T & MappedNDArray<T>::operator () (uint16_t x, uint16_t y, uint16_t z, uint16_t w, uint16_t n, uint16_t m, uint16_t l) const
+{
+    size_t index = 0;
+    uint16_t indices[ISMRMRD_NDARRAY_MAXDIM] = {x,y,z,w,n,m,l};
+    size_t stride = 1;
+    for (uint16_t i = 0; i < map_.ndim; i++) {
+        index += indices[i]*stride;
+        stride *= map_.dims[i];
+    }
+    return getDataPtr()[index];
+}
+
+template <typename T> void Dataset::mapNDArray(const std::string &var, uint32_t index, MappedNDArray<T> &arr)
+{
+    arr.release();
+    int status = ismrmrd_map_array(&dset_, var.c_str(), index, &arr.map_);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    if (arr.map_.data_type != arr.copy_.getDataType()) {
+        arr.release();
+        throw std::runtime_error("Mapped array data type does not match the stored array");
+    }
+    if (arr.map_.data == NULL) {
+        readNDArray(var, index, arr.copy_);
+        arr.map_.data = arr.copy_.getDataPtr();
+    }
+}
+
+template <typename T> void Dataset::mapImageData(const std::string &var, uint32_t index, MappedNDArray<T> &arr)
+{
+    arr.release();
+    int status = ismrmrd_map_image_data(&dset_, var.c_str(), index, &arr.map_);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    if (arr.map_.data_type != arr.copy_.getDataType()) {
+        arr.release();
+        throw std::runtime_error("Mapped image data type does not match the stored image");
+    }
+    if (arr.map_.data == NULL) {
+        std::vector<size_t> offset(4, 0), count(arr.map_.dims, arr.map_.dims + 4);
+        readImageSlab(var, index, offset, count, arr.copy_);
+        arr.map_.data = arr.copy_.getDataPtr();
+    }
+}
+
+// Specific instantiations
+template EXPORTISMRMRD class MappedNDArray<uint16_t>;
+template EXPORTISMRMRD class MappedNDArray<int16_t>;
+template EXPORTISMRMRD class MappedNDArray<uint32_t>;
+template EXPORTISMRMRD class MappedNDArray<int32_t>;
+template EXPORTISMRMRD class MappedNDArray<float>;
+template EXPORTISMRMRD class MappedNDArray<double>;
+template EXPORTISMRMRD class MappedNDArray<complex_float_t>;
+template EXPORTISMRMRD class MappedNDArray<complex_double_t>;
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, uint32_t index, MappedNDArray<uint16_t> &arr);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, uint32_t index, MappedNDArray<int16_t> &arr);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, uint32_t index, MappedNDArray<uint32_t> &arr);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, uint32_t index, MappedNDArray<int32_t> &arr);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, uint32_t index, MappedNDArray<float> &arr);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, uint32_t index, MappedNDArray<double> &arr);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, uint32_t index, MappedNDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, uint32_t index, MappedNDArray<complex_double_t> &arr);
+template EXPORTISMRMRD void Dataset::mapImageData(const std::string &var, uint32_t index, MappedNDArray<uint16_t> &arr);
+template EXPORTISMRMRD void Dataset::mapImageData(const std::string &var, uint32_t index, MappedNDArray<int16_t> &arr);
+template EXPORTISMRMRD void Dataset::mapImageData(const std::string &var, uint32_t index, MappedNDArray<uint32_t> &arr);
+template EXPORTISMRMRD void Dataset::mapImageData(const std::string &var, uint32_t index, MappedNDArray<int32_t> &arr);
+template EXPORTISMRMRD void Dataset::mapImageData(const std::string &var, uint32_t index, MappedNDArray<float> &arr);
+template EXPORTISMRMRD void Dataset::mapImageData(const std::string &var, uint32_t index, MappedNDArray<double> &arr);
+template EXPORTISMRMRD void Dataset::mapImageData(const std::string &var, uint32_t index, MappedNDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void Dataset::mapImageData(const std::string &var, uint32_t index, MappedNDArray<complex_double_t> &arr);
+
 } // namespace ISMRMRD
@@ -0,0 +1,969 @@
+#include "ismrmrd/dataset.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ISMRMRD {
+
+#ifndef _WIN32
+
+//
+// Append-only log dataset backend
+//
+// File layout, in the byte order of the writer:
+//   LogFileHeader
+//   records: LogRecordHeader, group name, variable name, payload
+//   index (optional): a LogRecordHeader of kind LOG_INDEX, per record a
+//                     LogRecordHeader, its payload offset and the names,
+//                     followed by a LogTrailer
+//
+// Payloads:
+//   header       the xml string
+//   acquisition  ISMRMRD_AcquisitionHeader, traj, data
+//   waveform     ISMRMRD_WaveformHeader, data
+//   image        ISMRMRD_ImageHeader, attribute string, data
+//   array        LogArrayHeader, data
+//
+namespace {
+
+const char LOG_MAGIC[8] = {'I', 'S', 'M', 'R', 'M', 'R', 'D', 'L'};
+const char INDEX_MAGIC[8] = {'I', 'S', 'M', 'R', 'D', 'I', 'D', 'X'};
+const uint32_t LOG_VERSION = 1;
+const uint32_t LOG_BYTE_ORDER = 0x01020304;
+
+// Records are collected up to this size before they are written
+const size_t LOG_BUFFER_BYTES = 8 << 20;
+
+enum LogRecordKind {
+    LOG_HEADER = 1,
+    LOG_ACQUISITION,
+    LOG_WAVEFORM,
+    LOG_IMAGE,
+    LOG_ARRAY,
+    LOG_INDEX = 0x100   /* starts the index, which a scan stops at */
+};
+
+struct LogFileHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+};
+
+struct LogRecordHeader {
+    uint32_t kind;
+    uint16_t group_len;
+    uint16_t var_len;
+    uint64_t length;    /* of the payload */
+};
+
+struct LogArrayHeader {
+    uint16_t version;
+    uint16_t data_type;
+    uint16_t ndim;
+    uint16_t reserved;
+    uint64_t dims[ISMRMRD_NDARRAY_MAXDIM];
+};
+
+struct LogTrailer {
+    uint64_t index_offset;
+    uint64_t count;
+    char magic[8];
+};
+
+// Location of a payload in the file
+struct LogItem {
+    LogItem(uint64_t off = 0, uint64_t len = 0) : offset(off), length(len) {}
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct LogGroup {
+    LogGroup() : has_header(false) {}
+    bool has_header;
+    LogItem header;
+    std::vector<LogItem> acquisitions;
+    std::vector<LogItem> waveforms;
+    std::map<std::string, std::vector<LogItem> > images;
+    std::map<std::string, std::vector<LogItem> > arrays;
+};
+
+// Shared by every open dataset of the file
+struct LogFile {
+    LogFile() : fd(-1), writable(false), flushed(0), has_index(false), index_dirty(false),
+                map_base(NULL), map_length(0), open_count(0) {}
+    int fd;
+    bool writable;
+    uint64_t flushed;           /* end of the records on disk */
+    std::vector<char> buffer;   /* records after flushed */
+    bool has_index;             /* the index follows the records on disk */
+    bool index_dirty;
+    void *map_base;
+    size_t map_length;
+    std::map<std::string, LogGroup> groups;
+    unsigned int open_count;
+};
+
+struct LogDataset {
+    LogFile *file;
+    LogGroup *group;
+    std::string filename;
+    std::string groupname;
+};
+
+std::map<std::string, LogFile *> log_files;
+std::mutex log_mutex;
+
+LogDataset *get_dataset(const ISMRMRD_Dataset *dset) {
+    return static_cast<LogDataset *>(dset->backend_data);
+}
+
+uint64_t end_of_records(const LogFile *file) {
+    return file->flushed + file->buffer.size();
+}
+
+int write_all(int fd, const void *data, size_t length, uint64_t offset) {
+    const char *p = static_cast<const char *>(data);
+    while (length > 0) {
+        ssize_t written = pwrite(fd, p, length, (off_t) offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to write to the log.");
+        }
+        p += written;
+        offset += (uint64_t) written;
+        length -= (size_t) written;
+    }
+    return ISMRMRD_NOERROR;
+}
+
+int flush_buffer(LogFile *file) {
+    if (file->buffer.empty()) {
+        return ISMRMRD_NOERROR;
+    }
+    if (write_all(file->fd, &file->buffer[0], file->buffer.size(), file->flushed) != ISMRMRD_NOERROR) {
+        return ISMRMRD_FILEERROR;
+    }
+    file->flushed += file->buffer.size();
+    file->buffer.clear();
+    return ISMRMRD_NOERROR;
+}
+
+void unmap_file(LogFile *file) {
+    if (file->map_base != NULL) {
+        munmap(file->map_base, file->map_length);
+        file->map_base = NULL;
+        file->map_length = 0;
+    }
+}
+
+// Copies length bytes at offset, mapping the records written so far
+int read_bytes(LogFile *file, uint64_t offset, void *dest, size_t length) {
+    if (length == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (offset + length > file->flushed && flush_buffer(file) != ISMRMRD_NOERROR) {
+        return ISMRMRD_FILEERROR;
+    }
+    if (offset + length > file->flushed) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Record is beyond the end of the log.");
+    }
+    if (offset + length > file->map_length) {
+        unmap_file(file);
+        void *base = mmap(NULL, (size_t) file->flushed, PROT_READ, MAP_SHARED, file->fd, 0);
+        if (base == MAP_FAILED) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to map the log.");
+        }
+        file->map_base = base;
+        file->map_length = (size_t) file->flushed;
+    }
+    memcpy(dest, static_cast<const char *>(file->map_base) + offset, length);
+    return ISMRMRD_NOERROR;
+}
+
+// A piece of a payload
+struct LogPart {
+    LogPart(const void *d, size_t len) : data(d), length(len) {}
+    const void *data;
+    size_t length;
+};
+
+int append_record(LogDataset *ld, uint32_t kind, const std::string &var,
+                  const LogPart *parts, size_t nparts, LogItem *item) {
+    LogFile *file = ld->file;
+    if (!file->writable) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Log is open read-only.");
+    }
+    if (ld->groupname.size() > 0xFFFF || var.size() > 0xFFFF) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Name is too long.");
+    }
+    /* The index is rewritten on close, a crash before that leaves a log that is scanned */
+    if (file->has_index) {
+        if (ftruncate(file->fd, (off_t) file->flushed) != 0) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to truncate the log index.");
+        }
+        file->has_index = false;
+    }
+    file->index_dirty = true;
+
+    LogRecordHeader head;
+    head.kind = kind;
+    head.group_len = (uint16_t) ld->groupname.size();
+    head.var_len = (uint16_t) var.size();
+    head.length = 0;
+    for (size_t i = 0; i < nparts; i++) {
+        head.length += parts[i].length;
+    }
+    const char *p = reinterpret_cast<const char *>(&head);
+    file->buffer.insert(file->buffer.end(), p, p + sizeof(head));
+    file->buffer.insert(file->buffer.end(), ld->groupname.begin(), ld->groupname.end());
+    file->buffer.insert(file->buffer.end(), var.begin(), var.end());
+    *item = LogItem(end_of_records(file), head.length);
+
+    /* Large parts bypass the buffer */
+    for (size_t i = 0; i < nparts; i++) {
+        if (file->buffer.size() + parts[i].length <= LOG_BUFFER_BYTES) {
+            p = static_cast<const char *>(parts[i].data);
+            file->buffer.insert(file->buffer.end(), p, p + parts[i].length);
+            continue;
+        }
+        if (flush_buffer(file) != ISMRMRD_NOERROR) {
+            return ISMRMRD_FILEERROR;
+        }
+        if (write_all(file->fd, parts[i].data, parts[i].length, file->flushed) != ISMRMRD_NOERROR) {
+            return ISMRMRD_FILEERROR;
+        }
+        file->flushed += parts[i].length;
+    }
+    if (file->buffer.size() >= LOG_BUFFER_BYTES) {
+        return flush_buffer(file);
+    }
+    return ISMRMRD_NOERROR;
+}
+
+void add_item(LogFile *file, const LogRecordHeader &head, const std::string &group,
+              const std::string &var, const LogItem &item) {
+    LogGroup &g = file->groups[group];
+    switch (head.kind) {
+    case LOG_HEADER:
+        g.has_header = true;
+        g.header = item;
+        break;
+    case LOG_ACQUISITION:
+        g.acquisitions.push_back(item);
+        break;
+    case LOG_WAVEFORM:
+        g.waveforms.push_back(item);
+        break;
+    case LOG_IMAGE:
+        g.images[var].push_back(item);
+        break;
+    case LOG_ARRAY:
+        g.arrays[var].push_back(item);
+        break;
+    default:
+        break;
+    }
+}
+
+// Loads the index at the end of a log of size bytes, false if there is none
+bool load_index(LogFile *file, uint64_t size) {
+    LogTrailer trailer;
+    if (size < sizeof(LogFileHeader) + sizeof(LogTrailer) ||
+            pread(file->fd, &trailer, sizeof(trailer), (off_t) (size - sizeof(trailer))) != (ssize_t) sizeof(trailer) ||
+            memcmp(trailer.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+            trailer.index_offset < sizeof(LogFileHeader) || trailer.index_offset > size - sizeof(trailer)) {
+        return false;
+    }
+    std::vector<char> index((size_t) (size - sizeof(trailer) - trailer.index_offset));
+    if (!index.empty() && pread(file->fd, &index[0], index.size(), (off_t) trailer.index_offset) != (ssize_t) index.size()) {
+        return false;
+    }
+    LogRecordHeader marker;
+    if (index.size() < sizeof(marker)) {
+        return false;
+    }
+    memcpy(&marker, &index[0], sizeof(marker));
+    if (marker.kind != LOG_INDEX) {
+        return false;
+    }
+    size_t pos = sizeof(marker);
+    for (uint64_t n = 0; n < trailer.count; n++) {
+        LogRecordHeader head;
+        uint64_t offset;
+        if (pos + sizeof(head) + sizeof(offset) > index.size()) {
+            file->groups.clear();
+            return false;
+        }
+        memcpy(&head, &index[pos], sizeof(head));
+        memcpy(&offset, &index[pos + sizeof(head)], sizeof(offset));
+        pos += sizeof(head) + sizeof(offset);
+        if (pos + head.group_len + head.var_len > index.size() ||
+                offset + head.length > trailer.index_offset) {
+            file->groups.clear();
+            return false;
+        }
+        std::string group(&index[pos], head.group_len);
+        std::string var(&index[pos + head.group_len], head.var_len);
+        pos += head.group_len + head.var_len;
+        add_item(file, head, group, var, LogItem(offset, head.length));
+    }
+    file->flushed = trailer.index_offset;
+    file->has_index = true;
+    return true;
+}
+
+// Rebuilds the index from the records, up to the last complete one
+int scan_records(LogFile *file, uint64_t size) {
+    uint64_t offset = sizeof(LogFileHeader);
+    std::vector<char> names;
+    for (;;) {
+        LogRecordHeader head;
+        if (offset + sizeof(head) > size ||
+                pread(file->fd, &head, sizeof(head), (off_t) offset) != (ssize_t) sizeof(head)) {
+            break;
+        }
+        uint64_t payload = offset + sizeof(head) + head.group_len + head.var_len;
+        if (head.kind < LOG_HEADER || head.kind > LOG_ARRAY || payload + head.length > size) {
+            break;
+        }
+        names.resize(head.group_len + head.var_len);
+        if (!names.empty() && pread(file->fd, &names[0], names.size(), (off_t) (offset + sizeof(head))) != (ssize_t) names.size()) {
+            break;
+        }
+        std::string group(names.begin(), names.begin() + head.group_len);
+        std::string var(names.begin() + head.group_len, names.end());
+        add_item(file, head, group, var, LogItem(payload, head.length));
+        offset = payload + head.length;
+    }
+    file->flushed = offset;
+    /* Anything after the last complete record is dropped by the next writer */
+    file->has_index = offset < size;
+    file->index_dirty = true;
+    return ISMRMRD_NOERROR;
+}
+
+void append_index_entry(std::vector<char> &index, uint32_t kind, const std::string &group,
+                        const std::string &var, const LogItem &item) {
+    LogRecordHeader head;
+    head.kind = kind;
+    head.group_len = (uint16_t) group.size();
+    head.var_len = (uint16_t) var.size();
+    head.length = item.length;
+    const char *p = reinterpret_cast<const char *>(&head);
+    index.insert(index.end(), p, p + sizeof(head));
+    p = reinterpret_cast<const char *>(&item.offset);
+    index.insert(index.end(), p, p + sizeof(item.offset));
+    index.insert(index.end(), group.begin(), group.end());
+    index.insert(index.end(), var.begin(), var.end());
+}
+
+int write_index(LogFile *file) {
+    if (flush_buffer(file) != ISMRMRD_NOERROR) {
+        return ISMRMRD_FILEERROR;
+    }
+    std::vector<char> index(sizeof(LogRecordHeader));
+    uint64_t count = 0;
+    const std::string none;
+    std::map<std::string, LogGroup>::const_iterator g;
+    std::map<std::string, std::vector<LogItem> >::const_iterator v;
+    for (g = file->groups.begin(); g != file->groups.end(); ++g) {
+        if (g->second.has_header) {
+            append_index_entry(index, LOG_HEADER, g->first, none, g->second.header);
+            count++;
+        }
+        for (size_t i = 0; i < g->second.acquisitions.size(); i++, count++) {
+            append_index_entry(index, LOG_ACQUISITION, g->first, none, g->second.acquisitions[i]);
+        }
+        for (size_t i = 0; i < g->second.waveforms.size(); i++, count++) {
+            append_index_entry(index, LOG_WAVEFORM, g->first, none, g->second.waveforms[i]);
+        }
+        for (v = g->second.images.begin(); v != g->second.images.end(); ++v) {
+            for (size_t i = 0; i < v->second.size(); i++, count++) {
+                append_index_entry(index, LOG_IMAGE, g->first, v->first, v->second[i]);
+            }
+        }
+        for (v = g->second.arrays.begin(); v != g->second.arrays.end(); ++v) {
+            for (size_t i = 0; i < v->second.size(); i++, count++) {
+                append_index_entry(index, LOG_ARRAY, g->first, v->first, v->second[i]);
+            }
+        }
+    }
+    LogRecordHeader marker;
+    marker.kind = LOG_INDEX;
+    marker.group_len = 0;
+    marker.var_len = 0;
+    marker.length = index.size() - sizeof(marker);
+    memcpy(&index[0], &marker, sizeof(marker));
+
+    LogTrailer trailer;
+    trailer.index_offset = file->flushed;
+    trailer.count = count;
+    memcpy(trailer.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    const char *p = reinterpret_cast<const char *>(&trailer);
+    index.insert(index.end(), p, p + sizeof(trailer));
+
+    if (write_all(file->fd, &index[0], index.size(), file->flushed) != ISMRMRD_NOERROR ||
+            ftruncate(file->fd, (off_t) (file->flushed + index.size())) != 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to write the log index.");
+    }
+    file->has_index = true;
+    file->index_dirty = false;
+    return ISMRMRD_NOERROR;
+}
+
+void close_file(LogFile *file) {
+    unmap_file(file);
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+    delete file;
+}
+
+int open_file(const std::string &filename, const bool create_if_needed, LogFile **result) {
+    LogFile *file = new LogFile();
+    file->fd = open(filename.c_str(), O_RDWR);
+    file->writable = true;
+    if (file->fd < 0 && (errno == EACCES || errno == EROFS)) {
+        file->fd = open(filename.c_str(), O_RDONLY);
+        file->writable = false;
+    }
+    if (file->fd < 0 && errno == ENOENT && create_if_needed) {
+        file->fd = open(filename.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+        file->writable = true;
+    }
+    if (file->fd < 0) {
+        close_file(file);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+    }
+
+    struct stat st;
+    if (fstat(file->fd, &st) != 0) {
+        close_file(file);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+    }
+    uint64_t size = (uint64_t) st.st_size;
+    LogFileHeader head;
+    if (size == 0 && file->writable) {
+        memcpy(head.magic, LOG_MAGIC, sizeof(LOG_MAGIC));
+        head.byte_order = LOG_BYTE_ORDER;
+        head.version = LOG_VERSION;
+        if (write_all(file->fd, &head, sizeof(head), 0) != ISMRMRD_NOERROR) {
+            close_file(file);
+            return ISMRMRD_FILEERROR;
+        }
+        file->flushed = sizeof(head);
+    } else {
+        if (pread(file->fd, &head, sizeof(head), 0) != (ssize_t) sizeof(head) ||
+                memcmp(head.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) {
+            close_file(file);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "File is not an ISMRMRD log.");
+        }
+        if (head.byte_order != LOG_BYTE_ORDER || head.version != LOG_VERSION) {
+            close_file(file);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Unsupported log version or byte order.");
+        }
+        if (!load_index(file, size)) {
+            scan_records(file, size);
+        }
+    }
+    *result = file;
+    return ISMRMRD_NOERROR;
+}
+
+bool same_image_layout(const ISMRMRD_ImageHeader &a, const ISMRMRD_ImageHeader &b) {
+    return a.data_type == b.data_type && a.channels == b.channels &&
+           memcmp(a.matrix_size, b.matrix_size, sizeof(a.matrix_size)) == 0;
+}
+
+void set_array_header(LogArrayHeader *head, const ISMRMRD_NDArray *arr) {
+    memset(head, 0, sizeof(*head));
+    head->version = arr->version;
+    head->data_type = arr->data_type;
+    head->ndim = arr->ndim;
+    for (uint16_t n = 0; n < arr->ndim && n < ISMRMRD_NDARRAY_MAXDIM; n++) {
+        head->dims[n] = arr->dims[n];
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+static int log_open(ISMRMRD_Dataset *dset, const bool create_if_needed) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    std::string filename(dset->filename);
+    std::map<std::string, LogFile *>::iterator it = log_files.find(filename);
+    LogFile *file = NULL;
+    if (it != log_files.end()) {
+        file = it->second;
+    } else {
+        if (open_file(filename, create_if_needed, &file) != ISMRMRD_NOERROR) {
+            return ISMRMRD_FILEERROR;
+        }
+        log_files[filename] = file;
+    }
+    file->open_count++;
+
+    LogDataset *ld = new LogDataset();
+    ld->file = file;
+    ld->group = &file->groups[dset->groupname];
+    ld->filename = filename;
+    ld->groupname = dset->groupname;
+    dset->backend_data = ld;
+    return ISMRMRD_NOERROR;
+}
+
+static int log_close(ISMRMRD_Dataset *dset) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL) {
+        return ISMRMRD_NOERROR;
+    }
+    int status = ISMRMRD_NOERROR;
+    LogFile *file = ld->file;
+    if (--file->open_count == 0) {
+        if (file->writable && file->index_dirty) {
+            status = write_index(file);
+        }
+        log_files.erase(ld->filename);
+        close_file(file);
+    }
+    delete ld;
+    dset->backend_data = NULL;
+    return status;
+}
+
+static int log_flush(ISMRMRD_Dataset *dset) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    return flush_buffer(ld->file);
+}
+
+static int log_write_header(const ISMRMRD_Dataset *dset, const char *xmlstring) {
+    if (xmlstring==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "xmlstring should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    LogPart part(xmlstring, strlen(xmlstring));
+    LogItem item;
+    if (append_record(ld, LOG_HEADER, std::string(), &part, 1, &item) != ISMRMRD_NOERROR) {
+        return ISMRMRD_FILEERROR;
+    }
+    ld->group->has_header = true;
+    ld->group->header = item;
+    return ISMRMRD_NOERROR;
+}
+
+static char *log_read_header(const ISMRMRD_Dataset *dset) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL || !ld->group->has_header) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Data set does not contain a header.");
+        return NULL;
+    }
+    const LogItem &item = ld->group->header;
+    char *xmlstring = (char *) malloc((size_t) item.length + 1);
+    if (xmlstring == NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc header string.");
+        return NULL;
+    }
+    if (read_bytes(ld->file, item.offset, xmlstring, (size_t) item.length) != ISMRMRD_NOERROR) {
+        free(xmlstring);
+        return NULL;
+    }
+    xmlstring[item.length] = '\0';
+    return xmlstring;
+}
+
+static int log_append_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, size_t n) {
+    if (n == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (acqs==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    for (size_t i = 0; i < n; i++) {
+        LogPart parts[3] = {
+            LogPart(&acqs[i].head, sizeof(ISMRMRD_AcquisitionHeader)),
+            LogPart(acqs[i].traj, ismrmrd_size_of_acquisition_traj(&acqs[i])),
+            LogPart(acqs[i].data, ismrmrd_size_of_acquisition_data(&acqs[i]))
+        };
+        LogItem item;
+        if (append_record(ld, LOG_ACQUISITION, std::string(), parts, 3, &item) != ISMRMRD_NOERROR) {
+            return ISMRMRD_FILEERROR;
+        }
+        ld->group->acquisitions.push_back(item);
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static int log_read_acquisitions(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                                 ISMRMRD_Acquisition *acqs) {
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (acqs==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL || (size_t) start + count > ld->group->acquisitions.size()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const LogItem &item = ld->group->acquisitions[start + i];
+        ISMRMRD_Acquisition *acq = &acqs[i];
+        if (item.length < sizeof(ISMRMRD_AcquisitionHeader) ||
+                read_bytes(ld->file, item.offset, &acq->head, sizeof(ISMRMRD_AcquisitionHeader)) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read acquisition.");
+        }
+        if (ismrmrd_make_consistent_acquisition(acq) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to make acquisition consistent.");
+        }
+        size_t traj_size = ismrmrd_size_of_acquisition_traj(acq);
+        size_t data_size = ismrmrd_size_of_acquisition_data(acq);
+        uint64_t offset = item.offset + sizeof(ISMRMRD_AcquisitionHeader);
+        if (item.length != sizeof(ISMRMRD_AcquisitionHeader) + traj_size + data_size ||
+                read_bytes(ld->file, offset, acq->traj, traj_size) != ISMRMRD_NOERROR ||
+                read_bytes(ld->file, offset + traj_size, acq->data, data_size) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read acquisition.");
+        }
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static uint32_t log_get_number_of_acquisitions(const ISMRMRD_Dataset *dset) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    return ld == NULL ? 0 : (uint32_t) ld->group->acquisitions.size();
+}
+
+static int log_append_waveform(const ISMRMRD_Dataset *dset, const ISMRMRD_Waveform *wav) {
+    if (wav==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Waveform pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    LogPart parts[2] = {
+        LogPart(&wav->head, sizeof(ISMRMRD_WaveformHeader)),
+        LogPart(wav->data, (size_t) ismrmrd_size_of_waveform_data(wav))
+    };
+    LogItem item;
+    if (append_record(ld, LOG_WAVEFORM, std::string(), parts, 2, &item) != ISMRMRD_NOERROR) {
+        return ISMRMRD_FILEERROR;
+    }
+    ld->group->waveforms.push_back(item);
+    return ISMRMRD_NOERROR;
+}
+
+static int log_read_waveform(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Waveform *wav) {
+    if (wav==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Waveform pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL || index >= ld->group->waveforms.size()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+    const LogItem &item = ld->group->waveforms[index];
+    if (item.length < sizeof(ISMRMRD_WaveformHeader) ||
+            read_bytes(ld->file, item.offset, &wav->head, sizeof(ISMRMRD_WaveformHeader)) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read waveform.");
+    }
+    if (ismrmrd_make_consistent_waveform(wav) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to make waveform consistent.");
+    }
+    size_t data_size = (size_t) ismrmrd_size_of_waveform_data(wav);
+    if (item.length != sizeof(ISMRMRD_WaveformHeader) + data_size ||
+            read_bytes(ld->file, item.offset + sizeof(ISMRMRD_WaveformHeader), wav->data, data_size) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read waveform.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static uint32_t log_get_number_of_waveforms(const ISMRMRD_Dataset *dset) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    return ld == NULL ? 0 : (uint32_t) ld->group->waveforms.size();
+}
+
+static int log_append_images(const ISMRMRD_Dataset *dset, const char *varname,
+                             const ISMRMRD_Image *ims, size_t n) {
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (n == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (ims==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Image pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    std::string var(varname);
+    if (ld->group->arrays.find(var) != ld->group->arrays.end()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Variable already holds arrays.");
+    }
+
+    /* Every image of a variable has the layout of the first one */
+    ISMRMRD_ImageHeader layout = ims[0].head;
+    std::map<std::string, std::vector<LogItem> >::iterator it = ld->group->images.find(var);
+    if (it != ld->group->images.end() && !it->second.empty() &&
+            read_bytes(ld->file, it->second[0].offset, &layout, sizeof(layout)) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image header.");
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!same_image_layout(layout, ims[i].head)) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Image dimensions or type do not match the variable.");
+        }
+    }
+
+    std::vector<LogItem> &items = ld->group->images[var];
+    for (size_t i = 0; i < n; i++) {
+        LogPart parts[3] = {
+            LogPart(&ims[i].head, sizeof(ISMRMRD_ImageHeader)),
+            LogPart(ims[i].attribute_string, ismrmrd_size_of_image_attribute_string(&ims[i])),
+            LogPart(ims[i].data, ismrmrd_size_of_image_data(&ims[i]))
+        };
+        LogItem item;
+        if (append_record(ld, LOG_IMAGE, var, parts, 3, &item) != ISMRMRD_NOERROR) {
+            return ISMRMRD_FILEERROR;
+        }
+        items.push_back(item);
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static int log_read_images(const ISMRMRD_Dataset *dset, const char *varname, const uint32_t start,
+                           const uint32_t count, const uint32_t stride, ISMRMRD_Image *ims) {
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (ims==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Image pointer should not be NULL.");
+    }
+    if (stride == 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Stride should not be zero.");
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    std::map<std::string, std::vector<LogItem> >::iterator var;
+    if (ld == NULL || (var = ld->group->images.find(varname)) == ld->group->images.end() ||
+            (size_t) start + (size_t) (count - 1) * stride >= var->second.size()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const LogItem &item = var->second[start + (size_t) i * stride];
+        ISMRMRD_Image *im = &ims[i];
+        if (item.length < sizeof(ISMRMRD_ImageHeader) ||
+                read_bytes(ld->file, item.offset, &im->head, sizeof(ISMRMRD_ImageHeader)) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image.");
+        }
+        if (ismrmrd_make_consistent_image(im) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to make image consistent.");
+        }
+        size_t attr_size = ismrmrd_size_of_image_attribute_string(im);
+        size_t data_size = ismrmrd_size_of_image_data(im);
+        uint64_t offset = item.offset + sizeof(ISMRMRD_ImageHeader);
+        if (item.length != sizeof(ISMRMRD_ImageHeader) + attr_size + data_size ||
+                read_bytes(ld->file, offset, im->attribute_string, attr_size) != ISMRMRD_NOERROR ||
+                read_bytes(ld->file, offset + attr_size, im->data, data_size) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image.");
+        }
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static uint32_t log_get_number_of_images(const ISMRMRD_Dataset *dset, const char *varname) {
+    if (varname==NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL) {
+        return 0;
+    }
+    std::map<std::string, std::vector<LogItem> >::const_iterator var = ld->group->images.find(varname);
+    return var == ld->group->images.end() ? 0 : (uint32_t) var->second.size();
+}
+
+static int log_append_array(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_NDArray *arr) {
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (arr==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Array pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    std::string var(varname);
+    if (ld->group->images.find(var) != ld->group->images.end()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Variable already holds images.");
+    }
+
+    LogArrayHeader head, first;
+    set_array_header(&head, arr);
+    std::map<std::string, std::vector<LogItem> >::iterator it = ld->group->arrays.find(var);
+    if (it != ld->group->arrays.end() && !it->second.empty()) {
+        if (read_bytes(ld->file, it->second[0].offset, &first, sizeof(first)) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read array header.");
+        }
+        if (first.data_type != head.data_type || first.ndim != head.ndim ||
+                memcmp(first.dims, head.dims, sizeof(head.dims)) != 0) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Array dimensions or type do not match the variable.");
+        }
+    }
+
+    LogPart parts[2] = {
+        LogPart(&head, sizeof(head)),
+        LogPart(arr->data, ismrmrd_size_of_ndarray_data(arr))
+    };
+    LogItem item;
+    if (append_record(ld, LOG_ARRAY, var, parts, 2, &item) != ISMRMRD_NOERROR) {
+        return ISMRMRD_FILEERROR;
+    }
+    ld->group->arrays[var].push_back(item);
+    return ISMRMRD_NOERROR;
+}
+
+static int log_read_array(const ISMRMRD_Dataset *dset, const char *varname, const uint32_t index,
+                          ISMRMRD_NDArray *arr) {
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (arr==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Array pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    std::map<std::string, std::vector<LogItem> >::iterator var;
+    if (ld == NULL || (var = ld->group->arrays.find(varname)) == ld->group->arrays.end() ||
+            index >= var->second.size()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+    const LogItem &item = var->second[index];
+    LogArrayHeader head;
+    if (item.length < sizeof(head) ||
+            read_bytes(ld->file, item.offset, &head, sizeof(head)) != ISMRMRD_NOERROR ||
+            head.ndim > ISMRMRD_NDARRAY_MAXDIM) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read array.");
+    }
+    arr->version = head.version;
+    arr->data_type = head.data_type;
+    arr->ndim = head.ndim;
+    for (uint16_t n = 0; n < ISMRMRD_NDARRAY_MAXDIM; n++) {
+        arr->dims[n] = n < head.ndim ? (size_t) head.dims[n] : 1;
+    }
+    if (ismrmrd_make_consistent_ndarray(arr) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to make array consistent.");
+    }
+    size_t data_size = ismrmrd_size_of_ndarray_data(arr);
+    if (item.length != sizeof(head) + data_size ||
+            read_bytes(ld->file, item.offset + sizeof(head), arr->data, data_size) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read array.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static uint32_t log_get_number_of_arrays(const ISMRMRD_Dataset *dset, const char *varname) {
+    if (varname==NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(log_mutex);
+    LogDataset *ld = get_dataset(dset);
+    if (ld == NULL) {
+        return 0;
+    }
+    std::map<std::string, std::vector<LogItem> >::const_iterator var = ld->group->arrays.find(varname);
+    return var == ld->group->arrays.end() ? 0 : (uint32_t) var->second.size();
+}
+
+static const ISMRMRD_DatasetBackend log_backend = {
+    "log",
+    log_open,
+    log_close,
+    log_flush,
+    log_write_header,
+    log_read_header,
+    log_append_acquisitions,
+    log_read_acquisitions,
+    log_get_number_of_acquisitions,
+    log_append_waveform,
+    log_read_waveform,
+    log_get_number_of_waveforms,
+    log_append_images,
+    log_read_images,
+    log_get_number_of_images,
+    log_append_array,
+    log_read_array,
+    log_get_number_of_arrays
+};
+
+} // extern "C"
+
+#else /* _WIN32 */
+
+extern "C" {
+
+static int log_open(ISMRMRD_Dataset *dset, const bool create_if_needed) {
+    return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "The log backend is not available on this platform.");
+}
+
+static int log_close(ISMRMRD_Dataset *dset) {
+    return ISMRMRD_NOERROR;
+}
+
+static const ISMRMRD_DatasetBackend log_backend = {
+    "log", log_open, log_close,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+} // extern "C"
+
+#endif /* _WIN32 */
+
+extern "C" const ISMRMRD_DatasetBackend *ismrmrd_log_backend(void) {
+    return &log_backend;
+}
+
+} // namespace ISMRMRD
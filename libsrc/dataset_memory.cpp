@@ -0,0 +1,440 @@
+#include "ismrmrd/dataset.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace ISMRMRD {
+
+//
+// In-memory dataset backend
+//
+// Items are held as copies of the C structures. The holders initialize and
+// clean up the structure they own and live in deques, which never move them.
+//
+namespace {
+
+struct StoredAcquisition {
+    ISMRMRD_Acquisition acq;
+    StoredAcquisition() { ismrmrd_init_acquisition(&acq); }
+    ~StoredAcquisition() { ismrmrd_cleanup_acquisition(&acq); }
+private:
+    StoredAcquisition(const StoredAcquisition &);
+    StoredAcquisition &operator=(const StoredAcquisition &);
+};
+
+struct StoredWaveform {
+    ISMRMRD_Waveform wav;
+    StoredWaveform() { ismrmrd_init_waveform(&wav); }
+    ~StoredWaveform() { ismrmrd_free(wav.data); }
+private:
+    StoredWaveform(const StoredWaveform &);
+    StoredWaveform &operator=(const StoredWaveform &);
+};
+
+struct StoredImage {
+    ISMRMRD_Image im;
+    StoredImage() { ismrmrd_init_image(&im); }
+    ~StoredImage() { ismrmrd_cleanup_image(&im); }
+private:
+    StoredImage(const StoredImage &);
+    StoredImage &operator=(const StoredImage &);
+};
+
+struct StoredArray {
+    ISMRMRD_NDArray arr;
+    StoredArray() { ismrmrd_init_ndarray(&arr); }
+    ~StoredArray() { ismrmrd_cleanup_ndarray(&arr); }
+private:
+    StoredArray(const StoredArray &);
+    StoredArray &operator=(const StoredArray &);
+};
+
+struct MemoryGroup {
+    MemoryGroup() : has_header(false), open_count(0) {}
+    bool has_header;
+    std::string header;
+    std::deque<StoredAcquisition> acquisitions;
+    std::deque<StoredWaveform> waveforms;
+    std::map<std::string, std::deque<StoredImage> > images;
+    std::map<std::string, std::deque<StoredArray> > arrays;
+    unsigned int open_count;
+};
+
+typedef std::map<std::string, MemoryGroup> MemoryFile;
+
+// filename -> groupname -> group
+std::map<std::string, MemoryFile> memory_files;
+std::mutex memory_mutex;
+
+MemoryGroup *get_group(const ISMRMRD_Dataset *dset) {
+    return static_cast<MemoryGroup *>(dset->backend_data);
+}
+
+// Whether a variable name is taken by the other kind of item, as in HDF5
+bool is_array_variable(const MemoryGroup *group, const std::string &var) {
+    return group->arrays.find(var) != group->arrays.end();
+}
+
+bool is_image_variable(const MemoryGroup *group, const std::string &var) {
+    return group->images.find(var) != group->images.end();
+}
+
+bool same_image_layout(const ISMRMRD_Image *a, const ISMRMRD_Image *b) {
+    return a->head.data_type == b->head.data_type &&
+           a->head.channels == b->head.channels &&
+           memcmp(a->head.matrix_size, b->head.matrix_size, sizeof(a->head.matrix_size)) == 0;
+}
+
+bool same_array_layout(const ISMRMRD_NDArray *a, const ISMRMRD_NDArray *b) {
+    if (a->data_type != b->data_type || a->ndim != b->ndim) {
+        return false;
+    }
+    for (uint16_t n = 0; n < a->ndim; n++) {
+        if (a->dims[n] != b->dims[n]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+extern "C" {
+
+static int memory_open(ISMRMRD_Dataset *dset, const bool create_if_needed) {
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    std::map<std::string, MemoryFile>::iterator file = memory_files.find(dset->filename);
+    if (file == memory_files.end()) {
+        if (!create_if_needed) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+        }
+        file = memory_files.insert(std::make_pair(std::string(dset->filename), MemoryFile())).first;
+    }
+    MemoryGroup &group = file->second[dset->groupname];
+    group.open_count++;
+    dset->backend_data = &group;
+    return ISMRMRD_NOERROR;
+}
+
+static int memory_close(ISMRMRD_Dataset *dset) {
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group != NULL) {
+        group->open_count--;
+        dset->backend_data = NULL;
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static int memory_write_header(const ISMRMRD_Dataset *dset, const char *xmlstring) {
+    if (xmlstring==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "xmlstring should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    group->header = xmlstring;
+    group->has_header = true;
+    return ISMRMRD_NOERROR;
+}
+
+static char *memory_read_header(const ISMRMRD_Dataset *dset) {
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group == NULL || !group->has_header) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Data set does not contain a header.");
+        return NULL;
+    }
+    char *xmlstring = (char *) malloc(group->header.size() + 1);
+    if (xmlstring == NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc header string.");
+        return NULL;
+    }
+    memcpy(xmlstring, group->header.c_str(), group->header.size() + 1);
+    return xmlstring;
+}
+
+static int memory_append_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, size_t n) {
+    if (n == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (acqs==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    size_t first = group->acquisitions.size();
+    for (size_t i = 0; i < n; i++) {
+        group->acquisitions.emplace_back();
+        if (ismrmrd_copy_acquisition(&group->acquisitions.back().acq, &acqs[i]) != ISMRMRD_NOERROR) {
+            while (group->acquisitions.size() > first) {
+                group->acquisitions.pop_back();
+            }
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to copy acquisition.");
+        }
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static int memory_read_acquisitions(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                                    ISMRMRD_Acquisition *acqs) {
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (acqs==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group == NULL || (size_t) start + count > group->acquisitions.size()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (ismrmrd_copy_acquisition(&acqs[i], &group->acquisitions[start + i].acq) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to copy acquisition.");
+        }
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static uint32_t memory_get_number_of_acquisitions(const ISMRMRD_Dataset *dset) {
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    return group == NULL ? 0 : (uint32_t) group->acquisitions.size();
+}
+
+static int memory_append_waveform(const ISMRMRD_Dataset *dset, const ISMRMRD_Waveform *wav) {
+    if (wav==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Waveform pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    group->waveforms.emplace_back();
+    if (ismrmrd_copy_waveform(&group->waveforms.back().wav, wav) != ISMRMRD_NOERROR) {
+        group->waveforms.pop_back();
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to copy waveform.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static int memory_read_waveform(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Waveform *wav) {
+    if (wav==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Waveform pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group == NULL || index >= group->waveforms.size()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+    return ismrmrd_copy_waveform(wav, &group->waveforms[index].wav);
+}
+
+static uint32_t memory_get_number_of_waveforms(const ISMRMRD_Dataset *dset) {
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    return group == NULL ? 0 : (uint32_t) group->waveforms.size();
+}
+
+static int memory_append_images(const ISMRMRD_Dataset *dset, const char *varname,
+                                const ISMRMRD_Image *ims, size_t n) {
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (n == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (ims==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Image pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    if (is_array_variable(group, varname)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Variable already holds arrays.");
+    }
+    std::deque<StoredImage> &images = group->images[varname];
+    const ISMRMRD_Image *layout = images.empty() ? &ims[0] : &images.front().im;
+    for (size_t i = 0; i < n; i++) {
+        if (!same_image_layout(layout, &ims[i])) {
+            if (images.empty()) {
+                group->images.erase(varname);
+            }
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Image dimensions or type do not match the variable.");
+        }
+    }
+    size_t first = images.size();
+    for (size_t i = 0; i < n; i++) {
+        images.emplace_back();
+        if (ismrmrd_copy_image(&images.back().im, &ims[i]) != ISMRMRD_NOERROR) {
+            while (images.size() > first) {
+                images.pop_back();
+            }
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to copy image.");
+        }
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static int memory_read_images(const ISMRMRD_Dataset *dset, const char *varname, const uint32_t start,
+                              const uint32_t count, const uint32_t stride, ISMRMRD_Image *ims) {
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (ims==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Image pointer should not be NULL.");
+    }
+    if (stride == 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Stride should not be zero.");
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    std::map<std::string, std::deque<StoredImage> >::iterator var;
+    if (group == NULL || (var = group->images.find(varname)) == group->images.end() ||
+            (size_t) start + (size_t) (count - 1) * stride >= var->second.size()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (ismrmrd_copy_image(&ims[i], &var->second[start + (size_t) i * stride].im) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to copy image.");
+        }
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static uint32_t memory_get_number_of_images(const ISMRMRD_Dataset *dset, const char *varname) {
+    if (varname==NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group == NULL || !is_image_variable(group, varname)) {
+        return 0;
+    }
+    return (uint32_t) group->images[varname].size();
+}
+
+static int memory_append_array(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_NDArray *arr) {
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (arr==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Array pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is not open.");
+    }
+    if (is_image_variable(group, varname)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Variable already holds images.");
+    }
+    std::deque<StoredArray> &arrays = group->arrays[varname];
+    if (!arrays.empty() && !same_array_layout(&arrays.front().arr, arr)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Array dimensions or type do not match the variable.");
+    }
+    arrays.emplace_back();
+    if (ismrmrd_copy_ndarray(&arrays.back().arr, arr) != ISMRMRD_NOERROR) {
+        arrays.pop_back();
+        if (arrays.empty()) {
+            group->arrays.erase(varname);
+        }
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to copy array.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+static int memory_read_array(const ISMRMRD_Dataset *dset, const char *varname, const uint32_t index,
+                             ISMRMRD_NDArray *arr) {
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (arr==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Array pointer should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    std::map<std::string, std::deque<StoredArray> >::iterator var;
+    if (group == NULL || (var = group->arrays.find(varname)) == group->arrays.end() ||
+            index >= var->second.size()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+    return ismrmrd_copy_ndarray(arr, &var->second[index].arr);
+}
+
+static uint32_t memory_get_number_of_arrays(const ISMRMRD_Dataset *dset, const char *varname) {
+    if (varname==NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    MemoryGroup *group = get_group(dset);
+    if (group == NULL || !is_array_variable(group, varname)) {
+        return 0;
+    }
+    return (uint32_t) group->arrays[varname].size();
+}
+
+static const ISMRMRD_DatasetBackend memory_backend = {
+    "memory",
+    memory_open,
+    memory_close,
+    NULL,
+    memory_write_header,
+    memory_read_header,
+    memory_append_acquisitions,
+    memory_read_acquisitions,
+    memory_get_number_of_acquisitions,
+    memory_append_waveform,
+    memory_read_waveform,
+    memory_get_number_of_waveforms,
+    memory_append_images,
+    memory_read_images,
+    memory_get_number_of_images,
+    memory_append_array,
+    memory_read_array,
+    memory_get_number_of_arrays
+};
+
+const ISMRMRD_DatasetBackend *ismrmrd_memory_backend(void) {
+    return &memory_backend;
+}
+
+int ismrmrd_remove_memory_dataset(const char *filename) {
+    if (filename==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Filename should not be NULL.");
+    }
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    std::map<std::string, MemoryFile>::iterator file = memory_files.find(filename);
+    if (file == memory_files.end()) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+    }
+    for (MemoryFile::const_iterator group = file->second.begin(); group != file->second.end(); ++group) {
+        if (group->second.open_count > 0) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dataset is still open.");
+        }
+    }
+    memory_files.erase(file);
+    return ISMRMRD_NOERROR;
+}
+
+} // extern "C"
+
+} // namespace ISMRMRD
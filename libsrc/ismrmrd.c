@@ -66,15 +66,15 @@ int ismrmrd_cleanup_acquisition(ISMRMRD_Acquisition *acq) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
     }
     
-    free(acq->data);
+    ismrmrd_free(acq->data);
     acq->data = NULL;
-    free(acq->traj);
+    ismrmrd_free(acq->traj);
     acq->traj = NULL;
     return ISMRMRD_NOERROR;
 }
     
 ISMRMRD_Acquisition * ismrmrd_create_acquisition() {
-    ISMRMRD_Acquisition *acq = (ISMRMRD_Acquisition *) malloc(sizeof(ISMRMRD_Acquisition));
+    ISMRMRD_Acquisition *acq = (ISMRMRD_Acquisition *) ismrmrd_malloc(sizeof(ISMRMRD_Acquisition));
     if (acq == NULL) {
         ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc new ISMRMRD_Acquistion.");
         return NULL;
@@ -96,7 +96,7 @@ int ismrmrd_free_acquisition(ISMRMRD_Acquisition *acq) {
     if (ismrmrd_cleanup_acquisition(acq)!=ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Failed to cleanup acquisition.");
     }
-    free(acq);
+    ismrmrd_free(acq);
     return ISMRMRD_NOERROR;
 }
 
@@ -133,7 +133,7 @@ int ismrmrd_make_consistent_acquisition(ISMRMRD_Acquisition *acq) {
     
     traj_size = ismrmrd_size_of_acquisition_traj(acq);
     if (traj_size > 0) {
-        float *newPtr = (float *)realloc(acq->traj, traj_size);
+        float *newPtr = (float *)ismrmrd_realloc(acq->traj, traj_size);
         if (newPtr == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR,
                           "Failed to realloc acquisition trajectory array");
@@ -143,7 +143,7 @@ int ismrmrd_make_consistent_acquisition(ISMRMRD_Acquisition *acq) {
         
     data_size = ismrmrd_size_of_acquisition_data(acq);
     if (data_size > 0) {
-        complex_float_t *newPtr = (complex_float_t *)realloc(acq->data, data_size);
+        complex_float_t *newPtr = (complex_float_t *)ismrmrd_realloc(acq->data, data_size);
         if (newPtr == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR,
                           "Failed to realloc acquisition data array");
@@ -210,7 +210,7 @@ int ismrmrd_init_image(ISMRMRD_Image *im) {
 }
 
 ISMRMRD_Image * ismrmrd_create_image() {
-    ISMRMRD_Image *im = (ISMRMRD_Image *) malloc(sizeof(ISMRMRD_Image));
+    ISMRMRD_Image *im = (ISMRMRD_Image *) ismrmrd_malloc(sizeof(ISMRMRD_Image));
     if (im==NULL) {
         ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to allocate new Image.");
         return NULL;
@@ -227,9 +227,9 @@ int ismrmrd_cleanup_image(ISMRMRD_Image *im) {
     if (im==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not NULL.");
     }
-    free(im->attribute_string);
+    ismrmrd_free(im->attribute_string);
     im->attribute_string = NULL;
-    free(im->data);
+    ismrmrd_free(im->data);
     im->data = NULL;
     return ISMRMRD_NOERROR;
 }
@@ -241,7 +241,7 @@ int ismrmrd_free_image(ISMRMRD_Image *im) {
     if (ismrmrd_cleanup_image(im) != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Failed to clean up image.");
     }
-    free(im);
+    ismrmrd_free(im);
     return ISMRMRD_NOERROR;
 }
 
@@ -271,7 +271,7 @@ int ismrmrd_make_consistent_image(ISMRMRD_Image *im) {
     attr_size = ismrmrd_size_of_image_attribute_string(im);
     if (attr_size > 0) {
         // Allocate space plus a null-terminating character
-        char *newPtr = (char *)realloc(im->attribute_string, attr_size+sizeof(*im->attribute_string));
+        char *newPtr = (char *)ismrmrd_realloc(im->attribute_string, attr_size+sizeof(*im->attribute_string));
         if (newPtr == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc image attribute string");
         }
@@ -282,7 +282,7 @@ int ismrmrd_make_consistent_image(ISMRMRD_Image *im) {
         
     data_size = ismrmrd_size_of_image_data(im);
     if (data_size > 0) {
-        void *newPtr = realloc(im->data, data_size);
+        void *newPtr = ismrmrd_realloc(im->data, data_size);
         if (newPtr == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc image data array");
         }
@@ -341,7 +341,7 @@ int ismrmrd_init_ndarray(ISMRMRD_NDArray *arr) {
 }
 
 ISMRMRD_NDArray * ismrmrd_create_ndarray() {
-    ISMRMRD_NDArray *arr = (ISMRMRD_NDArray *) malloc(sizeof(ISMRMRD_NDArray));
+    ISMRMRD_NDArray *arr = (ISMRMRD_NDArray *) ismrmrd_malloc(sizeof(ISMRMRD_NDArray));
     if (arr==NULL) {
         ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc new ISMRMRD_NDArray.");
         return NULL;
@@ -359,7 +359,7 @@ int ismrmrd_cleanup_ndarray(ISMRMRD_NDArray *arr) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
     }
 
-    free(arr->data);
+    ismrmrd_free(arr->data);
     arr->data = NULL;
     return ISMRMRD_NOERROR;
 }
@@ -372,7 +372,7 @@ int ismrmrd_free_ndarray(ISMRMRD_NDArray *arr) {
     if (ismrmrd_cleanup_ndarray(arr)!=ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Failed to cleanup ndarray.");
     }
-    free(arr);
+    ismrmrd_free(arr);
     return ISMRMRD_NOERROR;
 }
 
@@ -409,7 +409,7 @@ int ismrmrd_make_consistent_ndarray(ISMRMRD_NDArray *arr) {
 
     data_size = ismrmrd_size_of_ndarray_data(arr);
     if (data_size > 0) {
-        void *newPtr = realloc(arr->data, data_size);
+        void *newPtr = ismrmrd_realloc(arr->data, data_size);
         if (newPtr == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc NDArray data array");
         }
@@ -442,6 +442,12 @@ size_t ismrmrd_size_of_ndarray_data(const ISMRMRD_NDArray *arr) {
     return data_size;
 }
 
+/* Memory allocation, see allocator.cpp for the allocators */
+
+bool ismrmrd_is_aligned(const void *ptr, size_t alignment) {
+    return ((size_t) ptr & (alignment - 1)) == 0;
+}
+
 size_t ismrmrd_sizeof_data_type(int data_type)
 {
     size_t size = 0;
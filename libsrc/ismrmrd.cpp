@@ -81,11 +81,18 @@ Acquisition::Acquisition(const Acquisition &other) {
     }
 }
 
+Acquisition::Acquisition(Acquisition &&other) noexcept {
+    // Take the buffers, other is left empty
+    acq = other.acq;
+    ismrmrd_init_acquisition(&other.acq);
+}
+
 Acquisition & Acquisition::operator= (const Acquisition &other) {
-    // Assignment makes a copy
+    // Assignment makes a copy, the old buffers are released first
     int err = 0;
     if (this != &other )
     {
+        ismrmrd_cleanup_acquisition(&acq);
         err = ismrmrd_init_acquisition(&acq);
         if (err) {
             throw std::runtime_error(build_exception_string());
@@ -98,10 +105,27 @@ Acquisition & Acquisition::operator= (const Acquisition &other) {
     return *this;
 }
 
+Acquisition & Acquisition::operator= (Acquisition &&other) noexcept {
+    if (this != &other) {
+        ismrmrd_cleanup_acquisition(&acq);
+        acq = other.acq;
+        ismrmrd_init_acquisition(&other.acq);
+    }
+    return *this;
+}
+
 Acquisition::~Acquisition() {
     ismrmrd_cleanup_acquisition(&acq);
 }
 
+void Acquisition::swap(Acquisition &other) noexcept {
+    std::swap(acq, other.acq);
+}
+
+void swap(Acquisition &a, Acquisition &b) noexcept {
+    a.swap(b);
+}
+
 // Accessors and mutators
 const uint16_t &Acquisition::version() {
     return acq.head.version;
@@ -263,6 +287,11 @@ const float * Acquisition::getTrajPtr() const {
     return acq.traj;
 }
 
+bool Acquisition::isAligned() const {
+    size_t alignment = ismrmrd_get_buffer_alignment();
+    return ismrmrd_is_aligned(acq.data, alignment) && ismrmrd_is_aligned(acq.traj, alignment);
+}
+
 float * Acquisition::getTrajPtr() {
     return acq.traj;
 }
@@ -379,12 +408,20 @@ template <typename T> Image<T>::Image(const Image<T> &other) {
     }
 }
 
+template <typename T> Image<T>::Image(Image<T> &&other) noexcept {
+    // Take the buffers, other is left an empty image of the same type
+    im = other.im;
+    ismrmrd_init_image(&other.im);
+    other.im.head.data_type = static_cast<uint16_t>(get_data_type<T>());
+}
+
 template <typename T> Image<T> & Image<T>::operator= (const Image<T> &other)
 {
     int err = 0;
-    // Assignment makes a copy
+    // Assignment makes a copy, the old buffers are released first
     if (this != &other )
     {
+        ismrmrd_cleanup_image(&im);
         err = ismrmrd_init_image(&im);
         if (err) {
             throw std::runtime_error(build_exception_string());
@@ -397,10 +434,29 @@ template <typename T> Image<T> & Image<T>::operator= (const Image<T> &other)
     return *this;
 }
 
+template <typename T> Image<T> & Image<T>::operator= (Image<T> &&other) noexcept
+{
+    if (this != &other) {
+        ismrmrd_cleanup_image(&im);
+        im = other.im;
+        ismrmrd_init_image(&other.im);
+        other.im.head.data_type = static_cast<uint16_t>(get_data_type<T>());
+    }
+    return *this;
+}
+
 template <typename T> Image<T>::~Image() {
     ismrmrd_cleanup_image(&im);
 }
 
+template <typename T> void Image<T>::swap(Image<T> &other) noexcept {
+    std::swap(im, other.im);
+}
+
+template <typename T> void swap(Image<T> &a, Image<T> &b) noexcept {
+    a.swap(b);
+}
+
 // Image dimensions
 template <typename T> void Image<T>::resize(uint16_t matrix_size_x,
                                             uint16_t matrix_size_y,
@@ -943,7 +999,7 @@ template <typename T> void Image<T>::setAttributeString(const char *attr)
     size_t length = strlen(attr);
 
     // Allocate space plus a null terminator and check for success
-    char *newPointer = (char *)realloc(im.attribute_string, (length+1) * sizeof(*im.attribute_string));
+    char *newPointer = (char *)ismrmrd_realloc(im.attribute_string, (length+1) * sizeof(*im.attribute_string));
     if (NULL==newPointer) {
         throw std::runtime_error(build_exception_string());
     }
@@ -971,6 +1027,10 @@ template <typename T> const T * Image<T>::getDataPtr() const {
      return static_cast<const T*>(im.data);
 }
 
+template <typename T> bool Image<T>::isAligned() const {
+    return ismrmrd_is_aligned(im.data, ismrmrd_get_buffer_alignment());
+}
+
 template <typename T> size_t Image<T>::getNumberOfDataElements() const {
     size_t num = 1;
     num *= im.head.matrix_size[0];
@@ -1038,12 +1098,21 @@ template <typename T> NDArray<T>::~NDArray()
     ismrmrd_cleanup_ndarray(&arr);
 }
 
+template <typename T> NDArray<T>::NDArray(NDArray<T> &&other) noexcept
+{
+    // Take the buffer, other is left an empty array of the same type
+    arr = other.arr;
+    ismrmrd_init_ndarray(&other.arr);
+    other.arr.data_type = static_cast<uint16_t>(get_data_type<T>());
+}
+
 template <typename T> NDArray<T> & NDArray<T>::operator= (const NDArray<T> &other)
 {
     int err = 0;
-    // Assignment makes a copy
+    // Assignment makes a copy, the old buffer is released first
     if (this != &other )
     {
+        ismrmrd_cleanup_ndarray(&arr);
         err = ismrmrd_init_ndarray(&arr);
         if (err) {
             throw std::runtime_error(build_exception_string());
@@ -1056,6 +1125,27 @@ template <typename T> NDArray<T> & NDArray<T>::operator= (const NDArray<T> &othe
     return *this;
 }
 
+template <typename T> NDArray<T> & NDArray<T>::operator= (NDArray<T> &&other) noexcept
+{
+    if (this != &other) {
+        ismrmrd_cleanup_ndarray(&arr);
+        arr = other.arr;
+        ismrmrd_init_ndarray(&other.arr);
+        other.arr.data_type = static_cast<uint16_t>(get_data_type<T>());
+    }
+    return *this;
+}
+
+template <typename T> void NDArray<T>::swap(NDArray<T> &other) noexcept
+{
+    std::swap(arr, other.arr);
+}
+
+template <typename T> void swap(NDArray<T> &a, NDArray<T> &b) noexcept
+{
+    a.swap(b);
+}
+
 template <typename T> uint16_t NDArray<T>::getVersion() const {
     return arr.version;
 };
@@ -1072,6 +1162,10 @@ template <typename T> const size_t (&NDArray<T>::getDims())[ISMRMRD_NDARRAY_MAXD
     return arr.dims;
 };
 
+template <typename T> const size_t (&NDArray<T>::getDims() const)[ISMRMRD_NDARRAY_MAXDIM] {
+    return arr.dims;
+};
+
 template <typename T> void NDArray<T>::resize(const std::vector<size_t> dimvec) {
     if (dimvec.size() > ISMRMRD_NDARRAY_MAXDIM) {
         throw std::runtime_error("Input vector dimvec is too long.");
@@ -1093,6 +1187,10 @@ template <typename T> const T * NDArray<T>::getDataPtr() const {
     return static_cast<T*>(arr.data);
 }
 
+template <typename T> bool NDArray<T>::isAligned() const {
+    return ismrmrd_is_aligned(arr.data, ismrmrd_get_buffer_alignment());
+}
+
 template <typename T> size_t NDArray<T>::getDataSize() const {
     return ismrmrd_size_of_ndarray_data(&arr);
 }
@@ -1191,6 +1289,24 @@ template EXPORTISMRMRD class NDArray<double>;
 template EXPORTISMRMRD class NDArray<complex_float_t>;
 template EXPORTISMRMRD class NDArray<complex_double_t>;
 
+// Swaps
+template EXPORTISMRMRD void swap(Image<uint16_t> &a, Image<uint16_t> &b) noexcept;
+template EXPORTISMRMRD void swap(Image<int16_t> &a, Image<int16_t> &b) noexcept;
+template EXPORTISMRMRD void swap(Image<uint32_t> &a, Image<uint32_t> &b) noexcept;
+template EXPORTISMRMRD void swap(Image<int32_t> &a, Image<int32_t> &b) noexcept;
+template EXPORTISMRMRD void swap(Image<float> &a, Image<float> &b) noexcept;
+template EXPORTISMRMRD void swap(Image<double> &a, Image<double> &b) noexcept;
+template EXPORTISMRMRD void swap(Image<complex_float_t> &a, Image<complex_float_t> &b) noexcept;
+template EXPORTISMRMRD void swap(Image<complex_double_t> &a, Image<complex_double_t> &b) noexcept;
+template EXPORTISMRMRD void swap(NDArray<uint16_t> &a, NDArray<uint16_t> &b) noexcept;
+template EXPORTISMRMRD void swap(NDArray<int16_t> &a, NDArray<int16_t> &b) noexcept;
+template EXPORTISMRMRD void swap(NDArray<uint32_t> &a, NDArray<uint32_t> &b) noexcept;
+template EXPORTISMRMRD void swap(NDArray<int32_t> &a, NDArray<int32_t> &b) noexcept;
+template EXPORTISMRMRD void swap(NDArray<float> &a, NDArray<float> &b) noexcept;
+template EXPORTISMRMRD void swap(NDArray<double> &a, NDArray<double> &b) noexcept;
+template EXPORTISMRMRD void swap(NDArray<complex_float_t> &a, NDArray<complex_float_t> &b) noexcept;
+template EXPORTISMRMRD void swap(NDArray<complex_double_t> &a, NDArray<complex_double_t> &b) noexcept;
+
 
 // Helper function for generating exception message from ISMRMRD error stack
 std::string build_exception_string(void)
@@ -0,0 +1,708 @@
+#include "ismrmrd/serialization.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace ISMRMRD
+{
+
+namespace {
+
+// Most pieces a message is written or read in, after the frame
+const size_t MAX_PARTS = 4;
+
+// Body of an NDArray message before the data
+struct WireArrayHeader {
+    uint16_t version;
+    uint16_t data_type;
+    uint16_t ndim;
+    uint16_t reserved;
+    uint64_t dims[ISMRMRD_NDARRAY_MAXDIM];
+};
+
+struct Part {
+    Part(const void *d = NULL, size_t len = 0) : data(d), length(len) {}
+    const void *data;
+    size_t length;
+};
+
+struct MutablePart {
+    MutablePart(void *d = NULL, size_t len = 0) : data(d), length(len) {}
+    void *data;
+    size_t length;
+};
+
+//
+// Streams
+//
+void write_parts(std::ostream &os, const Part *parts, size_t nparts)
+{
+    for (size_t i = 0; i < nparts; i++) {
+        os.write(static_cast<const char *>(parts[i].data), parts[i].length);
+    }
+    if (!os) {
+        throw std::runtime_error("Failed to write message");
+    }
+}
+
+void read_parts(std::istream &is, const MutablePart *parts, size_t nparts)
+{
+    for (size_t i = 0; i < nparts; i++) {
+        is.read(static_cast<char *>(parts[i].data), parts[i].length);
+    }
+    if (!is) {
+        throw std::runtime_error("Failed to read message");
+    }
+}
+
+bool read_frame(std::istream &is, MessageFrame &frame)
+{
+    is.read(reinterpret_cast<char *>(&frame), sizeof(frame));
+    if (is.gcount() == 0 && is.eof()) {
+        return false;
+    }
+    if (!is) {
+        throw std::runtime_error("Failed to read message frame");
+    }
+    return true;
+}
+
+void skip_bytes(std::istream &is, uint64_t length)
+{
+    const uint64_t step = std::numeric_limits<std::streamsize>::max();
+    while (length > 0) {
+        std::streamsize n = static_cast<std::streamsize>(length < step ? length : step);
+        is.ignore(n);
+        if (is.gcount() != n) {
+            throw std::runtime_error("Failed to skip message");
+        }
+        length -= n;
+    }
+}
+
+#ifndef _WIN32
+//
+// File descriptors
+//
+void write_parts(int fd, const Part *parts, size_t nparts)
+{
+    struct iovec iov[MAX_PARTS + 1];
+    for (size_t i = 0; i < nparts; i++) {
+        iov[i].iov_base = const_cast<void *>(parts[i].data);
+        iov[i].iov_len = parts[i].length;
+    }
+    struct iovec *next = iov;
+    int left = static_cast<int>(nparts);
+    while (left > 0) {
+        ssize_t n = writev(fd, next, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to write message");
+        }
+        // Skip what was written, a partial write leaves the rest of a part
+        size_t done = static_cast<size_t>(n);
+        while (left > 0 && done >= next->iov_len) {
+            done -= next->iov_len;
+            next++;
+            left--;
+        }
+        if (left > 0) {
+            next->iov_base = static_cast<char *>(next->iov_base) + done;
+            next->iov_len -= done;
+        }
+    }
+}
+
+// Returns the number of bytes read, less than asked for only at the end of the file
+size_t read_some_parts(int fd, const MutablePart *parts, size_t nparts)
+{
+    struct iovec iov[MAX_PARTS + 1];
+    for (size_t i = 0; i < nparts; i++) {
+        iov[i].iov_base = parts[i].data;
+        iov[i].iov_len = parts[i].length;
+    }
+    struct iovec *next = iov;
+    int left = static_cast<int>(nparts);
+    size_t total = 0;
+    while (left > 0) {
+        if (next->iov_len == 0) {
+            next++;
+            left--;
+            continue;
+        }
+        ssize_t n = readv(fd, next, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to read message");
+        }
+        if (n == 0) {
+            break;
+        }
+        total += static_cast<size_t>(n);
+        size_t done = static_cast<size_t>(n);
+        while (left > 0 && done >= next->iov_len) {
+            done -= next->iov_len;
+            next++;
+            left--;
+        }
+        if (left > 0) {
+            next->iov_base = static_cast<char *>(next->iov_base) + done;
+            next->iov_len -= done;
+        }
+    }
+    return total;
+}
+
+void read_parts(int fd, const MutablePart *parts, size_t nparts)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < nparts; i++) {
+        length += parts[i].length;
+    }
+    if (read_some_parts(fd, parts, nparts) != length) {
+        throw std::runtime_error("Unexpected end of message");
+    }
+}
+
+bool read_frame(int fd, MessageFrame &frame)
+{
+    MutablePart part(&frame, sizeof(frame));
+    size_t n = read_some_parts(fd, &part, 1);
+    if (n == 0) {
+        return false;
+    }
+    if (n != sizeof(frame)) {
+        throw std::runtime_error("Unexpected end of message frame");
+    }
+    return true;
+}
+
+void skip_bytes(int fd, uint64_t length)
+{
+    std::vector<char> buffer(65536);
+    while (length > 0) {
+        MutablePart part(&buffer[0], static_cast<size_t>(length < buffer.size() ? length : buffer.size()));
+        read_parts(fd, &part, 1);
+        length -= part.length;
+    }
+}
+#endif
+
+//
+// Messages, for either kind of channel
+//
+template <typename Channel>
+void write_message(Channel &ch, uint16_t id, const Part *parts, size_t nparts)
+{
+    MessageFrame frame;
+    frame.id = id;
+    frame.version = ISMRMRD_MESSAGE_VERSION;
+    frame.reserved = 0;
+    frame.length = 0;
+    Part all[MAX_PARTS + 1];
+    all[0] = Part(&frame, sizeof(frame));
+    for (size_t i = 0; i < nparts; i++) {
+        frame.length += parts[i].length;
+        all[i + 1] = parts[i];
+    }
+    write_parts(ch, all, nparts + 1);
+}
+
+void check_frame(const MessageFrame &frame, uint16_t id, uint64_t min_length)
+{
+    if (frame.id != id) {
+        throw std::runtime_error("Unexpected message id");
+    }
+    if (frame.version != ISMRMRD_MESSAGE_VERSION) {
+        throw std::runtime_error("Unsupported message version");
+    }
+    if (frame.length < min_length) {
+        throw std::runtime_error("Message is too short");
+    }
+}
+
+// Sizes of message parts computed from their headers, which may hold anything
+class BodySize {
+public:
+    explicit BodySize(uint64_t size) : size_(size), overflow_(false) {}
+    BodySize &times(uint64_t factor)
+    {
+        if (factor != 0 && size_ > std::numeric_limits<uint64_t>::max() / factor) {
+            overflow_ = true;
+        }
+        size_ *= factor;
+        return *this;
+    }
+    BodySize &plus(const BodySize &other)
+    {
+        overflow_ = overflow_ || other.overflow_ || size_ > std::numeric_limits<uint64_t>::max() - other.size_;
+        size_ += other.size_;
+        return *this;
+    }
+    bool matches(uint64_t length) const
+    {
+        return !overflow_ && size_ == length && length <= std::numeric_limits<size_t>::max();
+    }
+private:
+    uint64_t size_;
+    bool overflow_;
+};
+
+// Throws if the message does not have the length given by its headers. The
+// rest of the message after the consumed bytes is skipped first, so that the
+// next frame can be read. Nothing is allocated for a message that is rejected.
+// The size of what was allocated is checked again, as the C size functions
+// count elements in an int.
+template <typename Channel>
+void check_length(Channel &ch, const MessageFrame &frame, uint64_t consumed, const BodySize &size)
+{
+    if (!size.matches(frame.length)) {
+        skip_bytes(ch, frame.length - consumed);
+        throw std::runtime_error("Message length does not match its header");
+    }
+}
+
+template <typename Channel>
+void write_acquisition(Channel &ch, const Acquisition &acq)
+{
+    Part parts[3] = {
+        Part(&acq.getHead(), sizeof(ISMRMRD_AcquisitionHeader)),
+        Part(acq.getTrajPtr(), acq.getTrajSize()),
+        Part(acq.getDataPtr(), acq.getDataSize())
+    };
+    write_message(ch, ISMRMRD_MESSAGE_ACQUISITION, parts, 3);
+}
+
+template <typename Channel>
+void read_acquisition(Channel &ch, const MessageFrame &frame, Acquisition &acq)
+{
+    check_frame(frame, ISMRMRD_MESSAGE_ACQUISITION, sizeof(ISMRMRD_AcquisitionHeader));
+    AcquisitionHeader head;
+    MutablePart part(&head, sizeof(ISMRMRD_AcquisitionHeader));
+    read_parts(ch, &part, 1);
+    BodySize traj_size = BodySize(head.number_of_samples).times(head.trajectory_dimensions).times(sizeof(float));
+    BodySize data_size = BodySize(head.number_of_samples).times(head.active_channels).times(sizeof(complex_float_t));
+    check_length(ch, frame, sizeof(ISMRMRD_AcquisitionHeader),
+                 BodySize(sizeof(ISMRMRD_AcquisitionHeader)).plus(traj_size).plus(data_size));
+    acq.setHead(head);
+    check_length(ch, frame, sizeof(ISMRMRD_AcquisitionHeader), BodySize(sizeof(ISMRMRD_AcquisitionHeader))
+                     .plus(BodySize(acq.getTrajSize())).plus(BodySize(acq.getDataSize())));
+    MutablePart parts[2] = {
+        MutablePart(acq.getTrajPtr(), acq.getTrajSize()),
+        MutablePart(acq.getDataPtr(), acq.getDataSize())
+    };
+    read_parts(ch, parts, 2);
+}
+
+template <typename Channel>
+void write_waveform(Channel &ch, const Waveform &wav)
+{
+    Part parts[2] = {
+        Part(&wav.head, sizeof(ISMRMRD_WaveformHeader)),
+        Part(wav.data, static_cast<size_t>(ismrmrd_size_of_waveform_data(&wav)))
+    };
+    write_message(ch, ISMRMRD_MESSAGE_WAVEFORM, parts, 2);
+}
+
+template <typename Channel>
+void read_waveform(Channel &ch, const MessageFrame &frame, Waveform &wav)
+{
+    check_frame(frame, ISMRMRD_MESSAGE_WAVEFORM, sizeof(ISMRMRD_WaveformHeader));
+    ISMRMRD_WaveformHeader head;
+    MutablePart part(&head, sizeof(ISMRMRD_WaveformHeader));
+    read_parts(ch, &part, 1);
+    BodySize data_size = BodySize(head.number_of_samples).times(head.channels).times(sizeof(uint32_t));
+    check_length(ch, frame, sizeof(ISMRMRD_WaveformHeader), BodySize(sizeof(ISMRMRD_WaveformHeader)).plus(data_size));
+    wav.head = head;
+    if (ismrmrd_make_consistent_waveform(&wav) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    part = MutablePart(wav.data, static_cast<size_t>(frame.length - sizeof(ISMRMRD_WaveformHeader)));
+    read_parts(ch, &part, 1);
+}
+
+template <typename Channel, typename T>
+void write_image(Channel &ch, const Image<T> &im)
+{
+    Part parts[3] = {
+        Part(&im.getHead(), sizeof(ISMRMRD_ImageHeader)),
+        Part(im.getAttributeString(), im.getAttributeStringLength()),
+        Part(im.getDataPtr(), im.getDataSize())
+    };
+    write_message(ch, ISMRMRD_MESSAGE_IMAGE, parts, 3);
+}
+
+template <typename Channel>
+void read_image_header(Channel &ch, const MessageFrame &frame, ImageHeader &head)
+{
+    check_frame(frame, ISMRMRD_MESSAGE_IMAGE, sizeof(ISMRMRD_ImageHeader));
+    MutablePart part(&head, sizeof(ISMRMRD_ImageHeader));
+    read_parts(ch, &part, 1);
+}
+
+template <typename Channel, typename T>
+void read_image_data(Channel &ch, const MessageFrame &frame, const ImageHeader &head, Image<T> &im)
+{
+    if (head.data_type != im.getDataType()) {
+        skip_bytes(ch, frame.length - sizeof(ISMRMRD_ImageHeader));
+        throw std::runtime_error("Message holds an image of a different data type");
+    }
+    BodySize data_size = BodySize(head.matrix_size[0]).times(head.matrix_size[1]).times(head.matrix_size[2])
+                             .times(head.channels).times(sizeof(T));
+    check_length(ch, frame, sizeof(ISMRMRD_ImageHeader),
+                 BodySize(sizeof(ISMRMRD_ImageHeader)).plus(BodySize(head.attribute_string_len)).plus(data_size));
+    im.setHead(head);
+    check_length(ch, frame, sizeof(ISMRMRD_ImageHeader),
+                 BodySize(sizeof(ISMRMRD_ImageHeader)).plus(BodySize(head.attribute_string_len))
+                     .plus(BodySize(im.getDataSize())));
+    std::string attr(head.attribute_string_len, '\0');
+    MutablePart parts[2] = {
+        MutablePart(attr.empty() ? NULL : &attr[0], attr.size()),
+        MutablePart(im.getDataPtr(), im.getDataSize())
+    };
+    read_parts(ch, parts, 2);
+    im.setAttributeString(attr);
+}
+
+template <typename Channel, typename T>
+void read_image(Channel &ch, const MessageFrame &frame, Image<T> &im)
+{
+    ImageHeader head;
+    read_image_header(ch, frame, head);
+    read_image_data(ch, frame, head, im);
+}
+
+template <typename Channel, typename T>
+void write_ndarray(Channel &ch, const NDArray<T> &arr)
+{
+    WireArrayHeader head;
+    memset(&head, 0, sizeof(head));
+    head.version = arr.getVersion();
+    head.data_type = arr.getDataType();
+    head.ndim = arr.getNDim();
+    for (uint16_t n = 0; n < ISMRMRD_NDARRAY_MAXDIM; n++) {
+        head.dims[n] = arr.getDims()[n];
+    }
+    Part parts[2] = {
+        Part(&head, sizeof(head)),
+        Part(arr.getDataPtr(), arr.getDataSize())
+    };
+    write_message(ch, ISMRMRD_MESSAGE_NDARRAY, parts, 2);
+}
+
+template <typename Channel, typename T>
+void read_ndarray(Channel &ch, const MessageFrame &frame, NDArray<T> &arr)
+{
+    check_frame(frame, ISMRMRD_MESSAGE_NDARRAY, sizeof(WireArrayHeader));
+    WireArrayHeader head;
+    MutablePart part(&head, sizeof(head));
+    read_parts(ch, &part, 1);
+    if (head.data_type != arr.getDataType()) {
+        skip_bytes(ch, frame.length - sizeof(head));
+        throw std::runtime_error("Message holds an array of a different data type");
+    }
+    if (head.ndim > ISMRMRD_NDARRAY_MAXDIM) {
+        skip_bytes(ch, frame.length - sizeof(head));
+        throw std::runtime_error("Message holds an array of too many dimensions");
+    }
+    BodySize size = BodySize(sizeof(T));
+    for (uint16_t n = 0; n < head.ndim; n++) {
+        size.times(head.dims[n]);
+    }
+    check_length(ch, frame, sizeof(head), BodySize(sizeof(head)).plus(size));
+    arr.resize(std::vector<size_t>(head.dims, head.dims + head.ndim));
+    check_length(ch, frame, sizeof(head), BodySize(sizeof(head)).plus(BodySize(arr.getDataSize())));
+    part = MutablePart(arr.getDataPtr(), arr.getDataSize());
+    read_parts(ch, &part, 1);
+}
+
+template <typename Channel>
+void write_header(Channel &ch, const std::string &xml)
+{
+    Part part(xml.data(), xml.size());
+    write_message(ch, ISMRMRD_MESSAGE_HEADER, &part, 1);
+}
+
+template <typename Channel>
+void read_header(Channel &ch, const MessageFrame &frame, std::string &xml)
+{
+    check_frame(frame, ISMRMRD_MESSAGE_HEADER, 0);
+    check_length(ch, frame, 0, BodySize(frame.length));
+    xml.assign(static_cast<size_t>(frame.length), '\0');
+    MutablePart part(xml.empty() ? NULL : &xml[0], xml.size());
+    read_parts(ch, &part, 1);
+}
+
+template <typename Channel>
+void write_close(Channel &ch)
+{
+    write_message(ch, ISMRMRD_MESSAGE_CLOSE, NULL, 0);
+}
+
+} // namespace
+
+//
+// Streams
+//
+void serialize(const Acquisition &acq, std::ostream &os)
+{
+    write_acquisition(os, acq);
+}
+
+void serialize(const Waveform &wav, std::ostream &os)
+{
+    write_waveform(os, wav);
+}
+
+template <typename T> void serialize(const Image<T> &im, std::ostream &os)
+{
+    write_image(os, im);
+}
+
+template <typename T> void serialize(const NDArray<T> &arr, std::ostream &os)
+{
+    write_ndarray(os, arr);
+}
+
+void serializeHeader(const std::string &xml, std::ostream &os)
+{
+    write_header(os, xml);
+}
+
+void serializeClose(std::ostream &os)
+{
+    write_close(os);
+}
+
+bool readMessageFrame(std::istream &is, MessageFrame &frame)
+{
+    return read_frame(is, frame);
+}
+
+void deserialize(std::istream &is, const MessageFrame &frame, Acquisition &acq)
+{
+    read_acquisition(is, frame, acq);
+}
+
+void deserialize(std::istream &is, const MessageFrame &frame, Waveform &wav)
+{
+    read_waveform(is, frame, wav);
+}
+
+template <typename T> void deserialize(std::istream &is, const MessageFrame &frame, Image<T> &im)
+{
+    read_image(is, frame, im);
+}
+
+void deserializeImageHeader(std::istream &is, const MessageFrame &frame, ImageHeader &head)
+{
+    read_image_header(is, frame, head);
+}
+
+template <typename T> void deserializeImageData(std::istream &is, const MessageFrame &frame, const ImageHeader &head, Image<T> &im)
+{
+    read_image_data(is, frame, head, im);
+}
+
+template <typename T> void deserialize(std::istream &is, const MessageFrame &frame, NDArray<T> &arr)
+{
+    read_ndarray(is, frame, arr);
+}
+
+void deserializeHeader(std::istream &is, const MessageFrame &frame, std::string &xml)
+{
+    read_header(is, frame, xml);
+}
+
+void skipMessage(std::istream &is, const MessageFrame &frame)
+{
+    skip_bytes(is, frame.length);
+}
+
+#ifndef _WIN32
+//
+// File descriptors
+//
+void serialize(const Acquisition &acq, int fd)
+{
+    write_acquisition(fd, acq);
+}
+
+void serialize(const Waveform &wav, int fd)
+{
+    write_waveform(fd, wav);
+}
+
+template <typename T> void serialize(const Image<T> &im, int fd)
+{
+    write_image(fd, im);
+}
+
+template <typename T> void serialize(const NDArray<T> &arr, int fd)
+{
+    write_ndarray(fd, arr);
+}
+
+void serializeHeader(const std::string &xml, int fd)
+{
+    write_header(fd, xml);
+}
+
+void serializeClose(int fd)
+{
+    write_close(fd);
+}
+
+bool readMessageFrame(int fd, MessageFrame &frame)
+{
+    return read_frame(fd, frame);
+}
+
+void deserialize(int fd, const MessageFrame &frame, Acquisition &acq)
+{
+    read_acquisition(fd, frame, acq);
+}
+
+void deserialize(int fd, const MessageFrame &frame, Waveform &wav)
+{
+    read_waveform(fd, frame, wav);
+}
+
+template <typename T> void deserialize(int fd, const MessageFrame &frame, Image<T> &im)
+{
+    read_image(fd, frame, im);
+}
+
+void deserializeImageHeader(int fd, const MessageFrame &frame, ImageHeader &head)
+{
+    read_image_header(fd, frame, head);
+}
+
+template <typename T> void deserializeImageData(int fd, const MessageFrame &frame, const ImageHeader &head, Image<T> &im)
+{
+    read_image_data(fd, frame, head, im);
+}
+
+template <typename T> void deserialize(int fd, const MessageFrame &frame, NDArray<T> &arr)
+{
+    read_ndarray(fd, frame, arr);
+}
+
+void deserializeHeader(int fd, const MessageFrame &frame, std::string &xml)
+{
+    read_header(fd, frame, xml);
+}
+
+void skipMessage(int fd, const MessageFrame &frame)
+{
+    skip_bytes(fd, frame.length);
+}
+#endif
+
+// Specific instantiations
+template EXPORTISMRMRD void serialize(const Image<uint16_t> &im, std::ostream &os);
+template EXPORTISMRMRD void serialize(const Image<int16_t> &im, std::ostream &os);
+template EXPORTISMRMRD void serialize(const Image<uint32_t> &im, std::ostream &os);
+template EXPORTISMRMRD void serialize(const Image<int32_t> &im, std::ostream &os);
+template EXPORTISMRMRD void serialize(const Image<float> &im, std::ostream &os);
+template EXPORTISMRMRD void serialize(const Image<double> &im, std::ostream &os);
+template EXPORTISMRMRD void serialize(const Image<complex_float_t> &im, std::ostream &os);
+template EXPORTISMRMRD void serialize(const Image<complex_double_t> &im, std::ostream &os);
+
+template EXPORTISMRMRD void serialize(const NDArray<uint16_t> &arr, std::ostream &os);
+template EXPORTISMRMRD void serialize(const NDArray<int16_t> &arr, std::ostream &os);
+template EXPORTISMRMRD void serialize(const NDArray<uint32_t> &arr, std::ostream &os);
+template EXPORTISMRMRD void serialize(const NDArray<int32_t> &arr, std::ostream &os);
+template EXPORTISMRMRD void serialize(const NDArray<float> &arr, std::ostream &os);
+template EXPORTISMRMRD void serialize(const NDArray<double> &arr, std::ostream &os);
+template EXPORTISMRMRD void serialize(const NDArray<complex_float_t> &arr, std::ostream &os);
+template EXPORTISMRMRD void serialize(const NDArray<complex_double_t> &arr, std::ostream &os);
+
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Image<uint16_t> &im);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Image<int16_t> &im);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Image<uint32_t> &im);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Image<int32_t> &im);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Image<float> &im);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Image<double> &im);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Image<complex_float_t> &im);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, Image<complex_double_t> &im);
+
+template EXPORTISMRMRD void deserializeImageData(std::istream &is, const MessageFrame &frame, const ImageHeader &head, Image<uint16_t> &im);
+template EXPORTISMRMRD void deserializeImageData(std::istream &is, const MessageFrame &frame, const ImageHeader &head, Image<int16_t> &im);
+template EXPORTISMRMRD void deserializeImageData(std::istream &is, const MessageFrame &frame, const ImageHeader &head, Image<uint32_t> &im);
+template EXPORTISMRMRD void deserializeImageData(std::istream &is, const MessageFrame &frame, const ImageHeader &head, Image<int32_t> &im);
+template EXPORTISMRMRD void deserializeImageData(std::istream &is, const MessageFrame &frame, const ImageHeader &head, Image<float> &im);
+template EXPORTISMRMRD void deserializeImageData(std::istream &is, const MessageFrame &frame, const ImageHeader &head, Image<double> &im);
+template EXPORTISMRMRD void deserializeImageData(std::istream &is, const MessageFrame &frame, const ImageHeader &head, Image<complex_float_t> &im);
+template EXPORTISMRMRD void deserializeImageData(std::istream &is, const MessageFrame &frame, const ImageHeader &head, Image<complex_double_t> &im);
+
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, NDArray<uint16_t> &arr);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, NDArray<int16_t> &arr);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, NDArray<uint32_t> &arr);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, NDArray<int32_t> &arr);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, NDArray<float> &arr);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, NDArray<double> &arr);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, NDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void deserialize(std::istream &is, const MessageFrame &frame, NDArray<complex_double_t> &arr);
+
+#ifndef _WIN32
+template EXPORTISMRMRD void serialize(const Image<uint16_t> &im, int fd);
+template EXPORTISMRMRD void serialize(const Image<int16_t> &im, int fd);
+template EXPORTISMRMRD void serialize(const Image<uint32_t> &im, int fd);
+template EXPORTISMRMRD void serialize(const Image<int32_t> &im, int fd);
+template EXPORTISMRMRD void serialize(const Image<float> &im, int fd);
+template EXPORTISMRMRD void serialize(const Image<double> &im, int fd);
+template EXPORTISMRMRD void serialize(const Image<complex_float_t> &im, int fd);
+template EXPORTISMRMRD void serialize(const Image<complex_double_t> &im, int fd);
+
+template EXPORTISMRMRD void serialize(const NDArray<uint16_t> &arr, int fd);
+template EXPORTISMRMRD void serialize(const NDArray<int16_t> &arr, int fd);
+template EXPORTISMRMRD void serialize(const NDArray<uint32_t> &arr, int fd);
+template EXPORTISMRMRD void serialize(const NDArray<int32_t> &arr, int fd);
+template EXPORTISMRMRD void serialize(const NDArray<float> &arr, int fd);
+template EXPORTISMRMRD void serialize(const NDArray<double> &arr, int fd);
+template EXPORTISMRMRD void serialize(const NDArray<complex_float_t> &arr, int fd);
+template EXPORTISMRMRD void serialize(const NDArray<complex_double_t> &arr, int fd);
+
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Image<uint16_t> &im);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Image<int16_t> &im);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Image<uint32_t> &im);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Image<int32_t> &im);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Image<float> &im);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Image<double> &im);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Image<complex_float_t> &im);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, Image<complex_double_t> &im);
+
+template EXPORTISMRMRD void deserializeImageData(int fd, const MessageFrame &frame, const ImageHeader &head, Image<uint16_t> &im);
+template EXPORTISMRMRD void deserializeImageData(int fd, const MessageFrame &frame, const ImageHeader &head, Image<int16_t> &im);
+template EXPORTISMRMRD void deserializeImageData(int fd, const MessageFrame &frame, const ImageHeader &head, Image<uint32_t> &im);
+template EXPORTISMRMRD void deserializeImageData(int fd, const MessageFrame &frame, const ImageHeader &head, Image<int32_t> &im);
+template EXPORTISMRMRD void deserializeImageData(int fd, const MessageFrame &frame, const ImageHeader &head, Image<float> &im);
+template EXPORTISMRMRD void deserializeImageData(int fd, const MessageFrame &frame, const ImageHeader &head, Image<double> &im);
+template EXPORTISMRMRD void deserializeImageData(int fd, const MessageFrame &frame, const ImageHeader &head, Image<complex_float_t> &im);
+template EXPORTISMRMRD void deserializeImageData(int fd, const MessageFrame &frame, const ImageHeader &head, Image<complex_double_t> &im);
+
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, NDArray<uint16_t> &arr);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, NDArray<int16_t> &arr);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, NDArray<uint32_t> &arr);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, NDArray<int32_t> &arr);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, NDArray<float> &arr);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, NDArray<double> &arr);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, NDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void deserialize(int fd, const MessageFrame &frame, NDArray<complex_double_t> &arr);
+#endif
+
+} // namespace ISMRMRD
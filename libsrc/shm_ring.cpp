@@ -0,0 +1,506 @@
+#include "ismrmrd/shm_ring.h"
+
+#ifndef _WIN32
+
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits>
+#include <new>
+#include <signal.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace ISMRMRD
+{
+
+namespace {
+
+const char RING_MAGIC[8] = {'I', 'S', 'M', 'R', 'M', 'R', 'D', 'R'};
+const uint32_t RING_VERSION = 2;
+
+// Records start at this offset of the mapping, after the control block
+const size_t RING_RECORDS_OFFSET = 4096;
+
+enum RecordKind {
+    RECORD_ACQUISITION = 1,
+    RECORD_PADDING = 2   // fills the end of the ring when a record does not fit
+};
+
+// Start of every record, followed for acquisitions by the header, data and trajectory
+struct RecordHeader {
+    uint32_t length;     // of the whole record, a multiple of RECORD_ALIGNMENT
+    uint32_t kind;
+    uint32_t released;   // only used by the consumer
+    uint32_t reserved;
+};
+
+// Spins this many times before yielding the processor while waiting
+const int SPIN_LIMIT = 256;
+
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+size_t round_up(size_t value, size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Records, and the data and trajectory within them, start on cache lines so
+// that they can be used with aligned vector loads in place
+const size_t RECORD_ALIGNMENT = 64;
+const size_t RECORD_DATA_OFFSET = (sizeof(RecordHeader) + sizeof(ISMRMRD_AcquisitionHeader) + RECORD_ALIGNMENT - 1)
+                                  / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+
+size_t traj_offset(size_t data_size)
+{
+    return round_up(RECORD_DATA_OFFSET + data_size, RECORD_ALIGNMENT);
+}
+
+size_t record_length(uint16_t num_samples, uint16_t active_channels, uint16_t trajectory_dimensions)
+{
+    return round_up(traj_offset(static_cast<size_t>(num_samples) * active_channels * sizeof(complex_float_t))
+                    + static_cast<size_t>(num_samples) * trajectory_dimensions * sizeof(float), RECORD_ALIGNMENT);
+}
+
+std::runtime_error ring_error(const std::string &what, const std::string &name)
+{
+    return std::runtime_error(what + " " + name + ": " + strerror(errno));
+}
+
+// Waits up to timeout_us for ready() to be true
+template <typename Ready>
+bool wait_for(Ready ready, uint32_t timeout_us)
+{
+    for (int n = 0; n < SPIN_LIMIT; n++) {
+        if (ready()) {
+            return true;
+        }
+        cpu_relax();
+    }
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us);
+    while (!ready()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+} // namespace
+
+// Shared by all processes at the start of the mapping. The positions count
+// bytes from the creation of the ring and are taken modulo the capacity.
+struct AcquisitionRingControl {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t capacity;
+    // claimed by producers
+    alignas(64) std::atomic<uint64_t> head;
+    // committed by producers, in the order they were claimed
+    alignas(64) std::atomic<uint64_t> published;
+    // released by the consumer
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> producers;
+    std::atomic<uint32_t> producers_seen;
+    // process id of the consumer, 0 if there is none
+    std::atomic<uint32_t> consumer;
+};
+
+namespace {
+
+static_assert(sizeof(AcquisitionRingControl) <= RING_RECORDS_OFFSET, "Ring control block is too large");
+
+// Atomics that take a lock do not work between processes
+void check_lock_free(const AcquisitionRingControl &control)
+{
+    if (!control.head.is_lock_free() || !control.producers.is_lock_free()) {
+        throw std::runtime_error("Atomic operations are not lock free on this platform");
+    }
+}
+
+// Records this process as the consumer, replacing one that has died
+bool claim_consumer(AcquisitionRingControl &control)
+{
+    uint32_t self = static_cast<uint32_t>(getpid());
+    uint32_t current = 0;
+    while (!control.consumer.compare_exchange_strong(current, self)) {
+        if (kill(static_cast<pid_t>(current), 0) == 0 || errno != ESRCH) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Maps an existing ring
+AcquisitionRingControl *map_ring(const std::string &name, void *&map, size_t &map_size)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw ring_error("Failed to open the ring", name);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < RING_RECORDS_OFFSET) {
+        ::close(fd);
+        throw std::runtime_error("Not an acquisition ring: " + name);
+    }
+    map_size = static_cast<size_t>(st.st_size);
+    map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw ring_error("Failed to map the ring", name);
+    }
+    AcquisitionRingControl *control = static_cast<AcquisitionRingControl *>(map);
+    if (memcmp(control->magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0 || control->version != RING_VERSION ||
+        control->capacity + RING_RECORDS_OFFSET != map_size) {
+        munmap(map, map_size);
+        throw std::runtime_error("Not an acquisition ring: " + name);
+    }
+    try {
+        check_lock_free(*control);
+    } catch (...) {
+        munmap(map, map_size);
+        throw;
+    }
+    return control;
+}
+
+} // namespace
+
+void createAcquisitionRing(const std::string &name, size_t capacity)
+{
+    capacity = round_up(capacity, RECORD_ALIGNMENT);
+    if (capacity == 0) {
+        throw std::runtime_error("Ring capacity must not be zero");
+    }
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        throw ring_error("Failed to create the ring", name);
+    }
+    size_t map_size = RING_RECORDS_OFFSET + capacity;
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(map_size)) == 0) {
+        map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::runtime_error error = ring_error("Failed to size the ring", name);
+        shm_unlink(name.c_str());
+        throw error;
+    }
+
+    // Touch every page here so they are placed on this process' node
+    memset(static_cast<char *>(map) + RING_RECORDS_OFFSET, 0, capacity);
+    AcquisitionRingControl *control = new (map) AcquisitionRingControl();
+    try {
+        check_lock_free(*control);
+    } catch (...) {
+        munmap(map, map_size);
+        shm_unlink(name.c_str());
+        throw;
+    }
+    control->version = RING_VERSION;
+    control->capacity = capacity;
+    control->head.store(0);
+    control->published.store(0);
+    control->tail.store(0);
+    control->producers.store(0);
+    control->producers_seen.store(0);
+    control->consumer.store(0);
+    // The magic goes last, openers check it
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(control->magic, RING_MAGIC, sizeof(RING_MAGIC));
+    munmap(map, map_size);
+}
+
+void removeAcquisitionRing(const std::string &name)
+{
+    if (shm_unlink(name.c_str()) != 0) {
+        throw ring_error("Failed to remove the ring", name);
+    }
+}
+
+//
+// AcquisitionSlot
+//
+AcquisitionSlot::AcquisitionSlot() : head(NULL), data(NULL), traj(NULL), start_(0), end_(0) {}
+
+//
+// AcquisitionView
+//
+AcquisitionView::AcquisitionView() : record_(NULL) {}
+
+bool AcquisitionView::isValid() const {
+    return record_ != NULL;
+}
+
+const AcquisitionHeader &AcquisitionView::getHead() const {
+    return *reinterpret_cast<const AcquisitionHeader *>(record_ + sizeof(RecordHeader));
+}
+
+const complex_float_t *AcquisitionView::getDataPtr() const {
+    return reinterpret_cast<const complex_float_t *>(record_ + RECORD_DATA_OFFSET);
+}
+
+const float *AcquisitionView::getTrajPtr() const {
+    return reinterpret_cast<const float *>(record_ + traj_offset(getDataSize()));
+}
+
+size_t AcquisitionView::getNumberOfDataElements() const {
+    const AcquisitionHeader &head = getHead();
+    return static_cast<size_t>(head.number_of_samples) * head.active_channels;
+}
+
+size_t AcquisitionView::getNumberOfTrajElements() const {
+    const AcquisitionHeader &head = getHead();
+    return static_cast<size_t>(head.number_of_samples) * head.trajectory_dimensions;
+}
+
+size_t AcquisitionView::getDataSize() const {
+    return getNumberOfDataElements() * sizeof(complex_float_t);
+}
+
+size_t AcquisitionView::getTrajSize() const {
+    return getNumberOfTrajElements() * sizeof(float);
+}
+
+const complex_float_t &AcquisitionView::data(uint16_t sample, uint16_t channel) const {
+    return getDataPtr()[sample + static_cast<size_t>(channel) * getHead().number_of_samples];
+}
+
+const float &AcquisitionView::traj(uint16_t dimension, uint16_t sample) const {
+    return getTrajPtr()[dimension + static_cast<size_t>(sample) * getHead().trajectory_dimensions];
+}
+
+void AcquisitionView::copyTo(Acquisition &acq) const {
+    acq.setHead(getHead());
+    memcpy(acq.getDataPtr(), getDataPtr(), getDataSize());
+    memcpy(acq.getTrajPtr(), getTrajPtr(), getTrajSize());
+}
+
+//
+// AcquisitionRingProducer
+//
+AcquisitionRingProducer::AcquisitionRingProducer(const std::string &name)
+    : map_(NULL), map_size_(0), control_(NULL), records_(NULL), open_(true)
+{
+    control_ = map_ring(name, map_, map_size_);
+    records_ = static_cast<char *>(map_) + RING_RECORDS_OFFSET;
+    control_->producers.fetch_add(1);
+    control_->producers_seen.store(1);
+}
+
+AcquisitionRingProducer::~AcquisitionRingProducer() {
+    close();
+    munmap(map_, map_size_);
+}
+
+void AcquisitionRingProducer::close() {
+    if (open_) {
+        open_ = false;
+        control_->producers.fetch_sub(1);
+    }
+}
+
+bool AcquisitionRingProducer::reserve(uint16_t num_samples, uint16_t active_channels, uint16_t trajectory_dimensions,
+                                      AcquisitionSlot &slot, uint32_t timeout_us) {
+    if (!open_) {
+        throw std::runtime_error("The ring producer is closed");
+    }
+    const uint64_t capacity = control_->capacity;
+    const uint64_t length = record_length(num_samples, active_channels, trajectory_dimensions);
+    // Padding is shorter than the record, so this always fits in an empty ring
+    if (2 * length > capacity || length > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Acquisition is too large for the ring");
+    }
+
+    uint64_t start = control_->head.load(std::memory_order_relaxed);
+    uint64_t end = 0;
+    bool claimed = wait_for([&]() {
+        for (;;) {
+            uint64_t offset = start % capacity;
+            uint64_t padding = offset + length > capacity ? capacity - offset : 0;
+            end = start + padding + length;
+            if (end - control_->tail.load(std::memory_order_acquire) > capacity) {
+                // Full, start is refreshed for the next try
+                start = control_->head.load(std::memory_order_relaxed);
+                return false;
+            }
+            if (control_->head.compare_exchange_weak(start, end, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }, timeout_us);
+    if (!claimed) {
+        return false;
+    }
+
+    uint64_t offset = start % capacity;
+    if (offset + length > capacity) {
+        RecordHeader *pad = reinterpret_cast<RecordHeader *>(records_ + offset);
+        pad->length = static_cast<uint32_t>(capacity - offset);
+        pad->kind = RECORD_PADDING;
+        pad->released = 0;
+        offset = 0;
+    }
+    RecordHeader *record = reinterpret_cast<RecordHeader *>(records_ + offset);
+    record->length = static_cast<uint32_t>(length);
+    record->kind = RECORD_ACQUISITION;
+    record->released = 0;
+
+    char *body = records_ + offset + sizeof(RecordHeader);
+    slot.head = reinterpret_cast<ISMRMRD_AcquisitionHeader *>(body);
+    ismrmrd_init_acquisition_header(slot.head);
+    slot.head->number_of_samples = num_samples;
+    slot.head->active_channels = active_channels;
+    slot.head->available_channels = active_channels;
+    slot.head->trajectory_dimensions = trajectory_dimensions;
+    slot.data = reinterpret_cast<complex_float_t *>(records_ + offset + RECORD_DATA_OFFSET);
+    slot.traj = reinterpret_cast<float *>(records_ + offset +
+        traj_offset(static_cast<size_t>(num_samples) * active_channels * sizeof(complex_float_t)));
+    slot.start_ = start;
+    slot.end_ = end;
+    return true;
+}
+
+void AcquisitionRingProducer::commit(AcquisitionSlot &slot, uint32_t timeout_us) {
+    if (slot.head == NULL) {
+        throw std::runtime_error("The slot has not been reserved");
+    }
+    // Records claimed earlier by other producers are committed first
+    uint64_t start = slot.start_;
+    if (!wait_for([&]() { return control_->published.load(std::memory_order_acquire) == start; }, timeout_us)) {
+        throw std::runtime_error("Timed out waiting for an earlier record to be committed");
+    }
+    control_->published.store(slot.end_, std::memory_order_release);
+    slot = AcquisitionSlot();
+}
+
+void AcquisitionRingProducer::abandon(AcquisitionSlot &slot, uint32_t timeout_us) {
+    if (slot.head == NULL) {
+        throw std::runtime_error("The slot has not been reserved");
+    }
+    // Committed as padding, which the consumer skips
+    RecordHeader *record = reinterpret_cast<RecordHeader *>(reinterpret_cast<char *>(slot.head) - sizeof(RecordHeader));
+    record->kind = RECORD_PADDING;
+    commit(slot, timeout_us);
+}
+
+bool AcquisitionRingProducer::push(const Acquisition &acq, uint32_t timeout_us) {
+    const AcquisitionHeader &head = acq.getHead();
+    AcquisitionSlot slot;
+    if (!reserve(head.number_of_samples, head.active_channels, head.trajectory_dimensions, slot, timeout_us)) {
+        return false;
+    }
+    memcpy(slot.head, &head, sizeof(ISMRMRD_AcquisitionHeader));
+    memcpy(slot.data, acq.getDataPtr(), acq.getDataSize());
+    memcpy(slot.traj, acq.getTrajPtr(), acq.getTrajSize());
+    commit(slot, timeout_us);
+    return true;
+}
+
+//
+// AcquisitionRingConsumer
+//
+AcquisitionRingConsumer::AcquisitionRingConsumer(const std::string &name)
+    : map_(NULL), map_size_(0), control_(NULL), records_(NULL), read_(0), tail_(0)
+{
+    control_ = map_ring(name, map_, map_size_);
+    if (!claim_consumer(*control_)) {
+        munmap(map_, map_size_);
+        throw std::runtime_error("The ring already has a consumer: " + name);
+    }
+    records_ = static_cast<char *>(map_) + RING_RECORDS_OFFSET;
+    tail_ = control_->tail.load(std::memory_order_acquire);
+    read_ = tail_;
+
+    // Records a consumer that died had viewed, but not handed back, are viewed again
+    const uint64_t capacity = control_->capacity;
+    const uint64_t published = control_->published.load(std::memory_order_acquire);
+    for (uint64_t position = tail_; position != published; ) {
+        RecordHeader *record = reinterpret_cast<RecordHeader *>(records_ + position % capacity);
+        record->released = 0;
+        position += record->length;
+    }
+}
+
+AcquisitionRingConsumer::~AcquisitionRingConsumer() {
+    control_->consumer.store(0);
+    munmap(map_, map_size_);
+}
+
+bool AcquisitionRingConsumer::next(AcquisitionView &view, uint32_t timeout_us) {
+    const uint64_t capacity = control_->capacity;
+    for (;;) {
+        bool ready = wait_for([&]() {
+            return control_->published.load(std::memory_order_acquire) != read_ || isFinished();
+        }, timeout_us);
+        if (!ready || control_->published.load(std::memory_order_acquire) == read_) {
+            view.record_ = NULL;
+            return false;
+        }
+        RecordHeader *record = reinterpret_cast<RecordHeader *>(records_ + read_ % capacity);
+        read_ += record->length;
+        if (record->kind == RECORD_ACQUISITION) {
+            view.record_ = reinterpret_cast<const char *>(record);
+            return true;
+        }
+        record->released = 1;
+    }
+}
+
+void AcquisitionRingConsumer::release(AcquisitionView &view) {
+    if (view.record_ == NULL) {
+        throw std::runtime_error("The view is not valid");
+    }
+    RecordHeader *record = reinterpret_cast<RecordHeader *>(const_cast<char *>(view.record_));
+    record->released = 1;
+    view.record_ = NULL;
+
+    // Hand back every released record at the tail
+    const uint64_t capacity = control_->capacity;
+    uint64_t tail = tail_;
+    while (tail != read_) {
+        RecordHeader *oldest = reinterpret_cast<RecordHeader *>(records_ + tail % capacity);
+        if (!oldest->released) {
+            break;
+        }
+        tail += oldest->length;
+    }
+    if (tail != tail_) {
+        tail_ = tail;
+        control_->tail.store(tail, std::memory_order_release);
+    }
+}
+
+bool AcquisitionRingConsumer::isFinished() {
+    return control_->producers_seen.load(std::memory_order_acquire) != 0 &&
+           control_->producers.load(std::memory_order_acquire) == 0 &&
+           control_->published.load(std::memory_order_acquire) == read_;
+}
+
+size_t AcquisitionRingConsumer::pending() {
+    return static_cast<size_t>(control_->published.load(std::memory_order_acquire) - read_);
+}
+
+} // namespace ISMRMRD
+
+#endif // _WIN32
@@ -27,7 +27,7 @@ int ismrmrd_make_consistent_waveform(ISMRMRD_Waveform *wav) {
     data_size = ismrmrd_size_of_waveform_data(wav);
 
     if (data_size > 0) {
-        uint32_t *newPtr = (uint32_t *) (realloc(wav->data, data_size));
+        uint32_t *newPtr = (uint32_t *) (ismrmrd_realloc(wav->data, data_size));
         if (newPtr == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR,
                                     "Failed to realloc acquisition data array");
@@ -44,7 +44,7 @@ int ismrmrd_size_of_waveform_data(const ISMRMRD_Waveform *wav) {
 
 
 ISMRMRD_Waveform *ismrmrd_create_waveform() {
-    ISMRMRD_Waveform *wav = (ISMRMRD_Waveform *) malloc(sizeof(ISMRMRD_Waveform));
+    ISMRMRD_Waveform *wav = (ISMRMRD_Waveform *) ismrmrd_malloc(sizeof(ISMRMRD_Waveform));
     if (wav == NULL) {
         ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc new ISMRMRD_Waveform.");
         return NULL;
@@ -94,8 +94,8 @@ int ismrmrd_free_waveform(ISMRMRD_Waveform* wav) {
 	if (wav == NULL) {
 		return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
 	}
-	free(wav->data);
-	free(wav);
+	ismrmrd_free(wav->data);
+	ismrmrd_free(wav);
 	return ISMRMRD_NOERROR;
 
 }
@@ -1,6 +1,8 @@
 #include "ismrmrd/ismrmrd.h"
 #include "ismrmrd/version.h"
 #include <boost/test/unit_test.hpp>
+#include <type_traits>
+#include <utility>
 
 using namespace ISMRMRD;
 
@@ -167,4 +169,60 @@ static void check_header(ISMRMRD_AcquisitionHeader* chead)
     }
 }
 
+BOOST_AUTO_TEST_CASE(test_acquisition_move)
+{
+    BOOST_CHECK(std::is_nothrow_move_constructible<Acquisition>::value);
+    BOOST_CHECK(std::is_nothrow_move_assignable<Acquisition>::value);
+
+    Acquisition acq(128, 4, 2);
+    acq.scan_counter() = 3;
+    complex_float_t *data = acq.getDataPtr();
+    float *traj = acq.getTrajPtr();
+
+    // Moving hands over the buffers and leaves an empty acquisition
+    Acquisition moved(std::move(acq));
+    BOOST_CHECK_EQUAL(moved.getDataPtr(), data);
+    BOOST_CHECK_EQUAL(moved.getTrajPtr(), traj);
+    BOOST_CHECK_EQUAL(moved.scan_counter(), 3u);
+    BOOST_CHECK(acq.getDataPtr() == NULL);
+    BOOST_CHECK_EQUAL(acq.getNumberOfDataElements(), 0u);
+
+    Acquisition assigned(16);
+    assigned = std::move(moved);
+    BOOST_CHECK_EQUAL(assigned.getDataPtr(), data);
+    BOOST_CHECK(moved.getDataPtr() == NULL);
+
+    Acquisition other(8);
+    complex_float_t *other_data = other.getDataPtr();
+    swap(assigned, other);
+    BOOST_CHECK_EQUAL(assigned.getDataPtr(), other_data);
+    BOOST_CHECK_EQUAL(other.getDataPtr(), data);
+}
+
+BOOST_AUTO_TEST_CASE(test_acquisition_vector_growth_keeps_buffers)
+{
+    // Every payload allocated once, growing the vector moves rather than copies
+    std::vector<Acquisition> acqs;
+    std::vector<const complex_float_t *> buffers;
+    for (uint32_t n = 0; n < 100; n++) {
+        Acquisition acq(256, 8);
+        acq.scan_counter() = n;
+        buffers.push_back(acq.getDataPtr());
+        acqs.push_back(std::move(acq));
+    }
+    for (uint32_t n = 0; n < 100; n++) {
+        BOOST_CHECK_EQUAL(acqs[n].getDataPtr(), buffers[n]);
+        BOOST_CHECK_EQUAL(acqs[n].scan_counter(), n);
+    }
+
+    // As does erasing from the front
+    acqs.erase(acqs.begin());
+    BOOST_CHECK_EQUAL(acqs[0].getDataPtr(), buffers[1]);
+
+    // Copies still own their payload
+    Acquisition copy(acqs[0]);
+    BOOST_CHECK(copy.getDataPtr() != acqs[0].getDataPtr());
+    BOOST_CHECK_EQUAL(copy.getDataSize(), acqs[0].getDataSize());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
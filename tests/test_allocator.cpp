@@ -0,0 +1,270 @@
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/waveform.h"
+#include <boost/test/unit_test.hpp>
+
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace ISMRMRD;
+
+BOOST_AUTO_TEST_SUITE(AllocatorTest)
+
+struct CallCounts {
+    int allocate;
+    int reallocate;
+    int release;
+    int live;
+};
+
+static void *counting_allocate(size_t size, size_t alignment, void *context)
+{
+    CallCounts *counts = static_cast<CallCounts *>(context);
+    (void) alignment;
+    counts->allocate++;
+    counts->live++;
+    return malloc(size);
+}
+
+static void *counting_reallocate(void *ptr, size_t size, size_t alignment, void *context)
+{
+    CallCounts *counts = static_cast<CallCounts *>(context);
+    (void) alignment;
+    counts->reallocate++;
+    if (ptr == NULL) {
+        counts->live++;
+    }
+    return realloc(ptr, size);
+}
+
+static void counting_release(void *ptr, void *context)
+{
+    CallCounts *counts = static_cast<CallCounts *>(context);
+    counts->release++;
+    if (ptr != NULL) {
+        counts->live--;
+    }
+    free(ptr);
+}
+
+// Installs allocator for one test and restores the default afterwards
+struct AllocatorFixture {
+    explicit AllocatorFixture(const ISMRMRD_Allocator &allocator) {
+        BOOST_REQUIRE_EQUAL(ismrmrd_set_allocator(&allocator), ISMRMRD_NOERROR);
+    }
+    ~AllocatorFixture() {
+        ismrmrd_set_allocator(NULL);
+    }
+};
+
+static bool is_aligned(const void *ptr, size_t alignment)
+{
+    return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+}
+
+BOOST_AUTO_TEST_CASE(test_custom_allocator)
+{
+    CallCounts counts = {0, 0, 0, 0};
+    ISMRMRD_Allocator allocator = {counting_allocate, counting_reallocate, counting_release, &counts};
+    ISMRMRD_Allocator incomplete = {counting_allocate, NULL, counting_release, &counts};
+    BOOST_CHECK_EQUAL(ismrmrd_set_allocator(&incomplete), ISMRMRD_RUNTIMEERROR);
+    // Live buffers stay with their allocator and move when resized
+    {
+        Acquisition before(16, 1);
+        {
+            AllocatorFixture fixture(allocator);
+            Acquisition during(16, 1);
+            before.resize(32, 1);
+            BOOST_CHECK_EQUAL(counts.live, 2);
+        }
+        BOOST_CHECK_EQUAL(counts.live, 1);
+    }
+    BOOST_CHECK_EQUAL(counts.live, 0);
+    // Buffers from malloc are released with free
+    ISMRMRD_Acquisition *foreign = ismrmrd_create_acquisition();
+    foreign->data = static_cast<complex_float_t *>(malloc(16 * sizeof(complex_float_t)));
+    BOOST_CHECK_EQUAL(ismrmrd_free_acquisition(foreign), ISMRMRD_NOERROR);
+    {
+        AllocatorFixture fixture(allocator);
+        ISMRMRD_Allocator current;
+        BOOST_CHECK_EQUAL(ismrmrd_get_allocator(&current), ISMRMRD_NOERROR);
+        BOOST_CHECK_EQUAL(current.context, &counts);
+
+        ISMRMRD_Acquisition *cacq = ismrmrd_create_acquisition();
+        cacq->head.number_of_samples = 64;
+        cacq->head.active_channels = 4;
+        cacq->head.trajectory_dimensions = 2;
+        BOOST_CHECK_EQUAL(ismrmrd_make_consistent_acquisition(cacq), ISMRMRD_NOERROR);
+        BOOST_CHECK_EQUAL(counts.live, 3);
+        BOOST_CHECK_EQUAL(ismrmrd_free_acquisition(cacq), ISMRMRD_NOERROR);
+
+        // The C++ classes go through the same functions
+        {
+            Image<float> im(16, 16, 1, 2);
+            im.setAttributeString("attributes");
+            NDArray<complex_float_t> arr(std::vector<size_t>(3, 8));
+            Waveform wav(100, 4);
+            Waveform copy(wav);
+            BOOST_CHECK_EQUAL(counts.live, 5);
+        }
+        BOOST_CHECK_EQUAL(counts.live, 0);
+    }
+    BOOST_CHECK(counts.allocate > 0);
+    BOOST_CHECK(counts.reallocate > 0);
+    BOOST_CHECK(counts.release > 0);
+
+    // The default is back
+    ISMRMRD_Allocator current;
+    ismrmrd_get_allocator(&current);
+    BOOST_CHECK(current.context != &counts);
+    Acquisition acq(32, 2);
+    BOOST_CHECK_EQUAL(counts.live, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_buffer_alignment)
+{
+    BOOST_CHECK_EQUAL(ismrmrd_get_buffer_alignment(), static_cast<size_t>(ISMRMRD_DEFAULT_ALIGNMENT));
+    BOOST_CHECK_EQUAL(ismrmrd_set_buffer_alignment(48), ISMRMRD_RUNTIMEERROR);
+    BOOST_CHECK_EQUAL(ismrmrd_set_buffer_alignment(2), ISMRMRD_RUNTIMEERROR);
+
+    // Odd sizes are aligned, and stay aligned through resizes and copies
+    Acquisition acq(123, 3, 2);
+    BOOST_CHECK(acq.isAligned());
+    for (uint16_t n = 1; n < 50; n++) {
+        acq.resize(static_cast<uint16_t>(123 + 37 * n), 3, 2);
+        BOOST_REQUIRE(acq.isAligned());
+    }
+    Acquisition acq_copy(acq);
+    BOOST_CHECK(acq_copy.isAligned());
+
+    Image<complex_float_t> im(17, 9, 3, 1);
+    BOOST_CHECK(im.isAligned());
+    im.resize(101, 33, 1, 5);
+    Image<complex_float_t> im_copy;
+    im_copy = im;
+    BOOST_CHECK(im.isAligned());
+    BOOST_CHECK(im_copy.isAligned());
+
+    NDArray<float> arr(std::vector<size_t>(2, 7));
+    BOOST_CHECK(arr.isAligned());
+    BOOST_CHECK(is_aligned(arr.getDataPtr(), 64));
+
+    Waveform wav(77, 3);
+    BOOST_CHECK(is_aligned(wav.data, 64));
+
+    // Resizing moves the contents to an aligned block
+    unsigned char *bytes = static_cast<unsigned char *>(ismrmrd_malloc(100));
+    BOOST_REQUIRE(bytes != NULL);
+    for (int n = 0; n < 100; n++) {
+        bytes[n] = static_cast<unsigned char>(n);
+    }
+    for (size_t size = 1000; size <= 1000000; size *= 10) {
+        bytes = static_cast<unsigned char *>(ismrmrd_realloc(bytes, size));
+        BOOST_REQUIRE(bytes != NULL);
+        BOOST_CHECK(is_aligned(bytes, 64));
+        BOOST_CHECK_EQUAL(bytes[99], 99);
+    }
+    ismrmrd_free(bytes);
+
+    // A page, for buffers handed to devices
+    BOOST_REQUIRE_EQUAL(ismrmrd_set_buffer_alignment(4096), ISMRMRD_NOERROR);
+    arr.resize(std::vector<size_t>(3, 31));
+    BOOST_CHECK(arr.isAligned());
+    BOOST_CHECK(is_aligned(arr.getDataPtr(), 4096));
+    NDArray<float> arr_copy(arr);
+    BOOST_CHECK(is_aligned(arr_copy.getDataPtr(), 4096));
+    BOOST_CHECK(!ismrmrd_is_aligned(reinterpret_cast<const char *>(arr.getDataPtr()) + 64, 4096));
+    BOOST_CHECK_EQUAL(ismrmrd_set_buffer_alignment(ISMRMRD_DEFAULT_ALIGNMENT), ISMRMRD_NOERROR);
+}
+
+BOOST_AUTO_TEST_CASE(test_pool_allocator_reuse)
+{
+    ISMRMRD_Allocator pool;
+    BOOST_REQUIRE_EQUAL(ismrmrd_create_pool_allocator(&pool, 64 << 20), ISMRMRD_NOERROR);
+    // The pool cannot align to more than 64 bytes
+    BOOST_REQUIRE_EQUAL(ismrmrd_set_buffer_alignment(128), ISMRMRD_NOERROR);
+    BOOST_CHECK_EQUAL(ismrmrd_set_allocator(&pool), ISMRMRD_RUNTIMEERROR);
+    BOOST_REQUIRE_EQUAL(ismrmrd_set_buffer_alignment(ISMRMRD_DEFAULT_ALIGNMENT), ISMRMRD_NOERROR);
+    {
+        AllocatorFixture fixture(pool);
+        BOOST_CHECK_EQUAL(ismrmrd_destroy_pool_allocator(&pool), ISMRMRD_RUNTIMEERROR);
+        BOOST_CHECK_EQUAL(ismrmrd_set_buffer_alignment(128), ISMRMRD_RUNTIMEERROR);
+
+        // Identical readouts get the blocks of the previous ones back
+        const complex_float_t *first = NULL;
+        for (int n = 0; n < 100; n++) {
+            Acquisition acq(512, 32, 3);
+            BOOST_CHECK(is_aligned(acq.getDataPtr(), 64));
+            BOOST_CHECK(is_aligned(acq.getTrajPtr(), 64));
+            if (n == 0) {
+                first = acq.getDataPtr();
+            } else {
+                BOOST_CHECK_EQUAL(acq.getDataPtr(), first);
+            }
+        }
+        ISMRMRD_PoolAllocatorStats stats;
+        BOOST_REQUIRE_EQUAL(ismrmrd_get_pool_allocator_stats(&pool, &stats), ISMRMRD_NOERROR);
+        BOOST_CHECK(stats.reused >= 99 * 2);
+        BOOST_CHECK(stats.cached_bytes >= 512 * 32 * sizeof(complex_float_t));
+
+        // Resizing keeps the contents, into a bigger block when needed
+        Acquisition acq(100, 1);
+        for (uint16_t s = 0; s < 100; s++) {
+            acq.data(s, 0) = complex_float_t(s, -s);
+        }
+        acq.resize(100, 8);
+        BOOST_CHECK_EQUAL(acq.data(99, 0), complex_float_t(99, -99));
+        acq.resize(60000, 8);
+        BOOST_CHECK(is_aligned(acq.getDataPtr(), 64));
+        BOOST_CHECK_EQUAL(acq.data(99, 0), complex_float_t(99, -99));
+    }
+    // Not while a block of the pool is live
+    {
+        void *kept = NULL;
+        {
+            AllocatorFixture fixture(pool);
+            kept = ismrmrd_malloc(256);
+        }
+        BOOST_CHECK_EQUAL(ismrmrd_destroy_pool_allocator(&pool), ISMRMRD_RUNTIMEERROR);
+        ismrmrd_free(kept);
+    }
+    BOOST_CHECK_EQUAL(ismrmrd_destroy_pool_allocator(&pool), ISMRMRD_NOERROR);
+    BOOST_CHECK(pool.context == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(test_pool_allocator_threads)
+{
+    ISMRMRD_Allocator pool;
+    BOOST_REQUIRE_EQUAL(ismrmrd_create_pool_allocator(&pool, 256 << 20), ISMRMRD_NOERROR);
+    {
+        AllocatorFixture fixture(pool);
+        // Boost checks are not thread safe, the threads count the mismatches
+        std::atomic<int> mismatches(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.push_back(std::thread([t, &mismatches]() {
+                std::vector<Acquisition> acqs(16);
+                for (int n = 0; n < 5000; n++) {
+                    Acquisition &acq = acqs[n % acqs.size()];
+                    acq.resize(static_cast<uint16_t>(128 << (n % 3)), 16);
+                    complex_float_t value(static_cast<float>(t), static_cast<float>(n));
+                    acq.data(acq.number_of_samples() - 1, 15) = value;
+                    if (acq.data(acq.number_of_samples() - 1, 15) != value) {
+                        mismatches++;
+                    }
+                }
+            }));
+        }
+        for (size_t n = 0; n < threads.size(); n++) {
+            threads[n].join();
+        }
+        BOOST_CHECK_EQUAL(mismatches, 0);
+        ISMRMRD_PoolAllocatorStats stats;
+        ismrmrd_get_pool_allocator_stats(&pool, &stats);
+        BOOST_CHECK(stats.reused > stats.allocations / 2);
+    }
+    BOOST_CHECK_EQUAL(ismrmrd_destroy_pool_allocator(&pool), ISMRMRD_NOERROR);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
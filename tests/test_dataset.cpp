@@ -0,0 +1,1352 @@
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ISMRMRD;
+
+static const char *test_filename = "test_dataset.h5";
+
+struct DatasetFixture {
+    DatasetFixture() { std::remove(test_filename); }
+    ~DatasetFixture() { std::remove(test_filename); }
+};
+
+static Acquisition make_acquisition(uint32_t counter, uint16_t samples, uint16_t channels, uint16_t trajdims)
+{
+    Acquisition acq(samples, channels, trajdims);
+    acq.scan_counter() = counter;
+    for (uint16_t c = 0; c < channels; c++) {
+        for (uint16_t s = 0; s < samples; s++) {
+            acq.data(s, c) = complex_float_t(float(counter), float(s + c * samples));
+        }
+    }
+    for (uint16_t s = 0; s < samples; s++) {
+        for (uint16_t d = 0; d < trajdims; d++) {
+            acq.traj(d, s) = float(counter + s);
+        }
+    }
+    return acq;
+}
+
+static void check_acquisition(Acquisition &acq, uint32_t counter, uint16_t samples, uint16_t channels, uint16_t trajdims)
+{
+    BOOST_CHECK_EQUAL(acq.scan_counter(), counter);
+    BOOST_CHECK_EQUAL(acq.number_of_samples(), samples);
+    BOOST_CHECK_EQUAL(acq.active_channels(), channels);
+    BOOST_CHECK_EQUAL(acq.trajectory_dimensions(), trajdims);
+    BOOST_CHECK(acq.data(samples - 1, channels - 1) ==
+                complex_float_t(float(counter), float(samples - 1 + (channels - 1) * samples)));
+    if (trajdims > 0) {
+        BOOST_CHECK_EQUAL(acq.traj(trajdims - 1, samples - 1), float(counter + samples - 1));
+    }
+}
+
+BOOST_FIXTURE_TEST_SUITE(DatasetTest, DatasetFixture)
+
+BOOST_AUTO_TEST_CASE(test_dataset_append_acquisitions)
+{
+    {
+        Dataset d(test_filename, "dataset", true);
+        d.appendAcquisition(make_acquisition(0, 64, 4, 2));
+
+        std::vector<Acquisition> batch;
+        for (uint32_t n = 1; n < 10; n++) {
+            batch.push_back(make_acquisition(n, 64, 4, 2));
+        }
+        d.appendAcquisitions(batch);
+        d.appendAcquisitions(std::vector<Acquisition>());
+        BOOST_CHECK_EQUAL(d.getNumberOfAcquisitions(), 10);
+    }
+
+    Dataset d(test_filename, "dataset", false);
+    BOOST_CHECK_EQUAL(d.getNumberOfAcquisitions(), 10);
+    Acquisition acq;
+    for (uint32_t n = 0; n < 10; n++) {
+        d.readAcquisition(n, acq);
+        check_acquisition(acq, n, 64, 4, 2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_read_acquisitions)
+{
+    {
+        Dataset d(test_filename, "dataset", true);
+        std::vector<Acquisition> batch;
+        for (uint32_t n = 0; n < 20; n++) {
+            batch.push_back(make_acquisition(n, 32 + n, 2, n % 3));
+        }
+        d.appendAcquisitions(batch);
+    }
+
+    Dataset d(test_filename, "dataset", false);
+    std::vector<Acquisition> acqs;
+    d.readAcquisitions(5, 10, acqs);
+    BOOST_CHECK_EQUAL(acqs.size(), 10);
+    for (uint32_t n = 0; n < acqs.size(); n++) {
+        check_acquisition(acqs[n], n + 5, 32 + n + 5, 2, (n + 5) % 3);
+    }
+
+    // Reading into already sized acquisitions reuses them
+    d.readAcquisitions(0, 20, acqs);
+    BOOST_CHECK_EQUAL(acqs.size(), 20);
+    for (uint32_t n = 0; n < acqs.size(); n++) {
+        check_acquisition(acqs[n], n, 32 + n, 2, n % 3);
+    }
+
+    BOOST_CHECK_THROW(d.readAcquisitions(15, 10, acqs), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_interleaved_access)
+{
+    // Appends and reads on several variables share one open dataset
+    Dataset d(test_filename, "dataset", true);
+    std::vector<size_t> dims(2);
+    dims[0] = 8;
+    dims[1] = 4;
+    NDArray<float> arr(dims);
+    for (uint32_t n = 0; n < 5; n++) {
+        d.appendAcquisition(make_acquisition(n, 16, 2, 0));
+        std::fill(arr.begin(), arr.end(), float(n));
+        d.appendNDArray("floats", arr);
+        d.appendNDArray("more_floats", arr);
+        BOOST_CHECK_EQUAL(d.getNumberOfAcquisitions(), n + 1);
+        BOOST_CHECK_EQUAL(d.getNumberOfNDArrays("floats"), n + 1);
+
+        Acquisition acq;
+        d.readAcquisition(n, acq);
+        check_acquisition(acq, n, 16, 2, 0);
+    }
+    BOOST_CHECK_EQUAL(d.getNumberOfNDArrays("more_floats"), 5);
+    BOOST_CHECK_EQUAL(d.getNumberOfNDArrays("missing"), 0);
+
+    NDArray<float> out;
+    d.readNDArray("floats", 3, out);
+    BOOST_CHECK_EQUAL(out.getNDim(), 2);
+    BOOST_CHECK_EQUAL(out.getDims()[0], 8);
+    BOOST_CHECK_EQUAL(out.getDims()[1], 4);
+    BOOST_CHECK_EQUAL(out(7, 3), 3.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_read_acquisition_reuses_buffers)
+{
+    {
+        Dataset d(test_filename, "dataset", true);
+        std::vector<Acquisition> batch;
+        for (uint32_t n = 0; n < 8; n++) {
+            batch.push_back(make_acquisition(n, 128, 8, 2));
+        }
+        batch.push_back(make_acquisition(8, 128, 8, 0));
+        batch.push_back(make_acquisition(9, 128, 8, 2));
+        d.appendAcquisitions(batch);
+    }
+
+    Dataset d(test_filename, "dataset", false);
+    Acquisition acq;
+    d.readAcquisition(0, acq);
+    check_acquisition(acq, 0, 128, 8, 2);
+    const complex_float_t *data = acq.getDataPtr();
+    const float *traj = acq.getTrajPtr();
+    for (uint32_t n = 1; n < 8; n++) {
+        d.readAcquisition(n, acq);
+        check_acquisition(acq, n, 128, 8, 2);
+        BOOST_CHECK_EQUAL(acq.getDataPtr(), data);
+        BOOST_CHECK_EQUAL(acq.getTrajPtr(), traj);
+    }
+
+    // An acquisition without trajectory keeps its buffers for the next read
+    d.readAcquisition(8, acq);
+    check_acquisition(acq, 8, 128, 8, 0);
+    d.readAcquisition(9, acq);
+    check_acquisition(acq, 9, 128, 8, 2);
+
+    BOOST_CHECK_THROW(d.readAcquisition(10, acq), std::runtime_error);
+    check_acquisition(acq, 9, 128, 8, 2);
+}
+
+// Forwards to the default allocator and counts the calls that allocate
+struct AllocationCounter {
+    AllocationCounter() : allocations(0) {
+        ismrmrd_get_allocator(&forward);
+        ISMRMRD_Allocator counting = {allocate, reallocate, release, this};
+        BOOST_REQUIRE_EQUAL(ismrmrd_set_allocator(&counting), ISMRMRD_NOERROR);
+    }
+    ~AllocationCounter() { ismrmrd_set_allocator(NULL); }
+
+    static void *allocate(size_t size, size_t alignment, void *context) {
+        AllocationCounter *counter = static_cast<AllocationCounter *>(context);
+        counter->allocations++;
+        return counter->forward.allocate(size, alignment, counter->forward.context);
+    }
+    static void *reallocate(void *ptr, size_t size, size_t alignment, void *context) {
+        AllocationCounter *counter = static_cast<AllocationCounter *>(context);
+        counter->allocations++;
+        return counter->forward.reallocate(ptr, size, alignment, counter->forward.context);
+    }
+    static void release(void *ptr, void *context) {
+        AllocationCounter *counter = static_cast<AllocationCounter *>(context);
+        counter->forward.release(ptr, counter->forward.context);
+    }
+
+    ISMRMRD_Allocator forward;
+    int allocations;
+};
+
+BOOST_AUTO_TEST_CASE(test_dataset_read_acquisitions_reuses_buffers)
+{
+    {
+        Dataset d(test_filename, "dataset", true);
+        std::vector<Acquisition> batch;
+        for (uint32_t n = 0; n < 16; n++) {
+            batch.push_back(make_acquisition(n, 256, 16, 0));
+        }
+        for (uint32_t n = 16; n < 32; n++) {
+            batch.push_back(make_acquisition(n, 256, 16, 2));
+        }
+        d.appendAcquisitions(batch);
+    }
+
+    AllocationCounter counter;
+    {
+        Dataset d(test_filename, "dataset", false);
+        for (uint32_t first = 0; first < 32; first += 16) {
+            uint16_t trajdims = first == 0 ? 0 : 2;
+            std::vector<Acquisition> acqs;
+            d.readAcquisitions(first, 8, acqs);
+            std::vector<const complex_float_t *> data;
+            std::vector<const float *> traj;
+            for (uint32_t n = 0; n < 8; n++) {
+                check_acquisition(acqs[n], first + n, 256, 16, trajdims);
+                data.push_back(acqs[n].getDataPtr());
+                traj.push_back(acqs[n].getTrajPtr());
+            }
+
+            // Batches of the same shape decode into the buffers of the last one
+            int allocations = counter.allocations;
+            d.readAcquisitions(first + 8, 8, acqs);
+            BOOST_CHECK_EQUAL(counter.allocations, allocations);
+            for (uint32_t n = 0; n < 8; n++) {
+                check_acquisition(acqs[n], first + 8 + n, 256, 16, trajdims);
+                BOOST_CHECK_EQUAL(acqs[n].getDataPtr(), data[n]);
+                BOOST_CHECK_EQUAL(acqs[n].getTrajPtr(), traj[n]);
+            }
+        }
+
+        // As do single reads without a trajectory
+        Acquisition acq;
+        d.readAcquisition(0, acq);
+        int allocations = counter.allocations;
+        for (uint32_t n = 1; n < 16; n++) {
+            d.readAcquisition(n, acq);
+            check_acquisition(acq, n, 256, 16, 0);
+        }
+        BOOST_CHECK_EQUAL(counter.allocations, allocations);
+        BOOST_CHECK(acq.getTrajPtr() == NULL);
+    }
+}
+
+static hsize_t chunk_elements(const char *path)
+{
+    hid_t file = H5Fopen(test_filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t dataset = H5Dopen2(file, path, H5P_DEFAULT);
+    hid_t props = H5Dget_create_plist(dataset);
+    hsize_t chunk[ISMRMRD_NDARRAY_MAXDIM + 1] = {0};
+    H5Pget_chunk(props, ISMRMRD_NDARRAY_MAXDIM + 1, chunk);
+    H5Pclose(props);
+    H5Dclose(dataset);
+    H5Fclose(file);
+    return chunk[0];
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_storage_policy)
+{
+    std::vector<size_t> dims(2);
+    dims[0] = 16;
+    dims[1] = 4;
+    NDArray<float> arr(dims);
+    {
+        Dataset d(test_filename, "dataset", true);
+        ISMRMRD_StoragePolicy group, data;
+        ismrmrd_init_storage_policy(&group);
+        ismrmrd_init_storage_policy(&data);
+        group.chunk_elements = 5;
+        data.chunk_elements = 7;
+        data.chunk_cache_bytes = 4 * 1024 * 1024;
+        data.alloc_time = ISMRMRD_ALLOC_TIME_EARLY;
+        d.setStoragePolicy("", group);
+        d.setStoragePolicy("data", data);
+
+        for (uint32_t n = 0; n < 10; n++) {
+            d.appendAcquisition(make_acquisition(n, 32, 2, 0));
+            d.appendNDArray("floats", arr);
+        }
+        BOOST_CHECK_EQUAL(d.getNumberOfAcquisitions(), 10);
+
+        data.alloc_time = 42;
+        BOOST_CHECK_THROW(d.setStoragePolicy("data", data), std::runtime_error);
+    }
+    BOOST_CHECK_EQUAL(chunk_elements("/dataset/data"), 7);
+    BOOST_CHECK_EQUAL(chunk_elements("/dataset/floats"), 5);
+
+    {
+        Dataset d(test_filename, "dataset", true);
+        d.appendNDArray("auto", arr);
+    }
+    // Without a chunk size every chunk holds one element as in earlier versions
+    BOOST_CHECK_EQUAL(chunk_elements("/dataset/auto"), 1);
+    BOOST_CHECK_EQUAL(ismrmrd_suggested_chunk_elements(16 * 4 * sizeof(float)), 256);
+    BOOST_CHECK_EQUAL(ismrmrd_suggested_chunk_elements(1024 * 1024), 1);
+
+    // The policy does not change how the data reads back
+    Dataset d(test_filename, "dataset", false);
+    Acquisition acq;
+    d.readAcquisition(9, acq);
+    check_acquisition(acq, 9, 32, 2, 0);
+}
+
+// An HDF5 filter whose can_apply callback refuses every dataset
+static htri_t rejecting_can_apply(hid_t, hid_t, hid_t)
+{
+    return 0;
+}
+
+static size_t rejecting_filter(unsigned int, size_t, const unsigned int *, size_t nbytes, size_t *, void **)
+{
+    return nbytes;
+}
+
+static uint32_t register_rejecting_filter()
+{
+    const H5Z_filter_t id = 32100;
+    H5Z_class2_t filter = {H5Z_CLASS_T_VERS, id, 1, 1, "ismrmrd test rejecting filter",
+                           rejecting_can_apply, NULL, rejecting_filter};
+    BOOST_REQUIRE(H5Zregister(&filter) >= 0);
+    return id;
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_compression)
+{
+    std::vector<size_t> dims(2);
+    dims[0] = 256;
+    dims[1] = 64;
+    NDArray<float> arr(dims);
+    for (size_t n = 0; n < arr.getNumberOfElements(); n++) {
+        arr.getDataPtr()[n] = float(n % 16);
+    }
+    const size_t raw_bytes = 20 * arr.getDataSize();
+
+    ISMRMRD_StoragePolicy policy;
+    ismrmrd_init_storage_policy(&policy);
+    policy.shuffle = 1;
+    policy.deflate_level = 6;
+    {
+        Dataset d(test_filename, "dataset", true, policy);
+        for (uint32_t n = 0; n < 20; n++) {
+            d.appendNDArray("floats", arr);
+        }
+    }
+    std::ifstream f(test_filename, std::ios::binary | std::ios::ate);
+    BOOST_CHECK_LT(size_t(f.tellg()), raw_bytes / 4);
+
+    // Reading is transparent
+    {
+        Dataset d(test_filename, "dataset", false);
+        NDArray<float> out;
+        d.readNDArray("floats", 19, out);
+        BOOST_CHECK(std::equal(arr.begin(), arr.end(), out.begin()));
+    }
+
+    // A filter plugin takes the place of deflate, checksum stands in for a compressor
+    policy.filter_id = H5Z_FILTER_FLETCHER32;
+    {
+        Dataset plugin(test_filename, "dataset", true, policy);
+        plugin.appendNDArray("checked", arr);
+    }
+    hid_t file = H5Fopen(test_filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t dataset = H5Dopen2(file, "/dataset/checked", H5P_DEFAULT);
+    hid_t props = H5Dget_create_plist(dataset);
+    BOOST_CHECK_EQUAL(H5Pget_nfilters(props), 2);
+    unsigned int flags = 0;
+    size_t nvalues = 0;
+    BOOST_CHECK_EQUAL(H5Pget_filter2(props, 1, &flags, &nvalues, NULL, 0, NULL, NULL), H5Z_FILTER_FLETCHER32);
+    H5Pclose(props);
+    H5Dclose(dataset);
+    H5Fclose(file);
+
+    // A filter that refuses the variable fails the append instead of being dropped
+    {
+        Dataset refused(test_filename, "dataset", true);
+        ISMRMRD_StoragePolicy rejecting;
+        ismrmrd_init_storage_policy(&rejecting);
+        rejecting.filter_id = register_rejecting_filter();
+        rejecting.alloc_time = ISMRMRD_ALLOC_TIME_EARLY;
+        refused.setStoragePolicy("refused", rejecting);
+        BOOST_CHECK_THROW(refused.appendNDArray("refused", arr), std::runtime_error);
+        BOOST_CHECK_EQUAL(refused.getNumberOfNDArrays("refused"), 0u);
+    }
+
+    // Unknown filter plugins are rejected up front
+    Dataset d(test_filename, "dataset", false);
+    policy.filter_id = 31999;
+    BOOST_CHECK_THROW(d.setStoragePolicy("other", policy), std::runtime_error);
+    policy.filter_id = 0;
+    policy.deflate_level = 10;
+    BOOST_CHECK_THROW(d.setStoragePolicy("other", policy), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_read_acquisition_headers)
+{
+    {
+        Dataset d(test_filename, "dataset", true);
+        std::vector<Acquisition> batch;
+        for (uint32_t n = 0; n < 12; n++) {
+            batch.push_back(make_acquisition(n, 16 + n, 2, n % 2));
+            batch.back().idx().slice = uint16_t(n % 3);
+        }
+        d.appendAcquisitions(batch);
+    }
+
+    Dataset d(test_filename, "dataset", false);
+    std::vector<AcquisitionHeader> heads;
+    d.readAcquisitionHeaders(2, 10, heads);
+    BOOST_CHECK_EQUAL(heads.size(), 10);
+    for (uint32_t n = 0; n < heads.size(); n++) {
+        BOOST_CHECK_EQUAL(heads[n].scan_counter, n + 2);
+        BOOST_CHECK_EQUAL(heads[n].number_of_samples, 16 + n + 2);
+        BOOST_CHECK_EQUAL(heads[n].trajectory_dimensions, (n + 2) % 2);
+        BOOST_CHECK_EQUAL(heads[n].idx.slice, (n + 2) % 3);
+    }
+
+    BOOST_CHECK_THROW(d.readAcquisitionHeaders(3, 10, heads), std::runtime_error);
+}
+
+static Acquisition make_indexed_acquisition(uint32_t n)
+{
+    Acquisition acq = make_acquisition(n, 8, 1, 0);
+    acq.idx().slice = uint16_t(n % 6);
+    acq.idx().repetition = uint16_t((n / 6) % 5);
+    acq.idx().kspace_encode_step_1 = uint16_t(n / 30);
+    if (n % 10 == 0) {
+        acq.setFlag(ISMRMRD_ACQ_IS_NOISE_MEASUREMENT);
+    }
+    return acq;
+}
+
+static std::vector<uint32_t> expected_indices(uint32_t total, int slice, int repetition, int e1, bool noise)
+{
+    std::vector<uint32_t> indices;
+    for (uint32_t n = 0; n < total; n++) {
+        if ((slice < 0 || int(n % 6) == slice) && (repetition < 0 || int((n / 6) % 5) == repetition) &&
+            (e1 < 0 || int(n / 30) == e1) && (!noise || n % 10 == 0)) {
+            indices.push_back(n);
+        }
+    }
+    return indices;
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_acquisition_index)
+{
+    {
+        Dataset d(test_filename, "dataset", true);
+        std::vector<Acquisition> batch;
+        for (uint32_t n = 0; n < 60; n++) {
+            batch.push_back(make_indexed_acquisition(n));
+        }
+        d.appendAcquisitions(batch);
+        BOOST_CHECK(!d.hasAcquisitionIndex());
+        ISMRMRD_AcquisitionIndexQuery query;
+        ismrmrd_init_acquisition_index_query(&query);
+        BOOST_CHECK_THROW(d.queryAcquisitionIndex(query), std::runtime_error);
+        // A user variable called index is not the acquisition index
+        d.appendNDArray("index", NDArray<float>(std::vector<size_t>(1, 4)));
+        d.updateAcquisitionIndex();
+        BOOST_CHECK(d.hasAcquisitionIndex());
+        BOOST_CHECK_EQUAL(d.getNumberOfNDArrays("index"), 1u);
+    }
+
+    {
+        Dataset d(test_filename, "dataset", true);
+        BOOST_CHECK(d.hasAcquisitionIndex());
+        ISMRMRD_AcquisitionIndexQuery query;
+        ismrmrd_init_acquisition_index_query(&query);
+        BOOST_CHECK(d.queryAcquisitionIndex(query) == expected_indices(60, -1, -1, -1, false));
+
+        query.slice = 3;
+        BOOST_CHECK(d.queryAcquisitionIndex(query) == expected_indices(60, 3, -1, -1, false));
+        query.repetition = 2;
+        BOOST_CHECK(d.queryAcquisitionIndex(query) == expected_indices(60, 3, 2, -1, false));
+        query.slice = ISMRMRD_INDEX_ANY;
+        BOOST_CHECK(d.queryAcquisitionIndex(query) == expected_indices(60, -1, 2, -1, false));
+        query.kspace_encode_step_1 = 1;
+        BOOST_CHECK(d.queryAcquisitionIndex(query) == expected_indices(60, -1, 2, 1, false));
+
+        ismrmrd_init_acquisition_index_query(&query);
+        ismrmrd_set_flag(&query.flags_set, ISMRMRD_ACQ_IS_NOISE_MEASUREMENT);
+        BOOST_CHECK(d.queryAcquisitionIndex(query) == expected_indices(60, -1, -1, -1, true));
+        query.slice = 7;
+        BOOST_CHECK(d.queryAcquisitionIndex(query).empty());
+
+        // Appending to an indexed dataset extends the index
+        for (uint32_t n = 60; n < 90; n++) {
+            d.appendAcquisition(make_indexed_acquisition(n));
+        }
+        ismrmrd_init_acquisition_index_query(&query);
+        query.slice = 4;
+        BOOST_CHECK(d.queryAcquisitionIndex(query) == expected_indices(90, 4, -1, -1, false));
+    }
+
+    Dataset d(test_filename, "dataset", false);
+    ISMRMRD_AcquisitionIndexQuery query;
+    ismrmrd_init_acquisition_index_query(&query);
+    query.slice = 5;
+    query.repetition = 4;
+    BOOST_CHECK(d.queryAcquisitionIndex(query) == expected_indices(90, 5, 4, -1, false));
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_acquisition_index_behind)
+{
+    // An index of the first 50 acquisitions, kept aside while 40 more are appended
+    {
+        Dataset d(test_filename, "dataset", true);
+        for (uint32_t n = 0; n < 50; n++) {
+            d.appendAcquisition(make_indexed_acquisition(n));
+        }
+        d.updateAcquisitionIndex();
+    }
+    {
+        hid_t file = H5Fopen(test_filename, H5F_ACC_RDWR, H5P_DEFAULT);
+        BOOST_REQUIRE(H5Ocopy(file, "/dataset/ismrmrd_index", file, "/behind", H5P_DEFAULT, H5P_DEFAULT) >= 0);
+        H5Fclose(file);
+    }
+    {
+        Dataset d(test_filename, "dataset", true);
+        for (uint32_t n = 50; n < 90; n++) {
+            d.appendAcquisition(make_indexed_acquisition(n));
+        }
+    }
+    {
+        // As if a program that does not know the index had appended them
+        hid_t file = H5Fopen(test_filename, H5F_ACC_RDWR, H5P_DEFAULT);
+        BOOST_REQUIRE(H5Ldelete(file, "/dataset/ismrmrd_index", H5P_DEFAULT) >= 0);
+        BOOST_REQUIRE(H5Lmove(file, "/behind", file, "/dataset/ismrmrd_index", H5P_DEFAULT, H5P_DEFAULT) >= 0);
+        H5Fclose(file);
+    }
+
+    // A query catches up, also on a read-only file
+    ISMRMRD_DatasetOptions options;
+    ismrmrd_init_dataset_options(&options);
+    options.read_only = true;
+    {
+        Dataset d(test_filename, "dataset", options);
+        ISMRMRD_AcquisitionIndexQuery query;
+        ismrmrd_init_acquisition_index_query(&query);
+        query.slice = 4;
+        BOOST_CHECK(d.queryAcquisitionIndex(query) == expected_indices(90, 4, -1, -1, false));
+    }
+
+    // and writes the complete index back when it can
+    {
+        Dataset d(test_filename, "dataset", false);
+        ISMRMRD_AcquisitionIndexQuery query;
+        ismrmrd_init_acquisition_index_query(&query);
+        BOOST_CHECK(d.queryAcquisitionIndex(query) == expected_indices(90, -1, -1, -1, false));
+    }
+    hid_t file = H5Fopen(test_filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t dataset = H5Dopen2(file, "/dataset/ismrmrd_index", H5P_DEFAULT);
+    hid_t space = H5Dget_space(dataset);
+    BOOST_CHECK_EQUAL(H5Sget_simple_extent_npoints(space), 90);
+    H5Sclose(space);
+    H5Dclose(dataset);
+    H5Fclose(file);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_acquisition_stream)
+{
+    {
+        Dataset d(test_filename, "dataset", true);
+        std::vector<Acquisition> batch;
+        for (uint32_t n = 0; n < 50; n++) {
+            batch.push_back(make_acquisition(n, 16 + n % 5, 2, n % 3));
+        }
+        d.appendAcquisitions(batch);
+    }
+
+    // A ring smaller than the dataset, the reader has to wait for the consumer
+    {
+        AcquisitionStream stream(test_filename, "dataset", 4, 2);
+        BOOST_CHECK_EQUAL(stream.size(), 50);
+        Acquisition acq;
+        uint32_t n = 0;
+        while (stream.next(acq)) {
+            check_acquisition(acq, n, 16 + n % 5, 2, n % 3);
+            n++;
+        }
+        BOOST_CHECK_EQUAL(n, 50);
+        BOOST_CHECK(!stream.next(acq));
+
+        AcquisitionStreamStats stats = stream.stats();
+        BOOST_CHECK_EQUAL(stats.acquisitions, 50);
+        BOOST_CHECK_EQUAL(stats.batches, 13);
+        BOOST_CHECK(stats.overlap() >= 0.0 && stats.overlap() <= 1.0);
+    }
+
+    // A range, clamped to the end of the dataset
+    {
+        AcquisitionStream stream(test_filename, "dataset", 45, 10, 3, 2);
+        BOOST_CHECK_EQUAL(stream.size(), 5);
+        Acquisition acq;
+        for (uint32_t n = 45; n < 50; n++) {
+            BOOST_REQUIRE(stream.next(acq));
+            check_acquisition(acq, n, 16 + n % 5, 2, n % 3);
+        }
+        BOOST_CHECK(!stream.next(acq));
+    }
+
+    // The consumer reads the file itself while the stream is open
+    {
+        AcquisitionStream stream(test_filename, "dataset", 4, 2);
+        Dataset d(test_filename, "dataset", false);
+        Acquisition acq;
+        Acquisition direct;
+        uint32_t n = 0;
+        while (stream.next(acq)) {
+            d.readAcquisition(n, direct);
+            check_acquisition(direct, n, 16 + n % 5, 2, n % 3);
+            n++;
+        }
+        BOOST_CHECK_EQUAL(n, 50);
+    }
+
+    // Stopping early with the reader blocked on a full ring
+    {
+        AcquisitionStream stream(test_filename, "dataset", 2, 1);
+        Acquisition acq;
+        BOOST_REQUIRE(stream.next(acq));
+        stream.stop();
+        BOOST_CHECK(!stream.next(acq));
+    }
+
+    BOOST_CHECK_THROW(AcquisitionStream(test_filename, "dataset", 0, 4), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_async_writer)
+{
+    {
+        // A queue smaller than the number of items, appends have to wait
+        AsyncWriter writer(test_filename, "dataset", 8);
+        for (uint32_t n = 0; n < 100; n++) {
+            Acquisition acq = make_acquisition(n, 32, 2, n % 3);
+            writer.append(std::move(acq));
+            BOOST_CHECK_EQUAL(acq.getDataSize(), 0);
+            if (n % 10 == 0) {
+                Waveform wav(16, 2);
+                std::fill(wav.begin_data(), wav.end_data(), n);
+                writer.append(std::move(wav));
+            }
+            if (n == 49) {
+                writer.flush();
+                AsyncWriterStats stats = writer.stats();
+                BOOST_CHECK_EQUAL(stats.acquisitions, 50);
+                BOOST_CHECK_EQUAL(stats.waveforms, 5);
+                // The producer reads the file itself while the writer is open
+                Dataset d(test_filename, "dataset", false);
+                BOOST_CHECK_EQUAL(d.getNumberOfAcquisitions(), 50);
+            }
+        }
+        writer.close();
+
+        AsyncWriterStats stats = writer.stats();
+        BOOST_CHECK_EQUAL(stats.acquisitions, 100);
+        BOOST_CHECK_EQUAL(stats.waveforms, 10);
+        BOOST_CHECK(stats.max_queued <= 8);
+        uint64_t latencies = 0;
+        for (int k = 0; k < AsyncWriterStats::LATENCY_BUCKETS; k++) {
+            latencies += stats.latency[k];
+        }
+        BOOST_CHECK_EQUAL(latencies, 110);
+        BOOST_CHECK(stats.latencyPercentile(0.5) <= stats.latencyPercentile(1.0));
+        BOOST_CHECK_THROW(writer.append(Acquisition(8)), std::runtime_error);
+    }
+
+    Dataset d(test_filename, "dataset", false);
+    BOOST_CHECK_EQUAL(d.getNumberOfAcquisitions(), 100);
+    BOOST_CHECK_EQUAL(d.getNumberOfWaveforms(), 10);
+    Acquisition acq;
+    for (uint32_t n = 0; n < 100; n++) {
+        d.readAcquisition(n, acq);
+        check_acquisition(acq, n, 32, 2, n % 3);
+    }
+    Waveform wav;
+    d.readWaveform(9, wav);
+    BOOST_CHECK_EQUAL(wav.size(), 32);
+    BOOST_CHECK_EQUAL(wav.data[31], 90);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_async_writer_error)
+{
+    {
+        // Acquisitions cannot be appended to an array of floats
+        Dataset d(test_filename, "dataset", true);
+        std::vector<size_t> dims(1, 4);
+        d.appendNDArray("data", NDArray<float>(dims));
+    }
+
+    AsyncWriter writer(test_filename, "dataset");
+    writer.append(make_acquisition(0, 32, 2, 0));
+    BOOST_CHECK_THROW(writer.flush(), std::runtime_error);
+    BOOST_CHECK_THROW(writer.append(make_acquisition(1, 32, 2, 0)), std::runtime_error);
+    BOOST_CHECK_THROW(writer.close(), std::runtime_error);
+    // Reported once, the destructor closes again
+    BOOST_CHECK_NO_THROW(writer.close());
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_append_images)
+{
+    std::vector<Image<float> > batch;
+    for (uint16_t n = 0; n < 6; n++) {
+        Image<float> im(16, 8, 2, 3);
+        im.setSlice(n);
+        im.setAttributeString(n % 2 ? "odd" : "even");
+        for (uint16_t c = 0; c < 3; c++) {
+            im(15, 7, 1, c) = float(n * 10 + c);
+        }
+        batch.push_back(im);
+    }
+    {
+        Dataset d(test_filename, "dataset", true);
+        d.appendImage("cine", batch[0]);
+        d.appendImages("cine", std::vector<Image<float> >(batch.begin() + 1, batch.end()));
+        d.appendImages("cine", std::vector<Image<float> >());
+        BOOST_CHECK_EQUAL(d.getNumberOfImages("cine"), 6);
+
+        // All images in a batch must share one shape
+        std::vector<Image<float> > mixed(1, batch[0]);
+        mixed.push_back(Image<float>(8, 8, 2, 3));
+        BOOST_CHECK_THROW(d.appendImages("mixed", mixed), std::runtime_error);
+    }
+    // Images that follow each other in one buffer
+    {
+        std::vector<float> pixels(3 * 8);
+        for (size_t k = 0; k < pixels.size(); k++) {
+            pixels[k] = float(k);
+        }
+        ISMRMRD_Image shared[3];
+        for (int n = 0; n < 3; n++) {
+            ismrmrd_init_image(&shared[n]);
+            shared[n].head.data_type = ISMRMRD_FLOAT;
+            shared[n].head.matrix_size[0] = 4;
+            shared[n].head.matrix_size[1] = 2;
+            shared[n].head.matrix_size[2] = 1;
+            shared[n].head.channels = 1;
+            shared[n].data = &pixels[n * 8];
+        }
+        ISMRMRD_Dataset dset;
+        BOOST_REQUIRE_EQUAL(ismrmrd_init_dataset(&dset, test_filename, "dataset"), ISMRMRD_NOERROR);
+        BOOST_REQUIRE_EQUAL(ismrmrd_open_dataset(&dset, false), ISMRMRD_NOERROR);
+        BOOST_CHECK_EQUAL(ismrmrd_append_images(&dset, "shared", shared, 3), ISMRMRD_NOERROR);
+        BOOST_CHECK_EQUAL(ismrmrd_close_dataset(&dset), ISMRMRD_NOERROR);
+    }
+
+    Dataset d(test_filename, "dataset", false);
+    BOOST_CHECK_EQUAL(d.getNumberOfImages("cine"), 6);
+    Image<float> im;
+    std::string attr;
+    for (uint16_t n = 0; n < 6; n++) {
+        d.readImage("cine", n, im);
+        BOOST_CHECK_EQUAL(im.getSlice(), n);
+        BOOST_CHECK_EQUAL(im.getMatrixSizeX(), 16);
+        BOOST_CHECK_EQUAL(im.getMatrixSizeZ(), 2);
+        BOOST_CHECK_EQUAL(im.getNumberOfChannels(), 3);
+        im.getAttributeString(attr);
+        BOOST_CHECK_EQUAL(attr, n % 2 ? "odd" : "even");
+        for (uint16_t c = 0; c < 3; c++) {
+            BOOST_CHECK_EQUAL(im(15, 7, 1, c), float(n * 10 + c));
+        }
+    }
+    for (uint16_t n = 0; n < 3; n++) {
+        d.readImage("shared", n, im);
+        BOOST_CHECK_EQUAL(im(0, 0), float(n * 8));
+        BOOST_CHECK_EQUAL(im(3, 1), float(n * 8 + 7));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_read_images)
+{
+    {
+        Dataset d(test_filename, "dataset", true);
+        std::vector<Image<float> > batch;
+        for (uint16_t n = 0; n < 10; n++) {
+            Image<float> im(8, 4, 1, 2);
+            im.setSlice(n);
+            im.setAttributeString(std::string(n + 1, 'a'));
+            im(7, 3, 0, 1) = float(n);
+            batch.push_back(im);
+        }
+        d.appendImages("cine", batch);
+    }
+
+    Dataset d(test_filename, "dataset", false);
+
+    // Every third image, starting at the second
+    std::vector<Image<float> > ims;
+    d.readImages("cine", 1, 3, ims, 3);
+    BOOST_REQUIRE_EQUAL(ims.size(), 3);
+    std::string attr;
+    for (uint16_t n = 0; n < 3; n++) {
+        BOOST_CHECK_EQUAL(ims[n].getSlice(), 1 + 3 * n);
+        ims[n].getAttributeString(attr);
+        BOOST_CHECK_EQUAL(attr, std::string(2 + 3 * n, 'a'));
+        BOOST_CHECK_EQUAL(ims[n](7, 3, 0, 1), float(1 + 3 * n));
+    }
+    BOOST_CHECK_THROW(d.readImages("cine", 1, 4, ims, 3), std::runtime_error);
+
+    // The data of a range of images as one (x, y, z, channels, image) array
+    NDArray<float> arr;
+    std::vector<ImageHeader> heads;
+    d.readImageArray("cine", 2, 4, arr, heads, 2);
+    BOOST_CHECK_EQUAL(arr.getNDim(), 5);
+    BOOST_CHECK_EQUAL(arr.getDims()[0], 8);
+    BOOST_CHECK_EQUAL(arr.getDims()[1], 4);
+    BOOST_CHECK_EQUAL(arr.getDims()[2], 1);
+    BOOST_CHECK_EQUAL(arr.getDims()[3], 2);
+    BOOST_CHECK_EQUAL(arr.getDims()[4], 4);
+    BOOST_REQUIRE_EQUAL(heads.size(), 4);
+    for (uint16_t n = 0; n < 4; n++) {
+        BOOST_CHECK_EQUAL(heads[n].slice, 2 + 2 * n);
+        BOOST_CHECK_EQUAL(arr(7, 3, 0, 1, n), float(2 + 2 * n));
+    }
+
+    d.readImageArray("cine", 0, 10, arr);
+    BOOST_CHECK_EQUAL(arr.getDims()[4], 10);
+    BOOST_CHECK_EQUAL(arr(7, 3, 0, 1, 9), 9.0f);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_read_slabs)
+{
+    {
+        Dataset d(test_filename, "dataset", true);
+        std::vector<size_t> dims(4);
+        dims[0] = 16; dims[1] = 12; dims[2] = 3; dims[3] = 8;
+        NDArray<complex_float_t> csm(dims);
+        for (uint16_t c = 0; c < 8; c++) {
+            for (uint16_t z = 0; z < 3; z++) {
+                for (uint16_t y = 0; y < 12; y++) {
+                    for (uint16_t x = 0; x < 16; x++) {
+                        csm(x, y, z, c) = complex_float_t(float(x + 16 * y), float(z + 3 * c));
+                    }
+                }
+            }
+        }
+        d.appendNDArray("csm", csm);
+
+        Image<float> im(16, 12, 3, 8);
+        for (uint16_t c = 0; c < 8; c++) {
+            im(5, 6, 2, c) = float(c);
+        }
+        d.appendImage("images", im);
+    }
+
+    Dataset d(test_filename, "dataset", false);
+
+    // One coil of the sensitivity map
+    std::vector<size_t> offset(4, 0), count(4);
+    offset[3] = 5;
+    count[0] = 16; count[1] = 12; count[2] = 3; count[3] = 1;
+    NDArray<complex_float_t> coil;
+    d.readNDArraySlab("csm", 0, offset, count, coil);
+    BOOST_CHECK_EQUAL(coil.getNDim(), 4);
+    BOOST_CHECK_EQUAL(coil.getNumberOfElements(), 16 * 12 * 3);
+    BOOST_CHECK(coil(15, 11, 2, 0) == complex_float_t(15 + 16 * 11, 2 + 3 * 5));
+
+    // A small region of interest
+    offset[0] = 4; offset[1] = 2; offset[2] = 1; offset[3] = 2;
+    count[0] = 3; count[1] = 2; count[2] = 1; count[3] = 2;
+    NDArray<complex_float_t> roi;
+    d.readNDArraySlab("csm", 0, offset, count, roi);
+    BOOST_CHECK_EQUAL(roi.getDims()[0], 3);
+    BOOST_CHECK_EQUAL(roi.getDims()[3], 2);
+    BOOST_CHECK(roi(0, 0, 0, 0) == complex_float_t(4 + 16 * 2, 1 + 3 * 2));
+    BOOST_CHECK(roi(2, 1, 0, 1) == complex_float_t(6 + 16 * 3, 1 + 3 * 3));
+
+    offset[0] = 14;
+    BOOST_CHECK_THROW(d.readNDArraySlab("csm", 0, offset, count, roi), std::runtime_error);
+    BOOST_CHECK_THROW(d.readNDArraySlab("csm", 0, std::vector<size_t>(3, 0), std::vector<size_t>(3, 1), roi),
+                      std::runtime_error);
+
+    // The last slice of the image, all channels
+    offset[0] = 0; offset[1] = 0; offset[2] = 2; offset[3] = 0;
+    count[0] = 16; count[1] = 12; count[2] = 1; count[3] = 8;
+    NDArray<float> slice;
+    d.readImageSlab("images", 0, offset, count, slice);
+    BOOST_CHECK_EQUAL(slice.getDims()[2], 1);
+    for (uint16_t c = 0; c < 8; c++) {
+        BOOST_CHECK_EQUAL(slice(5, 6, 0, c), float(c));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_ndarray_view)
+{
+    std::vector<size_t> dims(4);
+    dims[0] = 32; dims[1] = 16; dims[2] = 6; dims[3] = 5;
+    NDArray<float> vol(dims);
+    for (size_t t = 0; t < 5; t++) {
+        for (size_t z = 0; z < 6; z++) {
+            for (size_t y = 0; y < 16; y++) {
+                for (size_t x = 0; x < 32; x++) {
+                    vol(x, y, z, t) = float(x + 32 * (y + 16 * (z + 6 * t)));
+                }
+            }
+        }
+    }
+    Dataset d(test_filename, "dataset", true);
+    d.appendNDArray("vol", vol);
+    d.appendNDArray("vol", vol);
+
+    // Tiles of two slices (4 KiB), room for three of them
+    NDArrayView<float> view = d.getNDArrayView<float>("vol", 1, 3 * 4096, 4096);
+    BOOST_CHECK_EQUAL(view.getNDim(), 4);
+    BOOST_CHECK_EQUAL(view.getNumberOfElements(), vol.getNumberOfElements());
+    BOOST_REQUIRE_EQUAL(view.getTileDims().size(), 4);
+    BOOST_CHECK_EQUAL(view.getTileDims()[0], 32);
+    BOOST_CHECK_EQUAL(view.getTileDims()[1], 16);
+    BOOST_CHECK_EQUAL(view.getTileDims()[2], 2);
+    BOOST_CHECK_EQUAL(view.getTileDims()[3], 1);
+
+    // Slice-wise pass over the whole volume
+    bool equal = true;
+    for (size_t t = 0; t < 5; t++) {
+        for (size_t z = 0; z < 6; z++) {
+            for (size_t y = 0; y < 16; y++) {
+                for (size_t x = 0; x < 32; x++) {
+                    equal = equal && view(x, y, z, t) == vol(x, y, z, t);
+                }
+            }
+        }
+    }
+    BOOST_CHECK(equal);
+    NDArrayViewStats stats = view.stats();
+    BOOST_CHECK_EQUAL(stats.misses, 15);
+    BOOST_CHECK_EQUAL(stats.hits, vol.getNumberOfElements() - 15);
+    BOOST_CHECK_EQUAL(stats.evictions, 12);
+    BOOST_CHECK_EQUAL(stats.bytes_read, vol.getDataSize());
+
+    // The most recently used tiles are still cached
+    BOOST_CHECK_EQUAL(view(1, 2, 3, 4), vol(1, 2, 3, 4));
+    BOOST_CHECK_EQUAL(view.stats().misses, 15);
+    BOOST_CHECK_EQUAL(view(1, 2, 0, 0), vol(1, 2, 0, 0));
+    BOOST_CHECK_EQUAL(view.stats().misses, 16);
+
+    BOOST_CHECK_THROW(view(32, 0, 0, 0), std::runtime_error);
+    BOOST_CHECK_THROW(d.getNDArrayView<double>("vol", 0), std::runtime_error);
+    BOOST_CHECK_THROW(d.getNDArrayView<float>("vol", 2), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_mapped_arrays)
+{
+    std::vector<size_t> dims(3);
+    dims[0] = 64; dims[1] = 32; dims[2] = 4;
+    std::vector<NDArray<complex_float_t> > cal(3, NDArray<complex_float_t>(dims));
+    for (size_t n = 0; n < 3; n++) {
+        for (size_t k = 0; k < cal[n].getNumberOfElements(); k++) {
+            cal[n].getDataPtr()[k] = complex_float_t(float(n), float(k));
+        }
+    }
+    Image<float> im(16, 8, 1, 2);
+    im(15, 7, 0, 1) = 3.5f;
+    {
+        Dataset d(test_filename, "dataset", true);
+        ISMRMRD_StoragePolicy contiguous;
+        ismrmrd_init_storage_policy(&contiguous);
+        contiguous.contiguous_elements = 3;
+        d.setStoragePolicy("cal", contiguous);
+        d.setStoragePolicy("images", contiguous);
+
+        d.appendNDArray("cal", cal[0]);
+        BOOST_CHECK_EQUAL(d.getNumberOfNDArrays("cal"), 1);
+        d.appendNDArray("cal", cal[1]);
+        d.appendNDArray("cal", cal[2]);
+        BOOST_CHECK_EQUAL(d.getNumberOfNDArrays("cal"), 3);
+        BOOST_CHECK_THROW(d.appendNDArray("cal", cal[0]), std::runtime_error);
+        BOOST_CHECK_EQUAL(d.getNumberOfNDArrays("cal"), 3);
+        d.appendNDArray("chunked", cal[0]);
+        d.appendImage("images", im);
+
+        // Mapped by the writer as well
+        MappedNDArray<complex_float_t> mapped;
+        d.mapNDArray("cal", 2, mapped);
+        BOOST_CHECK(mapped.isMapped());
+        BOOST_CHECK(mapped(63, 31, 3) == cal[2](63, 31, 3));
+
+        contiguous.deflate_level = 1;
+        BOOST_CHECK_THROW(d.setStoragePolicy("other", contiguous), std::runtime_error);
+    }
+
+    MappedNDArray<complex_float_t> mapped;
+    {
+        Dataset d(test_filename, "dataset", false);
+        NDArray<complex_float_t> read;
+        d.readNDArray("cal", 1, read);
+        BOOST_CHECK(read(5, 6, 1) == cal[1](5, 6, 1));
+        BOOST_CHECK_THROW(d.readNDArray("cal", 3, read), std::runtime_error);
+
+        for (uint32_t n = 0; n < 3; n++) {
+            d.mapNDArray("cal", n, mapped);
+            BOOST_CHECK(mapped.isMapped());
+            BOOST_CHECK_EQUAL(mapped.getNDim(), 3);
+            BOOST_CHECK_EQUAL(mapped.getDims()[1], 32);
+            BOOST_REQUIRE_EQUAL(mapped.getNumberOfElements(), cal[n].getNumberOfElements());
+            BOOST_CHECK(std::equal(cal[n].begin(), cal[n].end(), mapped.getDataPtr()));
+        }
+        BOOST_CHECK_THROW(d.mapNDArray("cal", 3, mapped), std::runtime_error);
+
+        // Chunked variables are read instead
+        d.mapNDArray("chunked", 0, mapped);
+        BOOST_CHECK(!mapped.isMapped());
+        BOOST_CHECK(std::equal(cal[0].begin(), cal[0].end(), mapped.getDataPtr()));
+
+        MappedNDArray<float> data;
+        d.mapImageData("images", 0, data);
+        BOOST_CHECK(data.isMapped());
+        BOOST_CHECK_EQUAL(data.getNDim(), 4);
+        BOOST_CHECK_EQUAL(data(15, 7, 0, 1), 3.5f);
+        BOOST_CHECK_THROW(d.mapNDArray("cal", 0, data), std::runtime_error);
+    }
+
+    // The core driver holds the file in memory, so its arrays are read instead
+    ISMRMRD_DatasetOptions options;
+    ismrmrd_init_dataset_options(&options);
+    options.driver = ISMRMRD_DRIVER_CORE;
+    options.core_backing_store = true;
+    Dataset in_memory(test_filename, "dataset", options);
+    ISMRMRD_StoragePolicy contiguous;
+    ismrmrd_init_storage_policy(&contiguous);
+    contiguous.contiguous_elements = 2;
+    in_memory.setStoragePolicy("in_memory", contiguous);
+    in_memory.appendNDArray("in_memory", cal[1]);
+    in_memory.mapNDArray("in_memory", 0, mapped);
+    BOOST_CHECK(!mapped.isMapped());
+    BOOST_CHECK(std::equal(cal[1].begin(), cal[1].end(), mapped.getDataPtr()));
+    BOOST_CHECK_EQUAL(in_memory.getNumberOfNDArrays("in_memory"), 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_open_options)
+{
+    ISMRMRD_DatasetOptions options;
+    ismrmrd_init_dataset_options(&options);
+
+    // In memory without a backing store, nothing reaches the disk
+    options.driver = ISMRMRD_DRIVER_CORE;
+    {
+        Dataset d(test_filename, "dataset", options);
+        d.appendAcquisition(make_acquisition(0, 32, 2, 0));
+        BOOST_CHECK_EQUAL(d.getNumberOfAcquisitions(), 1);
+    }
+    BOOST_CHECK(!std::ifstream(test_filename).good());
+
+    options.read_only = true;
+    options.driver = ISMRMRD_DRIVER_DEFAULT;
+    BOOST_CHECK_THROW(Dataset(test_filename, "dataset", options), std::runtime_error);
+
+    options.read_only = false;
+    options.driver = ISMRMRD_DRIVER_STDIO;
+    options.alignment = 4096;
+    options.alignment_threshold = 1024;
+    options.metadata_cache_bytes = 8 << 20;
+    options.file_space_page_size = 8192;
+    options.libver_low = ISMRMRD_LIBVER_V110;
+    {
+        Dataset d(test_filename, "dataset", options);
+        d.writeHeader("<ismrmrdHeader/>");
+        for (uint32_t n = 0; n < 20; n++) {
+            d.appendAcquisition(make_acquisition(n, 256, 4, 0));
+        }
+    }
+
+    ismrmrd_init_dataset_options(&options);
+    options.read_only = true;
+    options.page_buffer_bytes = 1 << 20;
+    {
+        Dataset d(test_filename, "dataset", options);
+        BOOST_REQUIRE_EQUAL(d.getNumberOfAcquisitions(), 20);
+        Acquisition acq;
+        d.readAcquisition(19, acq);
+        check_acquisition(acq, 19, 256, 4, 0);
+        BOOST_CHECK_THROW(d.appendAcquisition(acq), std::runtime_error);
+    }
+
+    options.driver = 99;
+    BOOST_CHECK_THROW(Dataset(test_filename, "dataset", options), std::runtime_error);
+
+    // The storage policy of the options applies to the whole group
+    std::remove(test_filename);
+    ismrmrd_init_dataset_options(&options);
+    options.storage.chunk_elements = 3;
+    options.storage.deflate_level = 1;
+    {
+        std::vector<size_t> dims(1, 64);
+        NDArray<float> arr(dims);
+        Dataset d(test_filename, "dataset", options);
+        d.appendNDArray("compressed", arr);
+    }
+    BOOST_CHECK_EQUAL(chunk_elements("/dataset/compressed"), 3);
+    {
+        hid_t file = H5Fopen(test_filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+        hid_t dataset = H5Dopen2(file, "/dataset/compressed", H5P_DEFAULT);
+        hid_t props = H5Dget_create_plist(dataset);
+        BOOST_CHECK_EQUAL(H5Pget_nfilters(props), 1);
+        H5Pclose(props);
+        H5Dclose(dataset);
+        H5Fclose(file);
+    }
+
+    // A bad policy is refused before the file is created
+    std::remove(test_filename);
+    options.storage.contiguous_elements = 10;
+    BOOST_CHECK_THROW(Dataset(test_filename, "dataset", options), std::runtime_error);
+    BOOST_CHECK(!std::ifstream(test_filename).good());
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_memory_backend)
+{
+    const char *name = "memory:test_dataset";
+    const ISMRMRD_DatasetBackend *memory = ismrmrd_memory_backend();
+    BOOST_CHECK_THROW(Dataset(name, "dataset", false, memory), std::runtime_error);
+
+    std::vector<size_t> dims(2);
+    dims[0] = 8; dims[1] = 4;
+    NDArray<double> arr(dims);
+    for (size_t k = 0; k < arr.getNumberOfElements(); k++) {
+        arr.getDataPtr()[k] = 0.5 * k;
+    }
+    std::vector<Image<float> > ims(4, Image<float>(16, 8, 1, 2));
+    for (size_t n = 0; n < ims.size(); n++) {
+        ims[n](3, 2, 0, 1) = float(n);
+        ims[n].setImageIndex(uint16_t(n));
+    }
+    {
+        Dataset d(name, "dataset", true, memory);
+        d.writeHeader("<ismrmrdHeader/>");
+        for (uint32_t n = 0; n < 5; n++) {
+            d.appendAcquisition(make_acquisition(n, 32, 2, 1));
+        }
+        Waveform wav(10, 2);
+        wav.data[19] = 42;
+        d.appendWaveform(wav);
+        d.appendImages("images", ims);
+        d.appendNDArray("arr", arr);
+
+        BOOST_CHECK_THROW(d.appendImage("images", Image<float>(8, 8, 1, 2)), std::runtime_error);
+        BOOST_CHECK_THROW(d.appendNDArray("images", arr), std::runtime_error);
+        BOOST_CHECK_THROW(d.appendNDArray("arr", NDArray<double>(std::vector<size_t>(1, 3))), std::runtime_error);
+        std::vector<AcquisitionHeader> heads;
+        BOOST_CHECK_THROW(d.readAcquisitionHeaders(0, 1, heads), std::runtime_error);
+    }
+
+    // Nothing is written to disk, the data outlives the dataset
+    BOOST_CHECK(!std::ifstream(name).good());
+    {
+        Dataset d(name, "dataset", false, memory);
+        std::string xml;
+        d.readHeader(xml);
+        BOOST_CHECK_EQUAL(xml, "<ismrmrdHeader/>");
+        BOOST_REQUIRE_EQUAL(d.getNumberOfAcquisitions(), 5);
+        Acquisition acq;
+        for (uint32_t n = 0; n < 5; n++) {
+            d.readAcquisition(n, acq);
+            check_acquisition(acq, n, 32, 2, 1);
+        }
+        BOOST_CHECK_THROW(d.readAcquisition(5, acq), std::runtime_error);
+
+        BOOST_REQUIRE_EQUAL(d.getNumberOfWaveforms(), 1);
+        Waveform wav;
+        d.readWaveform(0, wav);
+        BOOST_CHECK_EQUAL(wav.head.number_of_samples, 10);
+        BOOST_CHECK_EQUAL(wav.data[19], 42);
+
+        BOOST_CHECK_EQUAL(d.getNumberOfImages("images"), 4);
+        std::vector<Image<float> > read;
+        d.readImages("images", 1, 2, read, 2);
+        BOOST_REQUIRE_EQUAL(read.size(), 2);
+        BOOST_CHECK_EQUAL(read[1].getImageIndex(), 3);
+        BOOST_CHECK_EQUAL(read[1](3, 2, 0, 1), 3.0f);
+        BOOST_CHECK_THROW(d.readImages("images", 2, 2, read, 2), std::runtime_error);
+
+        BOOST_CHECK_EQUAL(d.getNumberOfNDArrays("arr"), 1);
+        BOOST_CHECK_EQUAL(d.getNumberOfNDArrays("missing"), 0);
+        NDArray<double> out;
+        d.readNDArray("arr", 0, out);
+        BOOST_REQUIRE_EQUAL(out.getNumberOfElements(), arr.getNumberOfElements());
+        BOOST_CHECK(std::equal(arr.begin(), arr.end(), out.begin()));
+
+        // Other groups of the same file are independent
+        Dataset other(name, "other", true, memory);
+        BOOST_CHECK_EQUAL(other.getNumberOfAcquisitions(), 0);
+        BOOST_CHECK_NE(ismrmrd_remove_memory_dataset(name), ISMRMRD_NOERROR);
+    }
+
+    BOOST_CHECK_EQUAL(ismrmrd_remove_memory_dataset(name), ISMRMRD_NOERROR);
+    BOOST_CHECK_THROW(Dataset(name, "dataset", false, memory), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_log_backend)
+{
+    const char *name = "test_dataset.log";
+    const ISMRMRD_DatasetBackend *log = ismrmrd_log_backend();
+    std::remove(name);
+    BOOST_CHECK_THROW(Dataset(name, "dataset", false, log), std::runtime_error);
+
+    std::vector<size_t> dims(3);
+    dims[0] = 16; dims[1] = 4; dims[2] = 2;
+    NDArray<complex_float_t> arr(dims);
+    for (size_t k = 0; k < arr.getNumberOfElements(); k++) {
+        arr.getDataPtr()[k] = complex_float_t(float(k), -1.0f);
+    }
+    std::vector<Image<int16_t> > ims(3, Image<int16_t>(8, 8, 2, 1));
+    for (size_t n = 0; n < ims.size(); n++) {
+        ims[n](7, 7, 1, 0) = int16_t(n);
+        ims[n].setAttributeString("<meta/>");
+    }
+    {
+        Dataset d(name, "dataset", true, log);
+        d.writeHeader("<ismrmrdHeader/>");
+        for (uint32_t n = 0; n < 100; n++) {
+            d.appendAcquisition(make_acquisition(n, 64, 4, 2));
+        }
+        Waveform wav(5, 3);
+        wav.data[14] = 7;
+        d.appendWaveform(wav);
+        d.appendImages("images", ims);
+        d.appendNDArray("arr", arr);
+
+        // Readable before anything is written out
+        Acquisition acq;
+        d.readAcquisition(99, acq);
+        check_acquisition(acq, 99, 64, 4, 2);
+        BOOST_CHECK_THROW(d.appendImage("images", Image<int16_t>(4, 4, 1, 1)), std::runtime_error);
+        BOOST_CHECK_THROW(d.appendNDArray("arr", NDArray<complex_float_t>(std::vector<size_t>(1, 3))), std::runtime_error);
+        d.flush();
+
+        Dataset other(name, "other", true, log);
+        other.appendAcquisition(make_acquisition(1000, 8, 1, 0));
+    }
+    {
+        Dataset d(name, "dataset", false, log);
+        std::string xml;
+        d.readHeader(xml);
+        BOOST_CHECK_EQUAL(xml, "<ismrmrdHeader/>");
+        BOOST_REQUIRE_EQUAL(d.getNumberOfAcquisitions(), 100);
+        Acquisition acq;
+        for (uint32_t n = 0; n < 100; n++) {
+            d.readAcquisition(n, acq);
+            check_acquisition(acq, n, 64, 4, 2);
+        }
+        Waveform wav;
+        d.readWaveform(0, wav);
+        BOOST_CHECK_EQUAL(wav.data[14], 7);
+
+        std::vector<Image<int16_t> > read;
+        d.readImages("images", 0, 3, read);
+        BOOST_REQUIRE_EQUAL(read.size(), 3);
+        BOOST_CHECK_EQUAL(read[2](7, 7, 1, 0), 2);
+        BOOST_CHECK_EQUAL(read[2].getAttributeString(), "<meta/>");
+
+        NDArray<complex_float_t> out;
+        d.readNDArray("arr", 0, out);
+        BOOST_REQUIRE_EQUAL(out.getNumberOfElements(), arr.getNumberOfElements());
+        BOOST_CHECK(std::equal(arr.begin(), arr.end(), out.begin()));
+
+        // Appending after the index
+        d.appendAcquisition(make_acquisition(100, 64, 4, 2));
+        Dataset other(name, "other", false, log);
+        BOOST_REQUIRE_EQUAL(other.getNumberOfAcquisitions(), 1);
+        other.readAcquisition(0, acq);
+        check_acquisition(acq, 1000, 8, 1, 0);
+    }
+
+    // A log without a complete index, as after a crash, is scanned up to the last complete record
+    std::ifstream f(name, std::ios::binary | std::ios::ate);
+    std::streamoff size = f.tellg();
+    f.close();
+    BOOST_REQUIRE_EQUAL(truncate(name, size - 200), 0);
+    {
+        Dataset d(name, "dataset", false, log);
+        BOOST_CHECK_EQUAL(d.getNumberOfAcquisitions(), 101);
+        BOOST_CHECK_EQUAL(d.getNumberOfImages("images"), 3);
+        d.appendAcquisition(make_acquisition(101, 64, 4, 2));
+    }
+    {
+        Dataset d(name, "dataset", false, log);
+        BOOST_REQUIRE_EQUAL(d.getNumberOfAcquisitions(), 102);
+        Acquisition acq;
+        d.readAcquisition(101, acq);
+        check_acquisition(acq, 101, 64, 4, 2);
+    }
+
+    // Not a log
+    {
+        std::ofstream bad(name, std::ios::binary | std::ios::trunc);
+        bad << "not a log file at all";
+    }
+    BOOST_CHECK_THROW(Dataset(name, "dataset", false, log), std::runtime_error);
+    std::remove(name);
+}
+
+BOOST_AUTO_TEST_CASE(test_dataset_swmr)
+{
+    // The writer runs in a child process and tells the reader when it has started
+    int ready[2];
+    BOOST_REQUIRE_EQUAL(pipe(ready), 0);
+    pid_t writer = fork();
+    BOOST_REQUIRE(writer >= 0);
+    if (writer == 0) {
+        close(ready[0]);
+        int status = 0;
+        try {
+            Dataset d(test_filename, "dataset", Dataset::SWMR_WRITER);
+            d.writeHeader("<ismrmrdHeader/>");
+            for (uint32_t n = 0; n < 10; n++) {
+                d.appendAcquisition(make_acquisition(n, 32, 2, 0));
+            }
+            d.startSwmrWrite(4);
+            if (write(ready[1], "r", 1) != 1) {
+                status = 1;
+            }
+            for (uint32_t n = 10; n < 60; n++) {
+                d.appendAcquisition(make_acquisition(n, 32, 2, 0));
+                usleep(1000);
+            }
+        } catch (...) {
+            status = 1;
+        }
+        _exit(status);
+    }
+
+    close(ready[1]);
+    char c;
+    BOOST_REQUIRE_EQUAL(read(ready[0], &c, 1), 1);
+    close(ready[0]);
+    {
+        Dataset d(test_filename, "dataset", Dataset::SWMR_READER);
+        Acquisition acq;
+        for (uint32_t n = 0; n < 60; n++) {
+            BOOST_REQUIRE(d.waitForAcquisition(n, 10000));
+            d.readAcquisition(n, acq);
+            check_acquisition(acq, n, 32, 2, 0);
+        }
+        BOOST_CHECK(!d.waitForAcquisition(60, 20));
+    }
+
+    int status;
+    BOOST_REQUIRE_EQUAL(waitpid(writer, &status, 0), writer);
+    BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // A plain open sees everything once the writer is done
+    Dataset d(test_filename, "dataset", false);
+    BOOST_CHECK_EQUAL(d.getNumberOfAcquisitions(), 60);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
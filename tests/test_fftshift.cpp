@@ -0,0 +1,35 @@
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd_fftshift.h"
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+using namespace ISMRMRD;
+
+BOOST_AUTO_TEST_SUITE(FFTShiftTest)
+
+// fft2c shifts aligned arrays of even size in place and the others through a copy
+BOOST_AUTO_TEST_CASE(test_fftshift_in_place_matches_copy)
+{
+    const int sizes[][2] = {{8, 8}, {16, 6}, {2, 10}, {64, 32}};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int xdim = sizes[s][0];
+        int ydim = sizes[s][1];
+        std::vector<complex_float_t> in(xdim * ydim);
+        for (size_t n = 0; n < in.size(); n++) {
+            in[n] = complex_float_t(static_cast<float>(n), -static_cast<float>(n));
+        }
+
+        std::vector<complex_float_t> copied(in.size());
+        fftshift(&copied[0], &in[0], xdim, ydim);
+        std::vector<complex_float_t> shifted(in);
+        fftshift_in_place(&shifted[0], xdim, ydim);
+        BOOST_CHECK(shifted == copied);
+
+        // For even sizes the shift is its own inverse
+        fftshift_in_place(&shifted[0], xdim, ydim);
+        BOOST_CHECK(shifted == in);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,6 +1,8 @@
 #include "ismrmrd/ismrmrd.h"
 #include "ismrmrd/version.h"
 #include <boost/test/unit_test.hpp>
+#include <type_traits>
+#include <utility>
 
 using namespace ISMRMRD;
 
@@ -164,4 +166,51 @@ static void check_header(ISMRMRD_ImageHeader* chead)
     BOOST_CHECK_EQUAL(chead->attribute_string_len, 0);
 }
 
+BOOST_AUTO_TEST_CASE(test_image_move)
+{
+    BOOST_CHECK(std::is_nothrow_move_constructible<Image<float> >::value);
+    BOOST_CHECK(std::is_nothrow_move_assignable<Image<float> >::value);
+
+    Image<float> im(32, 32, 2, 4);
+    im.setAttributeString("attributes");
+    float *data = im.getDataPtr();
+    const char *attr = im.getAttributeString();
+
+    Image<float> moved(std::move(im));
+    BOOST_CHECK_EQUAL(moved.getDataPtr(), data);
+    BOOST_CHECK_EQUAL(moved.getAttributeString(), attr);
+    BOOST_CHECK_EQUAL(moved.getMatrixSizeX(), 32);
+    // The moved from image is empty and keeps its data type
+    BOOST_CHECK(im.getDataPtr() == NULL);
+    BOOST_CHECK_EQUAL(im.getAttributeStringLength(), 0u);
+    BOOST_CHECK_EQUAL(im.getDataType(), ISMRMRD_FLOAT);
+    im.resize(4, 4, 1, 1);
+    BOOST_CHECK_EQUAL(im.getDataSize(), 16 * sizeof(float));
+
+    Image<float> assigned;
+    assigned = std::move(moved);
+    BOOST_CHECK_EQUAL(assigned.getDataPtr(), data);
+    BOOST_CHECK_EQUAL(moved.getDataType(), ISMRMRD_FLOAT);
+
+    swap(assigned, im);
+    BOOST_CHECK_EQUAL(im.getDataPtr(), data);
+    BOOST_CHECK_EQUAL(assigned.getMatrixSizeX(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(test_image_vector_growth_keeps_buffers)
+{
+    std::vector<Image<complex_float_t> > ims;
+    std::vector<const complex_float_t *> buffers;
+    for (uint16_t n = 0; n < 50; n++) {
+        Image<complex_float_t> im(64, 64);
+        im.setImageIndex(n);
+        buffers.push_back(im.getDataPtr());
+        ims.push_back(std::move(im));
+    }
+    for (uint16_t n = 0; n < 50; n++) {
+        BOOST_CHECK_EQUAL(ims[n].getDataPtr(), buffers[n]);
+        BOOST_CHECK_EQUAL(ims[n].getImageIndex(), n);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
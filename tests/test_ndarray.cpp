@@ -1,6 +1,8 @@
 #include "ismrmrd/ismrmrd.h"
 #include "ismrmrd/version.h"
 #include <boost/test/unit_test.hpp>
+#include <type_traits>
+#include <utility>
 
 using namespace ISMRMRD;
 
@@ -44,7 +46,6 @@ BOOST_AUTO_TEST_CASE(test_ndarray_create_free)
     // Check cleanup
     BOOST_CHECK_EQUAL(ismrmrd_free_ndarray(NULL), ISMRMRD_RUNTIMEERROR);
     BOOST_CHECK_EQUAL(ismrmrd_free_ndarray(carrp), ISMRMRD_NOERROR);
-    BOOST_CHECK(!carrp->data);
 }
 
 BOOST_AUTO_TEST_CASE(test_ndarray_copy)
@@ -68,4 +69,55 @@ BOOST_AUTO_TEST_CASE(test_ndarray_copy)
     BOOST_CHECK(!cdst.data);
 }
 
+static NDArray<double> make_array(size_t n, const double *&data)
+{
+    std::vector<size_t> dims(2, n);
+    NDArray<double> arr(dims);
+    data = arr.getDataPtr();
+    return arr;
+}
+
+BOOST_AUTO_TEST_CASE(test_ndarray_move)
+{
+    BOOST_CHECK(std::is_nothrow_move_constructible<NDArray<double> >::value);
+    BOOST_CHECK(std::is_nothrow_move_assignable<NDArray<double> >::value);
+
+    // Returning by value hands over the buffer
+    const double *data = NULL;
+    NDArray<double> arr = make_array(16, data);
+    BOOST_CHECK_EQUAL(arr.getDataPtr(), data);
+    BOOST_CHECK_EQUAL(arr.getNumberOfElements(), 256u);
+
+    NDArray<double> moved(std::move(arr));
+    BOOST_CHECK_EQUAL(moved.getDataPtr(), data);
+    BOOST_CHECK(arr.getDataPtr() == NULL);
+    BOOST_CHECK_EQUAL(arr.getNDim(), 0);
+    BOOST_CHECK_EQUAL(arr.getDataType(), ISMRMRD_DOUBLE);
+
+    NDArray<double> assigned;
+    assigned = std::move(moved);
+    BOOST_CHECK_EQUAL(assigned.getDataPtr(), data);
+    BOOST_CHECK_EQUAL(assigned.getDims()[1], 16u);
+
+    const double *other_data = NULL;
+    NDArray<double> other = make_array(4, other_data);
+    swap(assigned, other);
+    BOOST_CHECK_EQUAL(assigned.getDataPtr(), other_data);
+    BOOST_CHECK_EQUAL(other.getDataPtr(), data);
+}
+
+BOOST_AUTO_TEST_CASE(test_ndarray_vector_growth_keeps_buffers)
+{
+    std::vector<NDArray<float> > arrs;
+    std::vector<const float *> buffers;
+    std::vector<size_t> dims(3, 8);
+    for (size_t n = 0; n < 50; n++) {
+        arrs.push_back(NDArray<float>(dims));
+        buffers.push_back(arrs.back().getDataPtr());
+    }
+    for (size_t n = 0; n < 50; n++) {
+        BOOST_CHECK_EQUAL(arrs[n].getDataPtr(), buffers[n]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,271 @@
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/serialization.h"
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <sstream>
+#include <string.h>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace ISMRMRD;
+
+BOOST_AUTO_TEST_SUITE(SerializationTest)
+
+static Acquisition make_acquisition(uint32_t scan)
+{
+    Acquisition acq(64, 4, 2);
+    acq.scan_counter() = scan;
+    acq.idx().kspace_encode_step_1 = static_cast<uint16_t>(scan);
+    for (size_t n = 0; n < acq.getNumberOfDataElements(); n++) {
+        acq.getDataPtr()[n] = complex_float_t(static_cast<float>(n), static_cast<float>(scan));
+    }
+    for (size_t n = 0; n < acq.getNumberOfTrajElements(); n++) {
+        acq.getTrajPtr()[n] = static_cast<float>(n) * 0.5f;
+    }
+    return acq;
+}
+
+static void check_acquisition(const Acquisition &acq, uint32_t scan)
+{
+    Acquisition expected = make_acquisition(scan);
+    BOOST_CHECK_EQUAL(memcmp(&acq.getHead(), &expected.getHead(), sizeof(ISMRMRD_AcquisitionHeader)), 0);
+    BOOST_REQUIRE_EQUAL(acq.getDataSize(), expected.getDataSize());
+    BOOST_REQUIRE_EQUAL(acq.getTrajSize(), expected.getTrajSize());
+    BOOST_CHECK_EQUAL(memcmp(acq.getDataPtr(), expected.getDataPtr(), acq.getDataSize()), 0);
+    BOOST_CHECK_EQUAL(memcmp(acq.getTrajPtr(), expected.getTrajPtr(), acq.getTrajSize()), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_serialize_stream_round_trip)
+{
+    std::stringstream ss;
+
+    std::string xml = "<ismrmrdHeader></ismrmrdHeader>";
+    serializeHeader(xml, ss);
+
+    Acquisition acq = make_acquisition(7);
+    serialize(acq, ss);
+
+    Waveform wav(32, 3);
+    wav.head.waveform_id = 5;
+    for (size_t n = 0; n < wav.size(); n++) {
+        wav.data[n] = static_cast<uint32_t>(n * 3);
+    }
+    serialize(wav, ss);
+
+    Image<float> im(8, 6, 2, 2);
+    im.setImageIndex(3);
+    im.setAttributeString("<ismrmrdMeta></ismrmrdMeta>");
+    for (size_t n = 0; n < im.getNumberOfDataElements(); n++) {
+        im.getDataPtr()[n] = static_cast<float>(n);
+    }
+    serialize(im, ss);
+
+    std::vector<size_t> dims;
+    dims.push_back(3);
+    dims.push_back(4);
+    dims.push_back(5);
+    NDArray<complex_double_t> arr(dims);
+    for (size_t n = 0; n < arr.getNumberOfElements(); n++) {
+        arr.getDataPtr()[n] = complex_double_t(static_cast<double>(n), -1.0);
+    }
+    serialize(arr, ss);
+    serializeClose(ss);
+
+    MessageFrame frame;
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    BOOST_CHECK_EQUAL(frame.id, ISMRMRD_MESSAGE_HEADER);
+    std::string xml_read;
+    deserializeHeader(ss, frame, xml_read);
+    BOOST_CHECK_EQUAL(xml_read, xml);
+
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    BOOST_CHECK_EQUAL(frame.id, ISMRMRD_MESSAGE_ACQUISITION);
+    Acquisition acq_read;
+    deserialize(ss, frame, acq_read);
+    check_acquisition(acq_read, 7);
+
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    BOOST_CHECK_EQUAL(frame.id, ISMRMRD_MESSAGE_WAVEFORM);
+    Waveform wav_read;
+    deserialize(ss, frame, wav_read);
+    BOOST_CHECK_EQUAL(wav_read.head.waveform_id, 5);
+    BOOST_REQUIRE_EQUAL(wav_read.size(), wav.size());
+    BOOST_CHECK_EQUAL(memcmp(wav_read.data, wav.data, wav.size() * sizeof(uint32_t)), 0);
+
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    BOOST_CHECK_EQUAL(frame.id, ISMRMRD_MESSAGE_IMAGE);
+    Image<float> im_read;
+    deserialize(ss, frame, im_read);
+    BOOST_CHECK_EQUAL(im_read.getImageIndex(), 3);
+    BOOST_CHECK_EQUAL(std::string(im_read.getAttributeString()), "<ismrmrdMeta></ismrmrdMeta>");
+    BOOST_REQUIRE_EQUAL(im_read.getDataSize(), im.getDataSize());
+    BOOST_CHECK_EQUAL(memcmp(im_read.getDataPtr(), im.getDataPtr(), im.getDataSize()), 0);
+
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    BOOST_CHECK_EQUAL(frame.id, ISMRMRD_MESSAGE_NDARRAY);
+    NDArray<complex_double_t> arr_read;
+    deserialize(ss, frame, arr_read);
+    BOOST_CHECK_EQUAL(arr_read.getNDim(), 3);
+    BOOST_CHECK_EQUAL(arr_read.getDims()[2], 5);
+    BOOST_REQUIRE_EQUAL(arr_read.getDataSize(), arr.getDataSize());
+    BOOST_CHECK_EQUAL(memcmp(arr_read.getDataPtr(), arr.getDataPtr(), arr.getDataSize()), 0);
+
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    BOOST_CHECK_EQUAL(frame.id, ISMRMRD_MESSAGE_CLOSE);
+    BOOST_CHECK_EQUAL(frame.length, 0);
+    BOOST_CHECK(!readMessageFrame(ss, frame));
+}
+
+BOOST_AUTO_TEST_CASE(test_serialize_skip_and_mismatch)
+{
+    std::stringstream ss;
+    serialize(make_acquisition(1), ss);
+    Image<int16_t> im(4, 4);
+    serialize(im, ss);
+    serialize(make_acquisition(2), ss);
+
+    MessageFrame frame;
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    skipMessage(ss, frame);
+
+    // An image of another data type is not read
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    Image<float> wrong_type;
+    BOOST_CHECK_THROW(deserialize(ss, frame, wrong_type), std::runtime_error);
+
+    ss.clear();
+    ss.seekg(0);
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    skipMessage(ss, frame);
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    Acquisition wrong_id;
+    BOOST_CHECK_THROW(deserialize(ss, frame, wrong_id), std::runtime_error);
+    skipMessage(ss, frame);
+
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    Acquisition acq;
+    deserialize(ss, frame, acq);
+    check_acquisition(acq, 2);
+
+    // The data type of an image can be looked up before reading the data
+    ss.clear();
+    ss.seekg(0);
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    skipMessage(ss, frame);
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    ImageHeader head;
+    deserializeImageHeader(ss, frame, head);
+    BOOST_CHECK_EQUAL(head.data_type, ISMRMRD_SHORT);
+    Image<int16_t> im_read;
+    deserializeImageData(ss, frame, head, im_read);
+    BOOST_CHECK_EQUAL(im_read.getMatrixSizeX(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(test_serialize_length_mismatch)
+{
+    // An acquisition followed by bytes its header does not account for
+    std::stringstream one;
+    serialize(make_acquisition(1), one);
+    std::string bytes = one.str();
+    MessageFrame frame;
+    memcpy(&frame, bytes.data(), sizeof(frame));
+    frame.length += 4;
+    memcpy(&bytes[0], &frame, sizeof(frame));
+    bytes.append(4, 'x');
+
+    // An array whose dimensions overflow, with a few bytes of data
+    uint16_t array_head[4] = {0, ISMRMRD_FLOAT, 3, 0};
+    uint64_t dims[ISMRMRD_NDARRAY_MAXDIM] = {uint64_t(1) << 32, uint64_t(1) << 32, uint64_t(1) << 32};
+    frame.id = ISMRMRD_MESSAGE_NDARRAY;
+    frame.version = ISMRMRD_MESSAGE_VERSION;
+    frame.reserved = 0;
+    frame.length = sizeof(array_head) + sizeof(dims) + 16;
+    bytes.append(reinterpret_cast<const char *>(&frame), sizeof(frame));
+    bytes.append(reinterpret_cast<const char *>(array_head), sizeof(array_head));
+    bytes.append(reinterpret_cast<const char *>(dims), sizeof(dims));
+    bytes.append(16, '\0');
+
+    std::stringstream ss;
+    ss.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    serialize(Image<int16_t>(4, 4), ss);
+    serialize(make_acquisition(2), ss);
+
+    // Each bad message is skipped, so the stream stays in sync
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    Acquisition acq;
+    BOOST_CHECK_THROW(deserialize(ss, frame, acq), std::runtime_error);
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    NDArray<float> arr;
+    BOOST_CHECK_THROW(deserialize(ss, frame, arr), std::runtime_error);
+    BOOST_CHECK_EQUAL(arr.getNDim(), 0);
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    Image<float> wrong_type;
+    BOOST_CHECK_THROW(deserialize(ss, frame, wrong_type), std::runtime_error);
+    BOOST_REQUIRE(readMessageFrame(ss, frame));
+    deserialize(ss, frame, acq);
+    check_acquisition(acq, 2);
+    BOOST_CHECK(!readMessageFrame(ss, frame));
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE(test_serialize_fd_throughput)
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    const uint32_t count = 20000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::thread writer([&]() {
+        serializeHeader("<ismrmrdHeader></ismrmrdHeader>", fds[0]);
+        for (uint32_t n = 0; n < count; n++) {
+            serialize(make_acquisition(n), fds[0]);
+        }
+        std::vector<size_t> dims(2, 16);
+        serialize(NDArray<float>(dims), fds[0]);
+        serializeClose(fds[0]);
+        close(fds[0]);
+    });
+
+    MessageFrame frame;
+    uint32_t received = 0;
+    bool closed = false;
+    std::string xml;
+    Acquisition acq;
+    NDArray<float> arr;
+    while (readMessageFrame(fds[1], frame)) {
+        if (frame.id == ISMRMRD_MESSAGE_HEADER) {
+            deserializeHeader(fds[1], frame, xml);
+        } else if (frame.id == ISMRMRD_MESSAGE_ACQUISITION) {
+            deserialize(fds[1], frame, acq);
+            BOOST_REQUIRE_EQUAL(acq.scan_counter(), received);
+            if (received % 1000 == 0) {
+                check_acquisition(acq, received);
+            }
+            received++;
+        } else if (frame.id == ISMRMRD_MESSAGE_NDARRAY) {
+            deserialize(fds[1], frame, arr);
+        } else if (frame.id == ISMRMRD_MESSAGE_CLOSE) {
+            closed = true;
+        } else {
+            skipMessage(fds[1], frame);
+        }
+    }
+    writer.join();
+    close(fds[1]);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    BOOST_CHECK_EQUAL(xml, "<ismrmrdHeader></ismrmrdHeader>");
+    BOOST_CHECK_EQUAL(received, count);
+    BOOST_CHECK_EQUAL(arr.getNumberOfElements(), 256);
+    BOOST_CHECK(closed);
+    double mbytes = count * (sizeof(ISMRMRD_AcquisitionHeader) + acq.getDataSize() + acq.getTrajSize()) / 1e6;
+    BOOST_TEST_MESSAGE("Sent " << count << " acquisitions over a socket at " << mbytes / seconds << " MB/s");
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,237 @@
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/shm_ring.h"
+#include "ismrmrd/version.h"
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace ISMRMRD;
+
+BOOST_AUTO_TEST_SUITE(ShmRingTest)
+
+static std::string ring_name(const char *test)
+{
+    std::stringstream name;
+    name << "/ismrmrd_test_" << test << "_" << getpid();
+    return name.str();
+}
+
+// Removes the ring at the end of a test
+struct RingFixture {
+    RingFixture(const char *test, size_t capacity) : name(ring_name(test)) {
+        createAcquisitionRing(name, capacity);
+    }
+    ~RingFixture() {
+        removeAcquisitionRing(name);
+    }
+    std::string name;
+};
+
+static void fill(AcquisitionSlot &slot, uint32_t scan)
+{
+    slot.head->scan_counter = scan;
+    for (size_t n = 0; n < static_cast<size_t>(slot.head->number_of_samples) * slot.head->active_channels; n++) {
+        slot.data[n] = complex_float_t(static_cast<float>(n), static_cast<float>(scan));
+    }
+    for (size_t n = 0; n < static_cast<size_t>(slot.head->number_of_samples) * slot.head->trajectory_dimensions; n++) {
+        slot.traj[n] = static_cast<float>(scan);
+    }
+}
+
+static void check(const AcquisitionView &view, uint32_t scan)
+{
+    BOOST_REQUIRE(view.isValid());
+    BOOST_CHECK_EQUAL(view.getHead().scan_counter, scan);
+    size_t last = view.getNumberOfDataElements() - 1;
+    BOOST_CHECK_EQUAL(view.getDataPtr()[last], complex_float_t(static_cast<float>(last), static_cast<float>(scan)));
+    if (view.getNumberOfTrajElements() > 0) {
+        BOOST_CHECK_EQUAL(view.getTrajPtr()[view.getNumberOfTrajElements() - 1], static_cast<float>(scan));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_shm_ring_in_place)
+{
+    RingFixture ring("in_place", 1 << 20);
+    AcquisitionRingConsumer consumer(ring.name);
+    AcquisitionRingProducer producer(ring.name);
+
+    AcquisitionSlot slot;
+    BOOST_REQUIRE(producer.reserve(128, 4, 2, slot));
+    BOOST_CHECK_EQUAL(slot.head->number_of_samples, 128);
+    BOOST_CHECK_EQUAL(slot.head->version, ISMRMRD_VERSION_MAJOR);
+    fill(slot, 11);
+
+    // Nothing is visible before the commit
+    AcquisitionView view;
+    BOOST_CHECK(!consumer.next(view, 0));
+    BOOST_CHECK(!consumer.isFinished());
+    producer.commit(slot);
+    BOOST_CHECK(consumer.pending() > 0);
+
+    BOOST_REQUIRE(consumer.next(view, 0));
+    check(view, 11);
+    BOOST_CHECK_EQUAL(view.getNumberOfTrajElements(), 256u);
+    BOOST_CHECK_EQUAL(view.traj(1, 127), 11.0f);
+
+    Acquisition acq;
+    view.copyTo(acq);
+    BOOST_CHECK_EQUAL(acq.scan_counter(), 11u);
+    BOOST_CHECK_EQUAL(acq.data(127, 3), view.data(127, 3));
+    consumer.release(view);
+    BOOST_CHECK(!view.isValid());
+
+    // A second consumer is refused
+    BOOST_CHECK_THROW(AcquisitionRingConsumer other(ring.name), std::runtime_error);
+    // As is a record that could not fit
+    BOOST_CHECK_THROW(producer.reserve(32768, 16, 0, slot), std::runtime_error);
+
+    producer.close();
+    BOOST_CHECK(!consumer.next(view, 0));
+    BOOST_CHECK(consumer.isFinished());
+}
+
+BOOST_AUTO_TEST_CASE(test_shm_ring_wrap_and_release_out_of_order)
+{
+    // Room for a handful of records, so the ring wraps often
+    RingFixture ring("wrap", 16 * 1024);
+    AcquisitionRingConsumer consumer(ring.name);
+    AcquisitionRingProducer producer(ring.name);
+
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    AcquisitionView held[2];
+    while (received < 500) {
+        // Fill the ring, samples vary so records land at uneven offsets
+        AcquisitionSlot slot;
+        while (sent < 500 && producer.reserve(static_cast<uint16_t>(40 + sent % 37), 2, 1, slot, 0)) {
+            // Data and trajectory start on cache lines wherever the record is
+            BOOST_CHECK(ismrmrd_is_aligned(slot.data, 64));
+            BOOST_CHECK(ismrmrd_is_aligned(slot.traj, 64));
+            fill(slot, sent++);
+            producer.commit(slot);
+        }
+        // Take two, release the newer first
+        BOOST_REQUIRE(consumer.next(held[0], 0));
+        BOOST_CHECK(ismrmrd_is_aligned(held[0].getTrajPtr(), 64));
+        check(held[0], received++);
+        if (consumer.next(held[1], 0)) {
+            check(held[1], received++);
+            consumer.release(held[1]);
+        }
+        consumer.release(held[0]);
+    }
+    BOOST_CHECK_EQUAL(consumer.pending(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_shm_ring_abandon)
+{
+    RingFixture ring("abandon", 1 << 20);
+    AcquisitionRingConsumer consumer(ring.name);
+    AcquisitionRingProducer producer(ring.name);
+
+    AcquisitionSlot first;
+    AcquisitionSlot second;
+    BOOST_REQUIRE(producer.reserve(64, 2, 0, first));
+    BOOST_REQUIRE(producer.reserve(64, 2, 0, second));
+    fill(second, 2);
+
+    // The second waits for the first, and stays reserved when that times out
+    BOOST_CHECK_THROW(producer.commit(second, 1000), std::runtime_error);
+    BOOST_CHECK(second.head != NULL);
+    producer.abandon(first);
+    producer.commit(second);
+
+    AcquisitionView view;
+    BOOST_REQUIRE(consumer.next(view, 0));
+    check(view, 2);
+    consumer.release(view);
+    BOOST_CHECK(!consumer.next(view, 0));
+}
+
+BOOST_AUTO_TEST_CASE(test_shm_ring_consumer_died)
+{
+    RingFixture ring("consumer_died", 1 << 20);
+    AcquisitionRingProducer producer(ring.name);
+    AcquisitionSlot slot;
+    BOOST_REQUIRE(producer.reserve(64, 2, 0, slot));
+    fill(slot, 5);
+    producer.commit(slot);
+
+    // The child views the record and exits without releasing it or detaching
+    pid_t child = fork();
+    BOOST_REQUIRE(child >= 0);
+    if (child == 0) {
+        AcquisitionRingConsumer *dying = new AcquisitionRingConsumer(ring.name);
+        AcquisitionView view;
+        _exit(dying->next(view, 1000000) ? 0 : 1);
+    }
+    int status = 0;
+    BOOST_REQUIRE_EQUAL(waitpid(child, &status, 0), child);
+    BOOST_REQUIRE(WIFEXITED(status));
+    BOOST_REQUIRE_EQUAL(WEXITSTATUS(status), 0);
+
+    // The next consumer takes over and gets the record again
+    AcquisitionRingConsumer consumer(ring.name);
+    AcquisitionView view;
+    BOOST_REQUIRE(consumer.next(view, 0));
+    check(view, 5);
+    consumer.release(view);
+    BOOST_CHECK_EQUAL(consumer.pending(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_shm_ring_producers_throughput)
+{
+    RingFixture ring("throughput", 8 << 20);
+    AcquisitionRingConsumer consumer(ring.name);
+
+    // Both attach before either can finish, the stream ends when both have closed
+    const uint32_t per_producer = 20000;
+    AcquisitionRingProducer producer0(ring.name);
+    AcquisitionRingProducer producer1(ring.name);
+    AcquisitionRingProducer *producers[2] = {&producer0, &producer1};
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < 2; p++) {
+        threads.push_back(std::thread([&producers, p, per_producer]() {
+            AcquisitionRingProducer &producer = *producers[p];
+            Acquisition acq(256, 8);
+            for (uint32_t n = 0; n < per_producer; n++) {
+                acq.scan_counter() = n;
+                acq.idx().slice = static_cast<uint16_t>(p);
+                producer.push(acq);
+            }
+            producer.close();
+        }));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint32_t next_scan[2] = {0, 0};
+    uint64_t received = 0;
+    uint64_t bytes = 0;
+    AcquisitionView view;
+    while (!consumer.isFinished() || consumer.pending() > 0) {
+        if (!consumer.next(view)) {
+            continue;
+        }
+        // Each producer's records arrive in the order they were pushed
+        uint16_t p = view.getHead().idx.slice;
+        BOOST_REQUIRE(p < 2);
+        BOOST_REQUIRE_EQUAL(view.getHead().scan_counter, next_scan[p]);
+        next_scan[p]++;
+        bytes += sizeof(ISMRMRD_AcquisitionHeader) + view.getDataSize();
+        received++;
+        consumer.release(view);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (size_t n = 0; n < threads.size(); n++) {
+        threads[n].join();
+    }
+    BOOST_CHECK_EQUAL(received, 2 * per_producer);
+    BOOST_TEST_MESSAGE("Moved " << received << " acquisitions through the ring at "
+                       << bytes / 1e6 / seconds << " MB/s");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
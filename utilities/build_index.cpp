@@ -0,0 +1,56 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double ms_since(const Clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cout << "Builds or updates the acquisition index of a dataset" << std::endl;
+        std::cout << "Usage: " << std::endl;
+        std::cout << "  " << argv[0] << " <FILENAME> [GROUP]" << std::endl;
+        return -1;
+    }
+    std::string group = argc > 2 ? argv[2] : "dataset";
+
+    try {
+        ISMRMRD::Dataset d(argv[1], group.c_str(), false);
+        uint32_t nacq = d.getNumberOfAcquisitions();
+
+        Clock::time_point start = Clock::now();
+        d.updateAcquisitionIndex();
+        std::cout << "Indexed " << nacq << " acquisitions in " << ms_since(start) << " ms" << std::endl;
+
+        // Summary of the slices, each one a single index query
+        ISMRMRD::ISMRMRD_AcquisitionIndexQuery query;
+        ISMRMRD::ismrmrd_init_acquisition_index_query(&query);
+        ISMRMRD::ismrmrd_set_flag(&query.flags_set, ISMRMRD::ISMRMRD_ACQ_IS_NOISE_MEASUREMENT);
+        std::cout << "Noise acquisitions: " << d.queryAcquisitionIndex(query).size() << std::endl;
+
+        ISMRMRD::ismrmrd_init_acquisition_index_query(&query);
+        uint32_t found = 0;
+        for (int32_t slice = 0; found < nacq && slice <= 0xFFFF; slice++) {
+            query.slice = slice;
+            size_t n = d.queryAcquisitionIndex(query).size();
+            if (n > 0) {
+                std::cout << "Slice " << slice << ": " << n << " acquisitions" << std::endl;
+                found += static_cast<uint32_t>(n);
+            }
+        }
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
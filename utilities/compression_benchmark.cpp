@@ -0,0 +1,164 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(const Clock::time_point &start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double file_size(const std::string &filename)
+{
+    std::ifstream f(filename.c_str(), std::ios::binary | std::ios::ate);
+    return f ? static_cast<double>(f.tellg()) : 0.0;
+}
+
+struct NamedPolicy {
+    const char *name;
+    uint16_t shuffle;
+    uint16_t deflate_level;
+};
+
+// Writes the readouts with the policy and reports ratio and throughput.
+// As arrays the payload lives in the chunks and is filtered, as acquisitions
+// it lives in the global heap and is not.
+static void run(const std::string &filename, const std::vector<ISMRMRD::Acquisition> &readouts,
+                const NamedPolicy &named, bool as_acquisitions)
+{
+    ISMRMRD::ISMRMRD_StoragePolicy policy;
+    ISMRMRD::ismrmrd_init_storage_policy(&policy);
+    policy.shuffle = named.shuffle;
+    policy.deflate_level = named.deflate_level;
+
+    std::vector<size_t> dims(2);
+    dims[0] = readouts[0].getHead().number_of_samples;
+    dims[1] = readouts[0].getHead().active_channels;
+    ISMRMRD::NDArray<complex_float_t> arr(dims);
+
+    double bytes = 0;
+    for (size_t n = 0; n < readouts.size(); n++) {
+        bytes += readouts[n].getDataSize();
+    }
+
+    double write_secs, read_secs;
+    std::remove(filename.c_str());
+    {
+        ISMRMRD::Dataset d(filename.c_str(), "dataset", true, policy);
+        Clock::time_point start = Clock::now();
+        if (as_acquisitions) {
+            d.appendAcquisitions(readouts);
+        } else {
+            for (size_t n = 0; n < readouts.size(); n++) {
+                std::copy(readouts[n].data_begin(), readouts[n].data_end(), arr.begin());
+                d.appendNDArray("readouts", arr);
+            }
+        }
+        write_secs = seconds_since(start);
+    }
+    {
+        ISMRMRD::Dataset d(filename.c_str(), "dataset", false);
+        Clock::time_point start = Clock::now();
+        if (as_acquisitions) {
+            std::vector<ISMRMRD::Acquisition> acqs;
+            d.readAcquisitions(0, static_cast<uint32_t>(readouts.size()), acqs);
+        } else {
+            for (size_t n = 0; n < readouts.size(); n++) {
+                d.readNDArray("readouts", static_cast<uint32_t>(n), arr);
+            }
+        }
+        read_secs = seconds_since(start);
+    }
+
+    const double mb = 1024.0 * 1024.0;
+    std::cout << std::setw(14) << (as_acquisitions ? "acquisitions" : "arrays")
+              << std::setw(18) << named.name
+              << std::fixed << std::setprecision(2) << std::setw(8) << bytes / file_size(filename)
+              << std::setprecision(0) << std::setw(12) << bytes / mb / write_secs
+              << std::setw(12) << bytes / mb / read_secs << std::endl;
+}
+
+static void run_all(const std::string &filename, const std::vector<ISMRMRD::Acquisition> &readouts)
+{
+    const NamedPolicy policies[] = {
+        {"none", 0, 0},
+        {"shuffle", 1, 0},
+        {"deflate 1", 0, 1},
+        {"shuffle+deflate 1", 1, 1},
+        {"shuffle+deflate 6", 1, 6}
+    };
+
+    std::cout << std::setw(14) << "LAYOUT" << std::setw(18) << "FILTERS" << std::setw(8) << "RATIO"
+              << std::setw(12) << "WRITE MB/s" << std::setw(12) << "READ MB/s" << std::endl;
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+        run(filename, readouts, policies[p], false);
+    }
+    run(filename, readouts, policies[3], true);
+    std::remove(filename.c_str());
+}
+
+int main(int argc, char** argv)
+{
+    std::cout << "Compression benchmark" << std::endl;
+
+    if (argc < 2) {
+        std::cout << "Usage: " << std::endl;
+        std::cout << "  " << argv[0] << " <SCRATCH_FILENAME> [INPUT_FILENAME]" << std::endl;
+        std::cout << "  e.g. the output of ismrmrd_generate_cartesian_shepp_logan as input" << std::endl;
+        return -1;
+    }
+    std::string filename(argv[1]);
+
+    std::vector<ISMRMRD::Acquisition> readouts;
+    if (argc > 2) {
+        ISMRMRD::Dataset input(argv[2], "dataset", false);
+        uint32_t nacq = input.getNumberOfAcquisitions();
+        input.readAcquisitions(0, nacq, readouts);
+        // Arrays need one shape, keep the readouts that match the first
+        size_t kept = 0;
+        for (size_t n = 0; n < readouts.size(); n++) {
+            if (readouts[n].number_of_samples() == readouts[0].number_of_samples() &&
+                readouts[n].active_channels() == readouts[0].active_channels()) {
+                std::swap(readouts[kept++], readouts[n]);
+            }
+        }
+        readouts.resize(kept);
+        if (readouts.empty()) {
+            std::cout << "No acquisitions in " << argv[2] << std::endl;
+            return -1;
+        }
+        std::cout << std::endl << argv[2] << ": " << readouts.size() << " readouts of "
+                  << readouts[0].number_of_samples() << " samples x "
+                  << readouts[0].active_channels() << " channels" << std::endl;
+        run_all(filename, readouts);
+    }
+
+    // Random noise, the worst case for any compressor
+    size_t nnoise = readouts.empty() ? 10000 : readouts.size();
+    uint16_t samples = readouts.empty() ? 128 : readouts[0].number_of_samples();
+    uint16_t channels = readouts.empty() ? 8 : readouts[0].active_channels();
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    readouts.resize(nnoise);
+    for (size_t n = 0; n < nnoise; n++) {
+        readouts[n].resize(samples, channels);
+        for (complex_float_t *p = readouts[n].data_begin(); p != readouts[n].data_end(); ++p) {
+            *p = complex_float_t(noise(rng), noise(rng));
+        }
+    }
+    std::cout << std::endl << "Random noise: " << nnoise << " readouts of " << samples
+              << " samples x " << channels << " channels" << std::endl;
+    run_all(filename, readouts);
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+
+using namespace ISMRMRD;
+
+typedef std::chrono::steady_clock Clock;
+
+// Acquisitions copied per call
+static const uint32_t BATCH = 1024;
+
+static double seconds_since(const Clock::time_point &start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static bool check(int status)
+{
+    if (status != ISMRMRD_NOERROR) {
+        char *file, *func, *msg;
+        int line, code;
+        while (ismrmrd_pop_error(&file, &line, &func, &code, &msg)) {
+            std::cerr << file << ":" << line << " " << func << ": " << msg << std::endl;
+        }
+        return false;
+    }
+    return true;
+}
+
+static bool open_dataset(ISMRMRD_Dataset &dset, const char *filename, const char *group,
+                         const ISMRMRD_DatasetBackend *backend, bool create)
+{
+    return check(ismrmrd_init_dataset(&dset, filename, group)) &&
+           check(ismrmrd_set_dataset_backend(&dset, backend)) &&
+           check(ismrmrd_open_dataset(&dset, create));
+}
+
+static bool copy_acquisitions(ISMRMRD_Dataset &in, ISMRMRD_Dataset &out)
+{
+    uint32_t nacq = ismrmrd_get_number_of_acquisitions(&in);
+    std::vector<ISMRMRD_Acquisition> acqs(std::min(nacq, BATCH));
+    for (size_t i = 0; i < acqs.size(); i++) {
+        ismrmrd_init_acquisition(&acqs[i]);
+    }
+    bool ok = true;
+    for (uint32_t start = 0; ok && start < nacq; start += BATCH) {
+        uint32_t count = std::min(BATCH, nacq - start);
+        ok = check(ismrmrd_read_acquisitions(&in, start, count, &acqs[0])) &&
+             check(ismrmrd_append_acquisitions(&out, &acqs[0], count));
+    }
+    for (size_t i = 0; i < acqs.size(); i++) {
+        ismrmrd_cleanup_acquisition(&acqs[i]);
+    }
+    return ok;
+}
+
+static bool copy_waveforms(ISMRMRD_Dataset &in, ISMRMRD_Dataset &out)
+{
+    uint32_t nwav = ismrmrd_get_number_of_waveforms(&in);
+    ISMRMRD_Waveform wav;
+    ismrmrd_init_waveform(&wav);
+    bool ok = true;
+    for (uint32_t n = 0; ok && n < nwav; n++) {
+        ok = check(ismrmrd_read_waveform(&in, n, &wav)) && check(ismrmrd_append_waveform(&out, &wav));
+    }
+    ismrmrd_free(wav.data);
+    return ok;
+}
+
+// Copies var as images if it holds any, as arrays otherwise
+static bool copy_variable(ISMRMRD_Dataset &in, ISMRMRD_Dataset &out, const char *var)
+{
+    bool ok = true;
+    uint32_t nims = ismrmrd_get_number_of_images(&in, var);
+    if (nims > 0) {
+        ISMRMRD_Image im;
+        ismrmrd_init_image(&im);
+        for (uint32_t n = 0; ok && n < nims; n++) {
+            ok = check(ismrmrd_read_image(&in, var, n, &im)) && check(ismrmrd_append_image(&out, var, &im));
+        }
+        ismrmrd_cleanup_image(&im);
+        std::cout << var << ": " << nims << " images" << std::endl;
+        return ok;
+    }
+
+    uint32_t narr = ismrmrd_get_number_of_arrays(&in, var);
+    ISMRMRD_NDArray arr;
+    ismrmrd_init_ndarray(&arr);
+    for (uint32_t n = 0; ok && n < narr; n++) {
+        ok = check(ismrmrd_read_array(&in, var, n, &arr)) && check(ismrmrd_append_array(&out, var, &arr));
+    }
+    ismrmrd_cleanup_ndarray(&arr);
+    std::cout << var << ": " << narr << " arrays" << std::endl;
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    std::string direction = argc > 1 ? argv[1] : "";
+    if (argc < 4 || (direction != "to-log" && direction != "to-hdf5")) {
+        std::cout << "Converts a dataset between the HDF5 and the append-only log format" << std::endl;
+        std::cout << "Usage: " << std::endl;
+        std::cout << "  " << argv[0] << " <to-log|to-hdf5> <INPUT> <OUTPUT> [GROUP] [VARIABLE...]" << std::endl;
+        std::cout << "The header, acquisitions and waveforms are always copied, the image" << std::endl;
+        std::cout << "and array variables only when they are listed." << std::endl;
+        return -1;
+    }
+    const char *group = argc > 4 ? argv[4] : "dataset";
+    const ISMRMRD_DatasetBackend *log = ismrmrd_log_backend();
+    const ISMRMRD_DatasetBackend *hdf5 = ismrmrd_hdf5_backend();
+    bool to_log = direction == "to-log";
+
+    ISMRMRD_Dataset in, out;
+    if (!open_dataset(in, argv[2], group, to_log ? hdf5 : log, false)) {
+        return -1;
+    }
+    if (!open_dataset(out, argv[3], group, to_log ? log : hdf5, true)) {
+        ismrmrd_close_dataset(&in);
+        return -1;
+    }
+
+    Clock::time_point start = Clock::now();
+    bool ok = true;
+    char *xml = ismrmrd_read_header(&in);
+    if (xml != NULL) {
+        ok = check(ismrmrd_write_header(&out, xml));
+        free(xml);
+    } else {
+        // A dataset without a header is still converted
+        char *file, *func, *msg;
+        int line, code;
+        while (ismrmrd_pop_error(&file, &line, &func, &code, &msg)) {
+        }
+    }
+    ok = ok && copy_acquisitions(in, out) && copy_waveforms(in, out);
+    for (int n = 5; ok && n < argc; n++) {
+        ok = copy_variable(in, out, argv[n]);
+    }
+    std::cout << ismrmrd_get_number_of_acquisitions(&out) << " acquisitions, "
+              << ismrmrd_get_number_of_waveforms(&out) << " waveforms" << std::endl;
+
+    ok = check(ismrmrd_close_dataset(&out)) && ok;
+    ismrmrd_close_dataset(&in);
+    if (!ok) {
+        return -1;
+    }
+    std::cout << "Converted in " << seconds_since(start) << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * ismrmrd_fftshift.h
+ *
+ *  Shifts of the utilities' 2D FFTs, kept apart from FFTW so they can be
+ *  tested without it.
+ */
+
+#ifndef ISMRMRD_FFTSHIFT_H
+#define ISMRMRD_FFTSHIFT_H
+
+#include <algorithm>
+
+namespace ISMRMRD {
+
+template<typename TI, typename TO> void circshift(TO *out, const TI *in, int xdim, int ydim, int xshift, int yshift)
+{
+  for (int i =0; i < ydim; i++) {
+    int ii = (i + yshift) % ydim;
+    for (int j = 0; j < xdim; j++) {
+      int jj = (j + xshift) % xdim;
+      out[ii * xdim + jj] = in[i * xdim + j];
+    }
+  }
+}
+
+#define fftshift(out, in, x, y) circshift(out, in, x, y, (x/2), (y/2))
+
+// Swaps the quadrants of an image, which is fftshift for even sizes
+template<typename T> void fftshift_in_place(T *data, int xdim, int ydim)
+{
+  for (int i = 0; i < ydim / 2; i++) {
+    int ii = i + ydim / 2;
+    for (int j = 0; j < xdim; j++) {
+      int jj = (j + xdim / 2) % xdim;
+      std::swap(data[i * xdim + j], data[ii * xdim + jj]);
+    }
+  }
+}
+
+}
+
+#endif // ISMRMRD_FFTSHIFT_H
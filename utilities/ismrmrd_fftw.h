@@ -6,23 +6,10 @@
  */
 
 #include "fftw3.h"
+#include "ismrmrd_fftshift.h"
 
 namespace ISMRMRD {
 
-template<typename TI, typename TO> void circshift(TO *out, const TI *in, int xdim, int ydim, int xshift, int yshift)
-{
-  for (int i =0; i < ydim; i++) {
-    int ii = (i + yshift) % ydim;
-    for (int j = 0; j < xdim; j++) {
-      int jj = (j + xshift) % xdim;
-      out[ii * xdim + jj] = in[i * xdim + j];
-    }
-  }
-}
-
-#define fftshift(out, in, x, y) circshift(out, in, x, y, (x/2), (y/2))
-
-
 int fft2c(NDArray<complex_float_t> &a, bool forward)
 {
     if (a.getNDim() < 2) {
@@ -33,6 +20,30 @@ int fft2c(NDArray<complex_float_t> &a, bool forward)
 	size_t elements =  a.getDims()[0]*a.getDims()[1];
 	size_t ffts = a.getNumberOfElements()/elements;
 
+	if (a.isAligned() && a.getDims()[0] % 2 == 0 && a.getDims()[1] % 2 == 0) {
+            //Aligned data of even size is shifted and transformed in place, with one plan for all images
+            int dims[2] = {static_cast<int>(a.getDims()[1]), static_cast<int>(a.getDims()[0])};
+            fftwf_complex* data = reinterpret_cast<fftwf_complex*>(a.getDataPtr());
+            fftwf_plan p = fftwf_plan_many_dft(2, dims, static_cast<int>(ffts),
+                                               data, NULL, 1, static_cast<int>(elements),
+                                               data, NULL, 1, static_cast<int>(elements),
+                                               forward ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+            for (size_t f = 0; f < ffts; f++) {
+                fftshift_in_place(a.getDataPtr() + f*elements, dims[1], dims[0]);
+            }
+            fftwf_execute(p);
+            for (size_t f = 0; f < ffts; f++) {
+                fftshift_in_place(a.getDataPtr() + f*elements, dims[1], dims[0]);
+            }
+            fftwf_destroy_plan(p);
+
+            std::complex<float> scale(std::sqrt(1.0f*elements),0.0);
+            for (size_t n=0; n<a.getNumberOfElements(); n++) {
+                a.getDataPtr()[n] /= scale;
+            }
+            return 0;
+	}
+
 	//Array for transformation
 	fftwf_complex* tmp = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*a.getNumberOfElements());
 
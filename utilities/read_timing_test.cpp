@@ -4,8 +4,12 @@
 #include <sys/time.h>
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "ismrmrd/ismrmrd.h"
 #include "ismrmrd/dataset.h"
@@ -17,7 +21,7 @@ public:
 
   Timer() { Timer("Timer"); }
 
-  Timer(const char* name) : name_(name) {
+  Timer(const char* name, size_t calls = 0) : name_(name), calls_(calls) {
     pre();
 #ifdef WIN32
     QueryPerformanceFrequency(&frequency_);
@@ -37,7 +41,11 @@ public:
     gettimeofday(&end_, NULL);
     time_in_us = ((end_.tv_sec * 1e6) + end_.tv_usec) - ((start_.tv_sec * 1e6) + start_.tv_usec);
 #endif
-    std::cout << name_ << ": " << time_in_us/1000.0 << " ms" << std::endl; std::cout.flush();
+    std::cout << name_ << ": " << time_in_us/1000.0 << " ms";
+    if (calls_ > 0) {
+      std::cout << " (" << time_in_us/calls_ << " us/call)";
+    }
+    std::cout << std::endl; std::cout.flush();
   }
 
   virtual void pre() { }
@@ -55,6 +63,7 @@ protected:
 #endif
 
   std::string name_;
+  size_t calls_;
 };
 
 
@@ -62,24 +71,94 @@ int main(int argc, char** argv)
 {
   std::cout << "File reader timing test" << std::endl;
 
-  if (argc != 2) {
+  if (argc < 2) {
     std::cout << "Usage: " << std::endl;
-    std::cout << "  " << argv[0] << " <FILENAME>" << std::endl;
-  } 
+    std::cout << "  " << argv[0] << " <FILENAME> [BLOCK_SIZE] [COMPUTE_US]" << std::endl;
+    return -1;
+  }
+
+  uint32_t block_size = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], NULL, 10)) : 1024;
+  if (block_size == 0) {
+    block_size = 1;
+  }
+  // Simulated reconstruction work per acquisition for the stream test
+  long compute_us = argc > 3 ? std::strtol(argv[3], NULL, 10) : 10;
 
   std::cout << "Opening file " << argv[1] << std::endl;
 
 
+  uint32_t number_of_acquisitions = 0;
+  {
+    ISMRMRD::Dataset d(argv[1],"dataset", false);
+    number_of_acquisitions = d.getNumberOfAcquisitions();
+  }
+  std::cout << "Number of acquisitions: " << number_of_acquisitions << std::endl;
+
   {
-    Timer t("READ TIMER");
+    Timer t("READ TIMER", number_of_acquisitions);
     ISMRMRD::Dataset d(argv[1],"dataset", false);
-    uint32_t number_of_acquisitions = d.getNumberOfAcquisitions();
     ISMRMRD::Acquisition acq;
     for (uint32_t i = 0; i < number_of_acquisitions; i++) {
         d.readAcquisition(i, acq);
         //We'll just throw the data away here. 
     }
   }
+
+  {
+    // Calls which do no I/O, this is the per-call overhead of the library
+    ISMRMRD::Dataset d(argv[1],"dataset", false);
+    Timer t("METADATA TIMER", number_of_acquisitions);
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < number_of_acquisitions; i++) {
+        n += d.getNumberOfAcquisitions();
+    }
+    if (n == 0) {
+        std::cout << "Empty dataset" << std::endl;
+    }
+  }
+
+  {
+    Timer t("RANGE READ TIMER", number_of_acquisitions);
+    ISMRMRD::Dataset d(argv[1],"dataset", false);
+    std::vector<ISMRMRD::Acquisition> acqs;
+    for (uint32_t i = 0; i < number_of_acquisitions; i += block_size) {
+        uint32_t count = std::min(block_size, number_of_acquisitions - i);
+        d.readAcquisitions(i, count, acqs);
+        //We'll just throw the data away here.
+    }
+  }
+
+  {
+    Timer t("HEADER READ TIMER", number_of_acquisitions);
+    ISMRMRD::Dataset d(argv[1],"dataset", false);
+    std::vector<ISMRMRD::AcquisitionHeader> heads;
+    for (uint32_t i = 0; i < number_of_acquisitions; i += block_size) {
+        uint32_t count = std::min(block_size, number_of_acquisitions - i);
+        d.readAcquisitionHeaders(i, count, heads);
+    }
+  }
+
+  {
+    ISMRMRD::AcquisitionStreamStats stats;
+    {
+      Timer t("STREAM TIMER", number_of_acquisitions);
+      ISMRMRD::AcquisitionStream stream(argv[1], "dataset", block_size, 4);
+      ISMRMRD::Acquisition acq;
+      while (stream.next(acq)) {
+        std::chrono::steady_clock::time_point end =
+            std::chrono::steady_clock::now() + std::chrono::microseconds(compute_us);
+        while (std::chrono::steady_clock::now() < end) {
+          // Busy, as a reconstruction would be
+        }
+      }
+      stats = stream.stats();
+    }
+    std::cout << "  read " << stats.read_time * 1000.0 << " ms, reader stalled "
+              << stats.stall_time * 1000.0 << " ms, consumer waited "
+              << stats.wait_time * 1000.0 << " ms, "
+              << compute_us << " us compute per acquisition" << std::endl;
+    std::cout << "  overlap " << stats.overlap() * 100.0 << "% of the read time" << std::endl;
+  }
   
   return 0;
 }
@@ -6,6 +6,7 @@
  *
  */
 
+#include <algorithm>
 #include <iostream>
 #include "ismrmrd/ismrmrd.h"
 #include "ismrmrd/dataset.h"
@@ -97,14 +98,19 @@ int main(int argc, char** argv)
     memset(buffer.getDataPtr(), 0, sizeof(complex_float_t)*nX*nY*nCoils);
     
     //Now loop through and copy data
-    unsigned int number_of_acquisitions = d.getNumberOfAcquisitions();
-    for (unsigned int i = 0; i < number_of_acquisitions; i++) {
-        //Read one acquisition at a time
-        d.readAcquisition(i, acq);
-
-        //Copy data, we should probably be more careful here and do more tests....
-        for (uint16_t c=0; c<nCoils; c++) {
-            memcpy(&buffer(0,acq.idx().kspace_encode_step_1,c), &acq.data(0, c), sizeof(complex_float_t)*nX);
+    const uint32_t block_size = 256;
+    std::vector<ISMRMRD::Acquisition> acqs;
+    uint32_t number_of_acquisitions = d.getNumberOfAcquisitions();
+    for (uint32_t i = 0; i < number_of_acquisitions; i += block_size) {
+        //Read a block of acquisitions at a time
+        uint32_t count = std::min(block_size, number_of_acquisitions - i);
+        d.readAcquisitions(i, count, acqs);
+
+        for (uint32_t n = 0; n < count; n++) {
+            //Copy data, we should probably be more careful here and do more tests....
+            for (uint16_t c=0; c<nCoils; c++) {
+                memcpy(&buffer(0,acqs[n].idx().kspace_encode_step_1,c), &acqs[n].data(0, c), sizeof(complex_float_t)*nX);
+            }
         }
     }
 
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(const Clock::time_point &start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double file_size_mb(const std::string &filename)
+{
+    std::ifstream f(filename.c_str(), std::ios::binary | std::ios::ate);
+    return f ? static_cast<double>(f.tellg()) / (1024.0 * 1024.0) : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+    std::cout << "Storage policy benchmark" << std::endl;
+
+    if (argc < 2) {
+        std::cout << "Usage: " << std::endl;
+        std::cout << "  " << argv[0] << " <FILENAME> [READOUTS] [SAMPLES] [CHANNELS] [CACHE_MB]" << std::endl;
+        return -1;
+    }
+
+    std::string filename(argv[1]);
+    size_t nreadouts = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 20000;
+    uint16_t samples = argc > 3 ? static_cast<uint16_t>(std::atoi(argv[3])) : 128;
+    uint16_t channels = argc > 4 ? static_cast<uint16_t>(std::atoi(argv[4])) : 8;
+    size_t cache_mb = argc > 5 ? std::strtoul(argv[5], NULL, 10) : 0;
+
+    std::cout << nreadouts << " readouts of " << samples << " samples x " << channels << " channels";
+    if (cache_mb > 0) {
+        std::cout << ", " << cache_mb << " MB chunk cache";
+    }
+    std::cout << std::endl;
+
+    ISMRMRD::Acquisition acq(samples, channels);
+    std::fill(acq.data_begin(), acq.data_end(), complex_float_t(1.0f, -1.0f));
+
+    // The same payload as a fixed size array, which is stored in the chunks
+    // themselves rather than in the global heap like the acquisition data
+    std::vector<size_t> dims(2);
+    dims[0] = samples;
+    dims[1] = channels;
+    ISMRMRD::NDArray<complex_float_t> arr(dims);
+    std::fill(arr.begin(), arr.end(), complex_float_t(1.0f, -1.0f));
+
+    std::vector<uint32_t> order(nreadouts);
+    for (size_t n = 0; n < nreadouts; n++) {
+        order[n] = static_cast<uint32_t>(n);
+    }
+    std::mt19937 rng(42);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    // 0 is the chunk size from ismrmrd_suggested_chunk_elements
+    const uint32_t chunk_sizes[] = {1, 16, 64, 256, 1024, 0};
+    const char *variables[] = {"data", "array"};
+
+    for (size_t v = 0; v < 2; v++) {
+        const bool arrays = (v == 1);
+        std::cout << std::endl << (arrays ? "NDArray" : "Acquisition") << std::endl;
+        std::cout << std::setw(8) << "CHUNK" << std::setw(14) << "APPEND/s"
+                  << std::setw(14) << "SEQ READ/s" << std::setw(14) << "RAND READ/s"
+                  << std::setw(12) << "SIZE MB" << std::endl;
+
+        for (size_t c = 0; c < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); c++) {
+            ISMRMRD::ISMRMRD_StoragePolicy policy;
+            ISMRMRD::ismrmrd_init_storage_policy(&policy);
+            policy.chunk_elements = chunk_sizes[c];
+            if (chunk_sizes[c] == 0) {
+                size_t element_size = arrays ? arr.getDataSize() : sizeof(ISMRMRD::ISMRMRD_AcquisitionHeader);
+                policy.chunk_elements = ISMRMRD::ismrmrd_suggested_chunk_elements(element_size);
+            }
+            policy.chunk_cache_bytes = cache_mb * 1024 * 1024;
+
+            double append_secs, seq_secs, rand_secs;
+            std::remove(filename.c_str());
+            {
+                ISMRMRD::Dataset d(filename.c_str(), "dataset", true);
+                d.setStoragePolicy(variables[v], policy);
+                Clock::time_point start = Clock::now();
+                for (size_t n = 0; n < nreadouts; n++) {
+                    if (arrays) {
+                        d.appendNDArray(variables[v], arr);
+                    } else {
+                        acq.scan_counter() = static_cast<uint32_t>(n);
+                        d.appendAcquisition(acq);
+                    }
+                }
+                append_secs = seconds_since(start);
+            }
+            {
+                ISMRMRD::Dataset d(filename.c_str(), "dataset", false);
+                d.setStoragePolicy(variables[v], policy);
+                Clock::time_point start = Clock::now();
+                for (size_t n = 0; n < nreadouts; n++) {
+                    if (arrays) {
+                        d.readNDArray(variables[v], static_cast<uint32_t>(n), arr);
+                    } else {
+                        d.readAcquisition(static_cast<uint32_t>(n), acq);
+                    }
+                }
+                seq_secs = seconds_since(start);
+
+                start = Clock::now();
+                for (size_t n = 0; n < nreadouts; n++) {
+                    if (arrays) {
+                        d.readNDArray(variables[v], order[n], arr);
+                    } else {
+                        d.readAcquisition(order[n], acq);
+                    }
+                }
+                rand_secs = seconds_since(start);
+            }
+
+            if (chunk_sizes[c] > 0) {
+                std::cout << std::setw(8) << chunk_sizes[c];
+            } else {
+                std::cout << std::setw(8) << "suggest";
+            }
+            std::cout << std::fixed << std::setprecision(0)
+                      << std::setw(14) << nreadouts / append_secs
+                      << std::setw(14) << nreadouts / seq_secs
+                      << std::setw(14) << nreadouts / rand_secs
+                      << std::setprecision(1) << std::setw(12) << file_size_mb(filename)
+                      << std::endl;
+        }
+    }
+
+    std::remove(filename.c_str());
+    return 0;
+}
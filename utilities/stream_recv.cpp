@@ -0,0 +1,205 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+#include "ismrmrd/serialization.h"
+#include "stream_socket.h"
+
+using namespace ISMRMRD;
+using namespace stream_socket;
+
+// Writes what arrives into a dataset, or drops it when there is none
+class Receiver
+{
+public:
+    Receiver(Dataset *dset, const std::string &var, uint32_t batch_size)
+        : dset_(dset), var_(var), batch_size_(batch_size), pending_(0), readouts_(0), images_(0), waveforms_(0) {
+        batch_.resize(batch_size);
+    }
+
+    void acquisition(int fd, const MessageFrame &frame) {
+        deserialize(fd, frame, batch_[pending_]);
+        pending_++;
+        readouts_++;
+        if (pending_ == batch_size_) {
+            flush();
+        }
+    }
+
+    void waveform(int fd, const MessageFrame &frame) {
+        deserialize(fd, frame, wav_);
+        if (dset_) {
+            dset_->appendWaveform(wav_);
+        }
+        waveforms_++;
+    }
+
+    void image(int fd, const MessageFrame &frame) {
+        ImageHeader head;
+        deserializeImageHeader(fd, frame, head);
+        switch (head.data_type) {
+        case ISMRMRD_USHORT: image(fd, frame, head, im_ushort_); break;
+        case ISMRMRD_SHORT: image(fd, frame, head, im_short_); break;
+        case ISMRMRD_UINT: image(fd, frame, head, im_uint_); break;
+        case ISMRMRD_INT: image(fd, frame, head, im_int_); break;
+        case ISMRMRD_FLOAT: image(fd, frame, head, im_float_); break;
+        case ISMRMRD_DOUBLE: image(fd, frame, head, im_double_); break;
+        case ISMRMRD_CXFLOAT: image(fd, frame, head, im_cxfloat_); break;
+        case ISMRMRD_CXDOUBLE: image(fd, frame, head, im_cxdouble_); break;
+        default: throw std::runtime_error("Invalid image data type");
+        }
+        images_++;
+    }
+
+    // Appends the acquisitions received since the last call
+    void flush() {
+        if (dset_ && pending_ > 0) {
+            if (pending_ < batch_.size()) {
+                // Swapped out and back in, so the buffers are neither copied nor lost
+                std::vector<Acquisition> rest(pending_);
+                for (size_t n = 0; n < pending_; n++) {
+                    rest[n].swap(batch_[n]);
+                }
+                dset_->appendAcquisitions(rest);
+                for (size_t n = 0; n < pending_; n++) {
+                    rest[n].swap(batch_[n]);
+                }
+            } else {
+                dset_->appendAcquisitions(batch_);
+            }
+        }
+        pending_ = 0;
+    }
+
+    uint64_t readouts() const { return readouts_; }
+    uint64_t images() const { return images_; }
+    uint64_t waveforms() const { return waveforms_; }
+
+private:
+    template <typename T>
+    void image(int fd, const MessageFrame &frame, const ImageHeader &head, Image<T> &im) {
+        deserializeImageData(fd, frame, head, im);
+        if (dset_) {
+            dset_->appendImage(var_, im);
+        }
+    }
+
+    Dataset *dset_;
+    std::string var_;
+    size_t batch_size_;
+    size_t pending_;
+    uint64_t readouts_;
+    uint64_t images_;
+    uint64_t waveforms_;
+    // Reused for every message so that buffers are only allocated once
+    std::vector<Acquisition> batch_;
+    Waveform wav_;
+    Image<uint16_t> im_ushort_;
+    Image<int16_t> im_short_;
+    Image<uint32_t> im_uint_;
+    Image<int32_t> im_int_;
+    Image<float> im_float_;
+    Image<double> im_double_;
+    Image<complex_float_t> im_cxfloat_;
+    Image<complex_double_t> im_cxdouble_;
+};
+
+int main(int argc, char** argv)
+{
+    uint32_t batch_size = 256;
+    int buffer_bytes = 0;
+    int n = 1;
+    try {
+        for (; n < argc && argv[n][0] == '-'; n++) {
+            std::string option = argv[n];
+            if (option == "-b") {
+                batch_size = static_cast<uint32_t>(option_value(argc, argv, n));
+            } else if (option == "-s") {
+                buffer_bytes = static_cast<int>(option_value(argc, argv, n));
+            } else {
+                throw std::runtime_error("Unknown option " + option);
+            }
+        }
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+    if (argc - n < 1 || batch_size == 0) {
+        std::cout << "Receives a dataset from ismrmrd_stream_send" << std::endl;
+        std::cout << "Usage: " << std::endl;
+        std::cout << "  " << argv[0] << " [-b BATCH] [-s SOCKET_BUFFER] <ADDRESS> [OUTPUT] [GROUP] [VARIABLE]" << std::endl;
+        std::cout << "ADDRESS is unix:PATH or tcp:HOST:PORT. Acquisitions are appended to OUTPUT" << std::endl;
+        std::cout << "BATCH at a time (256) and images to VARIABLE (images). Without OUTPUT the" << std::endl;
+        std::cout << "data is decoded and dropped, to measure the throughput of the stream alone." << std::endl;
+        return -1;
+    }
+    std::string address = argv[n];
+    const char *output = argc - n > 1 ? argv[n + 1] : NULL;
+    const char *group = argc - n > 2 ? argv[n + 2] : "dataset";
+    std::string var = argc - n > 3 ? argv[n + 3] : "images";
+
+    int fd = -1;
+    try {
+        std::unique_ptr<Dataset> dset;
+        if (output) {
+            dset.reset(new Dataset(output, group, true));
+        }
+        fd = accept_one(address, buffer_bytes);
+
+        Clock::time_point start = Clock::now();
+        Receiver receiver(dset.get(), var, batch_size);
+        uint64_t bytes = 0;
+        bool closed = false;
+        MessageFrame frame;
+        std::string xml;
+        while (!closed && readMessageFrame(fd, frame)) {
+            bytes += sizeof(frame) + frame.length;
+            switch (frame.id) {
+            case ISMRMRD_MESSAGE_HEADER:
+                deserializeHeader(fd, frame, xml);
+                if (dset) {
+                    dset->writeHeader(xml);
+                }
+                break;
+            case ISMRMRD_MESSAGE_ACQUISITION:
+                receiver.acquisition(fd, frame);
+                break;
+            case ISMRMRD_MESSAGE_WAVEFORM:
+                receiver.waveform(fd, frame);
+                break;
+            case ISMRMRD_MESSAGE_IMAGE:
+                receiver.image(fd, frame);
+                break;
+            case ISMRMRD_MESSAGE_CLOSE:
+                closed = true;
+                break;
+            default:
+                skipMessage(fd, frame);
+                break;
+            }
+        }
+        receiver.flush();
+        double seconds = seconds_since(start);
+        if (!closed) {
+            std::cerr << "The sender disconnected before the end of the stream" << std::endl;
+        }
+        std::cout << receiver.readouts() << " acquisitions, " << receiver.waveforms() << " waveforms, "
+                  << receiver.images() << " images" << std::endl;
+        report("Received", bytes, receiver.readouts(), seconds);
+        if (dset) {
+            dset->flush();
+        }
+        close(fd);
+        return closed ? 0 : -1;
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+}
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+#include "ismrmrd/serialization.h"
+#include "stream_socket.h"
+
+using namespace ISMRMRD;
+using namespace stream_socket;
+
+// Batches of acquisitions read ahead of the socket. put() blocks while the
+// queue is full, so a slow receiver stalls the reader instead of the
+// batches piling up in memory.
+class BatchQueue
+{
+public:
+    explicit BatchQueue(size_t depth) : depth_(depth), done_(false), cancelled_(false) { }
+
+    // Returns false once the sender has given up, the reader should stop
+    bool put(std::vector<Acquisition> &batch) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return batches_.size() < depth_ || cancelled_; });
+        if (cancelled_) {
+            return false;
+        }
+        batches_.push_back(std::vector<Acquisition>());
+        batches_.back().swap(batch);
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Returns false once the reader is done and the queue is empty
+    bool get(std::vector<Acquisition> &batch) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return !batches_.empty() || done_; });
+        if (batches_.empty()) {
+            return false;
+        }
+        batch.swap(batches_.front());
+        batches_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+        not_empty_.notify_all();
+    }
+
+    // Drops the queued batches and stops the reader at its next put()
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+        batches_.clear();
+        not_full_.notify_all();
+    }
+
+private:
+    size_t depth_;
+    bool done_;
+    bool cancelled_;
+    std::deque<std::vector<Acquisition> > batches_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+static uint64_t message_size(size_t body)
+{
+    return sizeof(MessageFrame) + body;
+}
+
+static uint64_t send_acquisitions(Dataset &dset, int fd, uint32_t batch_size, size_t depth, uint64_t &readouts)
+{
+    uint32_t nacq = dset.getNumberOfAcquisitions();
+    BatchQueue queue(depth);
+    std::string error;
+
+    std::thread reader([&]() {
+        try {
+            for (uint32_t start = 0; start < nacq; start += batch_size) {
+                std::vector<Acquisition> batch;
+                dset.readAcquisitions(start, std::min(batch_size, nacq - start), batch);
+                if (!queue.put(batch)) {
+                    break;
+                }
+            }
+        } catch (std::exception &e) {
+            error = e.what();
+        }
+        queue.finish();
+    });
+
+    uint64_t bytes = 0;
+    std::vector<Acquisition> batch;
+    try {
+        while (queue.get(batch)) {
+            for (size_t n = 0; n < batch.size(); n++) {
+                serialize(batch[n], fd);
+                bytes += message_size(sizeof(ISMRMRD_AcquisitionHeader) + batch[n].getTrajSize() + batch[n].getDataSize());
+            }
+            readouts += batch.size();
+        }
+    } catch (...) {
+        // Stop the reader after the batch it is reading, so that it can be joined
+        queue.cancel();
+        reader.join();
+        throw;
+    }
+    reader.join();
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+    return bytes;
+}
+
+static uint64_t send_waveforms(Dataset &dset, int fd)
+{
+    uint32_t nwav = dset.getNumberOfWaveforms();
+    uint64_t bytes = 0;
+    Waveform wav;
+    for (uint32_t n = 0; n < nwav; n++) {
+        dset.readWaveform(n, wav);
+        serialize(wav, fd);
+        bytes += message_size(sizeof(ISMRMRD_WaveformHeader) + ismrmrd_size_of_waveform_data(&wav));
+    }
+    return bytes;
+}
+
+// Images are read through the C API, which returns them in their stored
+// data type, and copied into an Image of that type
+template <typename T>
+static uint64_t send_image(const ISMRMRD_Image &cim, Image<T> &im, int fd)
+{
+    ImageHeader head;
+    static_cast<ISMRMRD_ImageHeader &>(head) = cim.head;
+    im.setHead(head);
+    memcpy(im.getDataPtr(), cim.data, im.getDataSize());
+    im.setAttributeString(std::string(cim.attribute_string ? cim.attribute_string : "", cim.head.attribute_string_len));
+    serialize(im, fd);
+    return message_size(sizeof(ISMRMRD_ImageHeader) + im.getAttributeStringLength() + im.getDataSize());
+}
+
+static uint64_t send_images(const char *filename, const char *group, const char *var, int fd)
+{
+    ISMRMRD_Dataset dset;
+    if (ismrmrd_init_dataset(&dset, filename, group) != ISMRMRD_NOERROR ||
+        ismrmrd_open_dataset(&dset, false) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    uint32_t nims = ismrmrd_get_number_of_images(&dset, var);
+    uint64_t bytes = 0;
+    ISMRMRD_Image cim;
+    ismrmrd_init_image(&cim);
+    Image<uint16_t> im_ushort;
+    Image<int16_t> im_short;
+    Image<uint32_t> im_uint;
+    Image<int32_t> im_int;
+    Image<float> im_float;
+    Image<double> im_double;
+    Image<complex_float_t> im_cxfloat;
+    Image<complex_double_t> im_cxdouble;
+    try {
+        for (uint32_t n = 0; n < nims; n++) {
+            if (ismrmrd_read_image(&dset, var, n, &cim) != ISMRMRD_NOERROR) {
+                throw std::runtime_error(build_exception_string());
+            }
+            switch (cim.head.data_type) {
+            case ISMRMRD_USHORT: bytes += send_image(cim, im_ushort, fd); break;
+            case ISMRMRD_SHORT: bytes += send_image(cim, im_short, fd); break;
+            case ISMRMRD_UINT: bytes += send_image(cim, im_uint, fd); break;
+            case ISMRMRD_INT: bytes += send_image(cim, im_int, fd); break;
+            case ISMRMRD_FLOAT: bytes += send_image(cim, im_float, fd); break;
+            case ISMRMRD_DOUBLE: bytes += send_image(cim, im_double, fd); break;
+            case ISMRMRD_CXFLOAT: bytes += send_image(cim, im_cxfloat, fd); break;
+            case ISMRMRD_CXDOUBLE: bytes += send_image(cim, im_cxdouble, fd); break;
+            default: throw std::runtime_error("Invalid image data type");
+            }
+        }
+    } catch (...) {
+        ismrmrd_cleanup_image(&cim);
+        ismrmrd_close_dataset(&dset);
+        throw;
+    }
+    ismrmrd_cleanup_image(&cim);
+    ismrmrd_close_dataset(&dset);
+    std::cout << var << ": " << nims << " images" << std::endl;
+    return bytes;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t batch_size = 256;
+    size_t depth = 4;
+    int buffer_bytes = 0;
+    int n = 1;
+    try {
+        for (; n < argc && argv[n][0] == '-'; n++) {
+            std::string option = argv[n];
+            if (option == "-b") {
+                batch_size = static_cast<uint32_t>(option_value(argc, argv, n));
+            } else if (option == "-q") {
+                depth = option_value(argc, argv, n);
+            } else if (option == "-s") {
+                buffer_bytes = static_cast<int>(option_value(argc, argv, n));
+            } else {
+                throw std::runtime_error("Unknown option " + option);
+            }
+        }
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+    if (argc - n < 2 || batch_size == 0 || depth == 0) {
+        std::cout << "Streams a dataset to ismrmrd_stream_recv" << std::endl;
+        std::cout << "Usage: " << std::endl;
+        std::cout << "  " << argv[0] << " [-b BATCH] [-q DEPTH] [-s SOCKET_BUFFER] <ADDRESS> <INPUT> [GROUP] [VARIABLE...]" << std::endl;
+        std::cout << "ADDRESS is unix:PATH or tcp:HOST:PORT. The header, acquisitions and waveforms" << std::endl;
+        std::cout << "are always sent, the image variables only when they are listed. Acquisitions" << std::endl;
+        std::cout << "are read BATCH at a time (256) with up to DEPTH batches (4) queued for the socket." << std::endl;
+        return -1;
+    }
+    std::string address = argv[n];
+    const char *filename = argv[n + 1];
+    const char *group = argc - n > 2 ? argv[n + 2] : "dataset";
+
+    ignore_sigpipe();
+    int fd = -1;
+    try {
+        Dataset dset(filename, group, false);
+        fd = connect_to(address, buffer_bytes);
+
+        Clock::time_point start = Clock::now();
+        uint64_t bytes = 0;
+        uint64_t readouts = 0;
+        std::string xml;
+        try {
+            dset.readHeader(xml);
+        } catch (std::runtime_error &) {
+            // A dataset without a header is still sent
+            xml.clear();
+        }
+        if (!xml.empty()) {
+            serializeHeader(xml, fd);
+            bytes += message_size(xml.size());
+        }
+        bytes += send_acquisitions(dset, fd, batch_size, depth, readouts);
+        bytes += send_waveforms(dset, fd);
+        for (int v = n + 3; v < argc; v++) {
+            bytes += send_images(filename, group, argv[v], fd);
+        }
+        serializeClose(fd);
+        bytes += message_size(0);
+        report("Sent", bytes, readouts, seconds_since(start));
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,213 @@
+#ifndef ISMRMRD_STREAM_SOCKET_H
+#define ISMRMRD_STREAM_SOCKET_H
+
+// Socket helpers shared by ismrmrd_stream_send and ismrmrd_stream_recv.
+// Addresses are either unix:PATH for a Unix-domain socket or
+// tcp:HOST:PORT, HOST usually being 127.0.0.1.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace stream_socket {
+
+typedef std::chrono::steady_clock Clock;
+
+inline double seconds_since(const Clock::time_point &start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+inline std::runtime_error socket_error(const std::string &what)
+{
+    return std::runtime_error(what + ": " + strerror(errno));
+}
+
+// Closes fd, keeping the errno of the call that failed for the error
+inline std::runtime_error close_with_error(int fd, const std::string &what)
+{
+    int saved = errno;
+    if (fd >= 0) {
+        close(fd);
+    }
+    errno = saved;
+    return socket_error(what);
+}
+
+inline bool is_unix_address(const std::string &address)
+{
+    return address.compare(0, 5, "unix:") == 0;
+}
+
+inline sockaddr_un unix_address(const std::string &address)
+{
+    std::string path = address.substr(5);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Invalid socket path: " + path);
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+inline addrinfo *tcp_address(const std::string &address, bool passive)
+{
+    if (address.compare(0, 4, "tcp:") != 0) {
+        throw std::runtime_error("Addresses are unix:PATH or tcp:HOST:PORT, not " + address);
+    }
+    std::string rest = address.substr(4);
+    size_t colon = rest.rfind(':');
+    if (colon == std::string::npos) {
+        throw std::runtime_error("Missing port in " + address);
+    }
+    std::string host = rest.substr(0, colon);
+    std::string port = rest.substr(colon + 1);
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    addrinfo *info = NULL;
+    int status = getaddrinfo(host.empty() ? NULL : host.c_str(), port.c_str(), &hints, &info);
+    if (status != 0) {
+        throw std::runtime_error("Cannot resolve " + address + ": " + gai_strerror(status));
+    }
+    return info;
+}
+
+// A receiver that goes away makes sends fail with EPIPE instead of killing the
+// sender. The library writes with writev, which takes no MSG_NOSIGNAL, so
+// SIGPIPE is ignored for the whole process.
+inline void ignore_sigpipe()
+{
+    signal(SIGPIPE, SIG_IGN);
+}
+
+// Socket buffers are sized to hold a few batches, the sender blocks once
+// they are full, which is what pushes back on it when the receiver is slow.
+inline void set_buffer_sizes(int fd, int bytes)
+{
+    if (bytes > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    }
+}
+
+// Listens on address and returns the first connection
+inline int accept_one(const std::string &address, int buffer_bytes)
+{
+    int listener = -1;
+    if (is_unix_address(address)) {
+        sockaddr_un addr = unix_address(address);
+        // Only a socket left behind by an earlier run is replaced
+        struct stat st;
+        if (lstat(addr.sun_path, &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                throw std::runtime_error("Cannot bind " + address + ": not a socket");
+            }
+            if (unlink(addr.sun_path) != 0) {
+                throw socket_error("Cannot remove " + address);
+            }
+        }
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            throw close_with_error(listener, "Cannot bind " + address);
+        }
+    } else {
+        addrinfo *info = tcp_address(address, true);
+        listener = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        int one = 1;
+        if (listener >= 0) {
+            setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        }
+        if (listener < 0 || bind(listener, info->ai_addr, info->ai_addrlen) != 0) {
+            freeaddrinfo(info);
+            throw close_with_error(listener, "Cannot bind " + address);
+        }
+        freeaddrinfo(info);
+    }
+    set_buffer_sizes(listener, buffer_bytes);
+    if (listen(listener, 1) != 0) {
+        throw close_with_error(listener, "Cannot listen on " + address);
+    }
+    std::cout << "Listening on " << address << std::endl;
+    int fd = accept(listener, NULL, NULL);
+    close(listener);
+    if (is_unix_address(address)) {
+        unlink(unix_address(address).sun_path);
+    }
+    if (fd < 0) {
+        throw socket_error("Cannot accept on " + address);
+    }
+    return fd;
+}
+
+// Connects to address, retrying for a few seconds while the receiver starts
+inline int connect_to(const std::string &address, int buffer_bytes)
+{
+    for (int attempt = 0; ; attempt++) {
+        int fd = -1;
+        int status = -1;
+        if (is_unix_address(address)) {
+            sockaddr_un addr = unix_address(address);
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            set_buffer_sizes(fd, buffer_bytes);
+            status = connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+        } else {
+            addrinfo *info = tcp_address(address, false);
+            fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+            set_buffer_sizes(fd, buffer_bytes);
+            status = connect(fd, info->ai_addr, info->ai_addrlen);
+            freeaddrinfo(info);
+        }
+        if (status == 0) {
+            return fd;
+        }
+        int error = errno;
+        if (fd >= 0) {
+            close(fd);
+        }
+        errno = error;
+        if (attempt == 50 || (errno != ENOENT && errno != ECONNREFUSED)) {
+            throw socket_error("Cannot connect to " + address);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+// Parses the value of a numeric option
+inline size_t option_value(int argc, char **argv, int &n)
+{
+    if (n + 1 >= argc) {
+        throw std::runtime_error(std::string("Missing value for ") + argv[n]);
+    }
+    return static_cast<size_t>(std::strtoul(argv[++n], NULL, 10));
+}
+
+inline void report(const char *what, uint64_t bytes, uint64_t readouts, double seconds)
+{
+    std::cout << what << " " << bytes / 1e6 << " MB, " << readouts << " readouts in " << seconds << " s: "
+              << bytes / 1e6 / seconds << " MB/s, " << readouts / seconds << " readouts/s" << std::endl;
+}
+
+} // namespace stream_socket
+
+#endif // ISMRMRD_STREAM_SOCKET_H
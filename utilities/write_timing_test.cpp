@@ -0,0 +1,138 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(const Clock::time_point &start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void fill_acquisitions(std::vector<ISMRMRD::Acquisition> &acqs, uint16_t samples, uint16_t channels)
+{
+    for (size_t n = 0; n < acqs.size(); n++) {
+        acqs[n].resize(samples, channels);
+        acqs[n].scan_counter() = static_cast<uint32_t>(n);
+        complex_float_t *p = acqs[n].getDataPtr();
+        for (size_t k = 0; k < acqs[n].getNumberOfDataElements(); k++) {
+            p[k] = complex_float_t(static_cast<float>(n), static_cast<float>(k));
+        }
+    }
+}
+
+static void report(const char *name, size_t nreadouts, size_t bytes, double secs)
+{
+    std::cout << name << ": " << secs * 1000.0 << " ms, "
+              << nreadouts / secs << " readouts/s, "
+              << bytes / secs / (1024.0 * 1024.0) << " MB/s" << std::endl;
+}
+
+static void report_latency(const ISMRMRD::AsyncWriterStats &stats)
+{
+    std::cout << "  " << stats.batches << " batches, deepest queue " << stats.max_queued
+              << ", " << stats.full_waits << " appends waited for room" << std::endl;
+    std::cout << "  enqueue to durable latency: p50 < " << stats.latencyPercentile(0.5)
+              << " us, p99 < " << stats.latencyPercentile(0.99)
+              << " us, max < " << stats.latencyPercentile(1.0) << " us" << std::endl;
+    for (int k = 0; k < ISMRMRD::AsyncWriterStats::LATENCY_BUCKETS; k++) {
+        if (stats.latency[k] > 0) {
+            std::cout << "    < " << (uint64_t(1) << (k + 1)) << " us: " << stats.latency[k] << std::endl;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::cout << "File writer timing test" << std::endl;
+
+    if (argc < 2) {
+        std::cout << "Usage: " << std::endl;
+        std::cout << "  " << argv[0] << " <FILENAME> [READOUTS] [SAMPLES] [CHANNELS] [BATCH] [RATE_HZ]" << std::endl;
+        return -1;
+    }
+
+    std::string filename(argv[1]);
+    size_t nreadouts = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 10000;
+    uint16_t samples = argc > 3 ? static_cast<uint16_t>(std::atoi(argv[3])) : 256;
+    uint16_t channels = argc > 4 ? static_cast<uint16_t>(std::atoi(argv[4])) : 32;
+    size_t batch = argc > 5 ? std::strtoul(argv[5], NULL, 10) : 128;
+    if (batch == 0) {
+        batch = 1;
+    }
+    // Readout rate of the asynchronous test, 0 is as fast as possible
+    double rate = argc > 6 ? std::atof(argv[6]) : 0.0;
+
+    std::cout << "Writing " << nreadouts << " readouts of " << samples << " samples x "
+              << channels << " channels, batches of " << batch << std::endl;
+
+    std::vector<ISMRMRD::Acquisition> acqs(batch);
+    fill_acquisitions(acqs, samples, channels);
+    size_t bytes = nreadouts * acqs[0].getDataSize();
+
+    // One call per readout
+    {
+        std::remove(filename.c_str());
+        ISMRMRD::Dataset d(filename.c_str(), "dataset", true);
+        Clock::time_point start = Clock::now();
+        for (size_t n = 0; n < nreadouts; n++) {
+            d.appendAcquisition(acqs[n % batch]);
+        }
+        report("SINGLE APPEND", nreadouts, bytes, seconds_since(start));
+    }
+
+    // One call per batch
+    {
+        std::remove(filename.c_str());
+        ISMRMRD::Dataset d(filename.c_str(), "dataset", true);
+        // The last, partial batch is copied before the clock starts
+        std::vector<ISMRMRD::Acquisition> rest(acqs.begin(), acqs.begin() + nreadouts % batch);
+        Clock::time_point start = Clock::now();
+        size_t written = 0;
+        while (written + batch <= nreadouts) {
+            d.appendAcquisitions(acqs);
+            written += batch;
+        }
+        if (!rest.empty()) {
+            d.appendAcquisitions(rest);
+        }
+        report("BATCHED APPEND", nreadouts, bytes, seconds_since(start));
+    }
+
+    // Queued on this thread, written on the writer's. The producer time includes
+    // the copy which stands in for receiving the readout.
+    {
+        std::remove(filename.c_str());
+        ISMRMRD::AsyncWriter writer(filename.c_str(), "dataset", 4 * batch);
+        Clock::time_point start = Clock::now();
+        double append_secs = 0;
+        for (size_t n = 0; n < nreadouts; n++) {
+            if (rate > 0) {
+                std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(n / rate)));
+            }
+            Clock::time_point append_start = Clock::now();
+            ISMRMRD::Acquisition acq(acqs[n % batch]);
+            writer.append(std::move(acq));
+            append_secs += seconds_since(append_start);
+        }
+        writer.close();
+        report("ASYNC APPEND", nreadouts, bytes, seconds_since(start));
+        std::cout << "  producer busy " << append_secs * 1000.0 << " ms ("
+                  << append_secs * 1e6 / nreadouts << " us/readout)";
+        if (rate > 0) {
+            std::cout << " at " << rate << " readouts/s";
+        }
+        std::cout << std::endl;
+        report_latency(writer.stats());
+    }
+
+    return 0;
+}